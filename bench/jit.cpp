@@ -0,0 +1,226 @@
+/**
+ * @file jit.cpp
+ * @brief `jit::Jit` でコンパイルした音，`render::Graph` でブロックごとに評価した音（演算を融合したものとしないもの），
+ * 音のグラフを標本ごとに辿る素朴な解釈器の速さを比べる．
+ *
+ * 使い方: `bench/jit <file.cryss> [秒数] [ブロックの大きさ]`
+ * トップレベルの文（`main`）を `vm::Machine` で実行し，変数に入った音を 48 kHz で指定秒数だけ書き出す．
+ * 解釈器は音の中の関数の呼び出しを `vm::Machine` で実行する．出力が一致することも確かめる．
+ * 環境変数 `CRYSS_CACHE_DIR` があれば，コンパイルしたコードをそこにキャッシュする．
+ */
+#include "../source/check.hpp"
+#include "../source/error.hpp"
+#include "../source/input.hpp"
+#include "../source/ir.hpp"
+#include "../source/jit.hpp"
+#include "../source/lexer.hpp"
+#include "../source/lower.hpp"
+#include "../source/parser.hpp"
+#include "../source/render.hpp"
+#include "../source/vm.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <variant>
+#include <vector>
+
+namespace {
+    using Value = std::variant<bool, std::int64_t, double>;
+    constexpr double rate = 48000.0;
+
+    /**
+     * @brief 音のグラフを標本ごとに `dynamic_cast` で辿る解釈器
+     */
+    class Interpreter {
+        vm::Machine &machine;
+        const type::TypeContext &types;
+        Value prim(const ir::Prim &, const std::vector<Value> &);
+    public:
+        Interpreter(vm::Machine &machine, const type::TypeContext &types): machine(machine), types(types) {}
+        Value eval(const ir::Sound &, double);
+    };
+
+    double number(const Value &value){
+        if(auto i = std::get_if<std::int64_t>(&value)) return static_cast<double>(*i);
+        if(auto b = std::get_if<bool>(&value)) return *b;
+        return std::get<double>(value);
+    }
+
+    Value Interpreter::prim(const ir::Prim &prim, const std::vector<Value> &args){
+        auto type = prim.get_operand();
+        auto i = [&](std::size_t n){ return std::get<std::int64_t>(args[n]); };
+        auto f = [&](std::size_t n){ return number(args[n]); };
+        auto b = [&](std::size_t n){ return std::get<bool>(args[n]); };
+        bool is_int = type == type::int_id, is_bool = type == type::bool_id;
+        switch(prim.get_op()){
+            case ir::Op::Cast: return is_int && prim.get_result() != type::int_id ? Value{f(0)} : args[0];
+            case ir::Op::Neg: return is_int ? Value{static_cast<std::int64_t>(-static_cast<std::uint64_t>(i(0)))} : Value{-f(0)};
+            case ir::Op::Recip: return 1.0 / f(0);
+            case ir::Op::Not: return !b(0);
+            case ir::Op::BitNot: return ~i(0);
+            case ir::Op::Add: return is_int ? Value{static_cast<std::int64_t>(static_cast<std::uint64_t>(i(0)) + static_cast<std::uint64_t>(i(1)))} : Value{f(0) + f(1)};
+            case ir::Op::Sub: return is_int ? Value{static_cast<std::int64_t>(static_cast<std::uint64_t>(i(0)) - static_cast<std::uint64_t>(i(1)))} : Value{f(0) - f(1)};
+            case ir::Op::Mul: return is_int ? Value{static_cast<std::int64_t>(static_cast<std::uint64_t>(i(0)) * static_cast<std::uint64_t>(i(1)))} : Value{f(0) * f(1)};
+            case ir::Op::Div: return f(0) / f(1);
+            case ir::Op::Rem:
+                if(!is_int) return std::fmod(f(0), f(1));
+                return i(1) == 0 || i(1) == -1 ? std::int64_t{0} : i(0) % i(1);
+            case ir::Op::LeftShift: return static_cast<std::int64_t>(static_cast<std::uint64_t>(i(0)) << (i(1) & 63));
+            case ir::Op::RightShift: return i(0) >> (i(1) & 63);
+            case ir::Op::Equal: return is_bool ? b(0) == b(1) : is_int ? i(0) == i(1) : f(0) == f(1);
+            case ir::Op::NotEqual: return is_bool ? b(0) != b(1) : is_int ? i(0) != i(1) : f(0) != f(1);
+            case ir::Op::Less: return is_int ? i(0) < i(1) : f(0) < f(1);
+            case ir::Op::LessEqual: return is_int ? i(0) <= i(1) : f(0) <= f(1);
+            case ir::Op::Greater: return is_int ? i(0) > i(1) : f(0) > f(1);
+            case ir::Op::GreaterEqual: return is_int ? i(0) >= i(1) : f(0) >= f(1);
+            case ir::Op::And: return b(0) && b(1);
+            case ir::Op::Or: return b(0) || b(1);
+            case ir::Op::BitAnd: return is_bool ? Value{b(0) && b(1)} : Value{i(0) & i(1)};
+            case ir::Op::BitOr: return is_bool ? Value{b(0) || b(1)} : Value{i(0) | i(1)};
+            case ir::Op::BitXor: return is_bool ? Value{b(0) != b(1)} : Value{i(0) ^ i(1)};
+            case ir::Op::Sin: return std::sin(f(0));
+            case ir::Op::Cos: return std::cos(f(0));
+            case ir::Op::Tan: return std::tan(f(0));
+            case ir::Op::Exp: return std::exp(f(0));
+            case ir::Op::Log: return std::log(f(0));
+            case ir::Op::Sqrt: return std::sqrt(f(0));
+            case ir::Op::Floor: return std::floor(f(0));
+            case ir::Op::Abs: return std::fabs(f(0));
+            default: std::abort();
+        }
+    }
+
+    Value Interpreter::eval(const ir::Sound &sound, double time){
+        if(dynamic_cast<const ir::T *>(&sound)) return time;
+        if(auto c = dynamic_cast<const ir::Const *>(&sound)){
+            auto &value = *c->get_value();
+            if(auto v = dynamic_cast<const ir::Bool *>(&value)) return v->get_value();
+            if(auto v = dynamic_cast<const ir::Int *>(&value)) return v->get_value();
+            if(auto v = dynamic_cast<const ir::Float *>(&value)) return v->get_value();
+            auto &r = dynamic_cast<const ir::Rational &>(value);
+            return static_cast<double>(r.get_numer()) / static_cast<double>(r.get_denom());
+        }
+        auto &app = dynamic_cast<const ir::App &>(sound);
+        auto &args = app.get_args();
+        if(auto p = dynamic_cast<const ir::Prim *>(app.get_func().get())){
+            if(p->get_op() == ir::Op::Delay) return eval(*args[0], time - number(eval(*args[1], time)));
+            if(p->get_op() == ir::Op::Advance) return eval(*args[0], time + number(eval(*args[1], time)));
+            std::vector<Value> values;
+            for(auto &arg : args) values.push_back(eval(*arg, time));
+            return prim(*p, values);
+        }
+        auto &ref = dynamic_cast<const ir::DefRef &>(*app.get_func());
+        std::vector<vm::Reg> regs;
+        for(auto &arg : args){
+            auto value = eval(*arg, time);
+            vm::Reg reg{};
+            if(auto b = std::get_if<bool>(&value)) reg.b = *b;
+            else if(auto i = std::get_if<std::int64_t>(&value)) reg.i = *i;
+            else reg.f = std::get<double>(value);
+            regs.push_back(reg);
+        }
+        auto ret = machine.call(ref.get_index(), regs);
+        auto type = dynamic_cast<const type::Sound &>(types.get(sound.get_type())).get_result();
+        if(type == type::bool_id) return ret.b;
+        if(type == type::int_id) return ret.i;
+        return ret.f;
+    }
+}
+
+int main(int argc, char **argv){
+    if(argc < 2){
+        std::cerr << "usage: " << argv[0] << " <file.cryss> [seconds] [block]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 1.0;
+    auto frames = static_cast<std::size_t>(seconds * rate);
+    std::size_t block = std::max<std::size_t>(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : render::default_block, 1);
+    input::MappedFile source(argv[1]);
+    if(!source){
+        std::cerr << "cannot open file `" << argv[1] << "`" << std::endl;
+        return EXIT_FAILURE;
+    }
+    ast::Arena arena;
+    std::vector<ast::TopLevel *> items;
+    type::TypeContext types;
+    check::Defs defs;
+    ir::Module module;
+    try {
+        lexer::Lexer lexer(source);
+        parser::Parser parser(lexer, arena);
+        while(auto item = parser.parse_top_level()) items.push_back(item);
+        check::check_program(types, defs, items, 1);
+        module = lower::lower_program(types, defs, items);
+
+        vm::Machine machine(types, module);
+        if(!machine.compiled(machine.main_index())){
+            std::cout << "main uses values the VM does not support" << std::endl;
+            return EXIT_FAILURE;
+        }
+        machine.call(machine.main_index(), {});
+        auto regs = machine.registers(machine.main_index());
+        std::vector<std::shared_ptr<ir::Sound>> sounds;
+        auto &slots = module.main->get_slots();
+        for(std::size_t i = 0; i < slots.size(); i++){
+            if(dynamic_cast<const type::Sound *>(&types.get(slots[i]))) sounds.push_back(machine.sound(regs[i]));
+        }
+        std::cout << sounds.size() << " sounds, " << seconds << " s at " << rate << " Hz" << std::endl;
+
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        jit::Jit jit(types, module, std::getenv("CRYSS_CACHE_DIR"));
+        std::vector<jit::Render> renders;
+        for(auto &sound : sounds) renders.push_back(jit.compile(*sound));
+        std::chrono::duration<double, std::milli> compile_time = clock::now() - start;
+
+        std::vector<render::Graph> graphs, unfused;
+        std::size_t buffers = 0, unfused_buffers = 0;
+        for(auto &sound : sounds){
+            graphs.emplace_back(machine, types, *sound, block);
+            unfused.emplace_back(machine, types, *sound, block, false);
+            buffers += graphs.back().buffers();
+            unfused_buffers += unfused.back().buffers();
+        }
+
+        std::vector<float> native(frames), blocked(frames), separate(frames), interpreted(frames);
+        std::chrono::duration<double, std::milli> native_time{0}, blocked_time{0}, separate_time{0}, interpreted_time{0};
+        Interpreter interpreter(machine, types);
+        for(std::size_t s = 0; s < sounds.size(); s++){
+            start = clock::now();
+            renders[s](native.data(), frames, 0.0, rate);
+            native_time += clock::now() - start;
+            start = clock::now();
+            graphs[s].render(blocked.data(), frames, 0.0, rate);
+            blocked_time += clock::now() - start;
+            start = clock::now();
+            unfused[s].render(separate.data(), frames, 0.0, rate);
+            separate_time += clock::now() - start;
+            start = clock::now();
+            for(std::size_t i = 0; i < frames; i++){
+                interpreted[i] = static_cast<float>(number(interpreter.eval(*sounds[s], static_cast<double>(i) * (1.0 / rate))));
+            }
+            interpreted_time += clock::now() - start;
+            for(std::size_t i = 0; i < frames; i++){
+                if(std::fabs(native[i] - interpreted[i]) > 1e-4f * std::max(1.0f, std::fabs(interpreted[i]))){
+                    std::cout << "MISMATCH: sound " << s << " frame " << i << ": " << native[i] << " != " << interpreted[i] << std::endl;
+                    return EXIT_FAILURE;
+                }
+                if(blocked[i] != interpreted[i] || separate[i] != interpreted[i]){
+                    std::cout << "MISMATCH: sound " << s << " frame " << i << ": block " << blocked[i] << ", " << separate[i] << " != " << interpreted[i] << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        std::cout << "compile     " << compile_time.count() << " ms" << std::endl;
+        std::cout << "interpreter " << interpreted_time.count() << " ms" << std::endl;
+        std::cout << "unfused     " << separate_time.count() << " ms (" << interpreted_time.count() / separate_time.count() << "x), " << unfused_buffers << " buffers" << std::endl;
+        std::cout << "fused       " << blocked_time.count() << " ms (" << interpreted_time.count() / blocked_time.count() << "x), " << buffers << " buffers, block " << block << std::endl;
+        std::cout << "jit         " << native_time.count() << " ms (" << interpreted_time.count() / native_time.count() << "x)" << std::endl;
+        std::cout << "realtime    " << seconds * 1000.0 * static_cast<double>(sounds.size()) / native_time.count() << " voices" << std::endl;
+    }catch(std::unique_ptr<error::Error> &error){
+        error->eprint(source);
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,157 @@
+/**
+ * @file parse.cpp
+ * @brief 字句解析と構文解析の速さを測る．
+ *
+ * 使い方: `bench/parse [file.cryss] [回数]`
+ * ファイルを指定しなければ，二項演算の多い式の文と数値のリストの文を生成して一時ファイルに書き，それぞれを測る．
+ * 字句解析だけの時間と，構文解析までの時間をそれぞれ指定回数測り，最短の時間を出力する．
+ * 構文解析の時間は両者の差で，AST の確保も含む．
+ */
+#include "../source/ast.hpp"
+#include "../source/error.hpp"
+#include "../source/input.hpp"
+#include "../source/lexer.hpp"
+#include "../source/parser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <unistd.h>
+
+namespace {
+    using clock = std::chrono::steady_clock;
+    using milliseconds = std::chrono::duration<double, std::milli>;
+
+    /**
+     * @brief 入れ子の二項演算の式を生成する．
+     */
+    void expression(std::mt19937 &random, std::string &out, int depth){
+        static const char *const names[] = {"a", "b", "gain", "freq", "x1", "y2"};
+        static const char *const operators[] = {" + ", " - ", " * ", " / ", " % ", " << ", " >> ", " & ", " | ", " ^ ", " < ", " <= ", " == ", " != ", " && ", " || "};
+        if(depth == 0 || random() % 4 == 0){
+            if(random() % 2) out += names[random() % std::size(names)];
+            else out += std::to_string(random() % 1000);
+            return;
+        }
+        bool paren = random() % 3 == 0;
+        if(paren) out += '(';
+        expression(random, out, depth - 1);
+        out += operators[random() % std::size(operators)];
+        expression(random, out, depth - 1);
+        if(paren) out += ')';
+    }
+
+    /**
+     * @brief 生成したソースコードを一時ファイルに書き，そのパスを返す．
+     * @param lists `true` なら数値のリストの文，`false` なら二項演算の式の文
+     */
+    std::string generate(bool lists, std::size_t lines){
+        char path[] = "/tmp/cryss-bench-parse-XXXXXX";
+        int fd = mkstemp(path);
+        if(fd < 0){
+            std::perror("mkstemp");
+            std::exit(EXIT_FAILURE);
+        }
+        close(fd);
+        std::mt19937 random(1);
+        std::ofstream file(path);
+        std::string line;
+        for(std::size_t i = 0; i < lines; i++){
+            line = "v = ";
+            if(lists){
+                line += '[';
+                for(int k = 0; k < 16; k++){
+                    if(k) line += ", ";
+                    line += std::to_string(random() % 100000);
+                }
+                line += ']';
+            }else expression(random, line, 5);
+            line += ";\n";
+            file << line;
+        }
+        return path;
+    }
+
+    /**
+     * @brief ファイルを最後まで字句解析し，トークンの数を返す．
+     */
+    std::size_t lex(const char *path){
+        input::MappedFile source(path);
+        lexer::Lexer lexer(source);
+        std::size_t tokens = 0;
+        try {
+            while(lexer.peek().kind != token::Kind::End){
+                lexer.next();
+                tokens++;
+            }
+        }catch(std::unique_ptr<error::Error> &error){
+            error->eprint(source);
+            std::exit(EXIT_FAILURE);
+        }
+        return tokens;
+    }
+
+    /**
+     * @brief ファイルを最後まで構文解析し，トップレベルの要素の数を返す．
+     */
+    std::size_t parse(const char *path){
+        input::MappedFile source(path);
+        lexer::Lexer lexer(source);
+        ast::Arena arena;
+        parser::Parser parser(lexer, arena);
+        std::size_t items = 0;
+        try {
+            while(parser.parse_top_level()) items++;
+        }catch(std::unique_ptr<error::Error> &error){
+            error->eprint(source);
+            std::exit(EXIT_FAILURE);
+        }
+        return items;
+    }
+
+    template<class F> double best(int repeat, F f){
+        auto ret = milliseconds::max();
+        for(int i = 0; i < repeat; i++){
+            auto start = clock::now();
+            f();
+            ret = std::min<milliseconds>(ret, clock::now() - start);
+        }
+        return ret.count();
+    }
+
+    void measure(const char *label, const char *path, int repeat){
+        input::MappedFile source(path);
+        if(!source){
+            std::cerr << "cannot open file `" << path << "`" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        auto bytes = std::filesystem::file_size(path);
+        auto tokens = lex(path), items = parse(path);
+        auto lex_time = best(repeat, [&]{ lex(path); });
+        auto parse_time = best(repeat, [&]{ parse(path); });
+        std::cout << label << ": " << static_cast<double>(bytes) / 1000000.0 << " MB, " << tokens << " tokens, " << items << " items" << std::endl;
+        std::cout << "  lex         " << lex_time << " ms" << std::endl;
+        std::cout << "  lex + parse " << parse_time << " ms" << std::endl;
+        std::cout << "  parse       " << parse_time - lex_time << " ms (" << static_cast<double>(tokens) / (parse_time - lex_time) / 1000.0 << " M tokens/s)" << std::endl;
+    }
+}
+
+int main(int argc, char **argv){
+    int repeat = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+    if(argc > 1){
+        measure(argv[1], argv[1], repeat);
+        return 0;
+    }
+    for(bool lists : {false, true}){
+        auto path = generate(lists, lists ? 100000 : 200000);
+        measure(lists ? "number lists" : "binary expressions", path.c_str(), repeat);
+        std::remove(path.c_str());
+    }
+}
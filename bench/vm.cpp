@@ -0,0 +1,225 @@
+/**
+ * @file vm.cpp
+ * @brief `vm::Machine` と IR の木をそのまま辿る素朴な解釈器の速さを比べる．
+ *
+ * 使い方: `bench/vm <file.cryss> [回数]`
+ * トップレベルの文（`main`）を両方で指定回数実行し，実行後のスロットの値が一致することも確かめる．
+ */
+#include "../source/check.hpp"
+#include "../source/error.hpp"
+#include "../source/input.hpp"
+#include "../source/ir.hpp"
+#include "../source/lexer.hpp"
+#include "../source/lower.hpp"
+#include "../source/parser.hpp"
+#include "../source/vm.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <variant>
+#include <vector>
+
+namespace {
+    //! `std::monostate` はまだ書いていないスロット
+    using Value = std::variant<std::monostate, bool, std::int64_t, double>;
+
+    /**
+     * @brief `ir::Expr` を仮想関数の呼び出しと `dynamic_cast` で辿る解釈器
+     *
+     * 意味は `vm::Machine` と同じにする（int は 2 の補数で折り返し，シフト量は下位 6 bit）．
+     */
+    class Walker {
+        const ir::Module &module;
+        std::size_t depth = 0;
+        Value eval(const ir::Expr &, std::vector<Value> &);
+        Value prim(const ir::Prim &, const std::vector<Value> &);
+    public:
+        explicit Walker(const ir::Module &module): module(module) {}
+        Value run(const ir::Def &, std::vector<Value> &);
+    };
+
+    std::int64_t wrap(std::uint64_t value){
+        return static_cast<std::int64_t>(value);
+    }
+
+    Value Walker::prim(const ir::Prim &prim, const std::vector<Value> &args){
+        auto type = prim.get_operand();
+        auto i = [&](std::size_t n){ return std::get<std::int64_t>(args[n]); };
+        auto f = [&](std::size_t n){ return std::get<double>(args[n]); };
+        auto b = [&](std::size_t n){ return std::get<bool>(args[n]); };
+        bool is_int = type == type::int_id, is_bool = type == type::bool_id;
+        switch(prim.get_op()){
+            case ir::Op::Cast:
+                if(type == prim.get_result()) return args[0];
+                return static_cast<double>(i(0));
+            case ir::Op::Neg: return is_int ? Value{wrap(-static_cast<std::uint64_t>(i(0)))} : Value{-f(0)};
+            case ir::Op::Recip: return 1.0 / f(0);
+            case ir::Op::Not: return !b(0);
+            case ir::Op::BitNot: return ~i(0);
+            case ir::Op::Add: return is_int ? Value{wrap(static_cast<std::uint64_t>(i(0)) + static_cast<std::uint64_t>(i(1)))} : Value{f(0) + f(1)};
+            case ir::Op::Sub: return is_int ? Value{wrap(static_cast<std::uint64_t>(i(0)) - static_cast<std::uint64_t>(i(1)))} : Value{f(0) - f(1)};
+            case ir::Op::Mul: return is_int ? Value{wrap(static_cast<std::uint64_t>(i(0)) * static_cast<std::uint64_t>(i(1)))} : Value{f(0) * f(1)};
+            case ir::Op::Div: return f(0) / f(1);
+            case ir::Op::Rem:
+                if(!is_int) return std::fmod(f(0), f(1));
+                if(i(1) == 0) throw error::make<error::DivisionByZero>();
+                return i(1) == -1 ? std::int64_t{0} : i(0) % i(1);
+            case ir::Op::LeftShift: return wrap(static_cast<std::uint64_t>(i(0)) << (i(1) & 63));
+            case ir::Op::RightShift: return i(0) >> (i(1) & 63);
+            case ir::Op::Equal: return args[0] == args[1];
+            case ir::Op::NotEqual: return args[0] != args[1];
+            case ir::Op::Less: return is_int ? i(0) < i(1) : f(0) < f(1);
+            case ir::Op::LessEqual: return is_int ? i(0) <= i(1) : f(0) <= f(1);
+            case ir::Op::Greater: return is_int ? i(0) > i(1) : f(0) > f(1);
+            case ir::Op::GreaterEqual: return is_int ? i(0) >= i(1) : f(0) >= f(1);
+            case ir::Op::And: return b(0) && b(1);
+            case ir::Op::Or: return b(0) || b(1);
+            case ir::Op::BitAnd: return is_bool ? Value{b(0) && b(1)} : Value{i(0) & i(1)};
+            case ir::Op::BitOr: return is_bool ? Value{b(0) || b(1)} : Value{i(0) | i(1)};
+            case ir::Op::BitXor: return is_bool ? Value{b(0) != b(1)} : Value{i(0) ^ i(1)};
+            case ir::Op::Sin: return std::sin(f(0));
+            case ir::Op::Cos: return std::cos(f(0));
+            case ir::Op::Tan: return std::tan(f(0));
+            case ir::Op::Exp: return std::exp(f(0));
+            case ir::Op::Log: return std::log(f(0));
+            case ir::Op::Sqrt: return std::sqrt(f(0));
+            case ir::Op::Floor: return std::floor(f(0));
+            case ir::Op::Abs: return std::fabs(f(0));
+            default: std::abort();
+        }
+    }
+
+    Value Walker::eval(const ir::Expr &expr, std::vector<Value> &slots){
+        if(auto var = dynamic_cast<const ir::Var *>(&expr)) return slots[var->get_index()];
+        if(auto subst = dynamic_cast<const ir::Subst *>(&expr)) return slots[subst->get_index()] = eval(subst->get_expr(), slots);
+        if(auto value = dynamic_cast<const ir::Bool *>(&expr)) return value->get_value();
+        if(auto value = dynamic_cast<const ir::Int *>(&expr)) return value->get_value();
+        if(auto value = dynamic_cast<const ir::Float *>(&expr)) return value->get_value();
+        if(auto value = dynamic_cast<const ir::Rational *>(&expr)) return static_cast<double>(value->get_numer()) / static_cast<double>(value->get_denom());
+        auto &call = dynamic_cast<const ir::Call &>(expr);
+        std::vector<Value> args;
+        for(auto &arg : call.get_args()) args.push_back(eval(*arg, slots));
+        if(auto p = dynamic_cast<const ir::Prim *>(call.get_func().get())){
+            // rational のリテラルは既に double にしてある
+            if(p->get_op() == ir::Op::Cast && std::holds_alternative<double>(args[0])) return args[0];
+            return prim(*p, args);
+        }
+        auto &ref = dynamic_cast<const ir::DefRef &>(*call.get_func());
+        return run(*module.defs[ref.get_index()], args);
+    }
+
+    Value Walker::run(const ir::Def &def, std::vector<Value> &slots){
+        if(++depth > 1000) throw error::make<error::StackOverflow>();
+        slots.resize(def.get_slots().size());
+        auto &blocks = def.get_blocks();
+        std::size_t block = 0;
+        for(;;){
+            for(auto &expr : blocks[block].first) eval(*expr, slots);
+            auto &term = *blocks[block].second;
+            if(auto ret = dynamic_cast<const ir::Ret *>(&term)){
+                auto value = ret->get_expr() ? eval(*ret->get_expr(), slots) : Value{};
+                --depth;
+                return value;
+            }
+            if(auto jmp = dynamic_cast<const ir::Jmp *>(&term)) block = jmp->get_dest();
+            else{
+                auto &br = dynamic_cast<const ir::Br &>(term);
+                block = std::get<bool>(eval(br.get_cond(), slots)) ? br.get_dest_true() : br.get_dest_false();
+            }
+        }
+    }
+
+    bool same(const Value &value, vm::Reg reg, type::TypeId type){
+        if(std::holds_alternative<std::monostate>(value)) return true;
+        if(type == type::bool_id) return std::get<bool>(value) == reg.b;
+        if(type == type::int_id) return std::get<std::int64_t>(value) == reg.i;
+        auto f = std::get<double>(value);
+        return std::memcmp(&f, &reg.f, sizeof(f)) == 0;
+    }
+}
+
+int main(int argc, char **argv){
+    if(argc < 2){
+        std::cerr << "usage: " << argv[0] << " <file.cryss> [repeat]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::size_t repeat = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+    input::MappedFile source(argv[1]);
+    if(!source){
+        std::cerr << "cannot open file `" << argv[1] << "`" << std::endl;
+        return EXIT_FAILURE;
+    }
+    ast::Arena arena;
+    std::vector<ast::TopLevel *> items;
+    type::TypeContext types;
+    check::Defs defs;
+    ir::Module module;
+    try {
+        lexer::Lexer lexer(source);
+        parser::Parser parser(lexer, arena);
+        while(auto item = parser.parse_top_level()) items.push_back(item);
+        check::check_program(types, defs, items, 1);
+        module = lower::lower_program(types, defs, items);
+    }catch(std::unique_ptr<error::Error> &error){
+        error->eprint(source);
+        return EXIT_FAILURE;
+    }
+
+    vm::Machine machine(types, module);
+    std::size_t compiled = 0;
+    for(std::size_t i = 0; i < machine.size(); i++) compiled += machine.compiled(i);
+    std::cout << "compiled " << compiled << " / " << machine.size() << " functions" << std::endl;
+    if(!machine.compiled(machine.main_index())){
+        std::cout << "main uses values the VM does not support" << std::endl;
+        return EXIT_FAILURE;
+    }
+    for(auto slot : module.main->get_slots()){
+        if(slot != type::bool_id && slot != type::int_id && slot != type::float_id){
+            std::cout << "main uses sounds, which the tree-walker does not support" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto &slot_types = module.main->get_slots();
+    std::vector<Value> slots;
+    bool walker_failed = false, vm_failed = false;
+    auto start = clock::now();
+    try {
+        Walker walker(module);
+        for(std::size_t n = 0; n < repeat; n++){
+            slots.clear();
+            walker.run(*module.main, slots);
+        }
+    }catch(std::unique_ptr<error::Error> &error){
+        error->eprint(source);
+        walker_failed = true;
+    }
+    std::chrono::duration<double, std::milli> walker_time = clock::now() - start;
+    start = clock::now();
+    try {
+        for(std::size_t n = 0; n < repeat; n++) machine.call(machine.main_index(), {});
+    }catch(std::unique_ptr<error::Error> &error){
+        error->eprint(source);
+        vm_failed = true;
+    }
+    std::chrono::duration<double, std::milli> vm_time = clock::now() - start;
+
+    if(walker_failed || vm_failed){
+        std::cout << (walker_failed == vm_failed ? "both failed" : "MISMATCH: only one failed") << std::endl;
+        return walker_failed == vm_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    auto regs = machine.registers(machine.main_index());
+    for(std::size_t i = 0; i < slot_types.size(); i++){
+        if(!same(slots[i], regs[i], slot_types[i])){
+            std::cout << "MISMATCH: slot " << i << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << "tree-walker " << walker_time.count() << " ms" << std::endl;
+    std::cout << "vm          " << vm_time.count() << " ms" << std::endl;
+    std::cout << "speedup     " << walker_time.count() / vm_time.count() << "x" << std::endl;
+}
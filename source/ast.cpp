@@ -3,50 +3,542 @@
  */
 #include "ast.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
 namespace ast {
+    //! 最初に確保するブロックの大きさ
+    static constexpr std::size_t min_block_size = 64 * 1024;
+    //! ブロックを倍々に伸ばすときの上限
+    static constexpr std::size_t max_block_size = 4 * 1024 * 1024;
+
+    Arena::Arena(): next(0), cursor(nullptr), rest(0) {}
+    /**
+     * @brief `alignment` に揃えた `size` バイトの領域を切り出す．
+     *
+     * 今のブロックに収まらなければ次のブロックに移り，それもなければ新しく確保する．
+     */
+    void *Arena::allocate(std::size_t size, std::size_t alignment){
+        auto padding = [&]{
+            return (alignment - reinterpret_cast<std::uintptr_t>(cursor) % alignment) % alignment;
+        };
+        if(padding() + size > rest){
+            std::size_t needed = size + alignment;
+            while(next < blocks.size() && blocks[next].size < needed) next++;
+            if(next == blocks.size()){
+                std::size_t block_size = blocks.empty() ? min_block_size : std::min(blocks.back().size * 2, max_block_size);
+                block_size = std::max(block_size, needed);
+                blocks.push_back(Block{std::unique_ptr<std::byte[]>(new std::byte[block_size]), block_size});
+            }
+            cursor = blocks[next].data.get();
+            rest = blocks[next].size;
+            next++;
+        }
+        auto skip = padding();
+        void *ret = cursor + skip;
+        cursor += skip + size;
+        rest -= skip + size;
+        return ret;
+    }
+    /**
+     * @brief 文字列をアリーナ上にコピーする．
+     */
+    std::string_view Arena::copy(std::string_view str){
+        if(str.empty()) return {};
+        auto data = static_cast<char *>(allocate(str.size(), 1));
+        std::memcpy(data, str.data(), str.size());
+        return {data, str.size()};
+    }
+    /**
+     * @brief 全てのノードを手放す．
+     *
+     * ブロックは解放せずに次の `parse_top_level` で使い回す．
+     */
+    void Arena::clear(){
+        next = 0;
+        cursor = nullptr;
+        rest = 0;
+    }
+
     namespace type {
         Type::~Type() = default;
+        Identifier::Identifier(symbol::Symbol name):
+            name(name) {}
+        List::List(Type *elem):
+            elem(elem) {}
+        Sound::Sound(Type *result):
+            result(result) {}
     }
     TopLevel::~TopLevel() = default;
     Stmt::~Stmt() = default;
     Expr::~Expr() = default;
 
-    Identifier::Identifier(std::string_view name):
+    Identifier::Identifier(symbol::Symbol name):
         name(name) {}
-    Number::Number(std::string_view value):
+    symbol::Symbol Identifier::get_name() const {
+        return name;
+    }
+    Number::Number(literal::Literal value):
         value(value) {}
-    String::String(std::string value):
-        value(std::move(value)) {}
-    Call::Call(std::unique_ptr<Expr> func, std::vector<std::unique_ptr<Expr>> args):
-        func(std::move(func)),
-        args(std::move(args)) {}
-    UnaryOperation::UnaryOperation(UnaryOperator op, std::unique_ptr<Expr> operand):
+    String::String(std::string_view value):
+        value(value) {}
+    Call::Call(Expr *func, std::span<Expr *> args):
+        func(func),
+        args(args) {}
+    UnaryOperation::UnaryOperation(UnaryOperator op, Expr *operand):
         op(op),
-        operand(std::move(operand)) {}
-    BinaryOperation::BinaryOperation(BinaryOperator op, std::unique_ptr<Expr> left, std::unique_ptr<Expr> right):
+        operand(operand) {}
+    BinaryOperation::BinaryOperation(BinaryOperator op, Expr *left, Expr *right):
         op(op),
-        left(std::move(left)),
-        right(std::move(right)) {}
-    Index::Index(std::unique_ptr<Expr> operand, std::unique_ptr<Expr> index):
-        operand(std::move(operand)),
-        index(std::move(index)) {}
-    List::List(std::vector<std::unique_ptr<Expr>> elems):
-        elems(std::move(elems)) {}
-    Tuple::Tuple(std::vector<std::unique_ptr<Expr>> elems):
-        elems(std::move(elems)) {}
-    Group::Group(std::unique_ptr<Expr> expr):
-        expr(std::move(expr)) {}
-    ExprStmt::ExprStmt(std::unique_ptr<Expr> expr):
-        expr(std::move(expr)) {}
-    While::While(std::unique_ptr<Expr> cond, std::unique_ptr<Stmt> stmt):
-        cond(std::move(cond)),
-        stmt(std::move(stmt)) {}
-    If::If(std::unique_ptr<Expr> cond, std::unique_ptr<Stmt> stmt_true, std::unique_ptr<Stmt> stmt_false):
-        cond(std::move(cond)),
-        stmt_true(std::move(stmt_true)),
-        stmt_false(std::move(stmt_false)) {}
-    Block::Block(std::vector<std::unique_ptr<Stmt>> stmts):
-        stmts(std::move(stmts)) {}
+        left(left),
+        right(right) {}
+    Index::Index(Expr *operand, Expr *index):
+        operand(operand),
+        index(index) {}
+    List::List(std::span<Expr *> elems):
+        elems(elems) {}
+    Tuple::Tuple(std::span<Expr *> elems):
+        elems(elems) {}
+    Group::Group(Expr *expr):
+        expr(expr) {}
+    ExprStmt::ExprStmt(Expr *expr):
+        expr(expr) {}
+    While::While(Expr *cond, Stmt *stmt):
+        cond(cond),
+        stmt(stmt) {}
+    If::If(Expr *cond, Stmt *stmt_true, Stmt *stmt_false):
+        cond(cond),
+        stmt_true(stmt_true),
+        stmt_false(stmt_false) {}
+    Block::Block(std::span<Stmt *> stmts):
+        stmts(stmts) {}
+    Return::Return(Expr *expr):
+        expr(expr) {}
+    Def::Def(Identifier *name, std::span<Param> params, type::Type *ret):
+        name(name),
+        params(params),
+        ret(ret) {}
+    const Identifier &Def::get_name() const {
+        return *name;
+    }
+    std::span<const Param> Def::get_params() const {
+        return params;
+    }
+    const type::Type *Def::get_ret() const {
+        return ret;
+    }
+    DefExpr::DefExpr(Identifier *name, std::span<Param> params, type::Type *ret, Expr *expr):
+        Def(name, params, ret),
+        expr(expr) {}
+    DefBlock::DefBlock(Identifier *name, std::span<Param> params, type::Type *ret, Block *body):
+        Def(name, params, ret),
+        body(body) {}
+}
+
+namespace ast {
+    namespace {
+        //! キャッシュ上でノードの種類を表す
+        enum class Tag : std::uint8_t {
+            Null,
+            Identifier,
+            Number,
+            String,
+            Call,
+            UnaryOperation,
+            BinaryOperation,
+            Index,
+            Group,
+            List,
+            Tuple,
+            ExprStmt,
+            Break,
+            Continue,
+            Block,
+            While,
+            If,
+            Return,
+            DefExpr,
+            DefBlock,
+            TypeIdentifier,
+            TypeList,
+            TypeSound,
+        };
+        void put_tag(serial::Writer &writer, Tag tag){
+            writer.put_u8(static_cast<std::uint8_t>(tag));
+        }
+        //! 子ノードを書く．`nullptr` なら `Tag::Null` を書く
+        template<class Node>
+        void encode_child(const Node *node, serial::Writer &writer){
+            if(!node){
+                put_tag(writer, Tag::Null);
+            }else{
+                if(writer.enter()) node->encode(writer);
+                writer.leave();
+            }
+        }
+        template<class Node>
+        void encode_children(std::span<Node *> nodes, serial::Writer &writer){
+            writer.put_uint(nodes.size());
+            for(auto node : nodes) encode_child(node, writer);
+        }
+        //! `nullptr` を許さない子ノードを読む
+        template<class Node>
+        Node *required(Node *node, serial::Reader &reader){
+            if(!node) reader.fail();
+            return node;
+        }
+        template<class Node, class Decode>
+        std::span<Node *> decode_children(serial::Reader &reader, Arena &arena, Decode decode){
+            auto size = reader.get_uint();
+            std::vector<Node *> nodes;
+            for(std::uint64_t i = 0; i < size && reader.ok(); i++) nodes.push_back(required(decode(reader, arena), reader));
+            return arena.copy(nodes);
+        }
+    }
+
+    void Identifier::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Identifier);
+        writer.put_range(pos);
+        writer.put_symbol(name);
+    }
+    void Number::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Number);
+        writer.put_range(pos);
+        writer.put_u8(static_cast<std::uint8_t>(value.index()));
+        if(auto integer = std::get_if<literal::Int>(&value)){
+            writer.put_int(integer->value);
+        }else if(auto rational = std::get_if<literal::Rational>(&value)){
+            writer.put_int(rational->numer);
+            writer.put_int(rational->denom);
+        }else{
+            writer.put_double(std::get<literal::Float>(value).value);
+        }
+    }
+    void String::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::String);
+        writer.put_range(pos);
+        writer.put_string(value);
+    }
+    void Call::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Call);
+        writer.put_range(pos);
+        encode_child(func, writer);
+        encode_children(args, writer);
+    }
+    void UnaryOperation::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::UnaryOperation);
+        writer.put_range(pos);
+        writer.put_u8(static_cast<std::uint8_t>(op));
+        encode_child(operand, writer);
+    }
+    void BinaryOperation::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::BinaryOperation);
+        writer.put_range(pos);
+        writer.put_u8(static_cast<std::uint8_t>(op));
+        encode_child(left, writer);
+        encode_child(right, writer);
+    }
+    void Index::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Index);
+        writer.put_range(pos);
+        encode_child(operand, writer);
+        encode_child(index, writer);
+    }
+    void Group::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Group);
+        writer.put_range(pos);
+        encode_child(expr, writer);
+    }
+    void List::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::List);
+        writer.put_range(pos);
+        encode_children(elems, writer);
+    }
+    void Tuple::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Tuple);
+        writer.put_range(pos);
+        encode_children(elems, writer);
+    }
+    void ExprStmt::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::ExprStmt);
+        writer.put_range(pos);
+        encode_child(expr, writer);
+    }
+    void Break::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Break);
+        writer.put_range(pos);
+    }
+    void Continue::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Continue);
+        writer.put_range(pos);
+    }
+    void Block::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Block);
+        writer.put_range(pos);
+        encode_children(stmts, writer);
+    }
+    void While::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::While);
+        writer.put_range(pos);
+        encode_child(cond, writer);
+        encode_child(stmt, writer);
+    }
+    void If::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::If);
+        writer.put_range(pos);
+        encode_child(cond, writer);
+        encode_child(stmt_true, writer);
+        encode_child(stmt_false, writer);
+    }
+
+    void Return::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::Return);
+        writer.put_range(pos);
+        encode_child(expr, writer);
+    }
+    /**
+     * @brief 名前，引数，返り値の型注釈を書く．
+     */
+    void Def::encode_signature(serial::Writer &writer) const {
+        writer.put_range(pos);
+        encode_child(name, writer);
+        writer.put_uint(params.size());
+        for(auto [param, type] : params){
+            encode_child(param, writer);
+            encode_child(type, writer);
+        }
+        encode_child(ret, writer);
+    }
+    void DefExpr::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::DefExpr);
+        encode_signature(writer);
+        encode_child(expr, writer);
+    }
+    void DefBlock::encode(serial::Writer &writer) const {
+        put_tag(writer, Tag::DefBlock);
+        encode_signature(writer);
+        encode_child(body, writer);
+    }
+    namespace type {
+        void Identifier::encode(serial::Writer &writer) const {
+            put_tag(writer, Tag::TypeIdentifier);
+            writer.put_range(pos);
+            writer.put_symbol(name);
+        }
+        void List::encode(serial::Writer &writer) const {
+            put_tag(writer, Tag::TypeList);
+            writer.put_range(pos);
+            encode_child(elem, writer);
+        }
+        void Sound::encode(serial::Writer &writer) const {
+            put_tag(writer, Tag::TypeSound);
+            writer.put_range(pos);
+            encode_child(result, writer);
+        }
+
+        /**
+         * @brief `Type::encode` で書いた型注釈を読み，`arena` 上に作る．
+         * @return `Tag::Null` なら `nullptr`．壊れていたら `reader` を失敗状態にする．
+         */
+        Type *decode(serial::Reader &reader, Arena &arena){
+            if(!reader.enter()){
+                reader.leave();
+                return nullptr;
+            }
+            auto tag = static_cast<Tag>(reader.get_u8());
+            if(tag == Tag::Null){
+                reader.leave();
+                return nullptr;
+            }
+            auto pos = reader.get_range();
+            Type *ret = nullptr;
+            switch(tag){
+                case Tag::TypeIdentifier:
+                    ret = arena.make<Identifier>(reader.get_symbol());
+                    break;
+                case Tag::TypeList:
+                    ret = arena.make<List>(required(decode(reader, arena), reader));
+                    break;
+                case Tag::TypeSound:
+                    ret = arena.make<Sound>(required(decode(reader, arena), reader));
+                    break;
+                default:
+                    reader.fail();
+            }
+            if(ret) ret->pos = std::move(pos);
+            reader.leave();
+            return ret;
+        }
+    }
+
+    /**
+     * @brief `Expr::encode` で書いた式を読み，`arena` 上に作る．
+     * @return `Tag::Null` なら `nullptr`．壊れていたら `reader` を失敗状態にする．
+     */
+    Expr *decode_expr(serial::Reader &reader, Arena &arena){
+        if(!reader.enter()){
+            reader.leave();
+            return nullptr;
+        }
+        auto tag = static_cast<Tag>(reader.get_u8());
+        if(tag == Tag::Null){
+            reader.leave();
+            return nullptr;
+        }
+        auto pos = reader.get_range();
+        Expr *ret = nullptr;
+        switch(tag){
+            case Tag::Identifier:
+                ret = arena.make<Identifier>(reader.get_symbol());
+                break;
+            case Tag::Number:
+                switch(reader.get_u8()){
+                    case 0:
+                        ret = arena.make<Number>(literal::Int{reader.get_int()});
+                        break;
+                    case 1: {
+                        auto numer = reader.get_int();
+                        auto denom = reader.get_int();
+                        ret = arena.make<Number>(literal::Rational{numer, denom});
+                        break;
+                    }
+                    case 2:
+                        ret = arena.make<Number>(literal::Float{reader.get_double()});
+                        break;
+                    default:
+                        reader.fail();
+                }
+                break;
+            case Tag::String:
+                ret = arena.make<String>(arena.copy(reader.get_string()));
+                break;
+            case Tag::Call: {
+                auto func = required(decode_expr(reader, arena), reader);
+                ret = arena.make<Call>(func, decode_children<Expr>(reader, arena, decode_expr));
+                break;
+            }
+            case Tag::UnaryOperation: {
+                auto op = static_cast<UnaryOperator>(reader.get_u8());
+                if(op > UnaryOperator::PostDec) reader.fail();
+                ret = arena.make<UnaryOperation>(op, required(decode_expr(reader, arena), reader));
+                break;
+            }
+            case Tag::BinaryOperation: {
+                auto op = static_cast<BinaryOperator>(reader.get_u8());
+                if(op > BinaryOperator::BackwardShiftAssign) reader.fail();
+                auto left = required(decode_expr(reader, arena), reader);
+                auto right = required(decode_expr(reader, arena), reader);
+                ret = arena.make<BinaryOperation>(op, left, right);
+                break;
+            }
+            case Tag::Index: {
+                auto operand = required(decode_expr(reader, arena), reader);
+                auto index = required(decode_expr(reader, arena), reader);
+                ret = arena.make<Index>(operand, index);
+                break;
+            }
+            case Tag::Group:
+                ret = arena.make<Group>(required(decode_expr(reader, arena), reader));
+                break;
+            case Tag::List:
+                ret = arena.make<List>(decode_children<Expr>(reader, arena, decode_expr));
+                break;
+            case Tag::Tuple:
+                ret = arena.make<Tuple>(decode_children<Expr>(reader, arena, decode_expr));
+                break;
+            default:
+                reader.fail();
+        }
+        if(ret) ret->pos = std::move(pos);
+        reader.leave();
+        return ret;
+    }
+    /**
+     * @brief `Stmt::encode` で書いた文を読み，`arena` 上に作る．
+     * @return `Tag::Null` なら `nullptr`．壊れていたら `reader` を失敗状態にする．
+     */
+    Stmt *decode_stmt(serial::Reader &reader, Arena &arena){
+        if(!reader.enter()){
+            reader.leave();
+            return nullptr;
+        }
+        auto tag = static_cast<Tag>(reader.get_u8());
+        if(tag == Tag::Null){
+            reader.leave();
+            return nullptr;
+        }
+        auto pos = reader.get_range();
+        Stmt *ret = nullptr;
+        switch(tag){
+            case Tag::ExprStmt:
+                ret = arena.make<ExprStmt>(decode_expr(reader, arena));
+                break;
+            case Tag::Break:
+                ret = arena.make<Break>();
+                break;
+            case Tag::Continue:
+                ret = arena.make<Continue>();
+                break;
+            case Tag::Block:
+                ret = arena.make<Block>(decode_children<Stmt>(reader, arena, decode_stmt));
+                break;
+            case Tag::While: {
+                auto cond = required(decode_expr(reader, arena), reader);
+                auto stmt = required(decode_stmt(reader, arena), reader);
+                ret = arena.make<While>(cond, stmt);
+                break;
+            }
+            case Tag::If: {
+                auto cond = required(decode_expr(reader, arena), reader);
+                auto stmt_true = required(decode_stmt(reader, arena), reader);
+                auto stmt_false = decode_stmt(reader, arena);
+                ret = arena.make<If>(cond, stmt_true, stmt_false);
+                break;
+            }
+            case Tag::Return:
+                ret = arena.make<Return>(required(decode_expr(reader, arena), reader));
+                break;
+            default:
+                reader.fail();
+        }
+        if(ret) ret->pos = std::move(pos);
+        reader.leave();
+        return ret;
+    }
+    /**
+     * @brief `TopLevel::encode` で書いたトップレベルの要素を読む．
+     *
+     * 関数定義でなければ文として読む．
+     */
+    TopLevel *decode_top_level(serial::Reader &reader, Arena &arena){
+        auto tag = static_cast<Tag>(reader.peek_u8());
+        if(tag != Tag::DefExpr && tag != Tag::DefBlock) return required(decode_stmt(reader, arena), reader);
+        reader.get_u8();
+        auto pos = reader.get_range();
+        auto name = dynamic_cast<Identifier *>(required(decode_expr(reader, arena), reader));
+        if(!name) reader.fail();
+        auto size = reader.get_uint();
+        std::vector<Param> params;
+        for(std::uint64_t i = 0; i < size && reader.ok(); i++){
+            auto param = dynamic_cast<Identifier *>(required(decode_expr(reader, arena), reader));
+            if(!param) reader.fail();
+            params.emplace_back(param, required(type::decode(reader, arena), reader));
+        }
+        auto ret_type = type::decode(reader, arena);
+        Def *ret = nullptr;
+        if(tag == Tag::DefExpr){
+            auto expr = required(decode_expr(reader, arena), reader);
+            if(reader.ok()) ret = arena.make<DefExpr>(name, arena.copy(params), ret_type, expr);
+        }else{
+            auto body = dynamic_cast<Block *>(required(decode_stmt(reader, arena), reader));
+            if(!body) reader.fail();
+            if(reader.ok()) ret = arena.make<DefBlock>(name, arena.copy(params), ret_type, body);
+        }
+        if(!ret) return nullptr;
+        ret->pos = std::move(pos);
+        return ret;
+    }
 }
 
 #ifdef DEBUG
@@ -60,9 +552,16 @@ public:
         return os;
     }
 };
+//! これより深いノードは省略する（入れ子の深い AST で再帰が深くなりすぎないように）
+static constexpr int max_debug_depth = 256;
+template<class Node>
+static void print_child(const Node *node, int depth){
+    if(depth > max_debug_depth) std::cout << indent(depth) << "..." << std::endl;
+    else node->debug_print(depth);
+}
 namespace ast {
     void Identifier::debug_print(int depth) const {
-        std::cout << indent(depth) << pos << " identifier(" << name << ")" << std::endl;
+        std::cout << indent(depth) << pos << " identifier(" << symbol::name(name) << ")" << std::endl;
     }
     void Number::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " number(" << value << ")" << std::endl;
@@ -72,9 +571,9 @@ namespace ast {
     }
     void Call::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " call" << std::endl;
-        func->debug_print(depth + 1);
+        print_child(func, depth + 1);
         std::cout << indent(depth) << "args(" << args.size() << "):" << std::endl;
-        for(auto &arg : args) arg->debug_print(depth + 1);
+        for(auto &arg : args) print_child(arg, depth + 1);
     }
     void UnaryOperation::debug_print(int depth) const {
         std::string_view name;
@@ -90,7 +589,7 @@ namespace ast {
             case UnaryOperator::PostDec: name = "postfix decrement";
         }
         std::cout << indent(depth) << pos << " unary operation(" << name << ")" << std::endl;
-        operand->debug_print(depth + 1);
+        print_child(operand, depth + 1);
     }
     void BinaryOperation::debug_print(int depth) const {
         std::string_view name;
@@ -130,56 +629,56 @@ namespace ast {
             case BinaryOperator::BackwardShiftAssign: name = "backward shift assign"; break;
         }
         std::cout << indent(depth) << pos << " binary operation(" << name << ")" << std::endl;
-        left->debug_print(depth + 1);
-        right->debug_print(depth + 1);
+        print_child(left, depth + 1);
+        print_child(right, depth + 1);
     }
     void Index::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " index" << std::endl;
-        operand->debug_print(depth + 1);
-        index->debug_print(depth + 1);
+        print_child(operand, depth + 1);
+        print_child(index, depth + 1);
     }
     void Group::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " group" << std::endl;
-        expr->debug_print(depth + 1);
+        print_child(expr, depth + 1);
     }
     void List::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " list(" << elems.size() << ")" << std::endl;
-        for(auto &elem : elems) elem->debug_print(depth + 1);
+        for(auto &elem : elems) print_child(elem, depth + 1);
     }
     void Tuple::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " tuple(" << elems.size() << ")" << std::endl;
-        for(auto &elem : elems) elem->debug_print(depth + 1);
+        for(auto &elem : elems) print_child(elem, depth + 1);
     }
     void ExprStmt::debug_print(int depth) const {
         if(expr){
             std::cout << indent(depth) << pos << " expression statement" << std::endl;
-            expr->debug_print(depth + 1);
+            print_child(expr, depth + 1);
         }else{
             std::cout << indent(depth) << pos << " expression statement (empty)" << std::endl;
         }
     }
     void While::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " while" << std::endl;
-        cond->debug_print(depth + 1);
+        print_child(cond, depth + 1);
         std::cout << indent(depth) << "do" << std::endl;
-        stmt->debug_print(depth + 1);
+        print_child(stmt, depth + 1);
         std::cout << indent(depth) << "end while" << std::endl;
     }
     void If::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " if" << std::endl;
-        cond->debug_print(depth + 1);
+        print_child(cond, depth + 1);
         std::cout << indent(depth) << "then" << std::endl;
-        stmt_true->debug_print(depth + 1);
+        print_child(stmt_true, depth + 1);
         if(stmt_false){
             std::cout << indent(depth) << "else" << std::endl;
-            stmt_false->debug_print(depth + 1);
+            print_child(stmt_false, depth + 1);
         }
         std::cout << indent(depth) << "end if" << std::endl;
     }
     void Block::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " block" << std::endl;
         for(auto &stmt : stmts){
-            stmt->debug_print(depth + 1);
+            print_child(stmt, depth + 1);
         }
         std::cout << indent(depth) << "end block" << std::endl;
     }
@@ -189,5 +688,45 @@ namespace ast {
     void Continue::debug_print(int depth) const {
         std::cout << indent(depth) << pos << " continue" << std::endl;
     }
+    void Return::debug_print(int depth) const {
+        std::cout << indent(depth) << pos << " return" << std::endl;
+        print_child(expr, depth + 1);
+    }
+    void Def::debug_print_signature(int depth) const {
+        std::cout << indent(depth) << pos << " def(" << symbol::name(name->get_name()) << ")" << std::endl;
+        std::cout << indent(depth) << "params(" << params.size() << "):" << std::endl;
+        for(auto [param, type] : params){
+            print_child(param, depth + 1);
+            print_child(type, depth + 2);
+        }
+        if(ret){
+            std::cout << indent(depth) << "returns:" << std::endl;
+            print_child(ret, depth + 1);
+        }
+    }
+    void DefExpr::debug_print(int depth) const {
+        debug_print_signature(depth);
+        std::cout << indent(depth) << "=" << std::endl;
+        print_child(expr, depth + 1);
+        std::cout << indent(depth) << "end def" << std::endl;
+    }
+    void DefBlock::debug_print(int depth) const {
+        debug_print_signature(depth);
+        print_child(body, depth + 1);
+        std::cout << indent(depth) << "end def" << std::endl;
+    }
+    namespace type {
+        void Identifier::debug_print(int depth) const {
+            std::cout << indent(depth) << pos << " type(" << symbol::name(name) << ")" << std::endl;
+        }
+        void List::debug_print(int depth) const {
+            std::cout << indent(depth) << pos << " list type" << std::endl;
+            print_child(elem, depth + 1);
+        }
+        void Sound::debug_print(int depth) const {
+            std::cout << indent(depth) << pos << " sound type" << std::endl;
+            print_child(result, depth + 1);
+        }
+    }
 }
 #endif
@@ -5,32 +5,143 @@
 #ifndef AST_HPP
 #define AST_HPP
 
-#include <string_view>
+#include <cstddef>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "literal.hpp"
 #include "pos.hpp"
+#include "serial.hpp"
+#include "symbol.hpp"
+#include "type.hpp"
+
+namespace check {
+    class Checker;
+}
+namespace ir {
+    class Expr;
+}
+namespace lower {
+    class Lowerer;
+}
 
 namespace ast {
+    /**
+     * @brief AST のノードを確保するアリーナ
+     *
+     * 大きなブロックの先頭から順に切り出し，`clear()` で全てのノードをまとめて手放す．
+     * デストラクタは呼ばないので，ノードはリソースを所有しない．
+     * 子は生ポインタか `std::span` で指し，文字列はアリーナ上にコピーする．
+     */
+    class Arena {
+        struct Block {
+            std::unique_ptr<std::byte[]> data;
+            std::size_t size;
+        };
+        std::vector<Block> blocks;
+        //! 次に使うブロックの添字
+        std::size_t next;
+        std::byte *cursor;
+        std::size_t rest;
+    public:
+        Arena();
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+        void *allocate(std::size_t, std::size_t);
+        std::string_view copy(std::string_view);
+        void clear();
+
+        /**
+         * @brief アリーナ上にノードを構築する．
+         */
+        template<class T, class... Args>
+        T *make(Args&&... args){
+            return new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+        /**
+         * @brief 一時的な配列の `[first, last)` をアリーナ上の連続した領域にコピーする．
+         */
+        template<class Iterator>
+        auto copy(Iterator first, Iterator last){
+            using T = typename std::iterator_traits<Iterator>::value_type;
+            auto size = static_cast<std::size_t>(last - first);
+            if(size == 0) return std::span<T>();
+            auto data = static_cast<T *>(allocate(sizeof(T) * size, alignof(T)));
+            std::uninitialized_copy(first, last, data);
+            return std::span<T>(data, size);
+        }
+        template<class T>
+        std::span<T> copy(const std::vector<T> &items){
+            return copy(items.begin(), items.end());
+        }
+    };
+
+    class Expr;
+    class Stmt;
+    class TopLevel;
+    Expr *decode_expr(serial::Reader &, Arena &);
+    Stmt *decode_stmt(serial::Reader &, Arena &);
+    TopLevel *decode_top_level(serial::Reader &, Arena &);
+
+    /**
+     * @brief 型注釈
+     */
     namespace type {
         class Type {
         public:
             pos::Range pos;
             virtual ~Type();
+            virtual void encode(serial::Writer &) const = 0;
+            virtual ::type::TypeId check(::check::Checker &) const = 0;
+#ifdef DEBUG
+            virtual void debug_print(int) const = 0;
+#endif
         };
         class Identifier : public Type {
-            std::string_view name;
+            symbol::Symbol name;
+        public:
+            Identifier(symbol::Symbol);
+            void encode(serial::Writer &) const override;
+            ::type::TypeId check(::check::Checker &) const override;
+#ifdef DEBUG
+            void debug_print(int) const override;
+#endif
         };
         class List : public Type {
-            std::unique_ptr<Type> elem;
+            Type *elem;
+        public:
+            List(Type *);
+            void encode(serial::Writer &) const override;
+            ::type::TypeId check(::check::Checker &) const override;
+#ifdef DEBUG
+            void debug_print(int) const override;
+#endif
         };
         class Sound : public Type {
-            std::unique_ptr<Type> result;
+            Type *result;
+        public:
+            Sound(Type *);
+            void encode(serial::Writer &) const override;
+            ::type::TypeId check(::check::Checker &) const override;
+#ifdef DEBUG
+            void debug_print(int) const override;
+#endif
         };
+        Type *decode(serial::Reader &, Arena &);
     }
     class TopLevel {
     public:
         pos::Range pos;
         virtual ~TopLevel();
+        virtual void encode(serial::Writer &) const = 0;
+        virtual void check(::check::Checker &) = 0;
+        virtual void collect_names(std::vector<symbol::Symbol> &, std::size_t) const = 0;
+        virtual void lower(::lower::Lowerer &) const = 0;
 #ifdef DEBUG
         virtual void debug_print(int) const = 0;
 #endif
@@ -38,6 +149,10 @@ namespace ast {
     class Stmt : public TopLevel {
     public:
         virtual ~Stmt() override;
+        virtual void encode(serial::Writer &) const override = 0;
+        virtual void check(::check::Checker &) override = 0;
+        virtual void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override = 0;
+        virtual void lower(::lower::Lowerer &) const override = 0;
 #ifdef DEBUG
         virtual void debug_print(int) const override = 0;
 #endif
@@ -45,40 +160,63 @@ namespace ast {
     class Expr {
     public:
         pos::Range pos;
+        //! 型検査で決まった型（検査前は `type::no_type`）
+        ::type::TypeId type_id = ::type::no_type;
         virtual ~Expr();
+        virtual void encode(serial::Writer &) const = 0;
+        virtual ::type::TypeId check(::check::Checker &) = 0;
+        virtual void collect_names(std::vector<symbol::Symbol> &, std::size_t) const = 0;
+        virtual std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const = 0;
 #ifdef DEBUG
         virtual void debug_print(int) const = 0;
 #endif
     };
     class Identifier : public Expr {
-        std::string_view name;
+        symbol::Symbol name;
     public:
-        Identifier(std::string_view);
+        Identifier(symbol::Symbol);
+        symbol::Symbol get_name() const;
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Number : public Expr {
-        std::string_view value;
+        literal::Literal value;
     public:
-        Number(std::string_view);
+        Number(literal::Literal);
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class String : public Expr {
-        std::string value;
+        std::string_view value;
     public:
-        String(std::string);
+        String(std::string_view);
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Call : public Expr {
-        std::unique_ptr<Expr> func;
-        std::vector<std::unique_ptr<Expr>> args;
+        Expr *func;
+        std::span<Expr *> args;
     public:
-        Call(std::unique_ptr<Expr>, std::vector<std::unique_ptr<Expr>>);
+        Call(Expr *, std::span<Expr *>);
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
@@ -96,9 +234,13 @@ namespace ast {
     };
     class UnaryOperation : public Expr {
         UnaryOperator op;
-        std::unique_ptr<Expr> operand;
+        Expr *operand;
     public:
-        UnaryOperation(UnaryOperator, std::unique_ptr<Expr>);
+        UnaryOperation(UnaryOperator, Expr *);
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
@@ -140,119 +282,213 @@ namespace ast {
     };
     class BinaryOperation : public Expr {
         BinaryOperator op;
-        std::unique_ptr<Expr> left, right;
+        Expr *left, *right;
     public:
-        BinaryOperation(BinaryOperator, std::unique_ptr<Expr>, std::unique_ptr<Expr>);
+        BinaryOperation(BinaryOperator, Expr *, Expr *);
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Index : public Expr {
-        std::unique_ptr<Expr> operand;
-        std::unique_ptr<Expr> index;
+        Expr *operand;
+        Expr *index;
     public:
-        Index(std::unique_ptr<Expr>, std::unique_ptr<Expr>);
+        Index(Expr *, Expr *);
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Group : public Expr {
-        std::unique_ptr<Expr> expr;
+        Expr *expr;
     public:
-        Group(std::unique_ptr<Expr>);
+        Group(Expr *);
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class List : public Expr {
-        std::vector<std::unique_ptr<Expr>> elems;
+        std::span<Expr *> elems;
     public:
-        List(std::vector<std::unique_ptr<Expr>>);
+        List(std::span<Expr *>);
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Tuple : public Expr {
-        std::vector<std::unique_ptr<Expr>> elems;
+        std::span<Expr *> elems;
     public:
-        Tuple(std::vector<std::unique_ptr<Expr>>);
+        Tuple(std::span<Expr *>);
+        void encode(serial::Writer &) const override;
+        ::type::TypeId check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        std::unique_ptr<::ir::Expr> lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class ExprStmt : public Stmt {
-        std::unique_ptr<Expr> expr;
+        Expr *expr;
     public:
-        ExprStmt(std::unique_ptr<Expr>);
+        ExprStmt(Expr *);
+        void encode(serial::Writer &) const override;
+        void check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        void lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Decl : public Stmt {
-        std::string_view name;
-        std::unique_ptr<type::Type> type;
-        std::unique_ptr<Expr> expr;
+        symbol::Symbol name;
+        type::Type *type;
+        Expr *expr;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Break : public Stmt {
+    public:
+        void encode(serial::Writer &) const override;
+        void check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        void lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Continue : public Stmt {
+    public:
+        void encode(serial::Writer &) const override;
+        void check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        void lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Return : public Stmt {
-        std::unique_ptr<Expr> expr;
+        Expr *expr;
+    public:
+        Return(Expr *);
+        void encode(serial::Writer &) const override;
+        void check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        void lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class Block : public Stmt {
-        std::vector<std::unique_ptr<Stmt>> stmts;
+        std::span<Stmt *> stmts;
     public:
-        Block(std::vector<std::unique_ptr<Stmt>>);
+        Block(std::span<Stmt *>);
+        void encode(serial::Writer &) const override;
+        void check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        void lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class While : public Stmt {
-        std::unique_ptr<Expr> cond;
-        std::unique_ptr<Stmt> stmt;
+        Expr *cond;
+        Stmt *stmt;
     public:
-        While(std::unique_ptr<Expr>, std::unique_ptr<Stmt>);
+        While(Expr *, Stmt *);
+        void encode(serial::Writer &) const override;
+        void check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        void lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
     class If : public Stmt {
-        std::unique_ptr<Expr> cond;
-        std::unique_ptr<Stmt> stmt_true;
-        std::unique_ptr<Stmt> stmt_false;
+        Expr *cond;
+        Stmt *stmt_true;
+        Stmt *stmt_false;
     public:
-        If(std::unique_ptr<Expr>, std::unique_ptr<Stmt>, std::unique_ptr<Stmt>);
+        If(Expr *, Stmt *, Stmt *);
+        void encode(serial::Writer &) const override;
+        void check(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        void lower(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
-    class DefExpr : public TopLevel {
-        std::string_view name;
-        std::vector<std::pair<std::string_view, std::unique_ptr<type::Type>>> args;
-        std::unique_ptr<type::Type> type;
-        std::unique_ptr<Expr> expr;
+    /**
+     * @brief 引数の名前と型注釈
+     */
+    using Param = std::pair<Identifier *, type::Type *>;
+    /**
+     * @brief トップレベルの関数定義
+     *
+     * `def name(param: type, ...): type = expr;` または `def name(param: type, ...): type { ... }`．
+     * 返り値の型注釈は省略でき，その場合は本体から推論する．
+     */
+    class Def : public TopLevel {
+    protected:
+        Identifier *name;
+        std::span<Param> params;
+        //! 返り値の型注釈（省略されていれば `nullptr`）
+        type::Type *ret;
+        Def(Identifier *, std::span<Param>, type::Type *);
+        void encode_signature(serial::Writer &) const;
+#ifdef DEBUG
+        void debug_print_signature(int) const;
+#endif
+    public:
+        const Identifier &get_name() const;
+        std::span<const Param> get_params() const;
+        const type::Type *get_ret() const;
+        void check(::check::Checker &) override;
+        /**
+         * @brief 本体を検査する．引数は `checker` のスコープに定義済み．
+         */
+        virtual void check_body(::check::Checker &) = 0;
+        void lower(::lower::Lowerer &) const override;
+        /**
+         * @brief 本体を変換する．引数は `lowerer` のスコープに定義済み．
+         */
+        virtual void lower_body(::lower::Lowerer &) const = 0;
+    };
+    class DefExpr : public Def {
+        Expr *expr;
+    public:
+        DefExpr(Identifier *, std::span<Param>, type::Type *, Expr *);
+        void encode(serial::Writer &) const override;
+        void check_body(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        void lower_body(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
-    class DefBlock : public TopLevel {
-        std::string_view name;
-        std::vector<std::pair<std::string_view, std::unique_ptr<type::Type>>> args;
-        std::unique_ptr<type::Type> type;
-        std::vector<std::unique_ptr<Stmt>> stmts;
+    class DefBlock : public Def {
+        Block *body;
+    public:
+        DefBlock(Identifier *, std::span<Param>, type::Type *, Block *);
+        void encode(serial::Writer &) const override;
+        void check_body(::check::Checker &) override;
+        void collect_names(std::vector<symbol::Symbol> &, std::size_t) const override;
+        void lower_body(::lower::Lowerer &) const override;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
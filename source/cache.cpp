@@ -0,0 +1,149 @@
+/**
+ * @file cache.cpp
+ */
+#include "cache.hpp"
+#include "serial.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cache {
+    //! キャッシュファイルの先頭
+    static constexpr std::string_view magic = "CRYSSAST";
+
+    static std::uint64_t mix(std::uint64_t x){
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb33fe1a85ec5ULL;
+        x ^= x >> 33;
+        return x;
+    }
+    /**
+     * @brief 8 バイトずつ読む 64 bit のハッシュ
+     *
+     * 暗号学的なハッシュではないので，キャッシュのキーと壊れたファイルの検出にだけ使う．
+     */
+    std::uint64_t hash(std::string_view data, std::uint64_t seed){
+        constexpr std::uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+        std::uint64_t h = seed ^ (data.size() * multiplier);
+        std::size_t i = 0;
+        for(; i + 8 <= data.size(); i += 8){
+            std::uint64_t word;
+            std::memcpy(&word, data.data() + i, 8);
+            h = (h ^ mix(word)) * multiplier;
+        }
+        std::uint64_t tail = 0;
+        if(i < data.size()) std::memcpy(&tail, data.data() + i, data.size() - i);
+        h = (h ^ mix(tail)) * multiplier;
+        return mix(h);
+    }
+
+    /**
+     * @brief コンストラクタ
+     * @param dir キャッシュを置くディレクトリ（なければ作る）
+     */
+    Cache::Cache(std::string dir): dir(std::move(dir)) {
+        std::error_code ec;
+        std::filesystem::create_directories(this->dir, ec);
+    }
+    /**
+     * @brief ソースコードに対応するキャッシュファイルのパス
+     *
+     * シードの異なる 2 つのハッシュを繋げた 128 bit をファイル名にする．
+     */
+    std::string Cache::path(std::string_view source) const {
+        auto version = hash(compiler_version, 0);
+        char name[33];
+        std::snprintf(
+            name, sizeof(name), "%016llx%016llx",
+            static_cast<unsigned long long>(hash(source, version)),
+            static_cast<unsigned long long>(hash(source, ~version))
+        );
+        return dir + "/" + name + ".ast";
+    }
+
+    /**
+     * @brief キャッシュがあれば mmap して読み，`items` に格納する．
+     *
+     * 先頭のマジックナンバーの後に本体のハッシュを置き，壊れたファイルは使わない．
+     * 読めなかった場合は `arena` と `items` を空にする．
+     * @return キャッシュが見つかり，正しく読めたか
+     */
+    bool Cache::load(std::string_view source, ast::Arena &arena, std::vector<ast::TopLevel *> &items) const {
+        int fd = open(path(source).c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) return false;
+        struct stat st;
+        void *addr = MAP_FAILED;
+        std::size_t length = 0;
+        if(fstat(fd, &st) == 0 && st.st_size > 0){
+            length = static_cast<std::size_t>(st.st_size);
+            addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if(addr == MAP_FAILED) return false;
+        std::string_view data(static_cast<const char *>(addr), length);
+        bool ok = false;
+        constexpr std::size_t header_size = magic.size() + sizeof(std::uint64_t);
+        std::uint64_t checksum = 0;
+        if(data.size() >= header_size) std::memcpy(&checksum, data.data() + magic.size(), sizeof(checksum));
+        if(data.starts_with(magic) && data.size() >= header_size && checksum == hash(data.substr(header_size), 0)){
+            serial::Reader reader(data.substr(header_size));
+            if(reader.get_uint() == source.size()){
+                auto count = reader.get_uint();
+                for(std::uint64_t i = 0; i < count && reader.ok(); i++){
+                    items.push_back(ast::decode_top_level(reader, arena));
+                }
+                ok = reader.ok() && reader.at_end();
+            }
+        }
+        munmap(addr, length);
+        if(!ok){
+            items.clear();
+            arena.clear();
+        }
+        return ok;
+    }
+    /**
+     * @brief 解析結果をキャッシュに書く．
+     *
+     * 一時ファイルに書いてから rename するので，並行して読み書きしても壊れたファイルは見えない．
+     * 入れ子が深すぎて書けない場合や書き込みに失敗した場合は何もしない．
+     */
+    void Cache::store(std::string_view source, const std::vector<ast::TopLevel *> &items) const {
+        serial::Writer writer;
+        writer.put_uint(source.size());
+        writer.put_uint(items.size());
+        for(auto item : items){
+            if(writer.enter()) item->encode(writer);
+            writer.leave();
+        }
+        if(!writer.ok()) return;
+        static std::atomic<unsigned> counter = 0;
+        auto target = path(source);
+        auto temporary = target + ".tmp." + std::to_string(getpid()) + "." + std::to_string(counter++);
+        {
+            std::ofstream file(temporary, std::ios::binary);
+            if(!file) return;
+            auto body = writer.finish();
+            auto checksum = hash(body, 0);
+            file.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+            file.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+            file.write(body.data(), static_cast<std::streamsize>(body.size()));
+            if(!file){
+                file.close();
+                std::remove(temporary.c_str());
+                return;
+            }
+        }
+        if(std::rename(temporary.c_str(), target.c_str()) != 0) std::remove(temporary.c_str());
+    }
+}
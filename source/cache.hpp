@@ -0,0 +1,43 @@
+/**
+ * @file cache.hpp
+ * @brief 構文解析の結果をディスクにキャッシュする．
+ */
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+
+/**
+ * @brief 構文解析の結果をディスクにキャッシュする．
+ */
+namespace cache {
+    /**
+     * @brief キャッシュの形式やコンパイラが変わったら書き換える．キーのハッシュに混ぜる．
+     */
+    constexpr std::string_view compiler_version = "cryss ast-cache 3";
+
+    std::uint64_t hash(std::string_view, std::uint64_t);
+
+    /**
+     * @brief AST のキャッシュを置くディレクトリ
+     *
+     * ファイル名はソースコードの内容と `compiler_version` のハッシュで，
+     * 中身は `serial::Writer` で書いたトップレベルの要素の列．
+     * エラーのあったファイルはキャッシュしない．
+     */
+    class Cache {
+        std::string dir;
+        std::string path(std::string_view) const;
+    public:
+        explicit Cache(std::string);
+        bool load(std::string_view, ast::Arena &, std::vector<ast::TopLevel *> &) const;
+        void store(std::string_view, const std::vector<ast::TopLevel *> &) const;
+    };
+}
+
+#endif
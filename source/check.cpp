@@ -0,0 +1,996 @@
+/**
+ * @file check.cpp
+ */
+#include "check.hpp"
+#include "error.hpp"
+#include "pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string_view>
+
+namespace check {
+    //! 組み込みの名前とその種類
+    static constexpr std::pair<std::string_view, Builtin> builtin_names[] = {
+        {"t", Builtin::Time},
+        {"pi", Builtin::Pi},
+        {"sin", Builtin::Sin},
+        {"cos", Builtin::Cos},
+        {"tan", Builtin::Tan},
+        {"exp", Builtin::Exp},
+        {"log", Builtin::Log},
+        {"sqrt", Builtin::Sqrt},
+        {"floor", Builtin::Floor},
+        {"abs", Builtin::Abs},
+    };
+
+    /**
+     * @brief 組み込みの名前ならその種類を返す．
+     */
+    std::optional<Builtin> builtin(symbol::Symbol name){
+        static const auto table = []{
+            std::unordered_map<symbol::Symbol, Builtin> ret;
+            for(auto [text, kind] : builtin_names) ret.emplace(symbol::intern(text), kind);
+            return ret;
+        }();
+        auto it = table.find(name);
+        if(it == table.end()) return std::nullopt;
+        return it->second;
+    }
+
+    /**
+     * @brief int，rational，float のいずれかなら `true`
+     *
+     * これらの ID は広げる順に並んでいるので，共通の型は ID の大きい方になる．
+     */
+    static bool is_numeric(type::TypeId id){
+        return id == type::int_id || id == type::rational_id || id == type::float_id;
+    }
+    /**
+     * @brief 音の各時刻の値になれる型なら `true`
+     */
+    static bool is_sample(type::TypeId id){
+        return id == type::bool_id || is_numeric(id);
+    }
+
+    static const char *operator_name(ast::UnaryOperator op){
+        switch(op){
+            case ast::UnaryOperator::Plus: return "+";
+            case ast::UnaryOperator::Minus: return "-";
+            case ast::UnaryOperator::Recip: return "/";
+            case ast::UnaryOperator::LogicalNot: return "!";
+            case ast::UnaryOperator::BitNot: return "~";
+            case ast::UnaryOperator::PreInc:
+            case ast::UnaryOperator::PostInc: return "++";
+            case ast::UnaryOperator::PreDec:
+            case ast::UnaryOperator::PostDec: return "--";
+        }
+        return "?";
+    }
+    static const char *operator_name(ast::BinaryOperator op){
+        switch(op){
+            case ast::BinaryOperator::Add: return "+";
+            case ast::BinaryOperator::Sub: return "-";
+            case ast::BinaryOperator::Mul: return "*";
+            case ast::BinaryOperator::Div: return "/";
+            case ast::BinaryOperator::Rem: return "%";
+            case ast::BinaryOperator::LeftShift: return "<<";
+            case ast::BinaryOperator::RightShift: return ">>";
+            case ast::BinaryOperator::ForwardShift: return ">>>";
+            case ast::BinaryOperator::BackwardShift: return "<<<";
+            case ast::BinaryOperator::Equal: return "==";
+            case ast::BinaryOperator::NotEqual: return "!=";
+            case ast::BinaryOperator::Less: return "<";
+            case ast::BinaryOperator::LessEqual: return "<=";
+            case ast::BinaryOperator::Greater: return ">";
+            case ast::BinaryOperator::GreaterEqual: return ">=";
+            case ast::BinaryOperator::LogicalAnd: return "&&";
+            case ast::BinaryOperator::LogicalOr: return "||";
+            case ast::BinaryOperator::BitAnd: return "&";
+            case ast::BinaryOperator::BitOr: return "|";
+            case ast::BinaryOperator::BitXor: return "^";
+            case ast::BinaryOperator::Assign: return "=";
+            case ast::BinaryOperator::AddAssign: return "+=";
+            case ast::BinaryOperator::SubAssign: return "-=";
+            case ast::BinaryOperator::MulAssign: return "*=";
+            case ast::BinaryOperator::DivAssign: return "/=";
+            case ast::BinaryOperator::RemAssign: return "%=";
+            case ast::BinaryOperator::BitAndAssign: return "&=";
+            case ast::BinaryOperator::BitOrAssign: return "|=";
+            case ast::BinaryOperator::BitXorAssign: return "^=";
+            case ast::BinaryOperator::LeftShiftAssign: return "<<=";
+            case ast::BinaryOperator::RightShiftAssign: return ">>=";
+            case ast::BinaryOperator::ForwardShiftAssign: return ">>>=";
+            case ast::BinaryOperator::BackwardShiftAssign: return "<<<=";
+        }
+        return "?";
+    }
+
+    /**
+     * @brief 左の被演算子に同じく連なる二項演算を，再帰せずに左の端から順に扱える演算子か（代入以外）
+     */
+    bool chains(ast::BinaryOperator op){
+        return op != ast::BinaryOperator::Assign && !compound(op);
+    }
+    /**
+     * @brief 複合代入演算子なら，対応する演算子を返す．
+     */
+    std::optional<ast::BinaryOperator> compound(ast::BinaryOperator op){
+        switch(op){
+            case ast::BinaryOperator::AddAssign: return ast::BinaryOperator::Add;
+            case ast::BinaryOperator::SubAssign: return ast::BinaryOperator::Sub;
+            case ast::BinaryOperator::MulAssign: return ast::BinaryOperator::Mul;
+            case ast::BinaryOperator::DivAssign: return ast::BinaryOperator::Div;
+            case ast::BinaryOperator::RemAssign: return ast::BinaryOperator::Rem;
+            case ast::BinaryOperator::BitAndAssign: return ast::BinaryOperator::BitAnd;
+            case ast::BinaryOperator::BitOrAssign: return ast::BinaryOperator::BitOr;
+            case ast::BinaryOperator::BitXorAssign: return ast::BinaryOperator::BitXor;
+            case ast::BinaryOperator::LeftShiftAssign: return ast::BinaryOperator::LeftShift;
+            case ast::BinaryOperator::RightShiftAssign: return ast::BinaryOperator::RightShift;
+            case ast::BinaryOperator::ForwardShiftAssign: return ast::BinaryOperator::ForwardShift;
+            case ast::BinaryOperator::BackwardShiftAssign: return ast::BinaryOperator::BackwardShift;
+            default: return std::nullopt;
+        }
+    }
+
+    /**
+     * @brief 関数を登録する．
+     * @return 関数の添字
+     * @throw error::Redefinition 組み込みの名前か，既に登録された関数と同じ名前だった．
+     */
+    std::size_t Defs::add(const ast::Identifier &name){
+        if(builtin(name.get_name()) || index.contains(name.get_name())){
+            throw error::make<error::Redefinition>(name.pos.clone(), std::string(symbol::name(name.get_name())));
+        }
+        index.emplace(name.get_name(), types.size());
+        types.push_back(type::no_type);
+        return types.size() - 1;
+    }
+    std::optional<std::size_t> Defs::find(symbol::Symbol name) const {
+        auto it = index.find(name);
+        if(it == index.end()) return std::nullopt;
+        return it->second;
+    }
+    type::TypeId Defs::get(std::size_t i) const {
+        return types[i];
+    }
+    void Defs::set(std::size_t i, type::TypeId id){
+        types[i] = id;
+    }
+    std::size_t Defs::size() const {
+        return types.size();
+    }
+
+    /**
+     * @brief コンストラクタ
+     *
+     * 組み込みの名前の型を作る．
+     */
+    Checker::Checker(type::TypeContext &context, Defs &defs):
+        context(context),
+        defs(defs),
+        scopes(1),
+        loops(0),
+        depth(0),
+        in_function(false),
+        result(type::no_type),
+        unreachable(false) {
+        const type::TypeId float_arg[] = {type::float_id};
+        for(auto [text, kind] : builtin_names){
+            type::TypeId id;
+            switch(kind){
+                case Builtin::Time: id = context.sound(type::float_id); break;
+                case Builtin::Pi: id = type::float_id; break;
+                default: id = context.func(float_arg, type::float_id);
+            }
+            builtins.emplace(symbol::intern(text), id);
+        }
+    }
+
+    /**
+     * @brief トップレベルの要素を検査する．
+     *
+     * 関数定義なら登録してから本体を検査する．
+     * エラーが起きた場合はスコープなどを最も外側に戻してから投げ直す．
+     */
+    void Checker::check(ast::TopLevel &item){
+        try {
+            unreachable = false;
+            item.check(*this);
+        }catch(...){
+            scopes.resize(1);
+            loops = 0;
+            depth = 0;
+            in_function = false;
+            throw;
+        }
+    }
+    type::TypeContext &Checker::get_context(){
+        return context;
+    }
+
+    /**
+     * @brief 関数を登録し，本体を検査する．
+     * @return 関数の型
+     * @throw error::Redefinition 同じ名前の変数，関数，組み込みの名前があった．
+     */
+    type::TypeId Checker::define(ast::Def &def){
+        auto &name = def.get_name();
+        if(find(name.get_name())) throw error::make<error::Redefinition>(name.pos.clone(), std::string(symbol::name(name.get_name())));
+        auto index = defs.add(name);
+        check_def(index, def);
+        return defs.get(index);
+    }
+    /**
+     * @brief 返り値の型注釈があれば，型注釈から関数の型を作る．
+     * @return 関数の型（返り値の型注釈がなければ `type::no_type`）
+     */
+    type::TypeId Checker::signature(const ast::Def &def){
+        if(!def.get_ret()) return type::no_type;
+        std::vector<type::TypeId> params;
+        for(auto [param, type] : def.get_params()) params.push_back(type->check(*this));
+        return context.func(params, def.get_ret()->check(*this));
+    }
+    /**
+     * @brief 登録済みの関数の本体を検査し，関数の型を `Defs` に書き込む．
+     *
+     * 本体は最も外側のスコープとは別の，引数だけを持つスコープで検査する．
+     * @param index `Defs` での添字
+     */
+    void Checker::check_def(std::size_t index, ast::Def &def){
+        auto declared = signature(def);
+        if(declared != type::no_type) defs.set(index, declared);
+        std::vector<std::unordered_map<symbol::Symbol, type::TypeId>> outer(1);
+        std::swap(outer, scopes);
+        auto restore = [&]{
+            std::swap(outer, scopes);
+            loops = 0;
+            in_function = false;
+            result = type::no_type;
+            unreachable = false;
+        };
+        try {
+            in_function = true;
+            result = def.get_ret() ? def.get_ret()->check(*this) : type::no_type;
+            std::vector<type::TypeId> params;
+            for(auto [param, type] : def.get_params()){
+                auto name = param->get_name();
+                if(builtins.contains(name) || defs.find(name) || scopes.back().contains(name)){
+                    throw error::make<error::Redefinition>(param->pos.clone(), std::string(symbol::name(name)));
+                }
+                param->type_id = type->check(*this);
+                params.push_back(param->type_id);
+                scopes.back().emplace(name, param->type_id);
+            }
+            def.check_body(*this);
+            if(result == type::no_type) throw error::make<error::MissingReturn>(def.pos.clone(), std::string(symbol::name(def.get_name().get_name())));
+            defs.set(index, context.func(params, result));
+        }catch(...){
+            restore();
+            throw;
+        }
+        restore();
+    }
+    /**
+     * @brief 型注釈の名前を型にする．
+     * @throw error::UnknownType 知らない名前だった．
+     */
+    type::TypeId Checker::resolve(symbol::Symbol name, const pos::Range &pos) const {
+        static const std::pair<symbol::Symbol, type::TypeId> names[] = {
+            {symbol::intern("bool"), type::bool_id},
+            {symbol::intern("int"), type::int_id},
+            {symbol::intern("rational"), type::rational_id},
+            {symbol::intern("float"), type::float_id},
+            {symbol::intern("str"), type::str_id},
+        };
+        for(auto [symbol, id] : names) if(symbol == name) return id;
+        throw error::make<error::UnknownType>(pos.clone());
+    }
+    /**
+     * @brief 型注釈 `Sound(T)` の型を作る．
+     * @throw error::UnknownType `T` が各時刻の値になれない型だった．
+     */
+    type::TypeId Checker::sound(type::TypeId id, const pos::Range &pos){
+        if(!is_sample(id)) throw error::make<error::UnknownType>(pos.clone());
+        return context.sound(id);
+    }
+
+    std::optional<type::TypeId> Checker::find(symbol::Symbol name) const {
+        for(auto it = scopes.rbegin(); it != scopes.rend(); ++it){
+            auto found = it->find(name);
+            if(found != it->end()) return found->second;
+        }
+        return std::nullopt;
+    }
+    /**
+     * @brief `Sound(X)` なら `lifted` を立てて `X` を，そうでなければそのまま返す．
+     */
+    type::TypeId Checker::unlift(type::TypeId id, bool &lifted) const {
+        if(auto sound = dynamic_cast<const type::Sound *>(&context.get(id))){
+            lifted = true;
+            return sound->get_result();
+        }
+        return id;
+    }
+    /**
+     * @brief `lifted` なら `Sound(id)` を返す．
+     */
+    type::TypeId Checker::lift(type::TypeId id, bool lifted) const {
+        return lifted ? context.sound(id) : id;
+    }
+
+    /**
+     * @brief 変数の型を返す．
+     * @throw error::UndefinedVariable 定義されていなかった．
+     */
+    type::TypeId Checker::lookup(symbol::Symbol name, const pos::Range &pos) const {
+        if(auto found = find(name)) return *found;
+        if(auto index = defs.find(name)){
+            auto id = defs.get(*index);
+            if(id == type::no_type) throw error::make<error::MissingReturnType>(pos.clone(), std::string(symbol::name(name)));
+            return id;
+        }
+        if(auto it = builtins.find(name); it != builtins.end()) return it->second;
+        throw error::make<error::UndefinedVariable>(pos.clone());
+    }
+    /**
+     * @brief 変数に代入する．定義されていなければ今のスコープに定義する．
+     * @param name 変数名
+     * @param value 代入する値の型
+     * @param target 代入先の位置
+     * @param source 代入する式の位置
+     * @return 変数の型
+     * @throw error::NotAssignable 関数か組み込みの名前だった．
+     * @throw error::TypeMismatch 変数の型に広げられない値だった．
+     */
+    type::TypeId Checker::assign(symbol::Symbol name, type::TypeId value, const pos::Range &target, const pos::Range &source){
+        if(builtins.contains(name) || defs.find(name)) throw error::make<error::NotAssignable>(target.clone());
+        if(auto found = find(name)){
+            if(!assignable(value, *found)){
+                throw error::make<error::TypeMismatch>(source.clone(), context.name(*found), context.name(value));
+            }
+            return *found;
+        }
+        scopes.back().emplace(name, value);
+        return value;
+    }
+    /**
+     * @brief `from` 型の値を `to` 型の変数や引数に渡せるなら `true`
+     *
+     * 数値は int < rational < float の順に広げられ，値は定数の音としても渡せる．
+     */
+    bool Checker::assignable(type::TypeId from, type::TypeId to) const {
+        if(from == to) return true;
+        if(is_numeric(from) && is_numeric(to)) return from < to;
+        bool lifted = false;
+        auto result = unlift(to, lifted);
+        if(!lifted) return false;
+        bool from_sound = false;
+        auto sample = unlift(from, from_sound);
+        return is_sample(sample) && assignable(sample, result);
+    }
+
+    /**
+     * @brief 単項演算の結果の型
+     * @throw error::InvalidOperands 適用できない型だった．
+     */
+    type::TypeId Checker::unary(ast::UnaryOperator op, type::TypeId operand, const pos::Range &pos){
+        bool lifted = false;
+        auto value = unlift(operand, lifted);
+        auto result = type::no_type;
+        switch(op){
+            case ast::UnaryOperator::Plus:
+            case ast::UnaryOperator::Minus:
+                if(is_numeric(value)) result = value;
+                break;
+            case ast::UnaryOperator::Recip:
+                if(is_numeric(value)) result = std::max(value, type::rational_id);
+                break;
+            case ast::UnaryOperator::LogicalNot:
+                if(value == type::bool_id) result = value;
+                break;
+            case ast::UnaryOperator::BitNot:
+                if(value == type::int_id) result = value;
+                break;
+            case ast::UnaryOperator::PreInc:
+            case ast::UnaryOperator::PreDec:
+            case ast::UnaryOperator::PostInc:
+            case ast::UnaryOperator::PostDec:
+                // 変数そのものを書き換えるので，音には使えない
+                if(is_numeric(value) && !lifted) result = value;
+                break;
+        }
+        if(result == type::no_type){
+            throw error::make<error::InvalidOperands>(pos.clone(), operator_name(op), std::vector{context.name(operand)});
+        }
+        return lift(result, lifted);
+    }
+    /**
+     * @brief 二項演算（代入を除く）の結果の型
+     *
+     * `>>>` と `<<<` は音を時間方向にずらす演算で，左辺は音，右辺は数値に限る．
+     * @throw error::InvalidOperands 適用できない型だった．
+     */
+    type::TypeId Checker::binary(ast::BinaryOperator op, type::TypeId left, type::TypeId right, const pos::Range &pos){
+        bool lifted = false;
+        auto l = unlift(left, lifted);
+        auto r = unlift(right, lifted);
+        bool numeric = is_numeric(l) && is_numeric(r);
+        auto result = type::no_type;
+        switch(op){
+            case ast::BinaryOperator::Add:
+                if(numeric) result = std::max(l, r);
+                else if(l == type::str_id && r == type::str_id && !lifted) result = type::str_id;
+                break;
+            case ast::BinaryOperator::Sub:
+            case ast::BinaryOperator::Mul:
+            case ast::BinaryOperator::Rem:
+                if(numeric) result = std::max(l, r);
+                break;
+            case ast::BinaryOperator::Div:
+                if(numeric) result = std::max({l, r, type::rational_id});
+                break;
+            case ast::BinaryOperator::LeftShift:
+            case ast::BinaryOperator::RightShift:
+                if(l == type::int_id && r == type::int_id) result = type::int_id;
+                break;
+            case ast::BinaryOperator::ForwardShift:
+            case ast::BinaryOperator::BackwardShift:
+                if(left != l && right == r && is_numeric(r)) return left;
+                break;
+            case ast::BinaryOperator::Equal:
+            case ast::BinaryOperator::NotEqual:
+                if(numeric || (l == r && (l == type::bool_id || (l == type::str_id && !lifted)))) result = type::bool_id;
+                break;
+            case ast::BinaryOperator::Less:
+            case ast::BinaryOperator::LessEqual:
+            case ast::BinaryOperator::Greater:
+            case ast::BinaryOperator::GreaterEqual:
+                if(numeric) result = type::bool_id;
+                break;
+            case ast::BinaryOperator::LogicalAnd:
+            case ast::BinaryOperator::LogicalOr:
+                if(l == type::bool_id && r == type::bool_id) result = type::bool_id;
+                break;
+            case ast::BinaryOperator::BitAnd:
+            case ast::BinaryOperator::BitOr:
+            case ast::BinaryOperator::BitXor:
+                if(l == r && (l == type::int_id || l == type::bool_id)) result = l;
+                break;
+            default:
+                break;
+        }
+        if(result == type::no_type){
+            throw error::make<error::InvalidOperands>(pos.clone(), operator_name(op), std::vector{context.name(left), context.name(right)});
+        }
+        return lift(result, lifted);
+    }
+    /**
+     * @brief 関数呼び出しの結果の型
+     *
+     * 値の引数に音を渡すと，各時刻の値に関数を適用した音になる．
+     * @param func 呼び出す式の型
+     * @param args 型検査済みの引数
+     * @param pos 呼び出す式の位置
+     * @throw error::NotCallable 関数でなかった．
+     * @throw error::WrongNumberOfArguments 引数の数が合わなかった．
+     * @throw error::TypeMismatch 引数の型が合わなかった．
+     */
+    type::TypeId Checker::call(type::TypeId func, std::span<ast::Expr *const> args, const pos::Range &pos){
+        auto type = dynamic_cast<const type::Func *>(&context.get(func));
+        if(!type) throw error::make<error::NotCallable>(pos.clone(), context.name(func));
+        auto params = type->get_args();
+        if(params.size() != args.size()) throw error::make<error::WrongNumberOfArguments>(pos.clone(), params.size(), args.size());
+        bool lifted = false;
+        for(std::size_t i = 0; i < args.size(); i++){
+            auto arg = args[i]->type_id;
+            if(assignable(arg, params[i])) continue;
+            bool sound = false;
+            auto sample = unlift(arg, sound);
+            if(sound && is_sample(params[i]) && is_sample(type->get_ret()) && assignable(sample, params[i])){
+                lifted = true;
+                continue;
+            }
+            throw error::make<error::TypeMismatch>(args[i]->pos.clone(), context.name(params[i]), context.name(arg));
+        }
+        return lift(type->get_ret(), lifted);
+    }
+    /**
+     * @brief `if` や `while` の条件の型を確かめる．
+     * @throw error::TypeMismatch `bool` でなかった．
+     */
+    void Checker::condition(type::TypeId cond, const pos::Range &pos) const {
+        if(cond != type::bool_id) throw error::make<error::TypeMismatch>(pos.clone(), "bool", context.name(cond));
+    }
+    /**
+     * @brief 関数から値を返す．
+     *
+     * 返り値の型がまだ決まっていなければ，最初に返した値の型にする．
+     * @param keyword `return` 文の位置
+     * @param expr 返す式の位置
+     * @throw error::OutsideFunction 関数の本体の外だった．
+     * @throw error::TypeMismatch 返り値の型に広げられない値だった．
+     */
+    void Checker::returns(type::TypeId value, const pos::Range &keyword, const pos::Range &expr){
+        if(!in_function) throw error::make<error::OutsideFunction>(keyword.clone());
+        if(result == type::no_type) result = value;
+        else if(!assignable(value, result)) throw error::make<error::TypeMismatch>(expr.clone(), context.name(result), context.name(value));
+        unreachable = true;
+    }
+    /**
+     * @brief 入れ子を 1 段深くする．
+     * @throw error::TooDeeplyNested `max_depth` を超えた．
+     */
+    void Checker::enter(const pos::Range &pos){
+        if(++depth > max_depth) throw error::make<error::TooDeeplyNested>(pos.clone());
+    }
+    void Checker::leave(){
+        depth--;
+    }
+    void Checker::enter_scope(){
+        scopes.emplace_back();
+    }
+    void Checker::leave_scope(){
+        scopes.pop_back();
+    }
+    void Checker::enter_loop(){
+        loops++;
+    }
+    void Checker::leave_loop(){
+        loops--;
+    }
+    /**
+     * @brief `break` や `continue` がループの中にあるか確かめる．
+     * @throw error::OutsideLoop ループの外だった．
+     */
+    void Checker::jump(const pos::Range &pos, const char *name){
+        if(loops == 0) throw error::make<error::OutsideLoop>(pos.clone(), name);
+        unreachable = true;
+    }
+    bool Checker::get_unreachable() const {
+        return unreachable;
+    }
+    void Checker::set_unreachable(bool value){
+        unreachable = value;
+    }
+
+    /**
+     * @brief 依存関係のグラフを強連結成分に分ける（Tarjan の方法）．
+     *
+     * 関数の数だけ深く再帰しないよう，明示的なスタックで辿る．
+     * @param deps `deps[i]` は頂点 `i` が依存する頂点
+     * @return 強連結成分の列（各成分の頂点は昇順）．依存される成分が先に来る．
+     */
+    static std::vector<std::vector<std::size_t>> components(const std::vector<std::vector<std::size_t>> &deps){
+        constexpr std::size_t unvisited = ~std::size_t{0};
+        const std::size_t n = deps.size();
+        std::vector<std::size_t> order(n, unvisited), low(n);
+        std::vector<bool> on_stack(n, false);
+        std::vector<std::size_t> stack;
+        //! 辿っている頂点と，次に見る辺の添字
+        std::vector<std::pair<std::size_t, std::size_t>> path;
+        std::vector<std::vector<std::size_t>> ret;
+        std::size_t counter = 0;
+        auto visit = [&](std::size_t v){
+            order[v] = low[v] = counter++;
+            stack.push_back(v);
+            on_stack[v] = true;
+            path.emplace_back(v, 0);
+        };
+        for(std::size_t root = 0; root < n; root++){
+            if(order[root] != unvisited) continue;
+            visit(root);
+            while(!path.empty()){
+                auto [v, edge] = path.back();
+                if(edge < deps[v].size()){
+                    path.back().second++;
+                    auto w = deps[v][edge];
+                    if(order[w] == unvisited) visit(w);
+                    else if(on_stack[w]) low[v] = std::min(low[v], order[w]);
+                    continue;
+                }
+                path.pop_back();
+                if(!path.empty()){
+                    auto parent = path.back().first;
+                    low[parent] = std::min(low[parent], low[v]);
+                }
+                if(low[v] == order[v]){
+                    auto &component = ret.emplace_back();
+                    std::size_t w;
+                    do {
+                        w = stack.back();
+                        stack.pop_back();
+                        on_stack[w] = false;
+                        component.push_back(w);
+                    } while(w != v);
+                    std::sort(component.begin(), component.end());
+                }
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * @brief ファイル全体を検査する．
+     *
+     * 関数定義を全て登録し，本体で参照する関数への依存関係のグラフを強連結成分に分ける．
+     * 依存先の成分が全て終わった成分から `threads` 個のスレッドで並列に検査し，
+     * 関数の型は `defs` に，式の型は `context` と AST に書き込む．
+     * 循環する成分の関数は，本体を検査する前に型注釈から型を決める．
+     * その後，関数定義以外の要素を先頭から順に検査する．
+     *
+     * エラーは成分ごとに記録し，依存先でエラーが起きた成分は検査しない．
+     * 関数のエラーと文のエラーのうちソースコードで最も前にある要素のものを投げるので，
+     * どのエラーを報告するかはスレッド数によらない．
+     * @param threads 2 以上なら，`context` は並行に使えるように作ったものでなければならない．
+     */
+    void check_program(type::TypeContext &context, Defs &defs, std::span<ast::TopLevel *const> items, unsigned threads){
+        const std::size_t base = defs.size();
+        std::vector<ast::Def *> list;
+        //! `list[i]` の `items` での添字
+        std::vector<std::size_t> item_of;
+        for(std::size_t i = 0; i < items.size(); i++){
+            if(auto def = dynamic_cast<ast::Def *>(items[i])){
+                list.push_back(def);
+                item_of.push_back(i);
+                defs.add(def->get_name());
+            }
+        }
+        std::vector<std::vector<std::size_t>> deps(list.size());
+        std::vector<symbol::Symbol> names;
+        for(std::size_t i = 0; i < list.size(); i++){
+            names.clear();
+            list[i]->collect_names(names, 0);
+            for(auto name : names){
+                if(auto index = defs.find(name); index && *index >= base) deps[i].push_back(*index - base);
+            }
+            std::sort(deps[i].begin(), deps[i].end());
+            deps[i].erase(std::unique(deps[i].begin(), deps[i].end()), deps[i].end());
+        }
+
+        struct Component {
+            std::vector<std::size_t> members;
+            //! この成分に依存する成分
+            std::vector<std::size_t> dependents;
+            //! まだ終わっていない依存先の成分の数
+            std::atomic<std::size_t> pending = 0;
+            std::atomic<bool> failed = false;
+            bool cyclic = false;
+            std::unique_ptr<error::Error> error;
+            //! エラーが起きた関数の `list` での添字
+            std::size_t error_at = 0;
+        };
+        auto members = components(deps);
+        std::vector<Component> graph(members.size());
+        std::vector<std::size_t> component_of(list.size());
+        for(std::size_t c = 0; c < members.size(); c++){
+            for(auto v : members[c]) component_of[v] = c;
+            graph[c].members = std::move(members[c]);
+        }
+        constexpr std::size_t none = ~std::size_t{0};
+        std::vector<std::size_t> seen(graph.size(), none);
+        for(std::size_t c = 0; c < graph.size(); c++){
+            for(auto v : graph[c].members){
+                for(auto w : deps[v]){
+                    auto d = component_of[w];
+                    if(d == c){
+                        graph[c].cyclic = true;
+                    }else if(seen[d] != c){
+                        seen[d] = c;
+                        graph[d].dependents.push_back(c);
+                        graph[c].pending++;
+                    }
+                }
+            }
+        }
+
+        auto run = [&](std::size_t c){
+            auto &component = graph[c];
+            if(component.failed) return;
+            auto current = component.members.front();
+            try {
+                Checker checker(context, defs);
+                if(component.cyclic){
+                    for(auto v : component.members){
+                        current = v;
+                        defs.set(base + v, checker.signature(*list[v]));
+                    }
+                }
+                for(auto v : component.members){
+                    current = v;
+                    checker.check_def(base + v, *list[v]);
+                }
+            }catch(std::unique_ptr<error::Error> &error){
+                component.error = std::move(error);
+                component.error_at = current;
+                component.failed = true;
+            }
+        };
+        if(threads <= 1 || graph.size() <= 1){
+            // 成分は依存先が先に並んでいる
+            for(std::size_t c = 0; c < graph.size(); c++){
+                run(c);
+                if(graph[c].failed) for(auto d : graph[c].dependents) graph[d].failed = true;
+            }
+        }else{
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::size_t done = 0;
+            std::function<void(std::size_t)> task;
+            // `task` などより先に破棄して，ワーカーが全て抜けるのを待つ
+            pool::Pool pool(threads);
+            task = [&](std::size_t c){
+                run(c);
+                for(auto d : graph[c].dependents){
+                    if(graph[c].failed) graph[d].failed = true;
+                    if(--graph[d].pending == 0) pool.submit([&task, d]{ task(d); });
+                }
+                std::lock_guard lock(mutex);
+                if(++done == graph.size()) finished.notify_one();
+            };
+            // ワーカーが `pending` を減らし始める前に，依存のない成分を数えておく
+            std::vector<std::size_t> roots;
+            for(std::size_t c = 0; c < graph.size(); c++){
+                if(graph[c].pending == 0) roots.push_back(c);
+            }
+            for(auto c : roots) pool.submit([&task, c]{ task(c); });
+            std::unique_lock lock(mutex);
+            finished.wait(lock, [&]{ return done == graph.size(); });
+        }
+        Component *first = nullptr;
+        for(auto &component : graph){
+            if(component.error && (!first || component.error_at < first->error_at)) first = &component;
+        }
+        // 最も前にある関数のエラーより前の文だけを検査し，文のエラーがあればそちらを先に報告する
+        const std::size_t end = first ? item_of[first->error_at] : items.size();
+        Checker checker(context, defs);
+        for(std::size_t i = 0; i < end; i++){
+            if(!dynamic_cast<ast::Def *>(items[i])) checker.check(*items[i]);
+        }
+        if(first) throw std::move(first->error);
+    }
+}
+
+namespace ast {
+    /**
+     * @brief 代入先が変数ならその式を返す．
+     * @throw error::NotAssignable 変数でなかった．
+     */
+    static Identifier &variable(Expr *target){
+        auto ident = dynamic_cast<Identifier *>(target);
+        if(!ident) throw error::make<error::NotAssignable>(target->pos.clone());
+        return *ident;
+    }
+
+    ::type::TypeId Identifier::check(::check::Checker &checker){
+        return type_id = checker.lookup(name, pos);
+    }
+    ::type::TypeId Number::check(::check::Checker &){
+        if(std::holds_alternative<literal::Int>(value)) return type_id = ::type::int_id;
+        if(std::holds_alternative<literal::Rational>(value)) return type_id = ::type::rational_id;
+        return type_id = ::type::float_id;
+    }
+    ::type::TypeId String::check(::check::Checker &){
+        return type_id = ::type::str_id;
+    }
+    ::type::TypeId Call::check(::check::Checker &checker){
+        checker.enter(pos);
+        auto callee = func->check(checker);
+        for(auto arg : args) arg->check(checker);
+        type_id = checker.call(callee, args, func->pos);
+        checker.leave();
+        return type_id;
+    }
+    ::type::TypeId UnaryOperation::check(::check::Checker &checker){
+        checker.enter(pos);
+        switch(op){
+            case UnaryOperator::PreInc:
+            case UnaryOperator::PreDec:
+            case UnaryOperator::PostInc:
+            case UnaryOperator::PostDec: {
+                auto &target = variable(operand);
+                type_id = checker.unary(op, target.check(checker), pos);
+                checker.assign(target.get_name(), type_id, target.pos, pos);
+                break;
+            }
+            default:
+                type_id = checker.unary(op, operand->check(checker), pos);
+        }
+        checker.leave();
+        return type_id;
+    }
+    ::type::TypeId BinaryOperation::check(::check::Checker &checker){
+        checker.enter(pos);
+        if(op == BinaryOperator::Assign){
+            auto &target = variable(left);
+            auto value = right->check(checker);
+            type_id = left->type_id = checker.assign(target.get_name(), value, target.pos, right->pos);
+        }else if(auto base = ::check::compound(op)){
+            auto &target = variable(left);
+            auto current = target.check(checker);
+            auto value = checker.binary(*base, current, right->check(checker), pos);
+            type_id = checker.assign(target.get_name(), value, target.pos, pos);
+        }else{
+            // 左の被演算子に連なる演算は入れ子ではないので，左の端から順に検査する
+            std::vector<BinaryOperation *> chain{this};
+            while(auto next = dynamic_cast<BinaryOperation *>(chain.back()->left)){
+                if(!::check::chains(next->op)) break;
+                chain.push_back(next);
+            }
+            auto value = chain.back()->left->check(checker);
+            for(auto it = chain.rbegin(); it != chain.rend(); ++it){
+                auto &node = **it;
+                auto r = node.right->check(checker);
+                value = node.type_id = checker.binary(node.op, value, r, node.pos);
+            }
+        }
+        checker.leave();
+        return type_id;
+    }
+    ::type::TypeId Index::check(::check::Checker &){
+        throw error::make<error::UnsupportedExpression>(pos.clone());
+    }
+    ::type::TypeId Group::check(::check::Checker &checker){
+        checker.enter(pos);
+        type_id = expr->check(checker);
+        checker.leave();
+        return type_id;
+    }
+    ::type::TypeId List::check(::check::Checker &){
+        throw error::make<error::UnsupportedExpression>(pos.clone());
+    }
+    ::type::TypeId Tuple::check(::check::Checker &){
+        throw error::make<error::UnsupportedExpression>(pos.clone());
+    }
+
+    void ExprStmt::check(::check::Checker &checker){
+        if(expr) expr->check(checker);
+    }
+    void Break::check(::check::Checker &checker){
+        checker.jump(pos, "break");
+    }
+    void Continue::check(::check::Checker &checker){
+        checker.jump(pos, "continue");
+    }
+    void Return::check(::check::Checker &checker){
+        checker.enter(pos);
+        checker.returns(expr->check(checker), pos, expr->pos);
+        checker.leave();
+    }
+    void Block::check(::check::Checker &checker){
+        checker.enter(pos);
+        checker.enter_scope();
+        for(auto stmt : stmts) stmt->check(checker);
+        checker.leave_scope();
+        checker.leave();
+    }
+    void While::check(::check::Checker &checker){
+        checker.enter(pos);
+        checker.condition(cond->check(checker), cond->pos);
+        // 条件が最初から偽なら本体を通らない
+        auto unreachable = checker.get_unreachable();
+        checker.enter_loop();
+        checker.enter_scope();
+        stmt->check(checker);
+        checker.leave_scope();
+        checker.leave_loop();
+        checker.set_unreachable(unreachable);
+        checker.leave();
+    }
+    void If::check(::check::Checker &checker){
+        checker.enter(pos);
+        checker.condition(cond->check(checker), cond->pos);
+        auto unreachable = checker.get_unreachable();
+        checker.enter_scope();
+        stmt_true->check(checker);
+        checker.leave_scope();
+        auto true_exits = checker.get_unreachable();
+        checker.set_unreachable(unreachable);
+        if(stmt_false){
+            checker.enter_scope();
+            stmt_false->check(checker);
+            checker.leave_scope();
+            checker.set_unreachable(unreachable || (true_exits && checker.get_unreachable()));
+        }
+        checker.leave();
+    }
+
+    void Def::check(::check::Checker &checker){
+        checker.define(*this);
+    }
+    void DefExpr::check_body(::check::Checker &checker){
+        checker.returns(expr->check(checker), pos, expr->pos);
+    }
+    void DefBlock::check_body(::check::Checker &checker){
+        body->check(checker);
+        if(!checker.get_unreachable()){
+            throw error::make<error::MissingReturn>(pos.clone(), std::string(symbol::name(name->get_name())));
+        }
+    }
+
+    namespace type {
+        ::type::TypeId Identifier::check(::check::Checker &checker) const {
+            return checker.resolve(name, pos);
+        }
+        ::type::TypeId List::check(::check::Checker &) const {
+            throw error::make<error::UnsupportedExpression>(pos.clone());
+        }
+        ::type::TypeId Sound::check(::check::Checker &checker) const {
+            return checker.sound(result->check(checker), pos);
+        }
+    }
+
+    /*
+     * 参照する名前を集める．`check` と同じ位置で入れ子を数え，
+     * `check::max_depth` より深い部分（`check` が検査しない部分）は辿らない．
+     */
+    void Identifier::collect_names(std::vector<symbol::Symbol> &names, std::size_t) const {
+        names.push_back(name);
+    }
+    void Number::collect_names(std::vector<symbol::Symbol> &, std::size_t) const {}
+    void String::collect_names(std::vector<symbol::Symbol> &, std::size_t) const {}
+    void Call::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        if(++depth > ::check::max_depth) return;
+        func->collect_names(names, depth);
+        for(auto arg : args) arg->collect_names(names, depth);
+    }
+    void UnaryOperation::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        if(++depth > ::check::max_depth) return;
+        operand->collect_names(names, depth);
+    }
+    void BinaryOperation::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        if(++depth > ::check::max_depth) return;
+        // `check` と同じく，左の被演算子に連なる演算は 1 段と数える
+        auto node = this;
+        if(::check::chains(op)){
+            while(auto next = dynamic_cast<const BinaryOperation *>(node->left)){
+                if(!::check::chains(next->op)) break;
+                node->right->collect_names(names, depth);
+                node = next;
+            }
+        }
+        node->left->collect_names(names, depth);
+        node->right->collect_names(names, depth);
+    }
+    // 添字，リスト，タプルはまだ検査できないので中を辿らない
+    void Index::collect_names(std::vector<symbol::Symbol> &, std::size_t) const {}
+    void List::collect_names(std::vector<symbol::Symbol> &, std::size_t) const {}
+    void Tuple::collect_names(std::vector<symbol::Symbol> &, std::size_t) const {}
+    void Group::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        if(++depth > ::check::max_depth) return;
+        expr->collect_names(names, depth);
+    }
+    void ExprStmt::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        if(expr) expr->collect_names(names, depth);
+    }
+    void Break::collect_names(std::vector<symbol::Symbol> &, std::size_t) const {}
+    void Continue::collect_names(std::vector<symbol::Symbol> &, std::size_t) const {}
+    void Return::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        if(++depth > ::check::max_depth) return;
+        expr->collect_names(names, depth);
+    }
+    void Block::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        if(++depth > ::check::max_depth) return;
+        for(auto stmt : stmts) stmt->collect_names(names, depth);
+    }
+    void While::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        if(++depth > ::check::max_depth) return;
+        cond->collect_names(names, depth);
+        stmt->collect_names(names, depth);
+    }
+    void If::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        if(++depth > ::check::max_depth) return;
+        cond->collect_names(names, depth);
+        stmt_true->collect_names(names, depth);
+        if(stmt_false) stmt_false->collect_names(names, depth);
+    }
+    void DefExpr::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        expr->collect_names(names, depth);
+    }
+    void DefBlock::collect_names(std::vector<symbol::Symbol> &names, std::size_t depth) const {
+        body->collect_names(names, depth);
+    }
+}
@@ -0,0 +1,127 @@
+/**
+ * @file check.hpp
+ * @brief 型検査と型推論を行う．
+ */
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hpp"
+#include "symbol.hpp"
+#include "type.hpp"
+
+/**
+ * @brief 型検査と型推論を行う．
+ *
+ * 各式の型を `type::TypeContext` で作り，`ast::Expr::type_id` に書き込む．
+ * 数値の型は int < rational < float の順に暗黙に広げる．
+ * 被演算子や引数に `Sound(X)` があれば演算を各時刻の値に持ち上げ，結果も `Sound(...)` になる．
+ * 例えば `sin(t * 440)` は `Sound(float)` で，バックエンドは各サンプルを `double` で計算できる．
+ */
+namespace check {
+    /**
+     * @brief これより深い入れ子の式や文は検査しない（ネイティブのスタックで再帰するため）
+     *
+     * 左結合の二項演算の連なり（`a + b + ... + z`）は再帰せずに辿るので，長さによらず 1 段と数える．
+     */
+    constexpr std::size_t max_depth = 16384;
+
+    /**
+     * @brief 組み込みの名前
+     */
+    enum class Builtin {
+        //! 時刻（秒）`Sound(float)`
+        Time,
+        //! 円周率 `float`
+        Pi,
+        Sin,
+        Cos,
+        Tan,
+        Exp,
+        Log,
+        Sqrt,
+        Floor,
+        Abs,
+    };
+    std::optional<Builtin> builtin(symbol::Symbol);
+    std::optional<ast::BinaryOperator> compound(ast::BinaryOperator);
+    bool chains(ast::BinaryOperator);
+
+    /**
+     * @brief トップレベルの関数定義の名前と型
+     *
+     * 関数は全て登録してから検査する．型は検査が終わるまで `type::no_type`．
+     * 異なる添字の型は別々のスレッドから書いてよい．
+     */
+    class Defs {
+        std::unordered_map<symbol::Symbol, std::size_t> index;
+        std::vector<type::TypeId> types;
+    public:
+        std::size_t add(const ast::Identifier &);
+        std::optional<std::size_t> find(symbol::Symbol) const;
+        type::TypeId get(std::size_t) const;
+        void set(std::size_t, type::TypeId);
+        std::size_t size() const;
+    };
+
+    /**
+     * @brief 型検査の状態
+     *
+     * 変数は最初の代入で定義され，その型はその後変わらない．
+     * ブロック，`if` の各分岐，`while` の本体はそれぞれスコープを作る．
+     * トップレベルの変数は，同じ `Checker` で検査する後続の文からも見える．
+     * 関数の本体からは引数，局所変数，関数，組み込みの名前だけが見え，トップレベルの変数は見えない．
+     * エラーは `std::unique_ptr<error::Error>` として投げる．
+     */
+    class Checker {
+        type::TypeContext &context;
+        Defs &defs;
+        std::vector<std::unordered_map<symbol::Symbol, type::TypeId>> scopes;
+        std::unordered_map<symbol::Symbol, type::TypeId> builtins;
+        std::size_t loops;
+        std::size_t depth;
+        //! 関数の本体を検査しているか
+        bool in_function;
+        //! 検査中の関数の返り値の型（まだ決まっていなければ `type::no_type`）
+        type::TypeId result;
+        //! 直前の文（`return`，`break`，`continue`）で制御が抜けたか
+        bool unreachable;
+        std::optional<type::TypeId> find(symbol::Symbol) const;
+        type::TypeId unlift(type::TypeId, bool &) const;
+        type::TypeId lift(type::TypeId, bool) const;
+    public:
+        Checker(type::TypeContext &, Defs &);
+        void check(ast::TopLevel &);
+        type::TypeContext &get_context();
+        type::TypeId define(ast::Def &);
+        type::TypeId signature(const ast::Def &);
+        void check_def(std::size_t, ast::Def &);
+        type::TypeId resolve(symbol::Symbol, const pos::Range &) const;
+        type::TypeId sound(type::TypeId, const pos::Range &);
+        type::TypeId lookup(symbol::Symbol, const pos::Range &) const;
+        type::TypeId assign(symbol::Symbol, type::TypeId, const pos::Range &, const pos::Range &);
+        bool assignable(type::TypeId, type::TypeId) const;
+        type::TypeId unary(ast::UnaryOperator, type::TypeId, const pos::Range &);
+        type::TypeId binary(ast::BinaryOperator, type::TypeId, type::TypeId, const pos::Range &);
+        type::TypeId call(type::TypeId, std::span<ast::Expr *const>, const pos::Range &);
+        void condition(type::TypeId, const pos::Range &) const;
+        void returns(type::TypeId, const pos::Range &, const pos::Range &);
+        void enter(const pos::Range &);
+        void leave();
+        void enter_scope();
+        void leave_scope();
+        void enter_loop();
+        void leave_loop();
+        void jump(const pos::Range &, const char *);
+        bool get_unreachable() const;
+        void set_unreachable(bool);
+    };
+
+    void check_program(type::TypeContext &, Defs &, std::span<ast::TopLevel *const>, unsigned);
+}
+
+#endif
@@ -12,6 +12,24 @@ namespace error {
      */
     UnexpectedCharacter::UnexpectedCharacter(pos::Pos pos):
         pos(pos) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 数値リテラルの位置
+     */
+    MalformedNumber::MalformedNumber(pos::Range pos):
+        pos(std::move(pos)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 数値リテラルの位置
+     */
+    NumberOutOfRange::NumberOutOfRange(pos::Range pos):
+        pos(std::move(pos)) {}
+    /**
+     * @brief コンストラクタ
+     * @param line 大きさを超えた行（0-indexed で）
+     */
+    SourceTooLarge::SourceTooLarge(std::size_t line):
+        line(line) {}
     /**
      * @brief コンストラクタ
      * @param poss コメントの開始位置．ネストしていた場合それら全て
@@ -106,126 +124,373 @@ namespace error {
     UnexpectedTokenAfterContinue::UnexpectedTokenAfterContinue(pos::Range keyword, pos::Range token):
         keyword(std::move(keyword)),
         token(std::move(token)) {}
+    EOFAfterReturn::EOFAfterReturn(pos::Range keyword):
+        keyword(std::move(keyword)) {}
+    UnexpectedTokenAfterReturn::UnexpectedTokenAfterReturn(pos::Range keyword, pos::Range token):
+        keyword(std::move(keyword)),
+        token(std::move(token)) {}
+    /**
+     * @brief コンストラクタ
+     * @param keyword `def` の位置
+     */
+    EOFInDef::EOFInDef(pos::Range keyword):
+        keyword(std::move(keyword)) {}
+    /**
+     * @brief コンストラクタ
+     * @param keyword `def` の位置
+     * @param token 予期しないトークンの位置
+     */
+    UnexpectedTokenInDef::UnexpectedTokenInDef(pos::Range keyword, pos::Range token):
+        keyword(std::move(keyword)),
+        token(std::move(token)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 変数の位置
+     */
+    UndefinedVariable::UndefinedVariable(pos::Range pos):
+        pos(std::move(pos)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 代入先の式の位置
+     */
+    NotAssignable::NotAssignable(pos::Range pos):
+        pos(std::move(pos)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 演算の位置
+     * @param op 演算子
+     * @param types 被演算子の型の名前
+     */
+    InvalidOperands::InvalidOperands(pos::Range pos, std::string op, std::vector<std::string> types):
+        pos(std::move(pos)),
+        op(std::move(op)),
+        types(std::move(types)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 式の位置
+     * @param expected 期待した型の名前
+     * @param found 実際の型の名前
+     */
+    TypeMismatch::TypeMismatch(pos::Range pos, std::string expected, std::string found):
+        pos(std::move(pos)),
+        expected(std::move(expected)),
+        found(std::move(found)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 呼び出された式の位置
+     * @param type その型の名前
+     */
+    NotCallable::NotCallable(pos::Range pos, std::string type):
+        pos(std::move(pos)),
+        type(std::move(type)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 関数呼び出しの位置
+     * @param expected 関数の型の引数の数
+     * @param found 渡された引数の数
+     */
+    WrongNumberOfArguments::WrongNumberOfArguments(pos::Range pos, std::size_t expected, std::size_t found):
+        pos(std::move(pos)),
+        expected(expected),
+        found(found) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 式の位置
+     */
+    UnsupportedExpression::UnsupportedExpression(pos::Range pos):
+        pos(std::move(pos)) {}
+    /**
+     * @brief コンストラクタ
+     * @param keyword キーワードの位置
+     * @param name キーワード（`break` か `continue`）
+     */
+    OutsideLoop::OutsideLoop(pos::Range keyword, const char *name):
+        keyword(std::move(keyword)),
+        name(name) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 深すぎた式や文の位置
+     */
+    TooDeeplyNested::TooDeeplyNested(pos::Range pos):
+        pos(std::move(pos)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 名前の位置
+     * @param name 名前
+     */
+    Redefinition::Redefinition(pos::Range pos, std::string name):
+        pos(std::move(pos)),
+        name(std::move(name)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 型注釈の位置
+     */
+    UnknownType::UnknownType(pos::Range pos):
+        pos(std::move(pos)) {}
+    /**
+     * @brief コンストラクタ
+     * @param keyword `return` 文の位置
+     */
+    OutsideFunction::OutsideFunction(pos::Range keyword):
+        keyword(std::move(keyword)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 関数定義の位置
+     * @param name 関数の名前
+     */
+    MissingReturn::MissingReturn(pos::Range pos, std::string name):
+        pos(std::move(pos)),
+        name(std::move(name)) {}
+    /**
+     * @brief コンストラクタ
+     * @param pos 関数を参照した位置
+     * @param name 関数の名前
+     */
+    MissingReturnType::MissingReturnType(pos::Range pos, std::string name):
+        pos(std::move(pos)),
+        name(std::move(name)) {}
+    IndirectCall::IndirectCall(pos::Range pos):
+        pos(std::move(pos)) {}
+    NotCompilable::NotCompilable(std::string name):
+        name(std::move(name)) {}
+    CodegenFailure::CodegenFailure(std::string message):
+        message(std::move(message)) {}
+    OutputFailure::OutputFailure(std::string path, std::string message):
+        path(std::move(path)),
+        message(std::move(message)) {}
     Unimplemented::Unimplemented(const char *file, unsigned line):
         file(file),
         line(line) {}
 
-    void UnexpectedCharacter::eprint(const std::deque<std::string> &log) const {
+    void UnexpectedCharacter::eprint(const pos::Source &log) const {
         std::cerr << "unexpected character at " << pos << std::endl;
         pos.eprint(log);
     }
-    void UnterminatedComment::eprint(const std::deque<std::string> &log) const {
+    void MalformedNumber::eprint(const pos::Source &log) const {
+        std::cerr << "malformed number at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void NumberOutOfRange::eprint(const pos::Source &log) const {
+        std::cerr << "number out of range at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void SourceTooLarge::eprint(const pos::Source &) const {
+        std::cerr << "source too large (over 4 GiB) at line " << line + 1 << std::endl;
+    }
+    void UnterminatedComment::eprint(const pos::Source &log) const {
         std::cerr << "unterminated comment" << std::endl;
         for(const pos::Pos &pos : poss){
             std::cerr << "started at " << pos << std::endl;
             pos.eprint(log);
         }
     }
-    void UnterminatedStringLiteral::eprint(const std::deque<std::string> &log) const {
+    void UnterminatedStringLiteral::eprint(const pos::Source &log) const {
         std::cerr << "unterminated string literal (started at " << pos << ")" << std::endl;
         pos.eprint(log);
     }   
-    void UnexpectedTokenAfterPrefix::eprint(const std::deque<std::string> &log) const {
+    void UnexpectedTokenAfterPrefix::eprint(const pos::Source &log) const {
         std::cerr << "unexpected token at " << token << std::endl;
         token.eprint(log);
         std::cerr << "after prefix operator at " << prefix << std::endl;
         prefix.eprint(log);
     }
-    void EOFAfterPrefix::eprint(const std::deque<std::string> &log) const {
+    void EOFAfterPrefix::eprint(const pos::Source &log) const {
         std::cerr << "expected token, found EOF after prefix operator at " << prefix << std::endl;
         prefix.eprint(log);
     }
-    void NoClosingBracket::eprint(const std::deque<std::string> &log) const {
+    void NoClosingBracket::eprint(const pos::Source &log) const {
         std::cerr << "no closing bracket corresponding to opening bracket at " << open << std::endl;
         open.eprint(log);
     }
-    void UnexpectedTokenInBracket::eprint(const std::deque<std::string> &log) const {
+    void UnexpectedTokenInBracket::eprint(const pos::Source &log) const {
         std::cerr << "unexpected token at " << token << std::endl;
         token.eprint(log);
         std::cerr << "bracket opened at " << open << std::endl;
         open.eprint(log);
     }
-    void DifferentClosingBracket::eprint(const std::deque<std::string> &log) const {
+    void DifferentClosingBracket::eprint(const pos::Source &log) const {
         std::cerr << "closing bracket at " << close << std::endl;
         close.eprint(log);
         std::cerr << "does not match opening bracket at " << open << std::endl;
         open.eprint(log);
     }
-    void UnexpectedTokenAfterInfix::eprint(const std::deque<std::string> &log) const {
+    void UnexpectedTokenAfterInfix::eprint(const pos::Source &log) const {
         std::cerr << "unexpected token at " << token << std::endl;
         token.eprint(log);
         std::cerr << "after infix operator at " << infix << std::endl;
         infix.eprint(log);
     }
-    void EOFAfterInfix::eprint(const std::deque<std::string> &log) const {
+    void EOFAfterInfix::eprint(const pos::Source &log) const {
         std::cerr << "expected token, found EOF after infix operator at " << infix << std::endl;
         infix.eprint(log);
     }
-    void EmptyItemInList::eprint(const std::deque<std::string> &log) const {
+    void EmptyItemInList::eprint(const pos::Source &log) const {
         std::cerr << "empty item, expected expression before comma at " << comma << std::endl;
         comma.eprint(log);
     }
-    void EmptyIndex::eprint(const std::deque<std::string> &log) const {
+    void EmptyIndex::eprint(const pos::Source &log) const {
         auto pos = open + close;
         std::cerr << "empty index at " << pos << std::endl;
         pos.eprint(log);
     }
-    void MultipleIndices::eprint(const std::deque<std::string> &log) const {
+    void MultipleIndices::eprint(const pos::Source &log) const {
         auto pos = open + close;
         std::cerr << "multiple indices at " << pos << std::endl;
         pos.eprint(log);
     }
-    void UnexpectedTokenAfterExpr::eprint(const std::deque<std::string> &log) const {
+    void UnexpectedTokenAfterExpr::eprint(const pos::Source &log) const {
         std::cerr << "unexpected token at " << token << std::endl;
         token.eprint(log);
         std::cerr << "expected semicolon after expression at " << expr << std::endl;
         expr.eprint(log);
     }
-    void EOFAfterExpr::eprint(const std::deque<std::string> &log) const {
+    void EOFAfterExpr::eprint(const pos::Source &log) const {
         std::cerr << "expected semicolon, found EOF after expression at " << expr << std::endl;
         expr.eprint(log);
     }
-    void EOFAfterIf::eprint(const std::deque<std::string> &log) const {
+    void EOFAfterIf::eprint(const pos::Source &log) const {
         std::cerr << "expected condition, found EOF after `if` at " << keyword << std::endl;
         keyword.eprint(log);
     }
-    void UnexpectedTokenAfterIf::eprint(const std::deque<std::string> &log) const {
+    void UnexpectedTokenAfterIf::eprint(const pos::Source &log) const {
         std::cerr << "unexpected token at " << token << std::endl;
         token.eprint(log);
         std::cerr << "expected condition after `if` at " << keyword << std::endl;
         keyword.eprint(log);
     }
-    void EOFAfterWhile::eprint(const std::deque<std::string> &log) const {
+    void EOFAfterWhile::eprint(const pos::Source &log) const {
         std::cerr << "expected condition, found EOF after `else` at " << keyword << std::endl;
         keyword.eprint(log);
     }
-    void UnexpectedTokenAfterWhile::eprint(const std::deque<std::string> &log) const {
+    void UnexpectedTokenAfterWhile::eprint(const pos::Source &log) const {
         std::cerr << "unexpected token at " << token << std::endl;
         token.eprint(log);
         std::cerr << "expected condition after `else` at " << keyword << std::endl;
         keyword.eprint(log);
     }
-    void EOFAfterBreak::eprint(const std::deque<std::string> &log) const {
+    void EOFAfterBreak::eprint(const pos::Source &log) const {
         std::cerr << "expected semicolon, found EOF after `break` at " << keyword << std::endl;
         keyword.eprint(log);
     }
-    void UnexpectedTokenAfterBreak::eprint(const std::deque<std::string> &log) const {
+    void UnexpectedTokenAfterBreak::eprint(const pos::Source &log) const {
         std::cerr << "unexpected token at " << token << std::endl;
         token.eprint(log);
         std::cerr << "expected semicolon after `break` at " << keyword << std::endl;
         keyword.eprint(log);
     }
-    void EOFAfterContinue::eprint(const std::deque<std::string> &log) const {
+    void EOFAfterContinue::eprint(const pos::Source &log) const {
         std::cerr << "expected semicolon, found EOF after `continue` at " << keyword << std::endl;
         keyword.eprint(log);
     }
-    void UnexpectedTokenAfterContinue::eprint(const std::deque<std::string> &log) const {
+    void UnexpectedTokenAfterContinue::eprint(const pos::Source &log) const {
         std::cerr << "unexpected token at " << token << std::endl;
         token.eprint(log);
         std::cerr << "expected semicolon after `continue` at " << keyword << std::endl;
         keyword.eprint(log);
     }
-    void Unimplemented::eprint(const std::deque<std::string> &log) const {
+    void EOFAfterReturn::eprint(const pos::Source &log) const {
+        std::cerr << "expected expression, found EOF after `return` at " << keyword << std::endl;
+        keyword.eprint(log);
+    }
+    void UnexpectedTokenAfterReturn::eprint(const pos::Source &log) const {
+        std::cerr << "unexpected token at " << token << std::endl;
+        token.eprint(log);
+        std::cerr << "expected expression after `return` at " << keyword << std::endl;
+        keyword.eprint(log);
+    }
+    void EOFInDef::eprint(const pos::Source &log) const {
+        std::cerr << "unexpected EOF in definition at " << keyword << std::endl;
+        keyword.eprint(log);
+    }
+    void UnexpectedTokenInDef::eprint(const pos::Source &log) const {
+        std::cerr << "unexpected token at " << token << std::endl;
+        token.eprint(log);
+        std::cerr << "in definition at " << keyword << std::endl;
+        keyword.eprint(log);
+    }
+    void UndefinedVariable::eprint(const pos::Source &log) const {
+        std::cerr << "undefined variable at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void NotAssignable::eprint(const pos::Source &log) const {
+        std::cerr << "cannot assign to expression at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void InvalidOperands::eprint(const pos::Source &log) const {
+        std::cerr << "invalid operand type" << (types.size() > 1 ? "s " : " ");
+        for(std::size_t i = 0; i < types.size(); i++){
+            std::cerr << (i ? " and `" : "`") << types[i] << "`";
+        }
+        std::cerr << " for `" << op << "` at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void TypeMismatch::eprint(const pos::Source &log) const {
+        std::cerr << "expected `" << expected << "`, found `" << found << "` at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void NotCallable::eprint(const pos::Source &log) const {
+        std::cerr << "cannot call a value of type `" << type << "` at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void WrongNumberOfArguments::eprint(const pos::Source &log) const {
+        std::cerr << "expected " << expected << " argument" << (expected == 1 ? "" : "s") << ", found " << found << " at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void UnsupportedExpression::eprint(const pos::Source &log) const {
+        std::cerr << "lists, tuples and indexing cannot be type-checked yet at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void OutsideLoop::eprint(const pos::Source &log) const {
+        std::cerr << "`" << name << "` outside of a loop at " << keyword << std::endl;
+        keyword.eprint(log);
+    }
+    void TooDeeplyNested::eprint(const pos::Source &log) const {
+        std::cerr << "nested too deeply to type-check at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void Redefinition::eprint(const pos::Source &log) const {
+        std::cerr << "`" << name << "` is already defined at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void UnknownType::eprint(const pos::Source &log) const {
+        std::cerr << "unknown type at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void OutsideFunction::eprint(const pos::Source &log) const {
+        std::cerr << "`return` outside of a function at " << keyword << std::endl;
+        keyword.eprint(log);
+    }
+    void MissingReturn::eprint(const pos::Source &log) const {
+        std::cerr << "function `" << name << "` may end without `return` at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void MissingReturnType::eprint(const pos::Source &log) const {
+        std::cerr << "return type of recursive function `" << name << "` must be annotated at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void IndirectCall::eprint(const pos::Source &log) const {
+        std::cerr << "only functions referred to by name can be called yet at " << pos << std::endl;
+        pos.eprint(log);
+    }
+    void DivisionByZero::eprint(const pos::Source &) const {
+        std::cerr << "integer division by zero" << std::endl;
+    }
+    void StackOverflow::eprint(const pos::Source &) const {
+        std::cerr << "stack overflow: function calls are nested too deeply" << std::endl;
+    }
+    void NotRenderable::eprint(const pos::Source &) const {
+        std::cerr << "the sound uses values that cannot be rendered" << std::endl;
+    }
+    void NotCompilable::eprint(const pos::Source &) const {
+        std::cerr << "`" << name << "` uses values that cannot be compiled to native code" << std::endl;
+    }
+    void CodegenFailure::eprint(const pos::Source &) const {
+        std::cerr << "code generation failed: " << message << std::endl;
+    }
+    void OutputFailure::eprint(const pos::Source &) const {
+        std::cerr << "cannot write `" << path << "`: " << message << std::endl;
+    }
+    void Unimplemented::eprint(const pos::Source &log) const {
         std::cerr << "error message unimplemented. file \"" << file << "\" line " << line << std::endl;
     }
 }
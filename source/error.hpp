@@ -5,8 +5,9 @@
 #ifndef ERROR_HPP
 #define ERROR_HPP
 
-#include <deque>
 #include <memory>
+#include <string>
+#include <vector>
 #include "pos.hpp"
 
 /**
@@ -23,7 +24,7 @@ namespace error {
          * @brief 標準エラー出力でエラーの内容を説明する．
          * @param source ソースコードの文字列
          */
-        void virtual eprint(const std::deque<std::string> &source) const = 0;
+        void virtual eprint(const pos::Source &source) const = 0;
     };
 
     /**
@@ -44,7 +45,39 @@ namespace error {
         pos::Pos pos;
     public:
         UnexpectedCharacter(pos::Pos);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
+    };
+
+    /**
+     * @brief Lexer：数値リテラルが文法に合わない．
+     * 数字の後に識別子が続いた，指数部に数字がない，小数点が複数あるなど．
+     */
+    class MalformedNumber : public Error {
+        pos::Range pos;
+    public:
+        MalformedNumber(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+
+    /**
+     * @brief Lexer：数値リテラルの値が表せる範囲を超えた．
+     */
+    class NumberOutOfRange : public Error {
+        pos::Range pos;
+    public:
+        NumberOutOfRange(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+
+    /**
+     * @brief Lexer：ソースコードが位置を 32 bit で表せる大きさ（4 GiB）を超えた．
+     * 標準入力では，手放していない行（処理中のトップレベルの要素とその先読み）の合計が超えた．
+     */
+    class SourceTooLarge : public Error {
+        std::size_t line;
+    public:
+        SourceTooLarge(std::size_t);
+        void eprint(const pos::Source &) const override;
     };
 
     /**
@@ -54,7 +87,7 @@ namespace error {
         std::vector<pos::Pos> poss;
     public:
         UnterminatedComment(std::vector<pos::Pos>);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
 
     /**
@@ -64,7 +97,7 @@ namespace error {
         pos::Pos pos;
     public:
         UnterminatedStringLiteral(pos::Pos);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
 
     /**
@@ -74,7 +107,7 @@ namespace error {
         pos::Range prefix, token;
     public:
         UnexpectedTokenAfterPrefix(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
 
     /**
@@ -84,7 +117,7 @@ namespace error {
         pos::Range prefix;
     public:
         EOFAfterPrefix(pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
 
     /**
@@ -93,7 +126,7 @@ namespace error {
         pos::Range open;
     public:
         NoClosingBracket(pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
 
     /**
@@ -102,7 +135,7 @@ namespace error {
         pos::Range open, token;
     public:
         UnexpectedTokenInBracket(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
 
     /**
@@ -111,7 +144,7 @@ namespace error {
         pos::Range open, close;
     public:
         DifferentClosingBracket(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
 
     /**
@@ -121,7 +154,7 @@ namespace error {
         pos::Range infix, token;
     public:
         UnexpectedTokenAfterInfix(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
 
     /**
@@ -131,7 +164,7 @@ namespace error {
         pos::Range infix;
     public:
         EOFAfterInfix(pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      * @brief parser：
@@ -140,19 +173,19 @@ namespace error {
         pos::Range comma;
     public:
         EmptyItemInList(pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     class EmptyIndex : public Error {
         pos::Range open, close;
     public:
         EmptyIndex(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     class MultipleIndices : public Error {
         pos::Range open, close;
     public:
         MultipleIndices(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      * @brief parser：
@@ -161,7 +194,7 @@ namespace error {
         pos::Range expr;
     public:
         EOFAfterExpr(pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      * @brief parser：
@@ -170,7 +203,7 @@ namespace error {
         pos::Range expr, token;
     public:
         UnexpectedTokenAfterExpr(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      *
@@ -179,7 +212,7 @@ namespace error {
         pos::Range keyword;
     public:
         EOFAfterIf(pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      *
@@ -188,7 +221,7 @@ namespace error {
         pos::Range keyword, token;
     public:
         UnexpectedTokenAfterIf(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      *
@@ -197,7 +230,7 @@ namespace error {
         pos::Range keyword;
     public:
         EOFAfterWhile(pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      *
@@ -206,7 +239,7 @@ namespace error {
         pos::Range keyword, token;
     public:
         UnexpectedTokenAfterWhile(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      *
@@ -215,7 +248,7 @@ namespace error {
         pos::Range keyword;
     public:
         EOFAfterBreak(pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      *
@@ -224,7 +257,7 @@ namespace error {
         pos::Range keyword, token;
     public:
         UnexpectedTokenAfterBreak(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      *
@@ -233,7 +266,7 @@ namespace error {
         pos::Range keyword;
     public:
         EOFAfterContinue(pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
     /**
      *
@@ -242,7 +275,235 @@ namespace error {
         pos::Range keyword, token;
     public:
         UnexpectedTokenAfterContinue(pos::Range, pos::Range);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief Parser：`return` の後に式がない．
+     */
+    class EOFAfterReturn : public Error {
+        pos::Range keyword;
+    public:
+        EOFAfterReturn(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief Parser：`return` の後に式でないトークンがあった．
+     */
+    class UnexpectedTokenAfterReturn : public Error {
+        pos::Range keyword, token;
+    public:
+        UnexpectedTokenAfterReturn(pos::Range, pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief Parser：関数定義の途中で EOF に達した．
+     */
+    class EOFInDef : public Error {
+        pos::Range keyword;
+    public:
+        EOFInDef(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief Parser：関数定義の文法に合わないトークンがあった．
+     */
+    class UnexpectedTokenInDef : public Error {
+        pos::Range keyword, token;
+    public:
+        UnexpectedTokenInDef(pos::Range, pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：定義されていない変数を参照した．
+     */
+    class UndefinedVariable : public Error {
+        pos::Range pos;
+    public:
+        UndefinedVariable(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：変数でないもの（組み込みの名前を含む）に代入しようとした．
+     */
+    class NotAssignable : public Error {
+        pos::Range pos;
+    public:
+        NotAssignable(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：演算子を適用できない型だった．
+     */
+    class InvalidOperands : public Error {
+        pos::Range pos;
+        std::string op;
+        std::vector<std::string> types;
+    public:
+        InvalidOperands(pos::Range, std::string, std::vector<std::string>);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：期待した型と異なる型の式があった．
+     */
+    class TypeMismatch : public Error {
+        pos::Range pos;
+        std::string expected, found;
+    public:
+        TypeMismatch(pos::Range, std::string, std::string);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：関数でない値を呼び出そうとした．
+     */
+    class NotCallable : public Error {
+        pos::Range pos;
+        std::string type;
+    public:
+        NotCallable(pos::Range, std::string);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：引数の数が関数の型と合わない．
+     */
+    class WrongNumberOfArguments : public Error {
+        pos::Range pos;
+        std::size_t expected, found;
+    public:
+        WrongNumberOfArguments(pos::Range, std::size_t, std::size_t);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：まだ型を付けられない式（リスト，タプル，添字）があった．
+     */
+    class UnsupportedExpression : public Error {
+        pos::Range pos;
+    public:
+        UnsupportedExpression(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：ループの外に `break` や `continue` があった．
+     */
+    class OutsideLoop : public Error {
+        pos::Range keyword;
+        const char *name;
+    public:
+        OutsideLoop(pos::Range, const char *);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：入れ子が深すぎて検査できない．
+     */
+    class TooDeeplyNested : public Error {
+        pos::Range pos;
+    public:
+        TooDeeplyNested(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：関数や引数の名前が既に定義されていた（組み込みの名前を含む）．
+     */
+    class Redefinition : public Error {
+        pos::Range pos;
+        std::string name;
+    public:
+        Redefinition(pos::Range, std::string);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：型注釈が知らない型を指していた．
+     */
+    class UnknownType : public Error {
+        pos::Range pos;
+    public:
+        UnknownType(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：関数定義の外に `return` があった．
+     */
+    class OutsideFunction : public Error {
+        pos::Range keyword;
+    public:
+        OutsideFunction(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：`return` せずに本体の終わりに達しうる．
+     */
+    class MissingReturn : public Error {
+        pos::Range pos;
+        std::string name;
+    public:
+        MissingReturn(pos::Range, std::string);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 型検査：返り値の型がまだ決まっていない関数を（再帰的に）参照した．
+     */
+    class MissingReturnType : public Error {
+        pos::Range pos;
+        std::string name;
+    public:
+        MissingReturnType(pos::Range, std::string);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief IR への変換：関数の名前以外の式を呼び出した（変数に入れた関数の呼び出しはまだ変換できない）．
+     */
+    class IndirectCall : public Error {
+        pos::Range pos;
+    public:
+        IndirectCall(pos::Range);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 実行時：int を 0 で割った余りを求めた．
+     */
+    class DivisionByZero : public Error {
+    public:
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 実行時：関数呼び出しが深すぎてスタックに収まらなかった．
+     */
+    class StackOverflow : public Error {
+    public:
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief 実行時：ブロックごとに評価できない値や関数を使う音を書き出そうとした．
+     */
+    class NotRenderable : public Error {
+    public:
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief コード生成：ネイティブコードで扱えない値を使う関数や音をコンパイルしようとした．
+     */
+    class NotCompilable : public Error {
+        std::string name;
+    public:
+        NotCompilable(std::string);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief コード生成：LLVM がエラーを返した．
+     */
+    class CodegenFailure : public Error {
+        std::string message;
+    public:
+        CodegenFailure(std::string);
+        void eprint(const pos::Source &) const override;
+    };
+    /**
+     * @brief コード生成：出力するファイルを書けなかった（リンクの失敗を含む）．
+     */
+    class OutputFailure : public Error {
+        std::string path, message;
+    public:
+        OutputFailure(std::string, std::string);
+        void eprint(const pos::Source &) const override;
     };
     /**
      * @brief エラーメッセージが未実装
@@ -252,7 +513,7 @@ namespace error {
         unsigned line;
     public:
         Unimplemented(const char *, unsigned);
-        void eprint(const std::deque<std::string> &) const override;
+        void eprint(const pos::Source &) const override;
     };
 }
 
@@ -0,0 +1,209 @@
+/**
+ * @file input.cpp
+ */
+#include "input.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace input {
+    /**
+     * @brief `line` 行目より前の行がもうトークンから参照されないことを伝える．
+     *
+     * 既定では何もしない．手放した行もエラー出力のために参照できなければならない．
+     * @return 位置の原点を後ろにずらしたバイト数（ずらさなければ 0）
+     */
+    std::uint32_t Input::release(std::size_t){
+        return 0;
+    }
+
+    /**
+     * @brief コンストラクタ
+     * @param source 入力
+     * @param prompt 各行を読む前にプロンプトを表示するか
+     */
+    Stream::Stream(std::istream &source, bool prompt):
+        source(source),
+        prompt(prompt),
+        first_kept(0),
+        spill(nullptr),
+        spill_index(nullptr),
+        spill_failed(false),
+        next_reloaded(0) {}
+    Stream::~Stream(){
+        if(spill) std::fclose(spill);
+        if(spill_index) std::fclose(spill_index);
+    }
+
+    std::optional<std::string_view> Stream::read_line(bool is_first_token){
+        if(!source) return std::nullopt;
+        // 直前の行の改行文字の次が行頭
+        line_starts.push_back(log.empty() ? 0 : line_starts.back() + log.back().size() + 1);
+        // log に空の std::string を追加し，1 行読んで格納
+        log.emplace_back();
+        if(prompt){
+            std::cout << (is_first_token ? "> " : "+ ");
+        }
+        std::getline(source, log.back());
+        return log.back();
+    }
+    /**
+     * @brief `line` 行目より前の行を一時ファイルに書き出し，メモリから手放す．
+     *
+     * 最後に読んだ行は字句解析の途中なので残す．
+     * 残した最初の行の行頭を位置の原点にするので，呼び出し側は持っている位置を戻り値の分だけ前にずらす．
+     * 一時ファイルを作れなかったり書き込みに失敗したりした場合は，以降は全てメモリに残す．
+     * @return 位置の原点を後ろにずらしたバイト数
+     */
+    std::uint32_t Stream::release(std::size_t line){
+        if(size() == 0) return 0;
+        line = std::min(line, size() - 1);
+        if(spill_failed || first_kept >= line) return 0;
+        if(!spill) spill = std::tmpfile();
+        if(!spill_index) spill_index = std::tmpfile();
+        auto origin = line_starts.front();
+        for(; first_kept < line; first_kept++){
+            auto &text = log.front();
+            auto start = line_starts.front();
+            if(
+                !spill || !spill_index
+                || std::fwrite(text.data(), 1, text.size(), spill) != text.size() || std::fputc('\n', spill) == EOF
+                || std::fwrite(&start, sizeof start, 1, spill_index) != 1
+            ){
+                spill_failed = true;
+                break;
+            }
+            log.pop_front();
+            line_starts.pop_front();
+        }
+        // 残した行の長さの合計は 32 bit に収まっている
+        return static_cast<std::uint32_t>(line_starts.front() - origin);
+    }
+    std::size_t Stream::size() const {
+        return first_kept + line_starts.size();
+    }
+    /**
+     * @brief 行を取り出す．
+     *
+     * 手放した行は一時ファイルから読み戻す．読み戻した行は後の数回の呼び出しの間だけ有効．
+     */
+    std::string_view Stream::operator[](std::size_t line) const {
+        if(line >= first_kept) return log[line - first_kept];
+        for(auto &[index, text] : reloaded){
+            if(index == line && !text.empty()) return std::string_view(text).substr(0, text.size() - 1);
+        }
+        auto &[index, text] = reloaded[next_reloaded];
+        next_reloaded = (next_reloaded + 1) % reloaded.size();
+        index = line;
+        // 行頭と次の行頭を索引から読み，改行文字まで読んで最後に取り除く（空行でも空でない文字列にしておく）
+        std::fflush(spill);
+        std::fflush(spill_index);
+        std::uint64_t starts[2] = {0, line_starts.front()};
+        auto count = line + 1 < first_kept ? 2 : 1;
+        auto bytes = static_cast<ssize_t>(count * sizeof(std::uint64_t));
+        if(pread(fileno(spill_index), starts, static_cast<std::size_t>(bytes), static_cast<off_t>(line * sizeof(std::uint64_t))) != bytes){
+            text.assign(1, '\n');
+        }else{
+            text.assign(starts[1] - starts[0], '\0');
+            auto n = pread(fileno(spill), text.data(), text.size(), static_cast<off_t>(starts[0]));
+            if(n != static_cast<ssize_t>(text.size())) text.assign(1, '\n');
+        }
+        return std::string_view(text).substr(0, text.size() - 1);
+    }
+    /**
+     * @brief 行頭の，位置の原点からのバイト数を返す（手放した行は 0）．
+     */
+    std::size_t Stream::line_start(std::size_t line) const {
+        if(line < first_kept) return 0;
+        return line_starts[line - first_kept] - line_starts.front();
+    }
+
+    /**
+     * @brief コンストラクタ
+     *
+     * 開けなかった場合は `operator bool` が `false` を返す．
+     * @param path ファイルのパス
+     */
+    MappedFile::MappedFile(const char *path):
+        data(nullptr),
+        length(0),
+        mapped(false),
+        opened(false),
+        next_line(0)
+    {
+        int fd = open(path, O_RDONLY);
+        if(fd < 0) return;
+        struct stat st;
+        if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+            void *addr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if(addr != MAP_FAILED){
+                madvise(addr, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+                data = static_cast<const char *>(addr);
+                length = static_cast<std::size_t>(st.st_size);
+                mapped = true;
+            }
+        }
+        if(!mapped){
+            // mmap できなかったので読み込む
+            char chunk[65536];
+            while(true){
+                auto n = read(fd, chunk, sizeof chunk);
+                if(n < 0){
+                    close(fd);
+                    return;
+                }
+                if(n == 0) break;
+                buffer.append(chunk, static_cast<std::size_t>(n));
+            }
+            data = buffer.data();
+            length = buffer.size();
+        }
+        close(fd);
+        opened = true;
+        // 行頭のオフセットの表を作る
+        line_starts.push_back(0);
+        for(std::size_t offset = 0; offset < length; ){
+            auto newline = static_cast<const char *>(std::memchr(data + offset, '\n', length - offset));
+            if(!newline) break;
+            offset = static_cast<std::size_t>(newline - data) + 1;
+            line_starts.push_back(offset);
+        }
+    }
+    MappedFile::~MappedFile(){
+        if(mapped) munmap(const_cast<char *>(data), length);
+    }
+    /**
+     * @brief ファイルを開けたかどうか
+     */
+    MappedFile::operator bool() const {
+        return opened;
+    }
+    /**
+     * @brief ファイル全体の内容
+     */
+    std::string_view MappedFile::contents() const {
+        return std::string_view(data, length);
+    }
+
+    std::optional<std::string_view> MappedFile::read_line(bool){
+        if(next_line == line_starts.size()) return std::nullopt;
+        return (*this)[next_line++];
+    }
+    std::size_t MappedFile::size() const {
+        return line_starts.size();
+    }
+    std::string_view MappedFile::operator[](std::size_t line) const {
+        std::size_t start = line_starts[line];
+        std::size_t end = line + 1 < line_starts.size() ? line_starts[line + 1] - 1 : length;
+        return std::string_view(data + start, end - start);
+    }
+    std::size_t MappedFile::line_start(std::size_t line) const {
+        return line_starts[line];
+    }
+}
@@ -0,0 +1,112 @@
+/**
+ * @file input.hpp
+ * @brief ソースコードの入力元を定義する．
+ */
+#ifndef INPUT_HPP
+#define INPUT_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <optional>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pos.hpp"
+
+/**
+ * @brief ソースコードの入力元を定義する．
+ */
+namespace input {
+    /**
+     * @brief 全ての入力元の基底クラス
+     *
+     * Lexer は `read_line` で 1 行ずつ受け取る．
+     * 読んだ行は `pos::Source` としてエラー出力に用いられるので，
+     * `read_line` の返す `std::string_view` は入力元が生きている間有効である．
+     */
+    class Input : public pos::Source {
+    public:
+        /**
+         * @brief 次の 1 行を読む．
+         * @param is_first_token 文の最初のトークンを待っているか（プロンプトの表示に用いる）
+         * @return 改行文字を含まない 1 行．EOF に達していれば `std::nullopt`．
+         */
+        virtual std::optional<std::string_view> read_line(bool is_first_token) = 0;
+        virtual std::uint32_t release(std::size_t);
+    };
+
+    /**
+     * @brief `std::istream` から 1 行ずつ読む．
+     *
+     * 標準入力のように全体を前もって読めない場合に用いる．
+     * 読んだ行は `release` されるまで `log` に残し，`release` された行は一時ファイルに追記して手放す．
+     * 一時ファイルには行を改行区切りでそのまま書くので，読み始めからの行頭のオフセットがそのまま索引になる．
+     * 手放した行の索引も別の一時ファイルに書くので，メモリに残るのは手放していない行の分だけである．
+     * 手放した行もエラー出力のために行番号で読み戻せる．
+     *
+     * 手放すたびに，残した最初の行の行頭が位置の原点 0 になるよう位置をずらす（手放した行の行頭は 0 とする）．
+     * したがって入力全体の大きさに上限はなく，位置を 32 bit で表せなければならないのは，
+     * 手放していない行（処理中のトップレベルの要素とその先読み）の合計だけである．
+     */
+    class Stream : public Input {
+        std::istream &source;
+        bool prompt;
+        //! `first_kept` 行目以降の行
+        std::deque<std::string> log;
+        std::size_t first_kept;
+        //! `first_kept` 行目以降の行頭の，読み始めからのオフセット
+        std::deque<std::uint64_t> line_starts;
+        //! 手放した行の書き出し先（まだ作っていなければ `nullptr`）
+        std::FILE *spill;
+        //! 手放した行の行頭のオフセット（`std::uint64_t` を行の順に並べる）の書き出し先
+        std::FILE *spill_index;
+        //! 書き出しに失敗したら以降は手放さない
+        bool spill_failed;
+        //! 読み戻した行（直近のいくつかだけ残す）
+        mutable std::array<std::pair<std::size_t, std::string>, 4> reloaded;
+        mutable std::size_t next_reloaded;
+    public:
+        Stream(std::istream &, bool);
+        Stream(const Stream &) = delete;
+        Stream &operator=(const Stream &) = delete;
+        ~Stream() override;
+        std::optional<std::string_view> read_line(bool) override;
+        std::uint32_t release(std::size_t) override;
+        std::size_t size() const override;
+        std::string_view operator[](std::size_t) const override;
+        std::size_t line_start(std::size_t) const override;
+    };
+
+    /**
+     * @brief ファイル全体を mmap して読む．
+     *
+     * 開いた時点で行頭のオフセットの表を作り，各行はマッピングを直接指す．
+     * 通常のファイルでない（パイプなど）ため mmap できなかった場合は，全体を一度だけ読み込む．
+     */
+    class MappedFile : public Input {
+        const char *data;
+        std::size_t length;
+        bool mapped;
+        bool opened;
+        std::string buffer;
+        std::vector<std::size_t> line_starts;
+        std::size_t next_line;
+    public:
+        MappedFile(const char *);
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile() override;
+        explicit operator bool() const;
+        std::string_view contents() const;
+        std::optional<std::string_view> read_line(bool) override;
+        std::size_t size() const override;
+        std::string_view operator[](std::size_t) const override;
+        std::size_t line_start(std::size_t) const override;
+    };
+}
+
+#endif
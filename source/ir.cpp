@@ -4,9 +4,376 @@
 #include "ir.hpp"
 
 namespace ir {
-    Func::~Func() = default;
-    Term::~Term() = default;
+    Expr::Expr(type::TypeId type): type(type) {}
     Expr::~Expr() = default;
+    type::TypeId Expr::get_type() const {
+        return type;
+    }
     Value::~Value() = default;
+    Func::~Func() = default;
     Sound::~Sound() = default;
+    Term::~Term() = default;
+
+    T::T(type::TypeId type): Sound(type) {}
+    Const::Const(type::TypeId type, std::shared_ptr<Value> value): Sound(type), value(std::move(value)) {}
+    const std::shared_ptr<Value> &Const::get_value() const {
+        return value;
+    }
+    App::App(type::TypeId type, std::shared_ptr<Func> func, std::vector<std::shared_ptr<Sound>> args): Sound(type), func(std::move(func)), args(std::move(args)) {}
+    /**
+     * @brief 実行時に作った音は長い連なりになりうるので，再帰せずに破棄する．
+     *
+     * 他から参照されていない引数の `App` は，その引数を先に取り出してから破棄する．
+     */
+    App::~App(){
+        auto pending = std::move(args);
+        while(!pending.empty()){
+            auto sound = std::move(pending.back());
+            pending.pop_back();
+            if(sound.use_count() != 1) continue;
+            if(auto app = dynamic_cast<App *>(sound.get())){
+                for(auto &arg : app->args) pending.push_back(std::move(arg));
+                app->args.clear();
+            }
+        }
+    }
+    const std::shared_ptr<Func> &App::get_func() const {
+        return func;
+    }
+    const std::vector<std::shared_ptr<Sound>> &App::get_args() const {
+        return args;
+    }
+
+    /**
+     * @brief 演算の引数の数
+     */
+    std::size_t arity(Op op){
+        switch(op){
+            case Op::Cast:
+            case Op::Neg:
+            case Op::Recip:
+            case Op::Not:
+            case Op::BitNot:
+            case Op::Sin:
+            case Op::Cos:
+            case Op::Tan:
+            case Op::Exp:
+            case Op::Log:
+            case Op::Sqrt:
+            case Op::Floor:
+            case Op::Abs:
+                return 1;
+            default:
+                return 2;
+        }
+    }
+    const char *name(Op op){
+        switch(op){
+            case Op::Cast: return "cast";
+            case Op::Neg: return "neg";
+            case Op::Recip: return "recip";
+            case Op::Not: return "not";
+            case Op::BitNot: return "bitnot";
+            case Op::Add: return "add";
+            case Op::Sub: return "sub";
+            case Op::Mul: return "mul";
+            case Op::Div: return "div";
+            case Op::Rem: return "rem";
+            case Op::LeftShift: return "shl";
+            case Op::RightShift: return "shr";
+            case Op::Equal: return "eq";
+            case Op::NotEqual: return "ne";
+            case Op::Less: return "lt";
+            case Op::LessEqual: return "le";
+            case Op::Greater: return "gt";
+            case Op::GreaterEqual: return "ge";
+            case Op::And: return "and";
+            case Op::Or: return "or";
+            case Op::BitAnd: return "bitand";
+            case Op::BitOr: return "bitor";
+            case Op::BitXor: return "bitxor";
+            case Op::Concat: return "concat";
+            case Op::Sin: return "sin";
+            case Op::Cos: return "cos";
+            case Op::Tan: return "tan";
+            case Op::Exp: return "exp";
+            case Op::Log: return "log";
+            case Op::Sqrt: return "sqrt";
+            case Op::Floor: return "floor";
+            case Op::Abs: return "abs";
+            case Op::Delay: return "delay";
+            case Op::Advance: return "advance";
+        }
+        return "?";
+    }
+    Prim::Prim(type::TypeId type, Op op, type::TypeId operand, type::TypeId result): Func(type), op(op), operand(operand), result(result) {}
+    Op Prim::get_op() const {
+        return op;
+    }
+    type::TypeId Prim::get_operand() const {
+        return operand;
+    }
+    type::TypeId Prim::get_result() const {
+        return result;
+    }
+    Lift::Lift(type::TypeId type, std::shared_ptr<Func> func): Func(type), func(std::move(func)) {}
+    const std::shared_ptr<Func> &Lift::get_func() const {
+        return func;
+    }
+    DefRef::DefRef(type::TypeId type, std::size_t index): Func(type), index(index) {}
+    std::size_t DefRef::get_index() const {
+        return index;
+    }
+
+    Ret::Ret(std::unique_ptr<Expr> expr): expr(std::move(expr)) {}
+    const Expr *Ret::get_expr() const {
+        return expr.get();
+    }
+    Jmp::Jmp(std::size_t dest): dest(dest) {}
+    std::size_t Jmp::get_dest() const {
+        return dest;
+    }
+    void Jmp::set_dest(std::size_t value){
+        dest = value;
+    }
+    Br::Br(std::unique_ptr<Expr> cond, std::size_t dest_true, std::size_t dest_false): cond(std::move(cond)), dest_true(dest_true), dest_false(dest_false) {}
+    const Expr &Br::get_cond() const {
+        return *cond;
+    }
+    std::size_t Br::get_dest_true() const {
+        return dest_true;
+    }
+    std::size_t Br::get_dest_false() const {
+        return dest_false;
+    }
+    void Br::set_dests(std::size_t t, std::size_t f){
+        dest_true = t;
+        dest_false = f;
+    }
+
+    Def::Def(type::TypeId type, std::string name, std::size_t params): Func(type), name(std::move(name)), params(params) {}
+    const std::string &Def::get_name() const {
+        return name;
+    }
+    std::size_t Def::get_params() const {
+        return params;
+    }
+    const std::vector<type::TypeId> &Def::get_slots() const {
+        return slots;
+    }
+    const std::vector<Def::Block> &Def::get_blocks() const {
+        return blocks;
+    }
+    std::vector<Def::Block> &Def::get_blocks(){
+        return blocks;
+    }
+    /**
+     * @brief スロットを追加する．
+     * @return スロット番号
+     */
+    std::size_t Def::add_slot(type::TypeId type){
+        slots.push_back(type);
+        return slots.size() - 1;
+    }
+    /**
+     * @brief 空のブロックを追加する．
+     * @return ブロック番号
+     */
+    std::size_t Def::add_block(){
+        blocks.emplace_back();
+        return blocks.size() - 1;
+    }
+    /**
+     * @brief 入口から辿れないブロックを取り除き，番号を詰める．
+     *
+     * 終端のないブロックは辿れないものとして扱う（`return` などの後に作った空のブロック）．
+     */
+    void Def::prune(){
+        constexpr auto none = ~std::size_t{0};
+        std::vector<std::size_t> renumber(blocks.size(), none), stack{0};
+        std::size_t count = 0;
+        renumber[0] = 0;
+        // 番号は元の順に振り直すので，まず辿れる印だけ付ける
+        while(!stack.empty()){
+            auto b = stack.back();
+            stack.pop_back();
+            auto visit = [&](std::size_t dest){
+                if(renumber[dest] == none){
+                    renumber[dest] = 0;
+                    stack.push_back(dest);
+                }
+            };
+            auto term = blocks[b].second.get();
+            if(auto jmp = dynamic_cast<Jmp *>(term)) visit(jmp->get_dest());
+            else if(auto br = dynamic_cast<Br *>(term)){
+                visit(br->get_dest_true());
+                visit(br->get_dest_false());
+            }
+        }
+        for(auto &n : renumber) if(n != none) n = count++;
+        std::vector<Block> kept;
+        kept.reserve(count);
+        for(std::size_t b = 0; b < blocks.size(); b++){
+            if(renumber[b] == none) continue;
+            auto term = blocks[b].second.get();
+            if(auto jmp = dynamic_cast<Jmp *>(term)) jmp->set_dest(renumber[jmp->get_dest()]);
+            else if(auto br = dynamic_cast<Br *>(term)) br->set_dests(renumber[br->get_dest_true()], renumber[br->get_dest_false()]);
+            kept.push_back(std::move(blocks[b]));
+        }
+        blocks = std::move(kept);
+    }
+
+    Bool::Bool(bool value): Value(type::bool_id), value(value) {}
+    bool Bool::get_value() const {
+        return value;
+    }
+    Int::Int(std::int64_t value): Value(type::int_id), value(value) {}
+    std::int64_t Int::get_value() const {
+        return value;
+    }
+    Rational::Rational(std::int64_t numer, std::int64_t denom): Value(type::rational_id), numer(numer), denom(denom) {}
+    std::int64_t Rational::get_numer() const {
+        return numer;
+    }
+    std::int64_t Rational::get_denom() const {
+        return denom;
+    }
+    Float::Float(double value): Value(type::float_id), value(value) {}
+    double Float::get_value() const {
+        return value;
+    }
+    Str::Str(std::string value): Value(type::str_id), value(std::move(value)) {}
+    const std::string &Str::get_value() const {
+        return value;
+    }
+    Var::Var(type::TypeId type, std::size_t index): Expr(type), index(index) {}
+    std::size_t Var::get_index() const {
+        return index;
+    }
+    Call::Call(type::TypeId type, std::shared_ptr<Func> func, std::vector<std::unique_ptr<Expr>> args): Expr(type), func(std::move(func)), args(std::move(args)) {}
+    const std::shared_ptr<Func> &Call::get_func() const {
+        return func;
+    }
+    const std::vector<std::unique_ptr<Expr>> &Call::get_args() const {
+        return args;
+    }
+    Subst::Subst(type::TypeId type, std::size_t index, std::unique_ptr<Expr> expr): Expr(type), index(index), expr(std::move(expr)) {}
+    std::size_t Subst::get_index() const {
+        return index;
+    }
+    const Expr &Subst::get_expr() const {
+        return *expr;
+    }
+}
+
+#ifdef DEBUG
+#include <iostream>
+static void indent(int depth){
+    for(int i = 0; i < depth; i++) std::cout << "  ";
+}
+//! これより深い式は省略する
+static constexpr int max_debug_depth = 256;
+static void print_child(const type::TypeContext &context, const ir::Expr &expr, int depth){
+    if(depth > max_debug_depth){
+        indent(depth);
+        std::cout << "..." << std::endl;
+    }else expr.debug_print(context, depth);
+}
+namespace ir {
+    void T::debug_print(const type::TypeContext &, int depth) const {
+        indent(depth);
+        std::cout << "t" << std::endl;
+    }
+    void Const::debug_print(const type::TypeContext &context, int depth) const {
+        indent(depth);
+        std::cout << "const" << std::endl;
+        print_child(context, *value, depth + 1);
+    }
+    void App::debug_print(const type::TypeContext &context, int depth) const {
+        indent(depth);
+        std::cout << "app" << std::endl;
+        print_child(context, *func, depth + 1);
+        for(auto &arg : args) print_child(context, *arg, depth + 1);
+    }
+    void Prim::debug_print(const type::TypeContext &context, int depth) const {
+        indent(depth);
+        std::cout << "prim(" << name(op) << ", " << context.name(operand) << " -> " << context.name(result) << ")" << std::endl;
+    }
+    void Lift::debug_print(const type::TypeContext &context, int depth) const {
+        indent(depth);
+        std::cout << "lift" << std::endl;
+        print_child(context, *func, depth + 1);
+    }
+    void DefRef::debug_print(const type::TypeContext &, int depth) const {
+        indent(depth);
+        std::cout << "def(" << index << ")" << std::endl;
+    }
+    void Ret::debug_print(const type::TypeContext &context, int depth) const {
+        indent(depth);
+        std::cout << "ret" << std::endl;
+        if(expr) print_child(context, *expr, depth + 1);
+    }
+    void Jmp::debug_print(const type::TypeContext &, int depth) const {
+        indent(depth);
+        std::cout << "jmp " << dest << std::endl;
+    }
+    void Br::debug_print(const type::TypeContext &context, int depth) const {
+        indent(depth);
+        std::cout << "br " << dest_true << ", " << dest_false << std::endl;
+        print_child(context, *cond, depth + 1);
+    }
+    void Def::debug_print(const type::TypeContext &context, int depth) const {
+        indent(depth);
+        std::cout << "def " << name << " (params " << params << ")" << std::endl;
+        for(std::size_t i = 0; i < slots.size(); i++){
+            indent(depth + 1);
+            std::cout << "slot " << i << ": " << context.name(slots[i]) << std::endl;
+        }
+        for(std::size_t b = 0; b < blocks.size(); b++){
+            indent(depth + 1);
+            std::cout << "block " << b << ":" << std::endl;
+            for(auto &expr : blocks[b].first) print_child(context, *expr, depth + 2);
+            if(blocks[b].second) blocks[b].second->debug_print(context, depth + 2);
+        }
+    }
+    void Bool::debug_print(const type::TypeContext &, int depth) const {
+        indent(depth);
+        std::cout << (value ? "true" : "false") << std::endl;
+    }
+    void Int::debug_print(const type::TypeContext &, int depth) const {
+        indent(depth);
+        std::cout << "int(" << value << ")" << std::endl;
+    }
+    void Rational::debug_print(const type::TypeContext &, int depth) const {
+        indent(depth);
+        std::cout << "rational(" << numer << "/" << denom << ")" << std::endl;
+    }
+    void Float::debug_print(const type::TypeContext &, int depth) const {
+        indent(depth);
+        std::cout << "float(" << value << ")" << std::endl;
+    }
+    void Str::debug_print(const type::TypeContext &, int depth) const {
+        indent(depth);
+        std::cout << "str(" << value << ")" << std::endl;
+    }
+    void Var::debug_print(const type::TypeContext &, int depth) const {
+        indent(depth);
+        std::cout << "var " << index << std::endl;
+    }
+    void Call::debug_print(const type::TypeContext &context, int depth) const {
+        indent(depth);
+        std::cout << "call" << std::endl;
+        print_child(context, *func, depth + 1);
+        for(auto &arg : args) print_child(context, *arg, depth + 1);
+    }
+    void Subst::debug_print(const type::TypeContext &context, int depth) const {
+        indent(depth);
+        std::cout << "subst " << index << std::endl;
+        print_child(context, *expr, depth + 1);
+    }
+    void Module::debug_print(const type::TypeContext &context) const {
+        for(auto &def : defs) if(def) def->debug_print(context, 0);
+        if(main) main->debug_print(context, 0);
+    }
 }
+#endif
@@ -5,21 +5,43 @@
 #ifndef IR_HPP
 #define IR_HPP
 
-#include <vector>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "type.hpp"
+
+/**
+ * @brief IR を定義する．
+ *
+ * 関数は基本ブロックの列で，各ブロックは式の列と終端からなる．
+ * 変数は名前ではなく関数ごとの密なスロット番号で表し，名前の解決は変換時に済ませる．
+ * 式の値の型は `type::TypeId` で持つ（どの `type::TypeContext` の ID かは `Module` が決める）．
+ * 呼び出しの引数は左から順に評価し，`Subst` は評価した時点で変数に書き込む．
+ */
 namespace ir {
     /**
      * @brief 式
      */
     class Expr {
+        type::TypeId type;
+    protected:
+        explicit Expr(type::TypeId);
     public:
         virtual ~Expr();
+        type::TypeId get_type() const;
+#ifdef DEBUG
+        virtual void debug_print(const type::TypeContext &, int) const = 0;
+#endif
     };
     /**
      * @brief 値
      */
     class Value : public Expr {
+    protected:
+        using Expr::Expr;
     public:
         virtual ~Value() override;
     };
@@ -27,6 +49,8 @@ namespace ir {
      * @brief 関数
      */
     class Func : public Value {
+    protected:
+        using Value::Value;
     public:
         virtual ~Func() override;
     };
@@ -34,6 +58,8 @@ namespace ir {
      * @brief 音
      */
     class Sound : public Value {
+    protected:
+        using Value::Value;
     public:
         virtual ~Sound() override;
     };
@@ -41,19 +67,133 @@ namespace ir {
      * @brief 音 T
      */
     class T : public Sound {
+    public:
+        explicit T(type::TypeId);
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief 音，定数
      */
     class Const : public Sound {
         std::shared_ptr<Value> value;
+    public:
+        Const(type::TypeId, std::shared_ptr<Value>);
+        const std::shared_ptr<Value> &get_value() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief 音，関数適用
+     *
+     * 同じ音を複数の引数に使えるよう，引数は共有する（音は木ではなく DAG になる）．
      */
     class App : public Sound {
         std::shared_ptr<Func> func;
-        std::vector<std::unique_ptr<Sound>> args;
+        std::vector<std::shared_ptr<Sound>> args;
+    public:
+        App(type::TypeId, std::shared_ptr<Func>, std::vector<std::shared_ptr<Sound>>);
+        ~App() override;
+        const std::shared_ptr<Func> &get_func() const;
+        const std::vector<std::shared_ptr<Sound>> &get_args() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
+    };
+    /**
+     * @brief 組み込みの演算の種類
+     */
+    enum class Op {
+        //! `operand` から `result` への変換（同じ型なら恒等関数）
+        Cast,
+        Neg,
+        Recip,
+        Not,
+        BitNot,
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Rem,
+        LeftShift,
+        RightShift,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        //! 短絡評価しない論理積（音の各時刻の値に使う）
+        And,
+        //! 短絡評価しない論理和（音の各時刻の値に使う）
+        Or,
+        BitAnd,
+        BitOr,
+        BitXor,
+        //! 文字列の連結
+        Concat,
+        Sin,
+        Cos,
+        Tan,
+        Exp,
+        Log,
+        Sqrt,
+        Floor,
+        Abs,
+        //! 音を第 2 引数の秒数だけ遅らせる（`>>>`）
+        Delay,
+        //! 音を第 2 引数の秒数だけ早める（`<<<`）
+        Advance,
+    };
+    std::size_t arity(Op);
+    const char *name(Op);
+    /**
+     * @brief 組み込みの演算
+     *
+     * 引数は全て `operand` 型で，結果は `result` 型．
+     * ただし `Delay` と `Advance` は音（`result` 型）と `float` を受け取る．
+     */
+    class Prim : public Func {
+        Op op;
+        type::TypeId operand, result;
+    public:
+        Prim(type::TypeId, Op, type::TypeId, type::TypeId);
+        Op get_op() const;
+        type::TypeId get_operand() const;
+        type::TypeId get_result() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
+    };
+    /**
+     * @brief 各時刻の値に関数を適用する音を作る関数
+     *
+     * 呼び出すと，値の引数を `Const` にして `App` を作る．型は持ち上げる前の関数の型．
+     */
+    class Lift : public Func {
+        std::shared_ptr<Func> func;
+    public:
+        Lift(type::TypeId, std::shared_ptr<Func>);
+        const std::shared_ptr<Func> &get_func() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
+    };
+    /**
+     * @brief トップレベルの関数の参照
+     *
+     * 再帰する関数が互いを所有しないよう，`Module::defs` の添字で指す．
+     */
+    class DefRef : public Func {
+        std::size_t index;
+    public:
+        DefRef(type::TypeId, std::size_t);
+        std::size_t get_index() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief ブロックの終端
@@ -61,18 +201,35 @@ namespace ir {
     class Term {
     public:
         virtual ~Term();
+#ifdef DEBUG
+        virtual void debug_print(const type::TypeContext &, int) const = 0;
+#endif
     };
     /**
      * @brief 関数からの値返し
      */
     class Ret : public Term {
+        //! 返す値（値を返さなければ `nullptr`）
         std::unique_ptr<Expr> expr;
+    public:
+        explicit Ret(std::unique_ptr<Expr>);
+        const Expr *get_expr() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief ジャンプ
      */
     class Jmp : public Term {
         std::size_t dest;
+    public:
+        explicit Jmp(std::size_t);
+        std::size_t get_dest() const;
+        void set_dest(std::size_t);
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief 条件分岐
@@ -80,48 +237,116 @@ namespace ir {
     class Br : public Term {
         std::unique_ptr<Expr> cond;
         std::size_t dest_true, dest_false;
+    public:
+        Br(std::unique_ptr<Expr>, std::size_t, std::size_t);
+        const Expr &get_cond() const;
+        std::size_t get_dest_true() const;
+        std::size_t get_dest_false() const;
+        void set_dests(std::size_t, std::size_t);
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief 式で定義された関数
+     *
+     * 引数はスロット 0 から順に置かれる．ブロック 0 が入口．
      */
     class Def : public Func {
-        std::vector<std::pair<std::vector<std::unique_ptr<Expr>>, std::unique_ptr<Term>>> blocks;
+    public:
+        using Block = std::pair<std::vector<std::unique_ptr<Expr>>, std::unique_ptr<Term>>;
+    private:
+        std::string name;
+        std::size_t params;
+        //! 各スロットの型
+        std::vector<type::TypeId> slots;
+        std::vector<Block> blocks;
+    public:
+        Def(type::TypeId, std::string, std::size_t);
+        const std::string &get_name() const;
+        std::size_t get_params() const;
+        const std::vector<type::TypeId> &get_slots() const;
+        const std::vector<Block> &get_blocks() const;
+        std::vector<Block> &get_blocks();
+        std::size_t add_slot(type::TypeId);
+        std::size_t add_block();
+        void prune();
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief bool 値
      */
     class Bool : public Value {
         bool value;
+    public:
+        explicit Bool(bool);
+        bool get_value() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief int 値
      */
     class Int : public Value {
-        int value;
+        std::int64_t value;
+    public:
+        explicit Int(std::int64_t);
+        std::int64_t get_value() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief rational 値
      */
     class Rational : public Value {
-        int numer, denom;
+        std::int64_t numer, denom;
+    public:
+        Rational(std::int64_t, std::int64_t);
+        std::int64_t get_numer() const;
+        std::int64_t get_denom() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief float 値
      */
     class Float : public Value {
         double value;
+    public:
+        explicit Float(double);
+        double get_value() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief str 値
      */
     class Str : public Value {
         std::string value;
+    public:
+        explicit Str(std::string);
+        const std::string &get_value() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief 変数からの値の読み出し
      */
     class Var : public Expr {
         std::size_t index;
+    public:
+        Var(type::TypeId, std::size_t);
+        std::size_t get_index() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
      * @brief 関数呼び出し
@@ -129,13 +354,42 @@ namespace ir {
     class Call : public Expr {
         std::shared_ptr<Func> func;
         std::vector<std::unique_ptr<Expr>> args;
+    public:
+        Call(type::TypeId, std::shared_ptr<Func>, std::vector<std::unique_ptr<Expr>>);
+        const std::shared_ptr<Func> &get_func() const;
+        const std::vector<std::unique_ptr<Expr>> &get_args() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
     };
     /**
-     * @brief 変数への代入
+     * @brief 変数への代入（値は代入した値）
      */
     class Subst : public Expr {
         std::size_t index;
         std::unique_ptr<Expr> expr;
+    public:
+        Subst(type::TypeId, std::size_t, std::unique_ptr<Expr>);
+        std::size_t get_index() const;
+        const Expr &get_expr() const;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &, int) const override;
+#endif
+    };
+
+    /**
+     * @brief 1 つの入力から作った関数の集まり
+     */
+    struct Module {
+        //! トップレベルの関数（`check::Defs` と同じ添字）
+        std::vector<std::shared_ptr<Def>> defs;
+        //! トップレベルの文を順に実行する関数（引数なし，値を返さない）
+        std::shared_ptr<Def> main;
+        //! トップレベルのスコープの変数の名前と `main` のスロット番号（スロット番号の順）
+        std::vector<std::pair<std::string, std::size_t>> globals;
+#ifdef DEBUG
+        void debug_print(const type::TypeContext &) const;
+#endif
     };
 }
 
@@ -0,0 +1,767 @@
+/**
+ * @file jit.cpp
+ */
+#include "jit.hpp"
+#include "cache.hpp"
+#include "error.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+#include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+namespace jit {
+    namespace {
+        /**
+         * @brief ネイティブコードで扱えない値や演算を使っていた．
+         */
+        struct Unsupported {};
+
+        //! ベクトル化した数学関数のライブラリ（glibc の libmvec）を読み込めたか
+        bool vector_library = false;
+
+        /**
+         * @brief LLVM のネイティブのターゲットを初期化する（最初の 1 回だけ）．
+         */
+        void initialize(){
+            static std::once_flag once;
+            std::call_once(once, []{
+                llvm::InitializeNativeTarget();
+                llvm::InitializeNativeTargetAsmPrinter();
+                vector_library = !llvm::sys::DynamicLibrary::LoadLibraryPermanently("libmvec.so.1");
+            });
+        }
+
+        template<class T> T check(llvm::Expected<T> value){
+            if(!value) throw error::make<error::CodegenFailure>(llvm::toString(value.takeError()));
+            return std::move(*value);
+        }
+        void check(llvm::Error error){
+            if(error) throw error::make<error::CodegenFailure>(llvm::toString(std::move(error)));
+        }
+
+        /**
+         * @brief 作ったモジュールが正しいか確かめる（DEBUG のときだけ）．
+         */
+        void verify([[maybe_unused]] const llvm::Module &target){
+#ifdef DEBUG
+            std::string message;
+            llvm::raw_string_ostream os(message);
+            if(llvm::verifyModule(target, &os)) throw error::make<error::CodegenFailure>(os.str());
+#endif
+        }
+
+        /**
+         * @brief オブジェクトファイル `object` を共有ライブラリ `path` にリンクする．
+         *
+         * リンカは `CC` 環境変数の C コンパイラ（なければ `cc`）を使う．
+         */
+        void link(const std::string &object, const std::string &path){
+            auto cc = std::getenv("CC");
+            std::string name = cc && *cc ? cc : "cc";
+            auto program = llvm::sys::findProgramByName(name);
+            if(!program) throw error::make<error::OutputFailure>(path, "cannot find `" + name + "`: " + program.getError().message());
+            std::vector<llvm::StringRef> args{name, "-shared", "-o", path, object};
+            // ベクトル化した sin などは libmvec にある
+            if(vector_library) args.push_back("-lmvec");
+            args.push_back("-lm");
+            std::string message;
+            if(llvm::sys::ExecuteAndWait(*program, args, llvm::None, {}, 0, 0, &message) != 0){
+                throw error::make<error::OutputFailure>(path, message.empty() ? "`" + name + "` failed" : message);
+            }
+        }
+    }
+
+    struct Codegen::Builder : llvm::IRBuilder<> {
+        using llvm::IRBuilder<>::IRBuilder;
+    };
+
+    Codegen::Codegen(const type::TypeContext &types, const ir::Module &module, llvm::Module &target): types(types), module(module), target(target), depth(0) {}
+
+    const ir::Def *Codegen::get(std::size_t index) const {
+        return index == module.defs.size() ? module.main.get() : module.defs[index].get();
+    }
+    /**
+     * @brief 値の型に対応する LLVM の型
+     * @param sample 音の各時刻の値か（rational を double で近似する）
+     */
+    llvm::Type *Codegen::type(type::TypeId id, bool sample) const {
+        auto &context = target.getContext();
+        if(id == type::bool_id) return llvm::Type::getInt1Ty(context);
+        if(id == type::int_id) return llvm::Type::getInt64Ty(context);
+        if(id == type::float_id || (sample && id == type::rational_id)) return llvm::Type::getDoubleTy(context);
+        throw Unsupported{};
+    }
+    llvm::Value *Codegen::constant(Builder &builder, const ir::Value &value) const {
+        if(auto literal = dynamic_cast<const ir::Bool *>(&value)) return builder.getInt1(literal->get_value());
+        if(auto literal = dynamic_cast<const ir::Int *>(&value)) return builder.getInt64(static_cast<std::uint64_t>(literal->get_value()));
+        if(auto literal = dynamic_cast<const ir::Float *>(&value)) return llvm::ConstantFP::get(builder.getDoubleTy(), literal->get_value());
+        if(auto literal = dynamic_cast<const ir::Rational *>(&value)){
+            return llvm::ConstantFP::get(builder.getDoubleTy(), static_cast<double>(literal->get_numer()) / static_cast<double>(literal->get_denom()));
+        }
+        throw Unsupported{};
+    }
+    /**
+     * @brief 組み込みの演算
+     *
+     * int の算術は 2 の補数で折り返し，シフト量は下位 6 bit だけを使う（`vm::Machine` と同じ）．
+     * @param sample 音の各時刻の値か（rational を double で近似する）
+     */
+    llvm::Value *Codegen::prim(Builder &builder, const ir::Prim &prim, std::span<llvm::Value *const> args, bool sample) const {
+        auto operand = prim.get_operand();
+        bool is_int = operand == type::int_id, is_bool = operand == type::bool_id;
+        bool is_float = operand == type::float_id || (sample && operand == type::rational_id);
+        auto require = [](bool ok){
+            if(!ok) throw Unsupported{};
+        };
+        require(is_int || is_bool || is_float);
+        auto intrinsic = [&](llvm::Intrinsic::ID id){
+            require(is_float);
+            return builder.CreateUnaryIntrinsic(id, args[0]);
+        };
+        switch(prim.get_op()){
+            case ir::Op::Cast: {
+                auto result = type(prim.get_result(), sample);
+                if(result == args[0]->getType()) return args[0];
+                require(is_int && result->isDoubleTy());
+                return builder.CreateSIToFP(args[0], result);
+            }
+            case ir::Op::Neg:
+                if(is_int) return builder.CreateNeg(args[0]);
+                require(is_float);
+                return builder.CreateFNeg(args[0]);
+            case ir::Op::Recip:
+                require(is_float);
+                return builder.CreateFDiv(llvm::ConstantFP::get(builder.getDoubleTy(), 1.0), args[0]);
+            case ir::Op::Not:
+                require(is_bool);
+                return builder.CreateNot(args[0]);
+            case ir::Op::BitNot:
+                require(is_int);
+                return builder.CreateNot(args[0]);
+            case ir::Op::Add:
+                if(is_int) return builder.CreateAdd(args[0], args[1]);
+                require(is_float);
+                return builder.CreateFAdd(args[0], args[1]);
+            case ir::Op::Sub:
+                if(is_int) return builder.CreateSub(args[0], args[1]);
+                require(is_float);
+                return builder.CreateFSub(args[0], args[1]);
+            case ir::Op::Mul:
+                if(is_int) return builder.CreateMul(args[0], args[1]);
+                require(is_float);
+                return builder.CreateFMul(args[0], args[1]);
+            case ir::Op::Div:
+                require(is_float);
+                return builder.CreateFDiv(args[0], args[1]);
+            case ir::Op::Rem: {
+                if(!is_int){
+                    require(is_float);
+                    return builder.CreateFRem(args[0], args[1]);
+                }
+                // 0 と -1 で割った余りは 0（srem では未定義）
+                auto zero = builder.getInt64(0);
+                auto trivial = builder.CreateOr(builder.CreateICmpEQ(args[1], zero), builder.CreateICmpEQ(args[1], builder.getInt64(~std::uint64_t{0})));
+                auto divisor = builder.CreateSelect(trivial, builder.getInt64(1), args[1]);
+                return builder.CreateSelect(trivial, zero, builder.CreateSRem(args[0], divisor));
+            }
+            case ir::Op::LeftShift:
+                require(is_int);
+                return builder.CreateShl(args[0], builder.CreateAnd(args[1], 63));
+            case ir::Op::RightShift:
+                require(is_int);
+                return builder.CreateAShr(args[0], builder.CreateAnd(args[1], 63));
+            case ir::Op::Equal: return is_float ? builder.CreateFCmpOEQ(args[0], args[1]) : builder.CreateICmpEQ(args[0], args[1]);
+            case ir::Op::NotEqual: return is_float ? builder.CreateFCmpUNE(args[0], args[1]) : builder.CreateICmpNE(args[0], args[1]);
+            case ir::Op::Less:
+                require(!is_bool);
+                return is_float ? builder.CreateFCmpOLT(args[0], args[1]) : builder.CreateICmpSLT(args[0], args[1]);
+            case ir::Op::LessEqual:
+                require(!is_bool);
+                return is_float ? builder.CreateFCmpOLE(args[0], args[1]) : builder.CreateICmpSLE(args[0], args[1]);
+            case ir::Op::Greater:
+                require(!is_bool);
+                return is_float ? builder.CreateFCmpOGT(args[0], args[1]) : builder.CreateICmpSGT(args[0], args[1]);
+            case ir::Op::GreaterEqual:
+                require(!is_bool);
+                return is_float ? builder.CreateFCmpOGE(args[0], args[1]) : builder.CreateICmpSGE(args[0], args[1]);
+            case ir::Op::And:
+            case ir::Op::BitAnd:
+                require(!is_float);
+                return builder.CreateAnd(args[0], args[1]);
+            case ir::Op::Or:
+            case ir::Op::BitOr:
+                require(!is_float);
+                return builder.CreateOr(args[0], args[1]);
+            case ir::Op::BitXor:
+                require(!is_float);
+                return builder.CreateXor(args[0], args[1]);
+            case ir::Op::Sin: return intrinsic(llvm::Intrinsic::sin);
+            case ir::Op::Cos: return intrinsic(llvm::Intrinsic::cos);
+            case ir::Op::Exp: return intrinsic(llvm::Intrinsic::exp);
+            case ir::Op::Log: return intrinsic(llvm::Intrinsic::log);
+            case ir::Op::Sqrt: return intrinsic(llvm::Intrinsic::sqrt);
+            case ir::Op::Floor: return intrinsic(llvm::Intrinsic::floor);
+            case ir::Op::Abs: return intrinsic(llvm::Intrinsic::fabs);
+            case ir::Op::Tan: {
+                // tan には組み込み関数がないので libm を呼ぶ
+                require(is_float);
+                auto tan = target.getOrInsertFunction("tan", builder.getDoubleTy(), builder.getDoubleTy());
+                if(auto func = llvm::dyn_cast<llvm::Function>(tan.getCallee())){
+                    func->setDoesNotAccessMemory();
+                    func->setDoesNotThrow();
+                    func->setWillReturn();
+                }
+                return builder.CreateCall(tan, args[0]);
+            }
+            default: throw Unsupported{};
+        }
+    }
+    /**
+     * @brief 関数の本体の式（再帰の深さを数える）
+     * @param slots スロットの領域
+     * @throw Unsupported 式が `max_depth` より深かった．
+     */
+    llvm::Value *Codegen::value(Builder &builder, const ir::Expr &expr, std::span<llvm::AllocaInst *const> slots){
+        if(depth >= max_depth) throw Unsupported{};
+        depth++;
+        auto ret = evaluate(builder, expr, slots);
+        depth--;
+        return ret;
+    }
+    /**
+     * @brief `value` の本体（部分式は `value` で計算する）
+     */
+    llvm::Value *Codegen::evaluate(Builder &builder, const ir::Expr &expr, std::span<llvm::AllocaInst *const> slots){
+        if(auto var = dynamic_cast<const ir::Var *>(&expr)){
+            auto slot = slots[var->get_index()];
+            return builder.CreateLoad(slot->getAllocatedType(), slot);
+        }
+        if(auto subst = dynamic_cast<const ir::Subst *>(&expr)){
+            auto ret = value(builder, subst->get_expr(), slots);
+            builder.CreateStore(ret, slots[subst->get_index()]);
+            return ret;
+        }
+        if(dynamic_cast<const ir::Sound *>(&expr) || dynamic_cast<const ir::Func *>(&expr)) throw Unsupported{};
+        if(auto literal = dynamic_cast<const ir::Value *>(&expr)){
+            // rational の値は float に変換するときだけ使える
+            if(expr.get_type() == type::rational_id) throw Unsupported{};
+            return constant(builder, *literal);
+        }
+        auto call = dynamic_cast<const ir::Call *>(&expr);
+        if(!call) throw Unsupported{};
+        auto &args = call->get_args();
+        if(auto p = dynamic_cast<const ir::Prim *>(call->get_func().get())){
+            // 小数のリテラルは rational なので，float への変換はここで済ませる
+            if(p->get_op() == ir::Op::Cast && p->get_result() == type::float_id){
+                if(auto literal = dynamic_cast<const ir::Rational *>(args[0].get())) return constant(builder, *literal);
+            }
+            if(p->get_op() == ir::Op::Delay || p->get_op() == ir::Op::Advance) throw Unsupported{};
+            std::vector<llvm::Value *> values;
+            for(auto &arg : args) values.push_back(value(builder, *arg, slots));
+            return prim(builder, *p, values, false);
+        }
+        if(auto ref = dynamic_cast<const ir::DefRef *>(call->get_func().get())){
+            std::vector<llvm::Value *> values;
+            for(auto &arg : args) values.push_back(value(builder, *arg, slots));
+            return builder.CreateCall(def(ref->get_index()), values);
+        }
+        throw Unsupported{};
+    }
+    /**
+     * @brief 時刻 `time` での音の値
+     *
+     * 同じ音と時刻の値は一度だけ計算する．音を遅らせると時刻がずれるので，別の値として計算する．
+     * 音のグラフはいくらでも深くなるので，再帰せずに明示的なスタックで辿る．
+     */
+    llvm::Value *Codegen::sample(Builder &builder, const ir::Sound &sound, llvm::Value *time, Memo &memo){
+        /**
+         * @brief 値を計算している途中の音
+         */
+        struct Frame {
+            const ir::Sound *sound;
+            llvm::Value *time;
+            //! 引数を積んだか
+            bool expanded = false;
+            //! 遅らせた時刻（`Delay` と `Advance` で，ずらす量を計算した後）
+            llvm::Value *shifted = nullptr;
+        };
+        std::vector<Frame> stack{{&sound, time}};
+        while(!stack.empty()){
+            auto frame = stack.back();
+            auto it = memo.try_emplace({frame.sound, frame.time}, nullptr).first;
+            if(it->second){
+                stack.pop_back();
+                continue;
+            }
+            if(dynamic_cast<const ir::T *>(frame.sound)) it->second = frame.time;
+            else if(auto c = dynamic_cast<const ir::Const *>(frame.sound)) it->second = constant(builder, *c->get_value());
+            else if(auto app = dynamic_cast<const ir::App *>(frame.sound)){
+                auto &args = app->get_args();
+                auto p = dynamic_cast<const ir::Prim *>(app->get_func().get());
+                auto ref = dynamic_cast<const ir::DefRef *>(app->get_func().get());
+                if(!p && !ref) throw Unsupported{};
+                if(p && (p->get_op() == ir::Op::Delay || p->get_op() == ir::Op::Advance)){
+                    // ずらす量，ずらした時刻の音の順に計算する
+                    if(!frame.expanded){
+                        stack.back().expanded = true;
+                        stack.push_back({args[1].get(), frame.time});
+                        continue;
+                    }
+                    if(!frame.shifted){
+                        auto shift = memo.at({args[1].get(), frame.time});
+                        auto shifted = p->get_op() == ir::Op::Delay ? builder.CreateFSub(frame.time, shift) : builder.CreateFAdd(frame.time, shift);
+                        stack.back().shifted = shifted;
+                        stack.push_back({args[0].get(), shifted});
+                        continue;
+                    }
+                    it->second = memo.at({args[0].get(), frame.shifted});
+                }else{
+                    // 引数を先頭から順に計算するように，逆順に積む
+                    if(!frame.expanded){
+                        stack.back().expanded = true;
+                        for(auto arg = args.rbegin(); arg != args.rend(); ++arg) stack.push_back({arg->get(), frame.time});
+                        continue;
+                    }
+                    std::vector<llvm::Value *> values;
+                    for(auto &arg : args) values.push_back(memo.at({arg.get(), frame.time}));
+                    it->second = p ? prim(builder, *p, values, true) : builder.CreateCall(def(ref->get_index()), values);
+                }
+            }else throw Unsupported{};
+            stack.pop_back();
+        }
+        return memo.at({&sound, time});
+    }
+    /**
+     * @brief 関数を内部の関数として宣言する．
+     *
+     * 本体は `bodies` で作る（呼び出しの連なりを再帰で辿らないため）．
+     */
+    llvm::Function *Codegen::def(std::size_t index){
+        if(auto it = defs.find(index); it != defs.end()) return it->second;
+        auto source = get(index);
+        if(!source) throw Unsupported{};
+        auto &slots = source->get_slots();
+        auto &blocks = source->get_blocks();
+        auto &context = target.getContext();
+        std::vector<llvm::Type *> params;
+        for(std::size_t i = 0; i < source->get_params(); i++) params.push_back(type(slots[i], false));
+        llvm::Type *result = llvm::Type::getVoidTy(context);
+        for(auto &block : blocks){
+            auto ret = dynamic_cast<const ir::Ret *>(block.second.get());
+            if(ret && ret->get_expr()) result = type(ret->get_expr()->get_type(), false);
+        }
+        auto func = llvm::Function::Create(llvm::FunctionType::get(result, params, false), llvm::Function::InternalLinkage, source->get_name(), target);
+        defs.emplace(index, func);
+        pending.push_back(index);
+        return func;
+    }
+    /**
+     * @brief 宣言した関数の本体を作る（本体から呼び出す関数も宣言されるので，なくなるまで繰り返す）．
+     *
+     * スロットは `alloca` に置き，最適化で SSA の値にする．
+     */
+    void Codegen::bodies(){
+        while(!pending.empty()){
+            auto index = pending.back();
+            pending.pop_back();
+            body(index);
+        }
+    }
+    /**
+     * @brief 宣言した関数 `index` の本体を作る．
+     */
+    void Codegen::body(std::size_t index){
+        auto source = get(index);
+        auto &slots = source->get_slots();
+        auto &blocks = source->get_blocks();
+        auto &context = target.getContext();
+        auto func = defs.at(index);
+
+        Builder builder(llvm::BasicBlock::Create(context, "entry", func));
+        std::vector<llvm::AllocaInst *> allocas;
+        for(auto slot : slots) allocas.push_back(builder.CreateAlloca(type(slot, false)));
+        for(std::size_t i = 0; i < source->get_params(); i++) builder.CreateStore(func->getArg(static_cast<unsigned>(i)), allocas[i]);
+        std::vector<llvm::BasicBlock *> targets;
+        for(std::size_t i = 0; i < blocks.size(); i++) targets.push_back(llvm::BasicBlock::Create(context, "", func));
+        builder.CreateBr(targets[0]);
+        for(std::size_t i = 0; i < blocks.size(); i++){
+            builder.SetInsertPoint(targets[i]);
+            for(auto &expr : blocks[i].first) value(builder, *expr, allocas);
+            auto &term = *blocks[i].second;
+            if(auto ret = dynamic_cast<const ir::Ret *>(&term)){
+                if(ret->get_expr()) builder.CreateRet(value(builder, *ret->get_expr(), allocas));
+                else builder.CreateRetVoid();
+            }else if(auto jmp = dynamic_cast<const ir::Jmp *>(&term)) builder.CreateBr(targets[jmp->get_dest()]);
+            else if(auto br = dynamic_cast<const ir::Br *>(&term)){
+                builder.CreateCondBr(value(builder, br->get_cond(), allocas), targets[br->get_dest_true()], targets[br->get_dest_false()]);
+            }else throw Unsupported{};
+        }
+    }
+    /**
+     * @brief 関数 `index` を `Entry` の形で呼び出す関数 `name` を作る．
+     */
+    llvm::Function *Codegen::entry(std::size_t index, const std::string &name){
+        try {
+            auto callee = def(index);
+            auto &context = target.getContext();
+            auto reg = llvm::Type::getInt64Ty(context);
+            auto func = llvm::Function::Create(llvm::FunctionType::get(llvm::Type::getVoidTy(context), {reg->getPointerTo(), reg->getPointerTo()}, false), llvm::Function::ExternalLinkage, name, target);
+            Builder builder(llvm::BasicBlock::Create(context, "entry", func));
+            // bool は `vm::Reg::b` として先頭の 1 byte に置く
+            auto pointer = [&](llvm::Value *address, llvm::Type *type){
+                return builder.CreateBitCast(address, (type->isIntegerTy(1) ? builder.getInt8Ty() : type)->getPointerTo());
+            };
+            std::vector<llvm::Value *> args;
+            for(auto &param : callee->args()){
+                auto type = param.getType();
+                auto at = builder.CreateConstInBoundsGEP1_64(reg, func->getArg(0), args.size());
+                if(type->isIntegerTy(1)) args.push_back(builder.CreateICmpNE(builder.CreateLoad(builder.getInt8Ty(), pointer(at, type)), builder.getInt8(0)));
+                else args.push_back(builder.CreateLoad(type, pointer(at, type)));
+            }
+            llvm::Value *ret = builder.CreateCall(callee, args);
+            auto type = ret->getType();
+            if(type->isIntegerTy(1)) builder.CreateStore(builder.CreateZExt(ret, builder.getInt8Ty()), pointer(func->getArg(1), type));
+            else if(!type->isVoidTy()) builder.CreateStore(ret, pointer(func->getArg(1), type));
+            builder.CreateRetVoid();
+            bodies();
+            return func;
+        }catch(const Unsupported &){
+            throw error::make<error::NotCompilable>(get(index) ? get(index)->get_name() : std::to_string(index));
+        }
+    }
+    /**
+     * @brief 音の 1 ブロックを書き出す関数 `name` を作る（`Render` の形）．
+     *
+     * 各時刻の値は副作用のない式なので，最適化でループをベクトル化できる．
+     */
+    llvm::Function *Codegen::render(const ir::Sound &sound, const std::string &name){
+        try {
+            auto &context = target.getContext();
+            Builder builder(context);
+            auto i64 = builder.getInt64Ty();
+            auto f64 = builder.getDoubleTy();
+            auto f32 = builder.getFloatTy();
+            auto func = llvm::Function::Create(llvm::FunctionType::get(builder.getVoidTy(), {f32->getPointerTo(), i64, f64, f64}, false), llvm::Function::ExternalLinkage, name, target);
+            func->addParamAttr(0, llvm::Attribute::NoAlias);
+            auto entry = llvm::BasicBlock::Create(context, "entry", func);
+            auto loop = llvm::BasicBlock::Create(context, "loop", func);
+            auto exit = llvm::BasicBlock::Create(context, "exit", func);
+            auto out = func->getArg(0), frames = func->getArg(1), time = func->getArg(2), rate = func->getArg(3);
+
+            builder.SetInsertPoint(entry);
+            auto step = builder.CreateFDiv(llvm::ConstantFP::get(f64, 1.0), rate);
+            builder.CreateCondBr(builder.CreateICmpEQ(frames, builder.getInt64(0)), exit, loop);
+
+            builder.SetInsertPoint(loop);
+            auto i = builder.CreatePHI(i64, 2);
+            i->addIncoming(builder.getInt64(0), entry);
+            auto now = builder.CreateFAdd(time, builder.CreateFMul(builder.CreateUIToFP(i, f64), step));
+            Memo memo;
+            auto value = sample(builder, sound, now, memo);
+            if(value->getType()->isIntegerTy(1)) value = builder.CreateUIToFP(value, f32);
+            else if(value->getType()->isIntegerTy()) value = builder.CreateSIToFP(value, f32);
+            else value = builder.CreateFPTrunc(value, f32);
+            builder.CreateStore(value, builder.CreateInBoundsGEP(f32, out, i));
+            auto next = builder.CreateAdd(i, builder.getInt64(1), "", true, true);
+            i->addIncoming(next, builder.GetInsertBlock());
+            builder.CreateCondBr(builder.CreateICmpEQ(next, frames), exit, loop);
+
+            builder.SetInsertPoint(exit);
+            builder.CreateRetVoid();
+            bodies();
+            return func;
+        }catch(const Unsupported &){
+            throw error::make<error::NotCompilable>(name);
+        }
+    }
+
+    /**
+     * @brief モジュールを O2 相当で最適化する．
+     *
+     * ループと SLP のベクトル化を有効にし，libmvec があれば sin などもベクトル化する．
+     */
+    void optimize(llvm::Module &target, llvm::TargetMachine &machine){
+        llvm::LoopAnalysisManager loops;
+        llvm::FunctionAnalysisManager functions;
+        llvm::CGSCCAnalysisManager cgscc;
+        llvm::ModuleAnalysisManager modules;
+        llvm::PipelineTuningOptions options;
+        options.LoopVectorization = true;
+        options.SLPVectorization = true;
+        llvm::PassBuilder builder(&machine, options);
+        llvm::TargetLibraryInfoImpl library(machine.getTargetTriple());
+        if(vector_library && machine.getTargetTriple().getArch() == llvm::Triple::x86_64){
+            library.addVectorizableFunctionsFromVecLib(llvm::TargetLibraryInfoImpl::LIBMVEC_X86);
+        }
+        // 既定の TargetLibraryAnalysis より先に登録する
+        functions.registerPass([&]{ return llvm::TargetLibraryAnalysis(library); });
+        builder.registerModuleAnalyses(modules);
+        builder.registerCGSCCAnalyses(cgscc);
+        builder.registerFunctionAnalyses(functions);
+        builder.registerLoopAnalyses(loops);
+        builder.crossRegisterProxies(loops, functions, cgscc, modules);
+        builder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2).run(target, modules);
+    }
+
+    /**
+     * @brief LLVM のモジュールの名前（キー）ごとにオブジェクトファイルを読み書きする．
+     *
+     * 最適化する前に `load` で探し，見つからなければ最適化してコンパイルした結果を書く．
+     */
+    class ObjectCache : public llvm::ObjectCache {
+        //! キャッシュファイルの先頭
+        static constexpr std::string_view magic = "CRYSSOBJ";
+        std::string dir;
+        std::string path(llvm::StringRef) const;
+    public:
+        explicit ObjectCache(std::string);
+        std::unique_ptr<llvm::MemoryBuffer> load(llvm::StringRef) const;
+        void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef) override;
+        std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override;
+    };
+
+    /**
+     * @brief コンストラクタ
+     * @param dir キャッシュを置くディレクトリ（なければ作る）
+     */
+    ObjectCache::ObjectCache(std::string dir): dir(std::move(dir)) {
+        std::error_code ec;
+        std::filesystem::create_directories(this->dir, ec);
+    }
+    std::string ObjectCache::path(llvm::StringRef name) const {
+        return dir + "/" + name.str() + ".o";
+    }
+    /**
+     * @brief キャッシュがあれば mmap して読む．
+     *
+     * 本体のハッシュが合わない壊れたファイルは使わない．
+     * @return オブジェクトファイル（見つからなければ `nullptr`）
+     */
+    std::unique_ptr<llvm::MemoryBuffer> ObjectCache::load(llvm::StringRef name) const {
+        auto file = llvm::MemoryBuffer::getFile(path(name), false, false);
+        if(!file) return nullptr;
+        auto data = (*file)->getBuffer();
+        constexpr std::size_t header_size = magic.size() + sizeof(std::uint64_t);
+        if(data.size() < header_size || !data.startswith(llvm::StringRef(magic.data(), magic.size()))) return nullptr;
+        std::uint64_t checksum;
+        std::memcpy(&checksum, data.data() + magic.size(), sizeof(checksum));
+        auto body = data.substr(header_size);
+        if(checksum != cache::hash(std::string_view(body.data(), body.size()), 0)) return nullptr;
+        // JIT はオブジェクトファイルを先頭から読むので，ヘッダを除いて複製する
+        return llvm::MemoryBuffer::getMemBufferCopy(body, name);
+    }
+    /**
+     * @brief コンパイルしたオブジェクトファイルをキャッシュに書く．
+     *
+     * 一時ファイルに書いてから rename するので，並行して読み書きしても壊れたファイルは見えない．
+     * 書き込みに失敗した場合は何もしない．
+     */
+    void ObjectCache::notifyObjectCompiled(const llvm::Module *target, llvm::MemoryBufferRef object){
+        static std::atomic<unsigned> counter = 0;
+        auto destination = path(target->getModuleIdentifier());
+        auto temporary = destination + ".tmp." + std::to_string(getpid()) + "." + std::to_string(counter++);
+        {
+            std::ofstream file(temporary, std::ios::binary);
+            if(!file) return;
+            auto body = object.getBuffer();
+            auto checksum = cache::hash(std::string_view(body.data(), body.size()), 0);
+            file.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+            file.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+            file.write(body.data(), static_cast<std::streamsize>(body.size()));
+            if(!file){
+                file.close();
+                std::remove(temporary.c_str());
+                return;
+            }
+        }
+        if(std::rename(temporary.c_str(), destination.c_str()) != 0) std::remove(temporary.c_str());
+    }
+    std::unique_ptr<llvm::MemoryBuffer> ObjectCache::getObject(const llvm::Module *target){
+        return load(target->getModuleIdentifier());
+    }
+
+    /**
+     * @brief 実行するマシン向けの JIT を作る．
+     * @param cache_dir コンパイルしたコードのキャッシュを置くディレクトリ（`nullptr` ならキャッシュしない）
+     * @throw error::CodegenFailure ターゲットを用意できなかった．
+     */
+    Jit::Jit(const type::TypeContext &types, const ir::Module &module, const char *cache_dir): types(types), module(module) {
+        initialize();
+        if(cache_dir && *cache_dir) cache = std::make_unique<ObjectCache>(cache_dir);
+        auto builder = check(llvm::orc::JITTargetMachineBuilder::detectHost());
+        builder.setCodeGenOptLevel(llvm::CodeGenOpt::Default);
+        machine = check(builder.createTargetMachine());
+        engine = check(
+            llvm::orc::LLJITBuilder()
+                .setJITTargetMachineBuilder(builder)
+                .setCompileFunctionCreator([this](llvm::orc::JITTargetMachineBuilder compiler) -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                    auto target = compiler.createTargetMachine();
+                    if(!target) return target.takeError();
+                    return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*target), cache.get());
+                })
+                .create()
+        );
+        auto &dylib = engine->getMainJITDylib();
+        // libm の関数（tan と libmvec のベクトル版）はこのプロセスから探す
+        dylib.addGenerator(check(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(engine->getDataLayout().getGlobalPrefix())));
+        engine->getIRTransformLayer().setTransform([this](llvm::orc::ThreadSafeModule compiled, const llvm::orc::MaterializationResponsibility &) -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+            compiled.withModuleDo([this](llvm::Module &target){ optimize(target, *machine); });
+            return compiled;
+        });
+    }
+    Jit::~Jit() = default;
+
+    /**
+     * @brief 最適化する前のモジュールのキー
+     *
+     * 同じ IR でもターゲットや LLVM が違えばコードが変わるので，それらも混ぜる．
+     * シードの異なる 2 つのハッシュを繋げた 128 bit を 16 進で表す．
+     */
+    std::string Jit::key(const llvm::Module &target) const {
+        std::string text;
+        llvm::raw_string_ostream os(text);
+        target.print(os, nullptr);
+        os << machine->getTargetCPU() << '\n' << machine->getTargetFeatureString() << '\n' << LLVM_VERSION_STRING << '\n' << vector_library;
+        os.flush();
+        auto version = cache::hash(cache_version, 0);
+        char name[33];
+        std::snprintf(
+            name, sizeof(name), "%016llx%016llx",
+            static_cast<unsigned long long>(cache::hash(text, version)),
+            static_cast<unsigned long long>(cache::hash(text, ~version))
+        );
+        return name;
+    }
+    /**
+     * @brief 新しい LLVM のモジュールに関数を作ってコンパイルし，そのアドレスを返す．
+     *
+     * キャッシュにあればコンパイルせずにオブジェクトファイルを読む．
+     * @param build `Codegen` と関数の名前を受け取り，その名前の関数を作って返す．
+     */
+    template<class Func, class Build> Func Jit::add(Build build){
+        auto context = std::make_unique<llvm::LLVMContext>();
+        auto target = std::make_unique<llvm::Module>("cryss", *context);
+        target->setDataLayout(engine->getDataLayout());
+        target->setTargetTriple(engine->getTargetTriple().str());
+        Codegen codegen(types, module, *target);
+        // 名前はキーに含めず，キーが決まってから付ける
+        llvm::Function *func = build(codegen, "cryss");
+        verify(*target);
+        auto name = "cryss." + key(*target);
+        if(symbols.insert(name).second){
+            func->setName(name);
+            target->setModuleIdentifier(name);
+            if(auto object = cache ? cache->load(name) : nullptr) check(engine->addObjectFile(std::move(object)));
+            else check(engine->addIRModule(llvm::orc::ThreadSafeModule(std::move(target), std::move(context))));
+        }
+        return reinterpret_cast<Func>(check(engine->lookup(name)).getAddress());
+    }
+    /**
+     * @brief 関数 `index` を呼び出す（`main` は `module.defs.size()`）．
+     * @throw error::NotCompilable 関数がネイティブコードで扱えない値を使っていた．
+     */
+    vm::Reg Jit::call(std::size_t index, std::span<const vm::Reg> args){
+        auto it = entries.find(index);
+        if(it == entries.end()){
+            auto entry = add<Entry>([&](Codegen &codegen, const std::string &name){ return codegen.entry(index, name); });
+            it = entries.emplace(index, entry).first;
+        }
+        vm::Reg ret{};
+        it->second(args.data(), &ret);
+        return ret;
+    }
+    /**
+     * @brief 音をコンパイルする．
+     * @throw error::NotCompilable 音がネイティブコードで扱えない値や関数を使っていた．
+     */
+    Render Jit::compile(const ir::Sound &sound){
+        return add<Render>([&](Codegen &codegen, const std::string &name){ return codegen.render(sound, name); });
+    }
+
+    /**
+     * @brief 音を事前にコンパイルしてファイル `path` に書き出す．
+     *
+     * 音 `name` ごとに C の関数 `void render_name(float *out, size_t frames, double time, double rate)`（`Render` の形）を公開する．
+     * コードは位置独立にし，コンパイルするマシンの CPU 向けに最適化する．
+     * libmvec でベクトル化したら，オブジェクトファイルをリンクするときに `-lmvec` も要る．
+     * @throw error::NotCompilable 音がネイティブコードで扱えない値や関数を使っていた．
+     * @throw error::OutputFailure ファイルを書けなかったか，リンクに失敗した．
+     */
+    void emit(const type::TypeContext &types, const ir::Module &module, std::span<const std::pair<std::string, const ir::Sound *>> sounds, const std::string &path, Output output){
+        initialize();
+        auto builder = check(llvm::orc::JITTargetMachineBuilder::detectHost());
+        builder.setCodeGenOptLevel(llvm::CodeGenOpt::Default);
+        builder.setRelocationModel(llvm::Reloc::PIC_);
+        auto machine = check(builder.createTargetMachine());
+        llvm::LLVMContext context;
+        llvm::Module target(path, context);
+        target.setDataLayout(machine->createDataLayout());
+        target.setTargetTriple(machine->getTargetTriple().str());
+        Codegen codegen(types, module, target);
+        for(auto &[name, sound] : sounds) codegen.render(*sound, "render_" + name);
+        verify(target);
+        optimize(target, *machine);
+
+        // 共有ライブラリは一時ファイルのオブジェクトファイルからリンクする
+        std::string object = path;
+        int fd;
+        std::error_code code;
+        if(output == Output::Shared){
+            llvm::SmallString<128> temporary;
+            code = llvm::sys::fs::createTemporaryFile("cryss", "o", fd, temporary);
+            object = temporary.str().str();
+        }else code = llvm::sys::fs::openFileForWrite(object, fd);
+        if(code) throw error::make<error::OutputFailure>(object, code.message());
+        try {
+            llvm::raw_fd_ostream os(fd, true);
+            llvm::legacy::PassManager passes;
+            if(machine->addPassesToEmitFile(passes, os, nullptr, llvm::CGFT_ObjectFile)){
+                throw error::make<error::CodegenFailure>("the target cannot emit object files");
+            }
+            passes.run(target);
+            os.close();
+            if(os.has_error()){
+                auto message = os.error().message();
+                os.clear_error();
+                throw error::make<error::OutputFailure>(object, message);
+            }
+            if(output == Output::Shared) link(object, path);
+        }catch(...){
+            llvm::sys::fs::remove(object);
+            throw;
+        }
+        if(output == Output::Shared) llvm::sys::fs::remove(object);
+    }
+}
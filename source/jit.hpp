@@ -0,0 +1,148 @@
+/**
+ * @file jit.hpp
+ * @brief IR の関数と音を LLVM でネイティブコードにする．
+ */
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ir.hpp"
+#include "type.hpp"
+#include "vm.hpp"
+
+namespace llvm {
+    class AllocaInst;
+    class Function;
+    class Module;
+    class TargetMachine;
+    class Type;
+    class Value;
+    namespace orc {
+        class LLJIT;
+    }
+}
+
+/**
+ * @brief IR の関数と音を LLVM ORC でネイティブコードに JIT コンパイルする．
+ *
+ * 扱える値は `vm::Machine` と同じ bool，int，float で，音の各時刻の rational の値は double で近似する．
+ * `vm::Machine` と違い，int を 0 で割った余りは 0 になり，呼び出しの深さも検査しない．
+ * モジュールは O2 相当で最適化し，実行するマシンの CPU 向けにベクトル化する．
+ */
+namespace jit {
+    //! これより深い関数の本体の式はコンパイルしない（ネイティブのスタックで再帰するため）
+    constexpr std::size_t max_depth = 32768;
+
+    /**
+     * @brief 音のブロックを書き出す関数
+     *
+     * `out[i]` に時刻 `time + i * (1 / rate)` の音の値を書く．
+     */
+    using Render = void (*)(float *out, std::uint64_t frames, double time, double rate);
+
+    /**
+     * @brief 関数の呼び出しの入口
+     *
+     * 引数を `args` から読み，返り値を `*ret` に書く．
+     */
+    using Entry = void (*)(const vm::Reg *args, vm::Reg *ret);
+
+    /**
+     * @brief LLVM IR を作る．
+     *
+     * 呼び出す関数は同じ LLVM のモジュールに内部の関数として複製し，インライン化できるようにする．
+     * 関数は添字で指し，`ir::Module::defs` の大きさの添字は `main` とする．
+     * コンパイルできなかったら `error::NotCompilable` を投げる（作りかけのモジュールは捨てる）．
+     * 音のグラフは明示的なスタックで辿るので，長さによらずコンパイルできる．
+     */
+    class Codegen {
+        struct Builder;
+        //! 音と時刻ごとの各時刻の値（同じ音を共有する DAG を一度だけ計算する）
+        using Memo = std::map<std::pair<const ir::Sound *, llvm::Value *>, llvm::Value *>;
+        const type::TypeContext &types;
+        const ir::Module &module;
+        llvm::Module &target;
+        //! モジュールに作った IR の関数
+        std::unordered_map<std::size_t, llvm::Function *> defs;
+        //! 宣言したが本体をまだ作っていない関数
+        std::vector<std::size_t> pending;
+        //! `value` の再帰の深さ
+        std::size_t depth;
+        const ir::Def *get(std::size_t) const;
+        llvm::Type *type(type::TypeId, bool) const;
+        llvm::Value *constant(Builder &, const ir::Value &) const;
+        llvm::Value *prim(Builder &, const ir::Prim &, std::span<llvm::Value *const>, bool) const;
+        llvm::Value *value(Builder &, const ir::Expr &, std::span<llvm::AllocaInst *const>);
+        llvm::Value *evaluate(Builder &, const ir::Expr &, std::span<llvm::AllocaInst *const>);
+        llvm::Value *sample(Builder &, const ir::Sound &, llvm::Value *, Memo &);
+        llvm::Function *def(std::size_t);
+        void bodies();
+        void body(std::size_t);
+    public:
+        Codegen(const type::TypeContext &, const ir::Module &, llvm::Module &);
+        llvm::Function *entry(std::size_t, const std::string &);
+        llvm::Function *render(const ir::Sound &, const std::string &);
+    };
+
+    /**
+     * @brief キャッシュの形式やコード生成が変わったら書き換える．キーのハッシュに混ぜる．
+     */
+    constexpr std::string_view cache_version = "cryss jit-cache 1";
+
+    /**
+     * @brief コンパイルしたオブジェクトファイルのキャッシュを置くディレクトリ
+     *
+     * ファイル名は最適化する前の LLVM IR，ターゲット，CPU とその機能，LLVM の版のハッシュで，
+     * 中身はマジックナンバーと本体のハッシュの後に続くオブジェクトファイル．
+     */
+    class ObjectCache;
+
+    /**
+     * @brief ネイティブコードにした関数と音を持つ．
+     *
+     * 関数は最初に呼び出したときに，音は `compile` したときにコンパイルし，`Jit` が破棄されるまで使える．
+     * シンボルの名前はキーのハッシュにし，同じコードは一度だけ追加する．
+     */
+    class Jit {
+        const type::TypeContext &types;
+        const ir::Module &module;
+        std::unique_ptr<ObjectCache> cache;
+        std::unique_ptr<llvm::TargetMachine> machine;
+        std::unique_ptr<llvm::orc::LLJIT> engine;
+        std::unordered_map<std::size_t, Entry> entries;
+        //! 追加したシンボルの名前
+        std::unordered_set<std::string> symbols;
+        std::string key(const llvm::Module &) const;
+        template<class Func, class Build> Func add(Build);
+    public:
+        Jit(const type::TypeContext &, const ir::Module &, const char * = nullptr);
+        ~Jit();
+        vm::Reg call(std::size_t, std::span<const vm::Reg>);
+        Render compile(const ir::Sound &);
+    };
+
+    /**
+     * @brief 事前にコンパイルした音の出力の形式
+     */
+    enum class Output {
+        //! 再配置可能なオブジェクトファイル
+        Object,
+        //! 共有ライブラリ（システムの C コンパイラでリンクする）
+        Shared,
+    };
+
+    void optimize(llvm::Module &, llvm::TargetMachine &);
+    void emit(const type::TypeContext &, const ir::Module &, std::span<const std::pair<std::string, const ir::Sound *>>, const std::string &, Output);
+}
+
+#endif
@@ -2,50 +2,171 @@
  * @file lexer.cpp
  */
 #include "lexer.hpp"
-#include "error.hpp"
+#include "scan.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
 
 namespace lexer {
+    TokenQueue::TokenQueue(): buffer(64), head(0), count(0) {}
+    bool TokenQueue::empty() const { return count == 0; }
+    std::size_t TokenQueue::size() const { return count; }
+    token::Token &TokenQueue::front(){ return buffer[head]; }
+    /**
+     * @brief 先頭から数えて `index` 番目のトークン
+     */
+    token::Token &TokenQueue::operator[](std::size_t index){ return buffer[(head + index) & (buffer.size() - 1)]; }
+    void TokenQueue::push(const token::Token &token){
+        if(count == buffer.size()){
+            // 満杯なので倍に伸ばし，先頭が添字 0 に来るよう並べ直す
+            std::vector<token::Token> new_buffer(buffer.size() * 2);
+            for(std::size_t i = 0; i < count; i++){
+                new_buffer[i] = buffer[(head + i) & (buffer.size() - 1)];
+            }
+            buffer = std::move(new_buffer);
+            head = 0;
+        }
+        buffer[(head + count) & (buffer.size() - 1)] = token;
+        count++;
+    }
+    void TokenQueue::pop(){
+        head = (head + 1) & (buffer.size() - 1);
+        count--;
+    }
+    /**
+     * @brief 先頭から `size` 個だけを残し，末尾のトークンを捨てる．
+     */
+    void TokenQueue::truncate(std::size_t size){
+        if(size < count) count = size;
+    }
+
     LineLexer::LineLexer(): is_first_token(true) {}
+    /**
+     * @brief コメントや文字列リテラルの途中でなければ `true`
+     *
+     * 次の行の字句解析がこれまでの行に依存しないことを表す．
+     */
+    bool LineLexer::is_clean() const {
+        return comments.empty() && !string;
+    }
+    /**
+     * @brief 次の行以降の字句解析の結果が一致する状態なら `true`
+     */
+    bool LineLexer::same_state(const LineLexer &other) const {
+        return comments == other.comments && string == other.string;
+    }
+    /**
+     * @brief 状態が指す位置を全て `delta` バイトずらす．
+     *
+     * 符号なしの剰余で計算するので，負の方向にずらすには 2 の補数を渡す．
+     */
+    void LineLexer::rebase(std::uint32_t delta){
+        for(auto &pos : comments) pos = pos::Pos(pos.get_offset() + delta);
+        if(string) string.value().first = pos::Pos(string.value().first.get_offset() + delta);
+    }
+    /**
+     * @brief 状態が指す位置（開いているコメントや文字列リテラルの開始）と `bound` のうち最も前のもの
+     */
+    std::uint32_t LineLexer::earliest(std::uint32_t bound) const {
+        for(auto &pos : comments) bound = std::min(bound, pos.get_offset());
+        if(string) bound = std::min(bound, string.value().first.get_offset());
+        return bound;
+    }
     /**
      * @brief コンストラクタ．
+     * @param source 入力元
+     * @param num_threads 字句解析に用いるスレッド数．1 なら 1 行ずつ読みながら解析する．
      */
-    Lexer::Lexer(std::istream &source, bool prompt):
+    Lexer::Lexer(input::Input &source, unsigned num_threads):
         source(source),
-        prompt(prompt) {}
+        incremental(nullptr),
+        num_threads(num_threads),
+        lexed_all(false),
+        line_num(0),
+        offset(0) {}
+    /**
+     * @brief `IncrementalLexer` で解析済みのトークンを受け取るコンストラクタ．
+     */
+    Lexer::Lexer(const IncrementalLexer &incremental):
+        source(const_cast<IncrementalLexer &>(incremental)),
+        incremental(&incremental),
+        num_threads(1),
+        lexed_all(false),
+        line_num(incremental.size()),
+        offset(0) {}
 
     void Lexer::reset_prompt(){
         line_lexer.is_first_token = true;
     }
+    /**
+     * @brief 消費済みのトークンだけが参照していた行を，入力元が手放してよいと伝える．
+     *
+     * 先読みしたトークンや，開いているコメントや文字列リテラルの開始を含む行は残す．
+     * 入力元が位置の原点をずらしたら，持っている位置も同じだけずらす．
+     * トップレベルの要素を 1 つ処理し終えるごとに呼ぶ．それまでの AST の位置は使えなくなる．
+     */
+    void Lexer::release(){
+        if(line_num == 0) return;
+        auto keep = static_cast<std::uint32_t>(source.line_start(line_num - 1));
+        for(std::size_t i = 0; i < tokens.size(); i++) keep = std::min(keep, tokens[i].start);
+        keep = line_lexer.earliest(keep);
+        auto shift = source.release(source.locate(keep).first);
+        if(shift == 0) return;
+        offset -= shift;
+        for(std::size_t i = 0; i < tokens.size(); i++){
+            tokens[i].start -= shift;
+            tokens[i].end -= shift;
+        }
+        line_lexer.rebase(-shift);
+    }
     /**
      * @brief 今までに読んだ入力の記録を返す．
      */
-    const std::deque<std::string> &Lexer::get_log() const {
-        return log;
+    const pos::Source &Lexer::get_log() const {
+        return source;
+    }
+    /**
+     * @brief 1 行読み終えたので，次の行の行頭に進む．
+     * @throw error::SourceTooLarge 位置が 32 bit に収まらなくなった（`release` で原点がずれる入力元では，手放していない行の合計が 4 GiB を超えた）．
+     */
+    void Lexer::advance(std::string_view line){
+        auto next = static_cast<std::uint64_t>(offset) + line.size() + 1;
+        if(next > std::numeric_limits<std::uint32_t>::max()) throw error::make<error::SourceTooLarge>(line_num);
+        offset = static_cast<std::uint32_t>(next);
+        line_num++;
     }
 
     /**
      * @brief 次のトークンを消費せずに返す．
      */
-    std::unique_ptr<token::Token> &Lexer::peek(){
+    const token::Token &Lexer::peek(){
+        if(!lexed_all){
+            if(incremental){
+                lexed_all = true;
+                incremental->export_tokens(tokens, payloads, pending_error, line_lexer, offset);
+            }else if(num_threads > 1){
+                lex_parallel();
+            }
+        }
         while(tokens.empty()){
-            if(source){
+            // 並列に解析した際のエラーは，その手前までのトークンを消費してから投げる
+            if(pending_error) throw std::move(pending_error);
+            // 消費済みのトークンの値はもう参照されない
+            payloads.clear();
+            if(auto line = source.read_line(line_lexer.is_first_token)){
                 // まだ EOF に達していない
-                // 次の行が何行目か
-                auto line_num = log.size();
-                // log に空の std::string を追加し，1 行読んで格納
-                log.emplace_back();
-                if(prompt){
-                    std::cout << (line_lexer.is_first_token ? "> " : "+ ");
-                }
-                std::getline(source, log.back());
                 // 字句解析を行う
-                line_lexer.run(line_num, log.back(), tokens);
+                auto start = offset;
+                advance(line.value());
+                line_lexer.run(start, line.value(), tokens, payloads);
             }else{
                 // EOF に達した
                 // コメント中なら例外を投げる
                 line_lexer.deal_with_eof();
-                // トークンの代わりに nullptr を入れる
-                tokens.emplace();
+                // EOF を表すトークンを入れる
+                tokens.push(token::Token{token::Kind::End, 0, offset, offset});
             }
         }
         // ここで tokens は空でない
@@ -55,25 +176,279 @@ namespace lexer {
     /**
      * @brief 次のトークンを消費して返す．
      */
-    std::unique_ptr<token::Token> Lexer::next(){
-        auto ret = std::move(peek());
+    token::Token Lexer::next(){
+        auto ret = peek();
         tokens.pop();
         return ret;
     }
 
+    /**
+     * @brief 先読みしたトークンが単独で式になるならその式を `arena` 上に作って返す．
+     *
+     * トークンの値は次の行を読むまでしか保持されないので，`next()` より先に呼ぶ．
+     */
+    ast::Expr *Lexer::factor(const token::Token &token, ast::Arena &arena) const {
+        return token::factor(token, payloads, arena);
+    }
+    /**
+     * @brief 先読みしたトークンがキーワードならそれを返す．
+     */
+    std::optional<token::Keyword> Lexer::keyword(const token::Token &token) const {
+        return token::keyword(token);
+    }
+
+    namespace {
+        /**
+         * @brief 並列な字句解析の単位となる，連続した行の範囲
+         */
+        struct Chunk {
+            std::size_t begin, end;
+            TokenQueue tokens;
+            token::Payloads payloads;
+            //! 最後の行を解析し終えたときの状態
+            LineLexer state;
+            std::unique_ptr<error::Error> error;
+            Chunk(std::size_t begin, std::size_t end): begin(begin), end(end) {}
+            /**
+             * @brief `initial` の状態から始めて字句解析する．
+             *
+             * エラーが起きた場合，その行の途中までのトークンは捨てて `error` に格納する．
+             */
+            void run(const std::vector<std::string_view> &lines, const std::vector<std::uint32_t> &starts, const LineLexer &initial){
+                tokens = TokenQueue();
+                payloads.clear();
+                error.reset();
+                state = initial;
+                for(std::size_t i = begin; i < end; i++){
+                    auto size = tokens.size();
+                    try {
+                        state.run(starts[i], lines[i], tokens, payloads);
+                    }catch(std::unique_ptr<error::Error> &e){
+                        tokens.truncate(size);
+                        error = std::move(e);
+                        return;
+                    }
+                }
+            }
+        };
+    }
+
+    /**
+     * @brief 入力全体を読み，複数のスレッドで字句解析する．
+     *
+     * 行単位のチャンクに分け，まず全てのチャンクを「コメントや文字列リテラルの途中でない」
+     * と仮定して並列に解析する．その後先頭から順に，直前のチャンクの終了時の状態が
+     * 仮定と異なっていたチャンクだけを正しい状態から解析し直す．
+     */
+    void Lexer::lex_parallel(){
+        lexed_all = true;
+        std::vector<std::string_view> lines;
+        std::vector<std::uint32_t> starts;
+        auto first_offset = offset;
+        while(auto line = source.read_line(false)){
+            lines.push_back(line.value());
+            starts.push_back(offset);
+            advance(line.value());
+        }
+        std::size_t total_bytes = offset - first_offset;
+        // 1 スレッドあたり数個のチャンクを受け持つよう分ける
+        constexpr std::size_t min_chunk_bytes = 64 * 1024;
+        std::size_t chunk_bytes = std::max(min_chunk_bytes, total_bytes / (num_threads * 4) + 1);
+        std::vector<Chunk> chunks;
+        for(std::size_t begin = 0, bytes = 0, i = 0; i < lines.size(); i++){
+            bytes += lines[i].size() + 1;
+            if(bytes >= chunk_bytes || i + 1 == lines.size()){
+                chunks.emplace_back(begin, i + 1);
+                begin = i + 1;
+                bytes = 0;
+            }
+        }
+
+        const LineLexer clean;
+        std::atomic<std::size_t> next_chunk = 0;
+        auto worker = [&]{
+            for(std::size_t i; (i = next_chunk++) < chunks.size(); ){
+                chunks[i].run(lines, starts, clean);
+            }
+        };
+        std::vector<std::thread> threads;
+        for(unsigned i = 1; i < num_threads && i < chunks.size(); i++) threads.emplace_back(worker);
+        worker();
+        for(auto &thread : threads) thread.join();
+
+        // 先頭から順に繋げる
+        LineLexer state = line_lexer;
+        for(auto &chunk : chunks){
+            if(!state.is_clean()) chunk.run(lines, starts, state);
+            auto numbers_offset = static_cast<std::uint32_t>(payloads.numbers.size());
+            auto strings_offset = static_cast<std::uint32_t>(payloads.strings.size());
+            for(; !chunk.tokens.empty(); chunk.tokens.pop()){
+                auto token = chunk.tokens.front();
+                if(token.kind == token::Kind::Number) token.payload += numbers_offset;
+                else if(token.kind == token::Kind::String) token.payload += strings_offset;
+                tokens.push(token);
+            }
+            payloads.numbers.insert(payloads.numbers.end(), chunk.payloads.numbers.begin(), chunk.payloads.numbers.end());
+            std::move(chunk.payloads.strings.begin(), chunk.payloads.strings.end(), std::back_inserter(payloads.strings));
+            if(chunk.error){
+                pending_error = std::move(chunk.error);
+                break;
+            }
+            state = std::move(chunk.state);
+        }
+        line_lexer = std::move(state);
+    }
+
+    IncrementalLexer::IncrementalLexer(): line_starts{0} {}
+
+    /**
+     * @brief `index` 行目を，直前の行末の状態 `initial` から字句解析する．
+     *
+     * 位置は行頭を 0 として数え，行末の状態は次の行の行頭からの相対位置に直しておく．
+     * エラーが起きた場合はその行のトークンを全て捨てる．
+     */
+    void IncrementalLexer::run_line(std::size_t index, const LineLexer &initial){
+        auto &line = *lines[index];
+        TokenQueue queue;
+        line.payloads.clear();
+        line.tokens.clear();
+        line.state = initial;
+        line.has_error = false;
+        try {
+            line.state.run(0, line.text, queue, line.payloads);
+        }catch(std::unique_ptr<error::Error> &){
+            line.has_error = true;
+        }
+        line.state.rebase(-static_cast<std::uint32_t>(line.text.size() + 1));
+        if(line.has_error) return;
+        for(; !queue.empty(); queue.pop()) line.tokens.push_back(queue.front());
+    }
+
+    /**
+     * @brief `first` 行目から `last` 行目の手前までを `replacement` で置き換え，必要な行だけ解析し直す．
+     *
+     * 末尾に行を追加するには `first` と `last` を `size()` にする．
+     * @return 解析し直した行数
+     */
+    std::size_t IncrementalLexer::edit(std::size_t first, std::size_t last, const std::vector<std::string> &replacement){
+        // 置き換えた範囲の直後の行の，以前の行頭の状態
+        LineLexer old_incoming = last > 0 ? lines[last - 1]->state : LineLexer();
+
+        lines.erase(lines.begin() + static_cast<std::ptrdiff_t>(first), lines.begin() + static_cast<std::ptrdiff_t>(last));
+        std::vector<std::unique_ptr<Line>> inserted;
+        for(auto &text : replacement){
+            inserted.push_back(std::make_unique<Line>());
+            inserted.back()->text = text;
+        }
+        lines.insert(lines.begin() + static_cast<std::ptrdiff_t>(first), std::make_move_iterator(inserted.begin()), std::make_move_iterator(inserted.end()));
+
+        // 置き換えた範囲より後ろの行は，相対位置なのでそのまま使い回す
+        auto rest = first + replacement.size();
+        line_starts.resize(lines.size() + 1);
+        for(auto i = first; i < lines.size(); i++) line_starts[i + 1] = line_starts[i] + lines[i]->text.size() + 1;
+
+        std::size_t count = 0;
+        LineLexer incoming = first > 0 ? lines[first - 1]->state : LineLexer();
+        for(auto i = first; i < lines.size(); i++){
+            if(i >= rest){
+                // 行頭の状態が以前と一致すれば，これ以降の結果は変わらない
+                if(incoming.same_state(old_incoming)) break;
+                old_incoming = lines[i]->state;
+            }
+            run_line(i, incoming);
+            incoming = lines[i]->state;
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * @brief 全ての行のトークンを繋げて渡す．
+     *
+     * エラーの起きた行があれば，その手前までのトークンと，その行を解析し直して得たエラーを渡す．
+     * @param tokens トークンの格納先
+     * @param payloads トークンの値の格納先
+     * @param error エラーの格納先
+     * @param state 最後の行末の状態の格納先
+     * @param offset 最後の行の次の行頭のオフセットの格納先
+     */
+    void IncrementalLexer::export_tokens(
+        TokenQueue &tokens,
+        token::Payloads &payloads,
+        std::unique_ptr<error::Error> &error,
+        LineLexer &state,
+        std::uint32_t &offset
+    ) const {
+        LineLexer incoming;
+        for(std::size_t i = 0; i < lines.size(); i++){
+            auto &line = *lines[i];
+            auto start = static_cast<std::uint32_t>(line_starts[i]);
+            if(line.has_error){
+                TokenQueue discarded;
+                token::Payloads discarded_payloads;
+                incoming.rebase(start);
+                try {
+                    incoming.run(start, line.text, discarded, discarded_payloads);
+                }catch(std::unique_ptr<error::Error> &e){
+                    error = std::move(e);
+                }
+                return;
+            }
+            auto numbers_offset = static_cast<std::uint32_t>(payloads.numbers.size());
+            auto strings_offset = static_cast<std::uint32_t>(payloads.strings.size());
+            for(auto token : line.tokens){
+                if(token.kind == token::Kind::Number) token.payload += numbers_offset;
+                else if(token.kind == token::Kind::String) token.payload += strings_offset;
+                token.start += start;
+                token.end += start;
+                tokens.push(token);
+            }
+            payloads.numbers.insert(payloads.numbers.end(), line.payloads.numbers.begin(), line.payloads.numbers.end());
+            payloads.strings.insert(payloads.strings.end(), line.payloads.strings.begin(), line.payloads.strings.end());
+            incoming = line.state;
+        }
+        offset = static_cast<std::uint32_t>(line_starts.back());
+        incoming.rebase(offset);
+        state = incoming;
+    }
+
+    /**
+     * @brief 常に `std::nullopt` を返す．
+     *
+     * トークンは `export_tokens` でまとめて渡すので，1 行ずつは読ませない．
+     */
+    std::optional<std::string_view> IncrementalLexer::read_line(bool){
+        return std::nullopt;
+    }
+    std::size_t IncrementalLexer::size() const {
+        return lines.size();
+    }
+    std::string_view IncrementalLexer::operator[](std::size_t line) const {
+        return lines[line]->text;
+    }
+    std::size_t IncrementalLexer::line_start(std::size_t line) const {
+        return line_starts[line];
+    }
+
     /**
      * @brief 1 行分の文字列を受け取って，トークンに分解する．
-     * @param line_num 位置情報に用いられる行番号．
+     * @param offset 位置情報に用いられる，行頭のオフセット．
      * @param line 1 行ぶんの文字列．
      * @param tokens トークンの格納先．
+     * @param payloads トークンの値の格納先．
      * @throw error::UnexpectedCharacter トークンの開始として適さない文字列があった．
+     * @throw error::MalformedNumber 数値リテラルが文法に合わなかった．
+     * @throw error::NumberOutOfRange 数値リテラルの値が表せる範囲を超えた．
      */
     void LineLexer::run(
-        std::size_t line_num,
+        std::uint32_t offset,
         const std::string_view &line,
-        std::queue<std::unique_ptr<token::Token>> &tokens
+        TokenQueue &tokens,
+        token::Payloads &payloads
     ){
         std::size_t cursor = 0;
+        // 行頭から byte バイト目の位置
+        auto at = [&](std::size_t byte){ return static_cast<std::uint32_t>(offset + byte); };
         auto advance_if = [&](char ch){
             bool ret = cursor < line.size() && line[cursor] == ch;
             if(ret) cursor++;
@@ -82,151 +457,171 @@ namespace lexer {
         while(true){
             while(true){
                 if(!comments.empty()){
-                    if(cursor >= line.size() - 1){
+                    cursor = scan::find_comment_delimiter(line, cursor);
+                    if(cursor + 1 >= line.size()){
                         return;
                     }else if(line[cursor] == '*' && line[cursor + 1] == '/'){
                         comments.pop_back();
                         cursor += 2;
                         continue;
                     }else if(line[cursor] == '/' && line[cursor + 1] == '*'){
-                        comments.emplace_back(line_num, cursor);
+                        comments.emplace_back(at(cursor));
                         cursor += 2;
                         continue;
                     }
                 }else if(string){
+                    // エスケープを含まない部分はまとめて追加する
+                    auto delimiter = scan::find_string_delimiter(line, cursor);
+                    string.value().second.append(line.substr(cursor, delimiter - cursor));
+                    cursor = delimiter;
                     if(cursor == line.size()){
                         string.value().second.push_back('\n');
                         return;
                     }else if(line[cursor] == '"'){
                         cursor++;
-                        std::unique_ptr<token::Token> token = std::make_unique<token::String>(std::move(string.value().second));
-                        token->pos = pos::Range(string.value().first, pos::Pos(line_num, cursor));
-                        tokens.push(std::move(token));
+                        tokens.push(token::Token{
+                            token::Kind::String,
+                            static_cast<std::uint32_t>(payloads.strings.size()),
+                            string.value().first.get_offset(),
+                            at(cursor),
+                        });
+                        payloads.strings.push_back(std::move(string.value().second));
                         string.reset();
                         continue;
+                    }else if(cursor == line.size() - 1){
+                        // 行末が `\` なら改行文字を push しない
+                        return;
                     }else{
+                        cursor++;
                         char ch;
-                        if(line[cursor] == '\\'){
-                            if(cursor == line.size() - 1){
-                                // 行末が `\` なら改行文字を push しない
-                                return;
-                            }else{
-                                cursor++;
-                                switch(line[cursor]){
-                                    case 'n': ch = '\n'; break;
-                                    case 't': ch = '\t'; break;
-                                    case 'r': ch = '\r'; break;
-                                    case '0': ch = '\0'; break;
-                                    default: ch = line[cursor];
-                                }
-                            }
-                        }else{
-                            ch = line[cursor];
+                        switch(line[cursor]){
+                            case 'n': ch = '\n'; break;
+                            case 't': ch = '\t'; break;
+                            case 'r': ch = '\r'; break;
+                            case '0': ch = '\0'; break;
+                            default: ch = line[cursor];
                         }
                         string.value().second.push_back(ch);
                     }
-                }else if(cursor == line.size()){
-                    return;
-                }else if(line[cursor] == '"'){
-                    string.emplace(pos::Pos(line_num, cursor), "");
-                }else if(!std::isspace(line[cursor])) break;
+                }else{
+                    cursor = scan::skip_space(line, cursor);
+                    if(cursor == line.size()){
+                        return;
+                    }else if(line[cursor] == '"'){
+                        string.emplace(pos::Pos(at(cursor)), "");
+                    }else break;
+                }
                 ++cursor;
             }
             std::size_t start = cursor;
-            std::unique_ptr<token::Token> token;
+            token::Kind kind;
+            std::uint32_t payload = 0;
             auto parse_number = [&]{
                 do cursor++;
                 while(
                     cursor < line.size() && (
                         std::isalnum(line[cursor])
                         || line[cursor] == '.'
-                        || (line[cursor - 1] == 'e' && (line[cursor] == '+' || line[cursor] == '-'))
+                        || ((line[cursor - 1] == 'e' || line[cursor - 1] == 'E') && (line[cursor] == '+' || line[cursor] == '-'))
                     )
                 );
-                token = std::make_unique<token::Number>(line.substr(start, cursor - start));
+                auto decoded = literal::decode(line.substr(start, cursor - start));
+                if(auto failure = std::get_if<literal::Failure>(&decoded)){
+                    pos::Range range(at(start), at(cursor));
+                    if(*failure == literal::Failure::OutOfRange) throw error::make<error::NumberOutOfRange>(std::move(range));
+                    else throw error::make<error::MalformedNumber>(std::move(range));
+                }
+                kind = token::Kind::Number;
+                payload = static_cast<std::uint32_t>(payloads.numbers.size());
+                payloads.numbers.push_back(std::get<literal::Literal>(decoded));
             };
             if(std::isdigit(line[start])){
                 parse_number();
             }else if(advance_if('.')){
                 if(cursor < line.size() && std::isdigit(line[cursor])) parse_number();
-                else token = std::make_unique<token::Dot>();
+                else kind = token::Kind::Dot;
             }else if(std::isalpha(line[start]) || line[start] == '_' || line[start] == '$'){
                 do cursor++;
                 while(cursor < line.size() && (std::isalnum(line[cursor]) || line[cursor] == '_' || line[cursor] == '$'));
-                token = std::make_unique<token::Identifier>(line.substr(start, cursor - start));
+                kind = token::Kind::Identifier;
+                payload = symbol::intern(line.substr(start, cursor - start));
             }else if(advance_if('+')){
-                if(advance_if('+')) token = std::make_unique<token::DoublePlus>();
-                else if(advance_if('=')) token = std::make_unique<token::PlusEqual>();
-                else token = std::make_unique<token::Plus>();
+                if(advance_if('+')) kind = token::Kind::DoublePlus;
+                else if(advance_if('=')) kind = token::Kind::PlusEqual;
+                else kind = token::Kind::Plus;
             }else if(advance_if('-')){
-                if(advance_if('-')) token = std::make_unique<token::DoubleHyphen>();
-                else if(advance_if('=')) token = std::make_unique<token::HyphenEqual>();
-                else token = std::make_unique<token::Hyphen>();
+                if(advance_if('-')) kind = token::Kind::DoubleHyphen;
+                else if(advance_if('=')) kind = token::Kind::HyphenEqual;
+                else kind = token::Kind::Hyphen;
             }else if(advance_if('*')){
-                if(advance_if('=')) token = std::make_unique<token::AsteriskEqual>();
-                else token = std::make_unique<token::Asterisk>();
+                if(advance_if('=')) kind = token::Kind::AsteriskEqual;
+                else kind = token::Kind::Asterisk;
             }else if(advance_if('/')){
-                if(line[cursor] == '/'){
+                if(cursor < line.size() && line[cursor] == '/'){
                     return;
                 }else if(advance_if('*')){
-                    comments.emplace_back(line_num, start);
+                    comments.emplace_back(at(start));
                     continue;
-                }else if(advance_if('=')) token = std::make_unique<token::SlashEqual>();
-                else token = std::make_unique<token::Slash>();
+                }else if(advance_if('=')) kind = token::Kind::SlashEqual;
+                else kind = token::Kind::Slash;
             }else if(advance_if('%')){
-                if(advance_if('=')) token = std::make_unique<token::PercentEqual>();
-                else token = std::make_unique<token::Percent>();
+                if(advance_if('=')) kind = token::Kind::PercentEqual;
+                else kind = token::Kind::Percent;
             }else if(advance_if('=')){
-                if(advance_if('=')) token = std::make_unique<token::DoubleEqual>();
-                else token = std::make_unique<token::Equal>();
+                if(advance_if('=')) kind = token::Kind::DoubleEqual;
+                else kind = token::Kind::Equal;
             }else if(advance_if('!')){
-                if(advance_if('=')) token = std::make_unique<token::ExclamationEqual>();
-                else token = std::make_unique<token::Exclamation>();
+                if(advance_if('=')) kind = token::Kind::ExclamationEqual;
+                else kind = token::Kind::Exclamation;
             }else if(advance_if('<')){
                 if(advance_if('<')){
                     if(advance_if('<')){
-                        if(advance_if('=')) token = std::make_unique<token::TripleLessEqual>();
-                        else token = std::make_unique<token::TripleLess>();
-                    }else if(advance_if('=')) token = std::make_unique<token::DoubleLessEqual>();
-                    else token = std::make_unique<token::DoubleLess>();
-                }else if(advance_if('=')) token = std::make_unique<token::LessEqual>();
-                else token = std::make_unique<token::Less>();
+                        if(advance_if('=')) kind = token::Kind::TripleLessEqual;
+                        else kind = token::Kind::TripleLess;
+                    }else if(advance_if('=')) kind = token::Kind::DoubleLessEqual;
+                    else kind = token::Kind::DoubleLess;
+                }else if(advance_if('=')) kind = token::Kind::LessEqual;
+                else kind = token::Kind::Less;
             }else if(advance_if('>')){
                 if(advance_if('>')){
                     if(advance_if('>')){
-                        if(advance_if('=')) token = std::make_unique<token::TripleGreaterEqual>();
-                        else token = std::make_unique<token::TripleGreater>();
-                    }else if(advance_if('=')) token = std::make_unique<token::DoubleGreaterEqual>();
-                    else token = std::make_unique<token::DoubleGreater>();
-                }else if(advance_if('=')) token = std::make_unique<token::GreaterEqual>();
-                else token = std::make_unique<token::Greater>();
+                        if(advance_if('=')) kind = token::Kind::TripleGreaterEqual;
+                        else kind = token::Kind::TripleGreater;
+                    }else if(advance_if('=')) kind = token::Kind::DoubleGreaterEqual;
+                    else kind = token::Kind::DoubleGreater;
+                }else if(advance_if('=')) kind = token::Kind::GreaterEqual;
+                else kind = token::Kind::Greater;
             }else if(advance_if('&')){
-                if(advance_if('&')) token = std::make_unique<token::DoubleAmpersand>();
-                else if(advance_if('=')) token = std::make_unique<token::AmpersandEqual>();
-                else token = std::make_unique<token::Ampersand>();
+                if(advance_if('&')) kind = token::Kind::DoubleAmpersand;
+                else if(advance_if('=')) kind = token::Kind::AmpersandEqual;
+                else kind = token::Kind::Ampersand;
             }else if(advance_if('|')){
-                if(advance_if('|')) token = std::make_unique<token::DoubleBar>();
-                else if(advance_if('=')) token = std::make_unique<token::BarEqual>();
-                else token = std::make_unique<token::Bar>();
+                if(advance_if('|')) kind = token::Kind::DoubleBar;
+                else if(advance_if('=')) kind = token::Kind::BarEqual;
+                else kind = token::Kind::Bar;
             }else if(advance_if('^')){
-                if(advance_if('=')) token = std::make_unique<token::CircumflexEqual>();
-                else token = std::make_unique<token::Circumflex>();
-            }else if(advance_if('.')) token = std::make_unique<token::Dot>();
-            else if(advance_if(':')) token = std::make_unique<token::Colon>();
-            else if(advance_if(';')) token = std::make_unique<token::Semicolon>();
-            else if(advance_if(',')) token = std::make_unique<token::Comma>();
-            else if(advance_if('?')) token = std::make_unique<token::Question>();
-            else if(advance_if('#')) token = std::make_unique<token::Hash>();
-            else if(advance_if('~')) token = std::make_unique<token::Tilde>();
-            else if(advance_if('(')) token = std::make_unique<token::OpeningParenthesis>();
-            else if(advance_if(')')) token = std::make_unique<token::ClosingParenthesis>();
-            else if(advance_if('[')) token = std::make_unique<token::OpeningBracket>();
-            else if(advance_if(']')) token = std::make_unique<token::ClosingBracket>();
-            else if(advance_if('{')) token = std::make_unique<token::OpeningBrace>();
-            else if(advance_if('}')) token = std::make_unique<token::ClosingBrace>();
-            else throw error::make<error::UnexpectedCharacter>(pos::Pos(line_num, cursor));
-            token->pos = pos::Range(line_num, start, cursor);
-            tokens.push(std::move(token));
+                if(advance_if('=')) kind = token::Kind::CircumflexEqual;
+                else kind = token::Kind::Circumflex;
+            }else if(advance_if('.')) kind = token::Kind::Dot;
+            else if(advance_if(':')) kind = token::Kind::Colon;
+            else if(advance_if(';')) kind = token::Kind::Semicolon;
+            else if(advance_if(',')) kind = token::Kind::Comma;
+            else if(advance_if('?')) kind = token::Kind::Question;
+            else if(advance_if('#')) kind = token::Kind::Hash;
+            else if(advance_if('~')) kind = token::Kind::Tilde;
+            else if(advance_if('(')) kind = token::Kind::OpeningParenthesis;
+            else if(advance_if(')')) kind = token::Kind::ClosingParenthesis;
+            else if(advance_if('[')) kind = token::Kind::OpeningBracket;
+            else if(advance_if(']')) kind = token::Kind::ClosingBracket;
+            else if(advance_if('{')) kind = token::Kind::OpeningBrace;
+            else if(advance_if('}')) kind = token::Kind::ClosingBrace;
+            else throw error::make<error::UnexpectedCharacter>(pos::Pos(at(cursor)));
+            tokens.push(token::Token{
+                kind,
+                payload,
+                at(start),
+                at(cursor),
+            });
         }
     }
 
@@ -5,18 +5,37 @@
 #ifndef LEXER_HPP
 #define LEXER_HPP
 
-#include <queue>
-#include <istream>
 #include <memory>
 #include <optional>
-#include <deque>
+#include <vector>
 
 #include "token.hpp"
+#include "input.hpp"
+#include "error.hpp"
 
 /**
  * @brief 字句解析を行う
  */
 namespace lexer {
+    /**
+     * @brief トークンを格納するリングバッファ
+     *
+     * 容量は常に 2 の冪で，満杯になったときだけ倍に伸ばす．
+     */
+    class TokenQueue {
+        std::vector<token::Token> buffer;
+        std::size_t head, count;
+    public:
+        TokenQueue();
+        bool empty() const;
+        std::size_t size() const;
+        token::Token &front();
+        token::Token &operator[](std::size_t);
+        void push(const token::Token &);
+        void pop();
+        void truncate(std::size_t);
+    };
+
     /**
      * @brief Lexer が内部で用いる．
      *
@@ -28,28 +47,90 @@ namespace lexer {
     public:
         bool is_first_token;
         LineLexer();
+        bool is_clean() const;
+        bool same_state(const LineLexer &) const;
+        void rebase(std::uint32_t);
+        std::uint32_t earliest(std::uint32_t) const;
         void run(
-            std::size_t,
+            std::uint32_t,
             const std::string_view &,
-            std::queue<std::unique_ptr<token::Token>> &
+            TokenQueue &,
+            token::Payloads &
         );
         void deal_with_eof();
     };
 
+    class IncrementalLexer;
+
     /**
      * @brief 入力を読みながら，トークンに分解する．
+     *
+     * `num_threads` が 2 以上なら，最初の `peek()` で入力全体を読み，
+     * 行単位のチャンクに分けて複数のスレッドで字句解析する（`lex_parallel()`）．
+     * 得られるトークン列とエラーは 1 行ずつ解析した場合と同じになる．
+     *
+     * `IncrementalLexer` から作った場合は，解析済みのトークンをまとめて受け取る．
      */
     class Lexer {
-        std::istream &source;
-        bool prompt;
-        std::deque<std::string> log;
-        std::queue<std::unique_ptr<token::Token>> tokens;
+        input::Input &source;
+        const IncrementalLexer *incremental;
+        unsigned num_threads;
+        bool lexed_all;
+        std::size_t line_num;
+        //! 次に読む行の行頭のオフセット
+        std::uint32_t offset;
+        TokenQueue tokens;
+        token::Payloads payloads;
         LineLexer line_lexer;
+        std::unique_ptr<error::Error> pending_error;
+        void lex_parallel();
+        void advance(std::string_view);
     public:
-        Lexer(std::istream &, bool);
+        Lexer(input::Input &, unsigned = 1);
+        Lexer(const IncrementalLexer &);
         void reset_prompt();
-        const std::deque<std::string> &get_log() const;
-        std::unique_ptr<token::Token> next(), &peek();
+        void release();
+        const pos::Source &get_log() const;
+        const token::Token &peek();
+        token::Token next();
+        ast::Expr *factor(const token::Token &, ast::Arena &) const;
+        std::optional<token::Keyword> keyword(const token::Token &) const;
+    };
+
+    /**
+     * @brief 行ごとのトークンを保持し，編集された行だけを解析し直す．
+     *
+     * エディタとの連携のように，同じソースコードを少しずつ変えながら繰り返し解析する場合に用いる．
+     * 各行について，その行で確定したトークンと行末での `LineLexer` の状態を覚えておき，
+     * 編集された行から解析し直して，行頭の状態が以前と一致した時点で打ち切る．
+     * それ以降の行のトークンはそのまま使い回す．
+     * 各行のトークンや状態の位置はその行の行頭からの相対位置（符号なしの剰余で前の行も指せる）
+     * で持つので，行の長さや行数が変わってもずらす必要はない．
+     *
+     * トークンは `Lexer(const IncrementalLexer &)` でまとめて受け取る．
+     */
+    class IncrementalLexer : public input::Input {
+        struct Line {
+            std::string text;
+            std::vector<token::Token> tokens;
+            token::Payloads payloads;
+            //! 行末での状態（位置は次の行の行頭からの相対位置）
+            LineLexer state;
+            //! この行で字句解析のエラーが起きた
+            bool has_error;
+        };
+        std::vector<std::unique_ptr<Line>> lines;
+        //! 各行の行頭のオフセット（末尾に全体の大きさを加えた `lines.size() + 1` 個）
+        std::vector<std::size_t> line_starts;
+        void run_line(std::size_t, const LineLexer &);
+    public:
+        IncrementalLexer();
+        std::size_t edit(std::size_t, std::size_t, const std::vector<std::string> &);
+        void export_tokens(TokenQueue &, token::Payloads &, std::unique_ptr<error::Error> &, LineLexer &, std::uint32_t &) const;
+        std::optional<std::string_view> read_line(bool) override;
+        std::size_t size() const override;
+        std::string_view operator[](std::size_t) const override;
+        std::size_t line_start(std::size_t) const override;
     };
 }
 
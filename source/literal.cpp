@@ -0,0 +1,103 @@
+/**
+ * @file literal.cpp
+ */
+#include "literal.hpp"
+
+#include <charconv>
+#include <numeric>
+#include <system_error>
+
+namespace literal {
+    /**
+     * @brief `text[from]` から続く数字の終わりを返す．
+     */
+    static std::size_t skip_digits(std::string_view text, std::size_t from){
+        while(from < text.size() && '0' <= text[from] && text[from] <= '9') from++;
+        return from;
+    }
+
+    /**
+     * @brief 数字のみからなる文字列を符号なし整数にする（空なら 0）．
+     * @return 64 bit に収まらなければ `std::nullopt`
+     */
+    static std::optional<std::uint64_t> parse_digits(std::string_view digits){
+        std::uint64_t value = 0;
+        if(digits.empty()) return value;
+        auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        if(ec != std::errc()) return std::nullopt;
+        return value;
+    }
+
+    /**
+     * @brief 数値リテラルの文字列を値にする．
+     *
+     * 文法は `digits [ "." digits ] [ ("e" | "E") [ "+" | "-" ] digits ]`（整数部か小数部の一方は省略できる）．
+     * 小数点も指数部もなければ `Int`，小数点のみなら `Rational`，指数部があれば `Float` になる．
+     * `Rational` の分子と分母が 64 bit に収まらないほど小数部が長ければ，収まる桁までで丸める．
+     * @param text Lexer が数値リテラルとして切り出した文字列
+     * @return 値．文法に合わなければ `Failure::Malformed`，表せる範囲を超えれば `Failure::OutOfRange`．
+     */
+    std::variant<Literal, Failure> decode(std::string_view text){
+        std::size_t int_end = skip_digits(text, 0);
+        std::size_t frac_begin = int_end, frac_end = int_end;
+        bool has_point = int_end < text.size() && text[int_end] == '.';
+        if(has_point){
+            frac_begin = int_end + 1;
+            frac_end = skip_digits(text, frac_begin);
+        }
+        if(int_end == 0 && frac_end == frac_begin) return Failure::Malformed;
+        std::size_t cursor = frac_end;
+        bool has_exponent = cursor < text.size() && (text[cursor] == 'e' || text[cursor] == 'E');
+        if(has_exponent){
+            cursor++;
+            if(cursor < text.size() && (text[cursor] == '+' || text[cursor] == '-')) cursor++;
+            std::size_t exponent_end = skip_digits(text, cursor);
+            if(exponent_end == cursor) return Failure::Malformed;
+            cursor = exponent_end;
+        }
+        if(cursor != text.size()) return Failure::Malformed;
+
+        if(has_exponent){
+            double value;
+            auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if(ec == std::errc::result_out_of_range) return Failure::OutOfRange;
+            if(ec != std::errc() || ptr != text.data() + text.size()) return Failure::Malformed;
+            return Float{value};
+        }
+
+        auto int_value = parse_digits(text.substr(0, int_end));
+        if(!int_value || *int_value > static_cast<std::uint64_t>(INT64_MAX)) return Failure::OutOfRange;
+        if(!has_point) return Int{static_cast<std::int64_t>(*int_value)};
+
+        // 末尾の 0 は値に影響しないので除き，numer / 10^k を約分する
+        // 64 bit に収まらない桁は捨て，捨てた最初の桁で四捨五入する
+        auto frac = text.substr(frac_begin, frac_end - frac_begin);
+        while(!frac.empty() && frac.back() == '0') frac.remove_suffix(1);
+        std::int64_t numer = static_cast<std::int64_t>(*int_value), denom = 1;
+        for(auto digit : frac){
+            std::int64_t next_numer, next_denom;
+            if(
+                __builtin_mul_overflow(numer, 10, &next_numer)
+                || __builtin_add_overflow(next_numer, digit - '0', &next_numer)
+                || __builtin_mul_overflow(denom, 10, &next_denom)
+            ){
+                if(digit >= '5' && numer < INT64_MAX) numer++;
+                break;
+            }
+            numer = next_numer;
+            denom = next_denom;
+        }
+        auto divisor = std::gcd(numer, denom);
+        return Rational{numer / divisor, denom / divisor};
+    }
+}
+
+#ifdef DEBUG
+namespace literal {
+    std::ostream &operator<<(std::ostream &os, const Literal &literal){
+        if(auto value = std::get_if<Int>(&literal)) return os << "int " << value->value;
+        else if(auto value = std::get_if<Rational>(&literal)) return os << "rational " << value->numer << "/" << value->denom;
+        else return os << "float " << std::get<Float>(literal).value;
+    }
+}
+#endif
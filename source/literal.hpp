@@ -0,0 +1,65 @@
+/**
+ * @file literal.hpp
+ * @brief 数値リテラルの値を定義する．
+ */
+#ifndef LITERAL_HPP
+#define LITERAL_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+/**
+ * @brief 数値リテラルの値を定義する．
+ *
+ * Lexer が一度だけ読み取り，以降のフェーズは文字列を読み直さずにこの値を使う．
+ */
+namespace literal {
+    /**
+     * @brief 整数リテラル（`type::Int` に対応する）
+     */
+    struct Int {
+        std::int64_t value;
+        friend bool operator==(const Int &, const Int &) = default;
+    };
+
+    /**
+     * @brief 小数点を含むリテラル（`type::Rational` に対応する）
+     *
+     * 10 進小数を誤差なく表すため既約分数で持つ．`denom` は常に正．
+     */
+    struct Rational {
+        std::int64_t numer, denom;
+        friend bool operator==(const Rational &, const Rational &) = default;
+    };
+
+    /**
+     * @brief 指数部を含むリテラル（`type::Float` に対応する）
+     */
+    struct Float {
+        double value;
+        friend bool operator==(const Float &, const Float &) = default;
+    };
+
+    using Literal = std::variant<Int, Rational, Float>;
+
+    /**
+     * @brief `decode` の失敗の理由
+     */
+    enum class Failure {
+        Malformed,
+        OutOfRange,
+    };
+
+    std::variant<Literal, Failure> decode(std::string_view);
+}
+
+#ifdef DEBUG
+#include <ostream>
+namespace literal {
+    std::ostream &operator<<(std::ostream &, const Literal &);
+}
+#endif
+
+#endif
@@ -0,0 +1,582 @@
+/**
+ * @file lower.cpp
+ */
+#include "lower.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <numbers>
+#include <utility>
+
+/**
+ * @brief ムーブしかできない式の列を作る．
+ */
+template<class... Exprs>
+static std::vector<std::unique_ptr<ir::Expr>> list(Exprs&&... exprs){
+    std::vector<std::unique_ptr<ir::Expr>> ret;
+    (ret.push_back(std::move(exprs)), ...);
+    return ret;
+}
+
+namespace lower {
+    Lowerer::Lowerer(type::TypeContext &context, const check::Defs &defs, ir::Module &module):
+        context(context),
+        defs(defs),
+        module(module),
+        main{std::make_shared<ir::Def>(type::no_type, "main", 0), 0, std::vector<std::unordered_map<symbol::Symbol, std::size_t>>(1), {}, type::no_type},
+        function(&main),
+        emitted(0) {
+        main.current = main.def->add_block();
+    }
+
+    /**
+     * @brief トップレベルの要素を変換する．
+     *
+     * 文は `main` の続きに，関数定義は `ir::Module::defs` の同じ添字に置く．
+     */
+    void Lowerer::lower(const ast::TopLevel &item){
+        function = &main;
+        item.lower(*this);
+    }
+    /**
+     * @brief `main` を閉じて `ir::Module::main` に置く．
+     */
+    void Lowerer::finish(){
+        function = &main;
+        terminate(std::make_unique<ir::Ret>(nullptr));
+        main.def->prune();
+        module.main = main.def;
+        for(auto &[name, slot] : main.scopes.front()) module.globals.emplace_back(symbol::name(name), slot);
+        std::sort(module.globals.begin(), module.globals.end(), [](auto &a, auto &b){ return a.second < b.second; });
+    }
+    /**
+     * @brief 型検査済みの関数定義を変換する．
+     *
+     * 引数はスロット 0 から順に置き，本体は引数だけを持つスコープで変換する．
+     */
+    void Lowerer::define(const ast::Def &def){
+        auto name = def.get_name().get_name();
+        auto index = *defs.find(name);
+        auto id = defs.get(index);
+        auto &signature = static_cast<const type::Func &>(context.get(id));
+        Function inner{
+            std::make_shared<ir::Def>(id, std::string(symbol::name(name)), def.get_params().size()),
+            0,
+            std::vector<std::unordered_map<symbol::Symbol, std::size_t>>(1),
+            {},
+            signature.get_ret(),
+        };
+        inner.current = inner.def->add_block();
+        auto params = def.get_params();
+        for(std::size_t i = 0; i < params.size(); i++){
+            inner.scopes.back().emplace(params[i].first->get_name(), inner.def->add_slot(signature.get_args()[i]));
+        }
+        auto outer = function;
+        function = &inner;
+        try {
+            def.lower_body(*this);
+        }catch(...){
+            function = outer;
+            throw;
+        }
+        function = outer;
+        inner.def->prune();
+        if(module.defs.size() < defs.size()) module.defs.resize(defs.size());
+        module.defs[index] = inner.def;
+    }
+
+    std::optional<std::size_t> Lowerer::find(symbol::Symbol name) const {
+        auto &scopes = function->scopes;
+        for(auto it = scopes.rbegin(); it != scopes.rend(); ++it){
+            auto found = it->find(name);
+            if(found != it->end()) return found->second;
+        }
+        return std::nullopt;
+    }
+    /**
+     * @brief `Sound(X)` なら `lifted` を立てて `X` を，そうでなければそのまま返す．
+     */
+    type::TypeId Lowerer::sample(type::TypeId id, bool &lifted) const {
+        if(auto sound = dynamic_cast<const type::Sound *>(&context.get(id))){
+            lifted = true;
+            return sound->get_result();
+        }
+        return id;
+    }
+    std::unique_ptr<ir::Prim> Lowerer::prim(ir::Op op, type::TypeId operand, type::TypeId result){
+        std::vector<type::TypeId> params(ir::arity(op), operand);
+        if(op == ir::Op::Delay || op == ir::Op::Advance) params = {result, type::float_id};
+        return std::make_unique<ir::Prim>(context.func(params, result), op, operand, result);
+    }
+    /**
+     * @brief 組み込みの演算を呼び出す．
+     *
+     * 引数は `operand` 型（音なら `Sound(operand)` 型）に広げる．
+     * @param lifted 音の各時刻の値に適用するか
+     */
+    std::unique_ptr<ir::Expr> Lowerer::apply(ir::Op op, type::TypeId operand, type::TypeId result, bool lifted, std::vector<std::unique_ptr<ir::Expr>> args){
+        for(auto &arg : args){
+            bool sound = false;
+            sample(arg->get_type(), sound);
+            arg = convert(std::move(arg), sound ? context.sound(operand) : operand);
+        }
+        std::shared_ptr<ir::Func> func = prim(op, operand, result);
+        if(lifted){
+            func = std::make_shared<ir::Lift>(func->get_type(), std::move(func));
+            result = context.sound(result);
+        }
+        return std::make_unique<ir::Call>(result, std::move(func), std::move(args));
+    }
+    /**
+     * @brief 数値の型の 1
+     */
+    std::unique_ptr<ir::Expr> Lowerer::one(type::TypeId id) const {
+        if(id == type::int_id) return std::make_unique<ir::Int>(1);
+        if(id == type::rational_id) return std::make_unique<ir::Rational>(1, 1);
+        return std::make_unique<ir::Float>(1.0);
+    }
+
+    Lowerer::Mark Lowerer::mark() const {
+        return {function->current, function->def->get_blocks()[function->current].first.size(), emitted};
+    }
+    /**
+     * @brief `mark` の後に文が追加されていたら，`expr` を `mark` の位置で一時変数に入れる．
+     *
+     * 後の式の副作用（代入や分岐）より前に評価した値を，その時点の値のまま使うため．
+     * @return `expr` か，一時変数の読み出し
+     */
+    std::unique_ptr<ir::Expr> Lowerer::spill(const Mark &mark, std::unique_ptr<ir::Expr> expr){
+        if(mark.emitted == emitted || dynamic_cast<const ir::Value *>(expr.get())) return expr;
+        auto type = expr->get_type();
+        auto slot = function->def->add_slot(type);
+        auto &exprs = function->def->get_blocks()[mark.block].first;
+        exprs.insert(exprs.begin() + static_cast<std::ptrdiff_t>(mark.index), std::make_unique<ir::Subst>(type, slot, std::move(expr)));
+        return std::make_unique<ir::Var>(type, slot);
+    }
+    /**
+     * @brief 値を一時変数に入れ，その読み出しを返す．
+     */
+    std::unique_ptr<ir::Expr> Lowerer::temporary(std::unique_ptr<ir::Expr> expr){
+        if(dynamic_cast<const ir::Var *>(expr.get()) || dynamic_cast<const ir::Value *>(expr.get())) return expr;
+        auto type = expr->get_type();
+        auto slot = function->def->add_slot(type);
+        emit(std::make_unique<ir::Subst>(type, slot, std::move(expr)));
+        return std::make_unique<ir::Var>(type, slot);
+    }
+    /**
+     * @brief 式を左から順に変換する．
+     *
+     * 後の式が文を追加したら，それより前の式の値は一時変数に退避する．
+     * 後ろから退避するので，同じブロックで前の位置を指す `Mark` はずれない．
+     */
+    std::vector<std::unique_ptr<ir::Expr>> Lowerer::operands(std::span<const ast::Expr *const> exprs){
+        std::vector<std::unique_ptr<ir::Expr>> values;
+        std::vector<Mark> marks;
+        for(auto expr : exprs){
+            values.push_back(expr->lower(*this));
+            marks.push_back(mark());
+        }
+        for(auto i = values.size(); i-- > 0; ) values[i] = spill(marks[i], std::move(values[i]));
+        return values;
+    }
+    /**
+     * @brief 値を `to` 型に広げる．
+     *
+     * 数値は `ir::Op::Cast` で，値や音の各時刻の値は `ir::Lift` した `ir::Op::Cast` で広げる．
+     */
+    std::unique_ptr<ir::Expr> Lowerer::convert(std::unique_ptr<ir::Expr> expr, type::TypeId to){
+        auto from = expr->get_type();
+        if(from == to) return expr;
+        bool to_sound = false, from_sound = false;
+        auto to_sample = sample(to, to_sound);
+        auto from_sample = sample(from, from_sound);
+        if(!to_sound) return std::make_unique<ir::Call>(to, prim(ir::Op::Cast, from, to), list(std::move(expr)));
+        std::shared_ptr<ir::Func> cast = prim(ir::Op::Cast, from_sample, to_sample);
+        auto lift = std::make_shared<ir::Lift>(cast->get_type(), std::move(cast));
+        return std::make_unique<ir::Call>(to, std::move(lift), list(std::move(expr)));
+    }
+
+    /**
+     * @brief 名前の値を読み出す．
+     *
+     * 変数はスロットの読み出しに，関数は `ir::DefRef` に，組み込みの名前はその値や演算になる．
+     */
+    std::unique_ptr<ir::Expr> Lowerer::load(symbol::Symbol name, const pos::Range &pos){
+        if(auto slot = find(name)) return std::make_unique<ir::Var>(function->def->get_slots()[*slot], *slot);
+        if(auto index = defs.find(name)) return std::make_unique<ir::DefRef>(defs.get(*index), *index);
+        auto kind = check::builtin(name);
+        if(!kind) throw error::make<error::UndefinedVariable>(pos.clone());
+        switch(*kind){
+            case check::Builtin::Time: return std::make_unique<ir::T>(context.sound(type::float_id));
+            case check::Builtin::Pi: return std::make_unique<ir::Float>(std::numbers::pi);
+            case check::Builtin::Sin: return prim(ir::Op::Sin, type::float_id, type::float_id);
+            case check::Builtin::Cos: return prim(ir::Op::Cos, type::float_id, type::float_id);
+            case check::Builtin::Tan: return prim(ir::Op::Tan, type::float_id, type::float_id);
+            case check::Builtin::Exp: return prim(ir::Op::Exp, type::float_id, type::float_id);
+            case check::Builtin::Log: return prim(ir::Op::Log, type::float_id, type::float_id);
+            case check::Builtin::Sqrt: return prim(ir::Op::Sqrt, type::float_id, type::float_id);
+            case check::Builtin::Floor: return prim(ir::Op::Floor, type::float_id, type::float_id);
+            case check::Builtin::Abs: return prim(ir::Op::Abs, type::float_id, type::float_id);
+        }
+        throw error::make<error::UndefinedVariable>(pos.clone());
+    }
+    /**
+     * @brief 変数に代入する．定義されていなければ今のスコープにスロットを作る．
+     * @param type 変数の型
+     */
+    std::unique_ptr<ir::Expr> Lowerer::store(symbol::Symbol name, type::TypeId type, std::unique_ptr<ir::Expr> value){
+        auto slot = find(name);
+        if(!slot){
+            slot = function->def->add_slot(type);
+            function->scopes.back().emplace(name, *slot);
+        }
+        return std::make_unique<ir::Subst>(type, *slot, convert(std::move(value), type));
+    }
+    /**
+     * @brief `++` と `--`
+     *
+     * 後置なら元の値を一時変数に入れ，その読み出しを値とする．
+     * @param inc `++` なら `true`
+     * @param post 後置なら `true`
+     */
+    std::unique_ptr<ir::Expr> Lowerer::increment(symbol::Symbol name, bool inc, bool post){
+        auto slot = *find(name);
+        auto type = function->def->get_slots()[slot];
+        auto op = inc ? ir::Op::Add : ir::Op::Sub;
+        if(!post){
+            auto value = std::make_unique<ir::Call>(type, prim(op, type, type), list(std::make_unique<ir::Var>(type, slot), one(type)));
+            return std::make_unique<ir::Subst>(type, slot, std::move(value));
+        }
+        auto old = function->def->add_slot(type);
+        emit(std::make_unique<ir::Subst>(type, old, std::make_unique<ir::Var>(type, slot)));
+        auto value = std::make_unique<ir::Call>(type, prim(op, type, type), list(std::make_unique<ir::Var>(type, old), one(type)));
+        emit(std::make_unique<ir::Subst>(type, slot, std::move(value)));
+        return std::make_unique<ir::Var>(type, old);
+    }
+    /**
+     * @brief 単項演算（`++` と `--` を除く）
+     */
+    std::unique_ptr<ir::Expr> Lowerer::unary(ast::UnaryOperator op, std::unique_ptr<ir::Expr> operand){
+        bool lifted = false;
+        auto value = sample(operand->get_type(), lifted);
+        switch(op){
+            case ast::UnaryOperator::Minus:
+                return apply(ir::Op::Neg, value, value, lifted, list(std::move(operand)));
+            case ast::UnaryOperator::Recip: {
+                auto type = std::max(value, type::rational_id);
+                return apply(ir::Op::Recip, type, type, lifted, list(std::move(operand)));
+            }
+            case ast::UnaryOperator::LogicalNot:
+                return apply(ir::Op::Not, value, value, lifted, list(std::move(operand)));
+            case ast::UnaryOperator::BitNot:
+                return apply(ir::Op::BitNot, value, value, lifted, list(std::move(operand)));
+            default:
+                return operand;
+        }
+    }
+    /**
+     * @brief 二項演算（代入と短絡評価する論理演算を除く）
+     *
+     * 数値の被演算子は `check::Checker::binary` と同じ規則で共通の型に広げる．
+     */
+    std::unique_ptr<ir::Expr> Lowerer::binary(ast::BinaryOperator op, std::unique_ptr<ir::Expr> left, std::unique_ptr<ir::Expr> right){
+        bool lifted = false;
+        auto l = sample(left->get_type(), lifted);
+        auto r = sample(right->get_type(), lifted);
+        auto common = std::max(l, r);
+        auto args = list(std::move(left), std::move(right));
+        switch(op){
+            case ast::BinaryOperator::Add:
+                if(l == type::str_id) return apply(ir::Op::Concat, l, l, false, std::move(args));
+                return apply(ir::Op::Add, common, common, lifted, std::move(args));
+            case ast::BinaryOperator::Sub: return apply(ir::Op::Sub, common, common, lifted, std::move(args));
+            case ast::BinaryOperator::Mul: return apply(ir::Op::Mul, common, common, lifted, std::move(args));
+            case ast::BinaryOperator::Rem: return apply(ir::Op::Rem, common, common, lifted, std::move(args));
+            case ast::BinaryOperator::Div: {
+                auto type = std::max(common, type::rational_id);
+                return apply(ir::Op::Div, type, type, lifted, std::move(args));
+            }
+            case ast::BinaryOperator::LeftShift: return apply(ir::Op::LeftShift, l, l, lifted, std::move(args));
+            case ast::BinaryOperator::RightShift: return apply(ir::Op::RightShift, l, l, lifted, std::move(args));
+            case ast::BinaryOperator::ForwardShift:
+            case ast::BinaryOperator::BackwardShift: {
+                // 音そのものに対する演算なので持ち上げない
+                auto sound = args[0]->get_type();
+                auto shift = op == ast::BinaryOperator::ForwardShift ? ir::Op::Delay : ir::Op::Advance;
+                args[1] = convert(std::move(args[1]), type::float_id);
+                return std::make_unique<ir::Call>(sound, prim(shift, type::float_id, sound), std::move(args));
+            }
+            case ast::BinaryOperator::Equal:
+            case ast::BinaryOperator::NotEqual: {
+                auto compare = op == ast::BinaryOperator::Equal ? ir::Op::Equal : ir::Op::NotEqual;
+                return apply(compare, common, type::bool_id, lifted, std::move(args));
+            }
+            case ast::BinaryOperator::Less: return apply(ir::Op::Less, common, type::bool_id, lifted, std::move(args));
+            case ast::BinaryOperator::LessEqual: return apply(ir::Op::LessEqual, common, type::bool_id, lifted, std::move(args));
+            case ast::BinaryOperator::Greater: return apply(ir::Op::Greater, common, type::bool_id, lifted, std::move(args));
+            case ast::BinaryOperator::GreaterEqual: return apply(ir::Op::GreaterEqual, common, type::bool_id, lifted, std::move(args));
+            case ast::BinaryOperator::LogicalAnd: return apply(ir::Op::And, l, l, lifted, std::move(args));
+            case ast::BinaryOperator::LogicalOr: return apply(ir::Op::Or, l, l, lifted, std::move(args));
+            case ast::BinaryOperator::BitAnd: return apply(ir::Op::BitAnd, l, l, lifted, std::move(args));
+            case ast::BinaryOperator::BitOr: return apply(ir::Op::BitOr, l, l, lifted, std::move(args));
+            case ast::BinaryOperator::BitXor: return apply(ir::Op::BitXor, l, l, lifted, std::move(args));
+            default:
+                // 代入は呼び出し側で扱うので来ない
+                std::unreachable();
+        }
+    }
+    /**
+     * @brief 短絡評価する `&&` と `||`
+     *
+     * 一時変数に左辺を入れ，右辺を評価する必要があるときだけ右辺のブロックに分岐する．
+     * @param conjunction `&&` なら `true`
+     * @param left 変換済みの左辺
+     */
+    std::unique_ptr<ir::Expr> Lowerer::logical(bool conjunction, std::unique_ptr<ir::Expr> left, const ast::Expr &right){
+        auto slot = function->def->add_slot(type::bool_id);
+        emit(std::make_unique<ir::Subst>(type::bool_id, slot, std::move(left)));
+        auto rhs = new_block(), join = new_block();
+        auto cond = std::make_unique<ir::Var>(type::bool_id, slot);
+        if(conjunction) branch(std::move(cond), rhs, join);
+        else branch(std::move(cond), join, rhs);
+        start(rhs);
+        emit(std::make_unique<ir::Subst>(type::bool_id, slot, right.lower(*this)));
+        jump(join);
+        start(join);
+        return std::make_unique<ir::Var>(type::bool_id, slot);
+    }
+    /**
+     * @brief 関数呼び出し
+     *
+     * 値の引数に音を渡していれば，関数を `ir::Lift` して呼び出す．
+     * @param result 呼び出しの型
+     * @throw error::IndirectCall 関数の名前以外を呼び出した．
+     */
+    std::unique_ptr<ir::Expr> Lowerer::call(const ast::Expr &func, std::span<const ast::Expr *const> args, type::TypeId result){
+        auto callee = func.lower(*this);
+        if(!dynamic_cast<const ir::Func *>(callee.get())) throw error::make<error::IndirectCall>(func.pos.clone());
+        std::shared_ptr<ir::Func> target(static_cast<ir::Func *>(callee.release()));
+        auto params = static_cast<const type::Func &>(context.get(target->get_type())).get_args();
+        auto values = operands(args);
+        bool lifted = false;
+        for(std::size_t i = 0; i < values.size(); i++){
+            bool sound = false, param_sound = false;
+            sample(values[i]->get_type(), sound);
+            sample(params[i], param_sound);
+            if(sound && !param_sound){
+                lifted = true;
+                values[i] = convert(std::move(values[i]), context.sound(params[i]));
+            }else values[i] = convert(std::move(values[i]), params[i]);
+        }
+        if(lifted) target = std::make_shared<ir::Lift>(target->get_type(), std::move(target));
+        return std::make_unique<ir::Call>(result, std::move(target), std::move(values));
+    }
+
+    /**
+     * @brief 今のブロックに式を追加する．
+     *
+     * 値を読むだけの式は効果がないので捨てる．
+     */
+    void Lowerer::emit(std::unique_ptr<ir::Expr> expr){
+        if(dynamic_cast<const ir::Var *>(expr.get()) || dynamic_cast<const ir::Value *>(expr.get())) return;
+        function->def->get_blocks()[function->current].first.push_back(std::move(expr));
+        emitted++;
+    }
+    std::size_t Lowerer::new_block(){
+        return function->def->add_block();
+    }
+    /**
+     * @brief 以降の式を `block` に追加する．
+     */
+    void Lowerer::start(std::size_t block){
+        function->current = block;
+    }
+    void Lowerer::terminate(std::unique_ptr<ir::Term> term){
+        function->def->get_blocks()[function->current].second = std::move(term);
+        emitted++;
+    }
+    void Lowerer::jump(std::size_t dest){
+        terminate(std::make_unique<ir::Jmp>(dest));
+    }
+    void Lowerer::branch(std::unique_ptr<ir::Expr> cond, std::size_t dest_true, std::size_t dest_false){
+        terminate(std::make_unique<ir::Br>(std::move(cond), dest_true, dest_false));
+    }
+    /**
+     * @brief 値を返す．後続の文は新しい（どこからも飛ばない）ブロックに追加する．
+     */
+    void Lowerer::returns(std::unique_ptr<ir::Expr> value){
+        terminate(std::make_unique<ir::Ret>(convert(std::move(value), function->result)));
+        start(new_block());
+    }
+    void Lowerer::enter_scope(){
+        function->scopes.emplace_back();
+    }
+    void Lowerer::leave_scope(){
+        function->scopes.pop_back();
+    }
+    /**
+     * @param head `continue` の飛び先
+     * @param exit `break` の飛び先
+     */
+    void Lowerer::enter_loop(std::size_t head, std::size_t exit){
+        function->loops.push_back({head, exit});
+    }
+    void Lowerer::leave_loop(){
+        function->loops.pop_back();
+    }
+    /**
+     * @brief `break`（`exit` なら）か `continue`
+     */
+    void Lowerer::jump_loop(bool exit){
+        auto loop = function->loops.back();
+        jump(exit ? loop.exit : loop.head);
+        start(new_block());
+    }
+
+    /**
+     * @brief 型検査済みのプログラムを IR に変換する．
+     * @param defs `check::check_program` で登録した関数
+     */
+    ir::Module lower_program(type::TypeContext &context, const check::Defs &defs, std::span<ast::TopLevel *const> items){
+        ir::Module module;
+        Lowerer lowerer(context, defs, module);
+        for(auto item : items) lowerer.lower(*item);
+        lowerer.finish();
+        return module;
+    }
+}
+
+namespace ast {
+    std::unique_ptr<::ir::Expr> Identifier::lower(::lower::Lowerer &lowerer) const {
+        return lowerer.load(name, pos);
+    }
+    std::unique_ptr<::ir::Expr> Number::lower(::lower::Lowerer &) const {
+        if(auto i = std::get_if<literal::Int>(&value)) return std::make_unique<::ir::Int>(i->value);
+        if(auto r = std::get_if<literal::Rational>(&value)) return std::make_unique<::ir::Rational>(r->numer, r->denom);
+        return std::make_unique<::ir::Float>(std::get<literal::Float>(value).value);
+    }
+    std::unique_ptr<::ir::Expr> String::lower(::lower::Lowerer &) const {
+        return std::make_unique<::ir::Str>(std::string(value));
+    }
+    std::unique_ptr<::ir::Expr> Call::lower(::lower::Lowerer &lowerer) const {
+        return lowerer.call(*func, args, type_id);
+    }
+    std::unique_ptr<::ir::Expr> UnaryOperation::lower(::lower::Lowerer &lowerer) const {
+        switch(op){
+            case UnaryOperator::PreInc: return lowerer.increment(static_cast<const Identifier &>(*operand).get_name(), true, false);
+            case UnaryOperator::PreDec: return lowerer.increment(static_cast<const Identifier &>(*operand).get_name(), false, false);
+            case UnaryOperator::PostInc: return lowerer.increment(static_cast<const Identifier &>(*operand).get_name(), true, true);
+            case UnaryOperator::PostDec: return lowerer.increment(static_cast<const Identifier &>(*operand).get_name(), false, true);
+            default: return lowerer.unary(op, operand->lower(lowerer));
+        }
+    }
+    std::unique_ptr<::ir::Expr> BinaryOperation::lower(::lower::Lowerer &lowerer) const {
+        // 代入先は型検査で変数だと確かめてある
+        if(op == BinaryOperator::Assign){
+            return lowerer.store(static_cast<const Identifier &>(*left).get_name(), type_id, right->lower(lowerer));
+        }
+        if(auto base = ::check::compound(op)){
+            const Expr *exprs[] = {left, right};
+            auto values = lowerer.operands(exprs);
+            auto value = lowerer.binary(*base, std::move(values[0]), std::move(values[1]));
+            return lowerer.store(static_cast<const Identifier &>(*left).get_name(), type_id, std::move(value));
+        }
+        // 左の被演算子に連なる演算は再帰せずに左の端から順に変換する
+        std::vector<const BinaryOperation *> chain{this};
+        while(auto next = dynamic_cast<const BinaryOperation *>(chain.back()->left)){
+            if(!::check::chains(next->op)) break;
+            chain.push_back(next);
+        }
+        auto value = chain.back()->left->lower(lowerer);
+        for(std::size_t i = chain.size(); i-- > 0; ){
+            auto &node = *chain[i];
+            if((node.op == BinaryOperator::LogicalAnd || node.op == BinaryOperator::LogicalOr) && node.type_id == ::type::bool_id){
+                value = lowerer.logical(node.op == BinaryOperator::LogicalAnd, std::move(value), *node.right);
+            }else{
+                // 右辺が文を追加したら，左辺はその前の値を使う（`Lowerer::operands` と同じ）
+                auto mark = lowerer.mark();
+                auto r = node.right->lower(lowerer);
+                value = lowerer.spill(mark, std::move(value));
+                value = lowerer.binary(node.op, std::move(value), std::move(r));
+            }
+            if(i > 0 && (chain.size() - i) % ::lower::max_chain == 0) value = lowerer.temporary(std::move(value));
+        }
+        return value;
+    }
+    std::unique_ptr<::ir::Expr> Index::lower(::lower::Lowerer &) const {
+        throw error::make<error::UnsupportedExpression>(pos.clone());
+    }
+    std::unique_ptr<::ir::Expr> Group::lower(::lower::Lowerer &lowerer) const {
+        return expr->lower(lowerer);
+    }
+    std::unique_ptr<::ir::Expr> List::lower(::lower::Lowerer &) const {
+        throw error::make<error::UnsupportedExpression>(pos.clone());
+    }
+    std::unique_ptr<::ir::Expr> Tuple::lower(::lower::Lowerer &) const {
+        throw error::make<error::UnsupportedExpression>(pos.clone());
+    }
+
+    void ExprStmt::lower(::lower::Lowerer &lowerer) const {
+        if(expr) lowerer.emit(expr->lower(lowerer));
+    }
+    void Break::lower(::lower::Lowerer &lowerer) const {
+        lowerer.jump_loop(true);
+    }
+    void Continue::lower(::lower::Lowerer &lowerer) const {
+        lowerer.jump_loop(false);
+    }
+    void Return::lower(::lower::Lowerer &lowerer) const {
+        lowerer.returns(expr->lower(lowerer));
+    }
+    void Block::lower(::lower::Lowerer &lowerer) const {
+        lowerer.enter_scope();
+        for(auto stmt : stmts) stmt->lower(lowerer);
+        lowerer.leave_scope();
+    }
+    void While::lower(::lower::Lowerer &lowerer) const {
+        auto head = lowerer.new_block();
+        lowerer.jump(head);
+        lowerer.start(head);
+        auto c = cond->lower(lowerer);
+        auto body = lowerer.new_block(), exit = lowerer.new_block();
+        lowerer.branch(std::move(c), body, exit);
+        lowerer.start(body);
+        lowerer.enter_loop(head, exit);
+        lowerer.enter_scope();
+        stmt->lower(lowerer);
+        lowerer.leave_scope();
+        lowerer.leave_loop();
+        lowerer.jump(head);
+        lowerer.start(exit);
+    }
+    void If::lower(::lower::Lowerer &lowerer) const {
+        auto c = cond->lower(lowerer);
+        auto block_true = lowerer.new_block();
+        auto block_false = stmt_false ? lowerer.new_block() : 0;
+        auto join = lowerer.new_block();
+        lowerer.branch(std::move(c), block_true, stmt_false ? block_false : join);
+        lowerer.start(block_true);
+        lowerer.enter_scope();
+        stmt_true->lower(lowerer);
+        lowerer.leave_scope();
+        lowerer.jump(join);
+        if(stmt_false){
+            lowerer.start(block_false);
+            lowerer.enter_scope();
+            stmt_false->lower(lowerer);
+            lowerer.leave_scope();
+            lowerer.jump(join);
+        }
+        lowerer.start(join);
+    }
+
+    void Def::lower(::lower::Lowerer &lowerer) const {
+        lowerer.define(*this);
+    }
+    void DefExpr::lower_body(::lower::Lowerer &lowerer) const {
+        lowerer.returns(expr->lower(lowerer));
+    }
+    void DefBlock::lower_body(::lower::Lowerer &lowerer) const {
+        body->lower(lowerer);
+    }
+}
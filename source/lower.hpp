@@ -0,0 +1,110 @@
+/**
+ * @file lower.hpp
+ * @brief 型検査済みの AST を IR に変換する．
+ */
+#ifndef LOWER_HPP
+#define LOWER_HPP
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hpp"
+#include "check.hpp"
+#include "ir.hpp"
+#include "symbol.hpp"
+#include "type.hpp"
+
+/**
+ * @brief 型検査済みの AST を IR に変換する．
+ *
+ * 変数は `check::Checker` と同じ規則でスコープを辿り，スロット番号に置き換える．
+ * 暗黙の型の広げ（int < rational < float，値から定数の音）は `ir::Op::Cast` の呼び出しとして明示する．
+ * 音を含む演算や呼び出しは `ir::Lift` した関数の呼び出しになる．
+ */
+namespace lower {
+    //! 左結合の二項演算の連なりをこの長さごとに一時変数に入れる（IR の式の木を深くしないため）
+    constexpr std::size_t max_chain = 256;
+
+    /**
+     * @brief IR への変換の状態
+     *
+     * 関数の本体は `ir::Def` に，トップレベルの文はまとめて `ir::Module::main` に変換する．
+     * エラーは `std::unique_ptr<error::Error>` として投げる．
+     */
+    class Lowerer {
+        /**
+         * @brief ループの `continue` と `break` の飛び先
+         */
+        struct Loop {
+            std::size_t head, exit;
+        };
+        /**
+         * @brief 変換中の関数
+         */
+        struct Function {
+            std::shared_ptr<ir::Def> def;
+            //! 式を追加するブロック
+            std::size_t current;
+            std::vector<std::unordered_map<symbol::Symbol, std::size_t>> scopes;
+            std::vector<Loop> loops;
+            //! 返り値の型
+            type::TypeId result;
+        };
+        type::TypeContext &context;
+        const check::Defs &defs;
+        ir::Module &module;
+        Function main;
+        Function *function;
+        //! これまでにブロックへ追加した式と終端の数
+        std::size_t emitted;
+        std::optional<std::size_t> find(symbol::Symbol) const;
+        type::TypeId sample(type::TypeId, bool &) const;
+        std::unique_ptr<ir::Prim> prim(ir::Op, type::TypeId, type::TypeId);
+        std::unique_ptr<ir::Expr> apply(ir::Op, type::TypeId, type::TypeId, bool, std::vector<std::unique_ptr<ir::Expr>>);
+        std::unique_ptr<ir::Expr> one(type::TypeId) const;
+        void terminate(std::unique_ptr<ir::Term>);
+    public:
+        /**
+         * @brief ブロック中の位置
+         *
+         * 後の式が文を追加したら，この位置で計算済みの値を一時変数に退避する．
+         */
+        struct Mark {
+            std::size_t block, index, emitted;
+        };
+        Lowerer(type::TypeContext &, const check::Defs &, ir::Module &);
+        void lower(const ast::TopLevel &);
+        void finish();
+        void define(const ast::Def &);
+        Mark mark() const;
+        std::unique_ptr<ir::Expr> spill(const Mark &, std::unique_ptr<ir::Expr>);
+        std::unique_ptr<ir::Expr> temporary(std::unique_ptr<ir::Expr>);
+        std::vector<std::unique_ptr<ir::Expr>> operands(std::span<const ast::Expr *const>);
+        std::unique_ptr<ir::Expr> convert(std::unique_ptr<ir::Expr>, type::TypeId);
+        std::unique_ptr<ir::Expr> load(symbol::Symbol, const pos::Range &);
+        std::unique_ptr<ir::Expr> store(symbol::Symbol, type::TypeId, std::unique_ptr<ir::Expr>);
+        std::unique_ptr<ir::Expr> increment(symbol::Symbol, bool, bool);
+        std::unique_ptr<ir::Expr> unary(ast::UnaryOperator, std::unique_ptr<ir::Expr>);
+        std::unique_ptr<ir::Expr> binary(ast::BinaryOperator, std::unique_ptr<ir::Expr>, std::unique_ptr<ir::Expr>);
+        std::unique_ptr<ir::Expr> logical(bool, std::unique_ptr<ir::Expr>, const ast::Expr &);
+        std::unique_ptr<ir::Expr> call(const ast::Expr &, std::span<const ast::Expr *const>, type::TypeId);
+        void emit(std::unique_ptr<ir::Expr>);
+        std::size_t new_block();
+        void start(std::size_t);
+        void jump(std::size_t);
+        void branch(std::unique_ptr<ir::Expr>, std::size_t, std::size_t);
+        void returns(std::unique_ptr<ir::Expr>);
+        void enter_scope();
+        void leave_scope();
+        void enter_loop(std::size_t, std::size_t);
+        void leave_loop();
+        void jump_loop(bool);
+    };
+
+    ir::Module lower_program(type::TypeContext &, const check::Defs &, std::span<ast::TopLevel *const>);
+}
+
+#endif
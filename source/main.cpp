@@ -6,27 +6,196 @@
  * @mainpage Cryss (C++)
  */
 #include "type.hpp"
+#include "check.hpp"
+#include "input.hpp"
 #include "lexer.hpp"
 #include "error.hpp"
 #include "parser.hpp"
+#include "cache.hpp"
+#include "lower.hpp"
+#include "pool.hpp"
+#include "vm.hpp"
+#include "jit.hpp"
 
 #include <iostream>
-#include <fstream>
+#include <cstdlib>
+#include <future>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #include <getopt.h>
 
 struct Config {
-    std::istream &source;
-    bool prompt;
+    unsigned lex_threads;
+    unsigned jobs;
+    //! AST のキャッシュを置くディレクトリ（`nullptr` ならキャッシュしない）
+    const char *cache_dir;
+    //! 型検査の後に IR に変換して出力するか
+    bool dump_ir;
+    //! 音を事前にコンパイルして書き出すファイル（`nullptr` なら書き出さない）
+    const char *emit_path;
+    jit::Output emit_output;
 };
 
-static void run(const Config &config){
-    lexer::Lexer lexer(config.source, config.prompt);
+/**
+ * @brief 1 つのファイルを解析した結果
+ *
+ * ワーカーで作り，メインスレッドが入力の順に出力する．
+ */
+struct Unit {
+    std::unique_ptr<input::MappedFile> source;
+    ast::Arena arena;
+    std::vector<ast::TopLevel *> items;
+    std::unique_ptr<error::Error> error;
+    //! 関数定義を並列に検査できるよう，並行に使える `TypeContext` にする
+    type::TypeContext types{true};
+    check::Defs defs;
+    std::optional<ir::Module> module;
+};
+
+/**
+ * @brief 解析できた要素を型検査し，エラーを記録する．
+ * @param threads 関数定義の検査に用いるスレッド数
+ */
+static void check_unit(Unit &unit, unsigned threads){
+    try {
+        check::check_program(unit.types, unit.defs, unit.items, threads);
+    }catch(std::unique_ptr<error::Error> &error){
+        unit.error = std::move(error);
+    }
+}
+
+/**
+ * @brief 型検査できた要素を IR に変換し，エラーを記録する．
+ */
+static void lower_unit(Unit &unit){
+    if(unit.error) return;
+    try {
+        unit.module = lower::lower_program(unit.types, unit.defs, unit.items);
+    }catch(std::unique_ptr<error::Error> &error){
+        unit.error = std::move(error);
+    }
+}
+
+/**
+ * @brief ファイルを解析し，型検査する．
+ *
+ * `cache` があれば，同じ内容のファイルの解析結果がキャッシュにある場合は字句解析も構文解析もしない．
+ * @param lower 型検査の後に IR に変換するか
+ */
+static std::unique_ptr<Unit> parse_file(const char *path, unsigned lex_threads, unsigned check_threads, const cache::Cache *cache, bool lower){
+    auto unit = std::make_unique<Unit>();
+    unit->source = std::make_unique<input::MappedFile>(path);
+    if(!*unit->source) return unit;
+    if(cache && cache->load(unit->source->contents(), unit->arena, unit->items)){
+        check_unit(*unit, check_threads);
+        if(lower) lower_unit(*unit);
+        return unit;
+    }
+    lexer::Lexer lexer(*unit->source, lex_threads);
+    parser::Parser parser(lexer, unit->arena);
+    try {
+        while(auto item = parser.parse_top_level()) unit->items.push_back(item);
+    }catch(std::unique_ptr<error::Error> &error){
+        unit->error = std::move(error);
+    }
+    if(unit->error) return unit;
+    if(cache) cache->store(unit->source->contents(), unit->items);
+    check_unit(*unit, check_threads);
+    if(lower) lower_unit(*unit);
+    return unit;
+}
+
+/**
+ * @brief 解析結果とエラーを出力する．
+ * @return ファイルを開けたか
+ */
+static bool print(const Unit &unit, const char *path){
+    if(!*unit.source){
+        std::cerr << "cannot open file `" << path << "`" << std::endl;
+        return false;
+    }
+    // 位置を行と列で出力する
+    pos::Attach out(std::cout, *unit.source), err(std::cerr, *unit.source);
+    for(auto item : unit.items) item->debug_print(0);
+    if(unit.module) unit.module->debug_print(unit.types);
+    if(unit.error) unit.error->eprint(*unit.source);
+    return true;
+}
+
+/**
+ * @brief トップレベルの文を実行し，トップレベルの変数に入った音を事前にコンパイルして書き出す．
+ * @return 書き出せたか
+ */
+static bool emit(Unit &unit, const char *path, const Config &config){
+    if(!*unit.source){
+        std::cerr << "cannot open file `" << path << "`" << std::endl;
+        return false;
+    }
+    pos::Attach err(std::cerr, *unit.source);
+    if(unit.error){
+        unit.error->eprint(*unit.source);
+        return false;
+    }
+    try {
+        auto &module = *unit.module;
+        vm::Machine machine(unit.types, module);
+        if(!machine.compiled(machine.main_index())){
+            std::cerr << "top-level statements use values that cannot be evaluated" << std::endl;
+            return false;
+        }
+        machine.call(machine.main_index(), {});
+        auto regs = machine.registers(machine.main_index());
+        std::vector<std::pair<std::string, const ir::Sound *>> sounds;
+        for(auto &[name, slot] : module.globals){
+            if(dynamic_cast<const type::Sound *>(&unit.types.get(module.main->get_slots()[slot]))) sounds.emplace_back(name, machine.sound(regs[slot]).get());
+        }
+        jit::emit(unit.types, module, sounds, config.emit_path, config.emit_output);
+    }catch(std::unique_ptr<error::Error> &error){
+        error->eprint(*unit.source);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 複数のファイルをスレッドプールで並列に解析する．
+ *
+ * 1 ファイルを 1 タスクとし，各タスクはそれぞれの `lexer::Lexer` を持つ．
+ * 出力は入力の順に，終わったものから行う．
+ */
+static int run_files(const std::vector<const char *> &paths, const Config &config, const cache::Cache *cache){
+    pool::Pool pool(config.jobs);
+    std::vector<std::future<std::unique_ptr<Unit>>> units;
+    for(auto path : paths){
+        units.push_back(pool.async([path, cache, &config]{ return parse_file(path, 1, 1, cache, config.dump_ir); }));
+    }
+    int status = 0;
+    for(std::size_t i = 0; i < paths.size(); i++){
+        auto unit = units[i].get();
+        std::cout << paths[i] << ":" << std::endl;
+        if(!print(*unit, paths[i])) status = 1;
+    }
+    return status;
+}
+
+static void run(input::Input &source, const Config &config){
+    lexer::Lexer lexer(source, config.lex_threads);
+    ast::Arena arena;
+    parser::Parser parser(lexer, arena);
+    type::TypeContext types;
+    check::Defs defs;
+    check::Checker checker(types, defs);
+    pos::Attach out(std::cout, source), err(std::cerr, source);
     try {
         while(true){
-            auto item = parse_top_level(lexer);
+            auto item = parser.parse_top_level();
             if(!item) break;
+            checker.check(*item);
             item->debug_print(0);
+            arena.clear();
+            lexer.release();
             lexer.reset_prompt();
         }
     }catch(std::unique_ptr<error::Error> &error){
@@ -35,17 +204,71 @@ static void run(const Config &config){
 }
 
 int main(int argc, char *argv[]) {
-    if(argc == 1){
-        run(Config{
-            .source = std::cin,
-            .prompt = true,
-        });
+    Config config{
+        .lex_threads = 1,
+        .jobs = std::max(1u, std::thread::hardware_concurrency()),
+        .cache_dir = std::getenv("CRYSS_CACHE_DIR"),
+        .dump_ir = false,
+        .emit_path = nullptr,
+        .emit_output = jit::Output::Object,
+    };
+    static const option long_options[] = {
+        {"lex-threads", required_argument, nullptr, 'l'},
+        {"jobs", required_argument, nullptr, 'j'},
+        {"cache-dir", required_argument, nullptr, 'c'},
+        {"dump-ir", no_argument, nullptr, 'i'},
+        {"emit-obj", required_argument, nullptr, 'o'},
+        {"emit-shared", required_argument, nullptr, 's'},
+        {nullptr, 0, nullptr, 0},
+    };
+    for(int opt; (opt = getopt_long(argc, argv, "l:j:c:", long_options, nullptr)) != -1; ){
+        switch(opt){
+            case 'l':
+                // 0 ならハードウェアのスレッド数
+                config.lex_threads = static_cast<unsigned>(std::strtoul(optarg, nullptr, 10));
+                if(config.lex_threads == 0) config.lex_threads = std::max(1u, std::thread::hardware_concurrency());
+                break;
+            case 'j':
+                // 0 ならハードウェアのスレッド数
+                config.jobs = static_cast<unsigned>(std::strtoul(optarg, nullptr, 10));
+                if(config.jobs == 0) config.jobs = std::max(1u, std::thread::hardware_concurrency());
+                break;
+            case 'c':
+                config.cache_dir = optarg;
+                break;
+            case 'i':
+                config.dump_ir = true;
+                break;
+            case 'o':
+            case 's':
+                config.emit_path = optarg;
+                config.emit_output = opt == 'o' ? jit::Output::Object : jit::Output::Shared;
+                break;
+            default:
+                std::cerr << "usage: " << argv[0] << " [--lex-threads=N] [--jobs=N] [--cache-dir=DIR] [--dump-ir] [--emit-obj=FILE | --emit-shared=FILE] [file...]" << std::endl;
+                return 1;
+        }
+    }
+    std::optional<cache::Cache> cache;
+    if(config.cache_dir && *config.cache_dir) cache.emplace(config.cache_dir);
+    if(optind == argc){
+        input::Stream source(std::cin, true);
+        // プロンプトでは 1 行ずつ解析する
+        run(source, Config{ .lex_threads = 1, .jobs = 1, .cache_dir = nullptr, .dump_ir = false, .emit_path = nullptr, .emit_output = jit::Output::Object });
+    }else if(config.emit_path){
+        // 書き出すのは 1 つのファイルの音だけ
+        if(optind + 1 != argc){
+            std::cerr << "--emit-obj and --emit-shared take exactly one file" << std::endl;
+            return 1;
+        }
+        auto unit = parse_file(argv[optind], config.lex_threads, config.jobs, cache ? &*cache : nullptr, true);
+        if(!emit(*unit, argv[optind], config)) return 1;
+    }else if(optind + 1 == argc){
+        auto unit = parse_file(argv[optind], config.lex_threads, config.jobs, cache ? &*cache : nullptr, config.dump_ir);
+        if(!print(*unit, argv[optind])) return 1;
     }else{
-        std::ifstream source(argv[1]);
-        run(Config{
-            .source = source,
-            .prompt = false,
-        });
+        // 各ファイルは 1 スレッドで字句解析・型検査し，ファイル単位で並列にする
+        return run_files(std::vector<const char *>(argv + optind, argv + argc), config, cache ? &*cache : nullptr);
     }
     return 0;
 }
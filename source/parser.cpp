@@ -6,80 +6,6 @@
 #include "error.hpp"
 #include <utility>
 
-static std::unique_ptr<ast::Expr> 
-    parse_factor(lexer::Lexer &),
-    parse_binary_operator(lexer::Lexer &, int current_precedence),
-    parse_expr(lexer::Lexer &);
-static std::tuple<std::vector<std::unique_ptr<ast::Expr>>, bool, pos::Range>
-    parse_list(lexer::Lexer &, token::BracketType, pos::Range &);
-static std::unique_ptr<ast::Stmt>
-    parse_stmt(lexer::Lexer &);
-
-std::unique_ptr<ast::Expr> parse_factor(lexer::Lexer &lexer){
-    std::unique_ptr<ast::Expr> ret;
-    {
-        auto &token_ref = lexer.peek();
-        if(!token_ref) return nullptr;
-        pos::Range pos;
-        if(auto factor = token_ref->factor()){
-            ret = std::move(factor);
-            pos = std::move(lexer.next()->pos);
-        }else if(auto prefix = token_ref->prefix()){
-            pos = std::move(lexer.next()->pos);
-            auto operand = parse_factor(lexer);
-            if(!operand){
-                if(auto token = lexer.next()) throw error::make<error::UnexpectedTokenAfterPrefix>(std::move(pos), std::move(token->pos));
-                else error::make<error::EOFAfterPrefix>(std::move(pos));
-            }
-            pos += operand->pos;
-            ret = std::make_unique<ast::UnaryOperation>(prefix.value(), std::move(operand));
-        }else if(auto bracket_type = token_ref->opening_bracket_type()){
-            pos = std::move(lexer.next()->pos);
-            auto [elems, trailing_comma, close_pos] = parse_list(lexer, bracket_type.value(), pos);
-            pos += close_pos;
-            if(bracket_type == token::BracketType::Round){
-                if(elems.size() == 1 && !trailing_comma){
-                    ret = std::make_unique<ast::Group>(std::move(elems.front()));
-                }else{
-                    ret = std::make_unique<ast::Tuple>(std::move(elems));
-                }
-            }else{
-                ret = std::make_unique<ast::List>(std::move(elems));
-            }
-        }else{
-            return nullptr;
-        }
-        ret->pos = std::move(pos);
-    }
-    while(true){
-        auto &token_ref = lexer.peek();
-        pos::Range pos;
-        if(!token_ref) return ret;
-        if(auto suffix = token_ref->suffix()){
-            pos = ret->pos + lexer.next()->pos;
-            ret = std::make_unique<ast::UnaryOperation>(suffix.value(), std::move(ret));
-        }else if(auto bracket_type = token_ref->opening_bracket_type()){
-            auto pos_open = std::move(lexer.next()->pos);
-            auto [elems, trailing_comma, pos_close] = parse_list(lexer, bracket_type.value(), pos_open);
-            pos = ret->pos + pos_close;
-            if(bracket_type == token::BracketType::Round){
-                ret = std::make_unique<ast::Call>(std::move(ret), std::move(elems));
-            }else{
-                if(elems.size() == 0){
-                    throw error::make<error::EmptyIndex>(std::move(pos_open), std::move(pos_close));
-                }else if(elems.size() == 1){
-                    ret = std::make_unique<ast::Index>(std::move(ret), std::move(elems.front()));
-                }else{
-                    throw error::make<error::MultipleIndices>(std::move(pos_open), std::move(pos_close));
-                }
-            }
-        }else{
-            return ret;
-        }
-        ret->pos = std::move(pos);
-    }
-}
-
 enum Precedence {
     AssignPrecedence,
     LogicalOrPrecedence,
@@ -150,152 +76,457 @@ static Associativity associativity(int precedence){
     if(precedence == AssignPrecedence) return Associativity::RightToLeft;
     else return Associativity::LeftToRight;
 }
-std::unique_ptr<ast::Expr> parse_binary_operator(lexer::Lexer &lexer, int current_precedence){
-    if(current_precedence == MaxPrecedence){
-        return parse_factor(lexer);
-    }
-    auto left = parse_binary_operator(lexer, current_precedence + 1);
-    if(!left) return nullptr;
-    bool left_to_right = associativity(current_precedence) == Associativity::LeftToRight;
-    while(true){
-        auto &op_token = lexer.peek();
-        if(!op_token) return left;
-        auto op = op_token->infix();
-        if(op && precedence(op.value()) == current_precedence){
-            auto &op_pos = lexer.next()->pos;
-            auto right = parse_binary_operator(lexer, current_precedence + left_to_right);
-            if(!right){
-                if(auto token = lexer.next()) throw error::make<error::UnexpectedTokenAfterInfix>(std::move(op_pos), std::move(token->pos));
-                else throw error::make<error::EOFAfterInfix>(std::move(op_pos));
+
+template <class EOFError, class UnexpectedTokenError>
+token::Token read_token(lexer::Lexer &lexer, token::Kind kind, pos::Range &arg){
+    auto token = lexer.next();
+    if(!token) throw error::make<EOFError>(std::move(arg));
+    if(token.kind != kind) throw error::make<UnexpectedTokenError>(std::move(arg), token.pos());
+    return token;
+}
+
+namespace parser {
+    Parser::Parser(lexer::Lexer &lexer, ast::Arena &arena):
+        lexer(lexer),
+        arena(arena) {}
+
+    /**
+     * @brief 式を読む．
+     *
+     * 次の 3 つの状態を行き来する．
+     * - `Operand`：因子の始まり．前置演算子と開き括弧はフレームに積んで次のトークンへ進む．
+     * - `Suffix`：因子の後の後置演算子・呼び出し・添字を読み，終わったら保留中の前置演算子を適用する．
+     * - `Operator`：二項演算子を読む．優先順位が高い（左結合なら等しいものも含む）保留中の二項演算子を先にまとめる．
+     * 式が終わったとき，括弧の中なら要素として積み，そうでなければ返す．
+     * @return 式がなければ（最初のトークンが因子の始まりでなければ）`nullptr`
+     */
+    ast::Expr *Parser::parse_expr(){
+        enum class State {
+            Operand,
+            Suffix,
+            Operator,
+        } state = State::Operand;
+        const std::size_t base = expr_frames.size();
+        ast::Expr *expr = nullptr;
+        auto reduce = [&]{
+            auto &frame = expr_frames.back();
+            pos::Range pos = frame.operand->pos + expr->pos;
+            expr = arena.make<ast::BinaryOperation>(frame.infix, frame.operand, expr);
+            expr->pos = std::move(pos);
+            expr_frames.pop_back();
+        };
+        while(true){
+            auto &token = lexer.peek();
+            auto &traits = token::traits(token.kind);
+            if(state == State::Operand){
+                if(auto factor = lexer.factor(token, arena)){
+                    expr = factor;
+                    expr->pos = lexer.next().pos();
+                    state = State::Suffix;
+                }else if(auto prefix = traits.prefix){
+                    expr_frames.push_back(ExprFrame{
+                        .kind = ExprFrame::Kind::Prefix,
+                        .prefix = prefix.value(),
+                        .pos = lexer.next().pos(),
+                    });
+                }else if(auto bracket_type = traits.opening_bracket_type){
+                    expr_frames.push_back(ExprFrame{
+                        .kind = ExprFrame::Kind::Bracket,
+                        .bracket_type = bracket_type.value(),
+                        .pos = lexer.next().pos(),
+                        .items_base = items.size(),
+                    });
+                }else{
+                    // 因子がない
+                    if(expr_frames.size() == base) return nullptr;
+                    auto &frame = expr_frames.back();
+                    if(frame.kind == ExprFrame::Kind::Prefix){
+                        if(auto next = lexer.next()) throw error::make<error::UnexpectedTokenAfterPrefix>(std::move(frame.pos), next.pos());
+                        else throw error::make<error::EOFAfterPrefix>(std::move(frame.pos));
+                    }else if(frame.kind == ExprFrame::Kind::Infix){
+                        if(auto next = lexer.next()) throw error::make<error::UnexpectedTokenAfterInfix>(std::move(frame.pos), next.pos());
+                        else throw error::make<error::EOFAfterInfix>(std::move(frame.pos));
+                    }else if(token.kind == token::Kind::Comma){
+                        throw error::make<error::EmptyItemInList>(lexer.next().pos());
+                    }else{
+                        // 空の括弧か，末尾のカンマの後
+                        expr = close_bracket(true);
+                        state = State::Suffix;
+                    }
+                }
+            }else if(state == State::Suffix){
+                if(auto suffix = traits.suffix){
+                    pos::Range pos = expr->pos + lexer.next().pos();
+                    expr = arena.make<ast::UnaryOperation>(suffix.value(), expr);
+                    expr->pos = std::move(pos);
+                }else if(auto bracket_type = traits.opening_bracket_type){
+                    expr_frames.push_back(ExprFrame{
+                        .kind = ExprFrame::Kind::Suffix,
+                        .bracket_type = bracket_type.value(),
+                        .operand = expr,
+                        .pos = lexer.next().pos(),
+                        .items_base = items.size(),
+                    });
+                    state = State::Operand;
+                }else{
+                    while(expr_frames.size() > base && expr_frames.back().kind == ExprFrame::Kind::Prefix){
+                        auto &frame = expr_frames.back();
+                        pos::Range pos = frame.pos + expr->pos;
+                        expr = arena.make<ast::UnaryOperation>(frame.prefix, expr);
+                        expr->pos = std::move(pos);
+                        expr_frames.pop_back();
+                    }
+                    state = State::Operator;
+                }
+            }else{
+                auto op = traits.infix;
+                int current_precedence = op ? precedence(op.value()) : -1;
+                while(expr_frames.size() > base && expr_frames.back().kind == ExprFrame::Kind::Infix){
+                    int left_precedence = expr_frames.back().precedence;
+                    if(
+                        left_precedence < current_precedence
+                        || (left_precedence == current_precedence && associativity(left_precedence) == Associativity::RightToLeft)
+                    ) break;
+                    reduce();
+                }
+                if(op){
+                    expr_frames.push_back(ExprFrame{
+                        .kind = ExprFrame::Kind::Infix,
+                        .infix = op.value(),
+                        .precedence = current_precedence,
+                        .operand = expr,
+                        .pos = lexer.next().pos(),
+                    });
+                    state = State::Operand;
+                }else if(expr_frames.size() == base){
+                    return expr;
+                }else{
+                    // 括弧の中の要素が終わった
+                    items.push_back(expr);
+                    if(token.kind == token::Kind::Comma){
+                        lexer.next();
+                        state = State::Operand;
+                    }else{
+                        expr = close_bracket(false);
+                        state = State::Suffix;
+                    }
+                }
             }
-            pos::Range pos = left->pos + right->pos;
-            left = std::make_unique<ast::BinaryOperation>(op.value(), std::move(left), std::move(right));
-            left->pos = std::move(pos);
-            if(left_to_right) continue;
         }
-        return left;
     }
-}
 
-std::tuple<std::vector<std::unique_ptr<ast::Expr>>, bool, pos::Range> parse_list(lexer::Lexer &lexer, token::BracketType opening_bracket_type, pos::Range &pos_open){
-    std::vector<std::unique_ptr<ast::Expr>> ret;
-    bool trailing_comma = true;
-    while(true){
-        auto expr = parse_expr(lexer);
-        // ここで expr は nullptr の可能性がある
-        auto &token = lexer.peek();
-        if(token && token->is_comma()){
-            auto pos_comma = std::move(lexer.next()->pos);
-            if(!expr) throw error::make<error::EmptyItemInList>(std::move(pos_comma));
-            ret.push_back(std::move(expr));
+    /**
+     * @brief 閉じ括弧を読み，スタックの一番上の括弧を式にする．
+     * @param trailing_comma 最後の要素の後にカンマがあったか（要素がない場合も含む）
+     */
+    ast::Expr *Parser::close_bracket(bool trailing_comma){
+        auto &frame = expr_frames.back();
+        auto close = lexer.next();
+        if(!close) throw error::make<error::NoClosingBracket>(std::move(frame.pos));
+        auto closing_bracket_type = token::traits(close.kind).closing_bracket_type;
+        if(!closing_bracket_type) throw error::make<error::UnexpectedTokenInBracket>(std::move(frame.pos), close.pos());
+        if(frame.bracket_type != closing_bracket_type) throw error::make<error::DifferentClosingBracket>(std::move(frame.pos), close.pos());
+        auto elems = arena.copy(items.begin() + static_cast<std::ptrdiff_t>(frame.items_base), items.end());
+        items.resize(frame.items_base);
+        ast::Expr *ret;
+        pos::Range pos;
+        if(frame.kind == ExprFrame::Kind::Bracket){
+            pos = frame.pos + close.pos();
+            if(frame.bracket_type == token::BracketType::Round){
+                if(elems.size() == 1 && !trailing_comma){
+                    ret = arena.make<ast::Group>(elems.front());
+                }else{
+                    ret = arena.make<ast::Tuple>(elems);
+                }
+            }else{
+                ret = arena.make<ast::List>(elems);
+            }
         }else{
-            if(expr){
-                ret.push_back(std::move(expr));
-                trailing_comma = false;
+            pos = frame.operand->pos + close.pos();
+            if(frame.bracket_type == token::BracketType::Round){
+                ret = arena.make<ast::Call>(frame.operand, elems);
+            }else{
+                if(elems.size() == 0){
+                    throw error::make<error::EmptyIndex>(std::move(frame.pos), close.pos());
+                }else if(elems.size() == 1){
+                    ret = arena.make<ast::Index>(frame.operand, elems.front());
+                }else{
+                    throw error::make<error::MultipleIndices>(std::move(frame.pos), close.pos());
+                }
             }
-            break;
         }
+        ret->pos = std::move(pos);
+        expr_frames.pop_back();
+        return ret;
     }
-    auto close = lexer.next();
-    if(!close) throw error::make<error::NoClosingBracket>(std::move(pos_open));
-    auto closing_bracket_type = close->closing_bracket_type();
-    if(!closing_bracket_type) throw error::make<error::UnexpectedTokenInBracket>(std::move(pos_open), std::move(close->pos));
-    if(opening_bracket_type != closing_bracket_type) throw error::make<error::DifferentClosingBracket>(std::move(pos_open), std::move(close->pos));
-    return {std::move(ret), trailing_comma, std::move(close->pos)};
-}
 
-std::unique_ptr<ast::Expr> parse_expr(lexer::Lexer &lexer){
-    return parse_binary_operator(lexer, 0);
-}
-
-template <class EOFError, class UnexpectedTokenError>
-std::unique_ptr<token::Token> read_token(lexer::Lexer &lexer, bool (token::Token::*cond)() const, pos::Range &arg){
-    auto token = lexer.next();
-    if(!token) throw error::make<EOFError>(std::move(arg));
-    if(!((*token).*cond)()) throw error::make<UnexpectedTokenError>(std::move(arg), std::move(token->pos));
-    return token;
-}
+    /**
+     * @brief 文を読む．
+     *
+     * `begin_stmt` が構文の途中でフレームを積んだら次の文へ進み，
+     * 文が完成したらフレームを上から順に閉じる．
+     * @return 文がなければ（EOF か，閉じ括弧などの文の始まりでないトークンなら）`nullptr`
+     */
+    ast::Stmt *Parser::parse_stmt(){
+        const std::size_t base = stmt_frames.size();
+        while(true){
+            ast::Stmt *stmt;
+            if(!begin_stmt(stmt)) continue;
+            while(true){
+                if(stmt_frames.size() == base) return stmt;
+                auto &frame = stmt_frames.back();
+                if(frame.kind == StmtFrame::Kind::Block){
+                    if(stmt){
+                        stmts.push_back(stmt);
+                        break;
+                    }
+                    auto pos_close = read_token<error::NoClosingBracket, error::UnexpectedTokenInBracket>(lexer, token::Kind::ClosingBrace, frame.pos).pos();
+                    stmt = arena.make<ast::Block>(arena.copy(stmts.begin() + static_cast<std::ptrdiff_t>(frame.stmts_base), stmts.end()));
+                    stmt->pos = frame.pos + pos_close;
+                    stmts.resize(frame.stmts_base);
+                }else{
+                    if(!stmt) TODO;
+                    if(frame.kind == StmtFrame::Kind::Then){
+                        if(lexer.keyword(lexer.peek()) == token::Keyword::Else){
+                            lexer.next();
+                            frame.kind = StmtFrame::Kind::Else;
+                            frame.stmt_true = stmt;
+                            break;
+                        }
+                        pos::Range pos = frame.pos + stmt->pos;
+                        stmt = arena.make<ast::If>(frame.cond, stmt, nullptr);
+                        stmt->pos = std::move(pos);
+                    }else if(frame.kind == StmtFrame::Kind::Else){
+                        pos::Range pos = frame.pos + frame.stmt_true->pos + stmt->pos;
+                        stmt = arena.make<ast::If>(frame.cond, frame.stmt_true, stmt);
+                        stmt->pos = std::move(pos);
+                    }else{
+                        pos::Range pos = frame.pos + stmt->pos;
+                        stmt = arena.make<ast::While>(frame.cond, stmt);
+                        stmt->pos = std::move(pos);
+                    }
+                }
+                stmt_frames.pop_back();
+            }
+        }
+    }
 
-std::unique_ptr<ast::Stmt> parse_stmt(lexer::Lexer &lexer){
-    auto &token_ref = lexer.peek();
-    if(!token_ref) return nullptr;
-    if(token_ref->is_opening_brace()){
-        auto pos_open = std::move(lexer.next()->pos);
-        std::vector<std::unique_ptr<ast::Stmt>> stmts;
-        while(auto stmt = parse_stmt(lexer)) stmts.push_back(std::move(stmt));
-        auto pos_close = std::move(read_token<error::NoClosingBracket, error::UnexpectedTokenInBracket>(lexer, &token::Token::is_closing_brace, pos_open)->pos);
-        auto ret = std::make_unique<ast::Block>(std::move(stmts));
-        ret->pos = pos_open + pos_close;
-        return ret;
-    }else if(auto keyword = token_ref->keyword()){
-        if(keyword.value() == token::Keyword::If){
-            auto pos_if = std::move(lexer.next()->pos);
-            auto cond_open = read_token<error::EOFAfterIf, error::UnexpectedTokenAfterIf>(lexer, &token::Token::is_opening_parenthesis, pos_if);
-            auto cond = parse_expr(lexer);
-            if(!cond) TODO;
-            auto cond_close = read_token<error::NoClosingBracket, error::UnexpectedTokenInBracket>(lexer, &token::Token::is_closing_parenthesis, cond_open->pos);
-            auto stmt_true = parse_stmt(lexer);
-            if(!stmt_true) TODO;
-            auto pos = pos_if + stmt_true->pos;
-            std::unique_ptr<ast::Stmt> stmt_false;
-            auto &maybe_else = lexer.peek();
-            if(maybe_else && maybe_else->keyword() == token::Keyword::Else){
-                auto pos_else = std::move(lexer.next()->pos);
-                stmt_false = parse_stmt(lexer);
-                if(!stmt_false) TODO;
-                pos += stmt_false->pos;
+    /**
+     * @brief 文の始まりを読む．
+     *
+     * ブロック・`if`・`while` は中の文を待つフレームを積んで `false` を返す．
+     * それ以外は文を最後まで読んで `stmt` に入れ，`true` を返す．
+     */
+    bool Parser::begin_stmt(ast::Stmt *&stmt){
+        auto &token_ref = lexer.peek();
+        if(!token_ref){
+            stmt = nullptr;
+            return true;
+        }
+        if(token_ref.kind == token::Kind::OpeningBrace){
+            stmt_frames.push_back(StmtFrame{
+                .kind = StmtFrame::Kind::Block,
+                .pos = lexer.next().pos(),
+                .stmts_base = stmts.size(),
+            });
+            return false;
+        }else if(auto keyword = lexer.keyword(token_ref)){
+            if(keyword.value() == token::Keyword::If){
+                auto pos_if = lexer.next().pos();
+                auto cond_open_pos = read_token<error::EOFAfterIf, error::UnexpectedTokenAfterIf>(lexer, token::Kind::OpeningParenthesis, pos_if).pos();
+                auto cond = parse_expr();
+                if(!cond) TODO;
+                read_token<error::NoClosingBracket, error::UnexpectedTokenInBracket>(lexer, token::Kind::ClosingParenthesis, cond_open_pos);
+                stmt_frames.push_back(StmtFrame{
+                    .kind = StmtFrame::Kind::Then,
+                    .pos = std::move(pos_if),
+                    .cond = cond,
+                });
+                return false;
+            }else if(keyword.value() == token::Keyword::While){
+                auto pos_while = lexer.next().pos();
+                auto cond_open_pos = read_token<error::EOFAfterWhile, error::UnexpectedTokenAfterWhile>(lexer, token::Kind::OpeningParenthesis, pos_while).pos();
+                auto cond = parse_expr();
+                if(!cond) TODO;
+                read_token<error::NoClosingBracket, error::UnexpectedTokenInBracket>(lexer, token::Kind::ClosingParenthesis, cond_open_pos);
+                stmt_frames.push_back(StmtFrame{
+                    .kind = StmtFrame::Kind::While,
+                    .pos = std::move(pos_while),
+                    .cond = cond,
+                });
+                return false;
+            }else if(keyword.value() == token::Keyword::Break){
+                auto pos_break = lexer.next().pos();
+                auto semicolon = read_token<error::EOFAfterBreak, error::UnexpectedTokenAfterBreak>(lexer, token::Kind::Semicolon, pos_break);
+                stmt = arena.make<ast::Break>();
+                stmt->pos = pos_break + semicolon.pos();
+                return true;
+            }else if(keyword.value() == token::Keyword::Return){
+                auto pos_return = lexer.next().pos();
+                auto expr = parse_expr();
+                if(!expr){
+                    if(auto token = lexer.next()) throw error::make<error::UnexpectedTokenAfterReturn>(std::move(pos_return), token.pos());
+                    else throw error::make<error::EOFAfterReturn>(std::move(pos_return));
+                }
+                auto semicolon = read_token<error::EOFAfterExpr, error::UnexpectedTokenAfterExpr>(lexer, token::Kind::Semicolon, expr->pos);
+                stmt = arena.make<ast::Return>(expr);
+                stmt->pos = pos_return + semicolon.pos();
+                return true;
+            }else if(keyword.value() == token::Keyword::Continue){
+                auto pos_continue = lexer.next().pos();
+                auto semicolon = read_token<error::EOFAfterContinue, error::UnexpectedTokenAfterContinue>(lexer, token::Kind::Semicolon, pos_continue);
+                stmt = arena.make<ast::Continue>();
+                stmt->pos = pos_continue + semicolon.pos();
+                return true;
+            }else{
+                TODO;
             }
-            auto ret = std::make_unique<ast::If>(std::move(cond), std::move(stmt_true), std::move(stmt_false));
-            ret->pos = std::move(pos);
-            return ret;
-        }else if(keyword.value() == token::Keyword::While){
-            auto pos_while = std::move(lexer.next()->pos);
-            auto cond_open = read_token<error::EOFAfterWhile, error::UnexpectedTokenAfterWhile>(lexer, &token::Token::is_opening_parenthesis, pos_while);
-            auto cond = parse_expr(lexer);
-            if(!cond) TODO;
-            auto cond_close = read_token<error::NoClosingBracket, error::UnexpectedTokenInBracket>(lexer, &token::Token::is_closing_parenthesis, cond_open->pos);
-            auto stmt = parse_stmt(lexer);
-            if(!stmt) TODO;
-            auto pos = pos_while + stmt->pos;
-            auto ret = std::make_unique<ast::While>(std::move(cond), std::move(stmt));
-            ret->pos = std::move(pos);
-            return ret;
-        }else if(keyword.value() == token::Keyword::Break){
-            auto pos_break = std::move(lexer.next()->pos);
-            auto semicolon = read_token<error::EOFAfterBreak, error::UnexpectedTokenAfterBreak>(lexer, &token::Token::is_semicolon, pos_break);
-            auto ret = std::make_unique<ast::Break>();
-            ret->pos = pos_break + semicolon->pos;
-            return ret;
-        }else if(keyword.value() == token::Keyword::Continue){
-            auto pos_continue = std::move(lexer.next()->pos);
-            auto semicolon = read_token<error::EOFAfterContinue, error::UnexpectedTokenAfterContinue>(lexer, &token::Token::is_semicolon, pos_continue);
-            auto ret = std::make_unique<ast::Continue>();
-            ret->pos = pos_continue + semicolon->pos;
-            return ret;
+        }
+
+        auto expr = parse_expr();
+        auto &token = lexer.peek();
+        if(!token){
+            // token_ref は EOF でないが，token は EOF．
+            // よってここで expr は空でない
+            throw error::make<error::EOFAfterExpr>(std::move(expr->pos));
+        }
+        if(token.kind == token::Kind::Semicolon){
+            auto pos_semicolon = lexer.next().pos();
+            auto pos = expr ? expr->pos + pos_semicolon : std::move(pos_semicolon);
+            stmt = arena.make<ast::ExprStmt>(expr);
+            stmt->pos = std::move(pos);
+            return true;
+        }else if(!expr){
+            stmt = nullptr;
+            return true;
         }else{
             TODO;
         }
     }
 
-    auto expr = parse_expr(lexer);
-    auto &token = lexer.peek();
-    if(!token){
-        // token_ref は nullptr でないが，token は nullptr．
-        // よってここで expr は空でない
-        throw error::make<error::EOFAfterExpr>(std::move(expr->pos));
+    /**
+     * @brief 型注釈を読む．
+     *
+     * `Sound(T)` と `[T]` の入れ子は式と同じく明示的なスタックに積む．
+     * @param keyword エラーの報告に使う `def` の位置
+     */
+    ast::type::Type *Parser::parse_type(pos::Range &keyword){
+        static const auto sound = symbol::intern("Sound");
+        const std::size_t base = type_frames.size();
+        ast::type::Type *type;
+        while(true){
+            auto token = lexer.next();
+            if(!token) throw error::make<error::EOFInDef>(std::move(keyword));
+            if(token.kind == token::Kind::OpeningBracket){
+                type_frames.push_back(TypeFrame{false, token.pos()});
+            }else if(token.kind != token::Kind::Identifier || lexer.keyword(token)){
+                throw error::make<error::UnexpectedTokenInDef>(std::move(keyword), token.pos());
+            }else if(token.payload == sound && lexer.peek().kind == token::Kind::OpeningParenthesis){
+                lexer.next();
+                type_frames.push_back(TypeFrame{true, token.pos()});
+            }else{
+                type = arena.make<ast::type::Identifier>(token.payload);
+                type->pos = token.pos();
+                break;
+            }
+        }
+        while(type_frames.size() > base){
+            auto &frame = type_frames.back();
+            if(frame.sound){
+                auto close = read_token<error::EOFInDef, error::UnexpectedTokenInDef>(lexer, token::Kind::ClosingParenthesis, keyword);
+                pos::Range pos = frame.pos + close.pos();
+                type = arena.make<ast::type::Sound>(type);
+                type->pos = std::move(pos);
+            }else{
+                auto close = read_token<error::EOFInDef, error::UnexpectedTokenInDef>(lexer, token::Kind::ClosingBracket, keyword);
+                pos::Range pos = frame.pos + close.pos();
+                type = arena.make<ast::type::List>(type);
+                type->pos = std::move(pos);
+            }
+            type_frames.pop_back();
+        }
+        return type;
     }
-    if(token->is_semicolon()){
-        auto pos_semicolon = std::move(lexer.next()->pos);
-        auto pos = expr ? expr->pos + pos_semicolon : std::move(pos_semicolon);
-        auto ret = std::make_unique<ast::ExprStmt>(std::move(expr));
-        ret->pos = std::move(pos);
-        return ret;
-    }else if(!expr){
-        return nullptr;
-    }else{
-        TODO;
+
+    /**
+     * @brief `def` で始まる関数定義を読む．
+     *
+     * `def name(param: type, ...): type = expr;` か `def name(param: type, ...): type { ... }`．
+     * 返り値の型注釈（`: type`）は省略できる．
+     */
+    ast::Def *Parser::parse_def(){
+        auto pos_def = lexer.next().pos();
+        auto identifier = [&]{
+            auto token = read_token<error::EOFInDef, error::UnexpectedTokenInDef>(lexer, token::Kind::Identifier, pos_def);
+            if(lexer.keyword(token)) throw error::make<error::UnexpectedTokenInDef>(std::move(pos_def), token.pos());
+            auto ret = arena.make<ast::Identifier>(token.payload);
+            ret->pos = token.pos();
+            return ret;
+        };
+        auto unexpected = [&]{
+            if(auto token = lexer.next()) throw error::make<error::UnexpectedTokenInDef>(std::move(pos_def), token.pos());
+            else throw error::make<error::EOFInDef>(std::move(pos_def));
+        };
+        auto name = identifier();
+        read_token<error::EOFInDef, error::UnexpectedTokenInDef>(lexer, token::Kind::OpeningParenthesis, pos_def);
+        if(lexer.peek().kind == token::Kind::ClosingParenthesis){
+            lexer.next();
+        }else{
+            while(true){
+                auto param = identifier();
+                read_token<error::EOFInDef, error::UnexpectedTokenInDef>(lexer, token::Kind::Colon, pos_def);
+                params.emplace_back(param, parse_type(pos_def));
+                auto kind = lexer.peek().kind;
+                if(kind == token::Kind::ClosingParenthesis){
+                    lexer.next();
+                    break;
+                }
+                if(kind != token::Kind::Comma) unexpected();
+                lexer.next();
+            }
+        }
+        auto param_span = arena.copy(params);
+        params.clear();
+        ast::type::Type *ret = nullptr;
+        if(lexer.peek().kind == token::Kind::Colon){
+            lexer.next();
+            ret = parse_type(pos_def);
+        }
+        auto kind = lexer.peek().kind;
+        if(kind != token::Kind::Equal && kind != token::Kind::OpeningBrace) unexpected();
+        ast::Def *def;
+        pos::Range pos;
+        if(kind == token::Kind::Equal){
+            lexer.next();
+            auto expr = parse_expr();
+            if(!expr) unexpected();
+            auto semicolon = read_token<error::EOFAfterExpr, error::UnexpectedTokenAfterExpr>(lexer, token::Kind::Semicolon, expr->pos);
+            def = arena.make<ast::DefExpr>(name, param_span, ret, expr);
+            pos = pos_def + semicolon.pos();
+        }else{
+            auto body = static_cast<ast::Block *>(parse_stmt());
+            def = arena.make<ast::DefBlock>(name, param_span, ret, body);
+            pos = pos_def + body->pos;
+        }
+        def->pos = std::move(pos);
+        return def;
+    }
+
+    /**
+     * @brief トップレベルの要素を 1 つ読む．
+     *
+     * ノードは全て `arena` 上に確保されるので，結果を使い終えたら `arena.clear()` でまとめて手放せる．
+     * @return EOF に達していれば `nullptr`
+     */
+    ast::TopLevel *Parser::parse_top_level(){
+        // 前の要素の途中でエラーが起きていてもスタックを空から始める
+        expr_frames.clear();
+        items.clear();
+        stmt_frames.clear();
+        stmts.clear();
+        type_frames.clear();
+        params.clear();
+        if(lexer.keyword(lexer.peek()) == token::Keyword::Def) return parse_def();
+        return parse_stmt();
     }
-}
-std::unique_ptr<ast::TopLevel> parse_top_level(lexer::Lexer &lexer){
-    return parse_stmt(lexer);
 }
@@ -5,9 +5,93 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <vector>
+
 #include "ast.hpp"
 #include "lexer.hpp"
 
-std::unique_ptr<ast::TopLevel> parse_top_level(lexer::Lexer &);
+/**
+ * @brief 構文解析を行う
+ */
+namespace parser {
+    /**
+     * @brief トークン列から AST を作る．
+     *
+     * 括弧・前置演算子・ブロックなどの入れ子はネイティブのスタックで再帰せず，明示的なスタックに積む．
+     * そのため入れ子がどれだけ深くてもスタックオーバーフローしない．
+     * スタックの領域はトップレベルの要素をまたいで使い回す．
+     */
+    class Parser {
+        /**
+         * @brief 式の途中で保留している構文
+         */
+        struct ExprFrame {
+            enum class Kind {
+                //! 前置演算子．被演算子を待っている
+                Prefix,
+                //! 二項演算子．右辺を待っている
+                Infix,
+                //! 括弧で始まる因子（グループ・タプル・リスト）
+                Bracket,
+                //! 因子の後に続く括弧（呼び出し・添字）
+                Suffix,
+            } kind;
+            ast::UnaryOperator prefix{};
+            ast::BinaryOperator infix{};
+            int precedence = 0;
+            token::BracketType bracket_type{};
+            //! 二項演算子の左辺か，呼び出し・添字の対象
+            ast::Expr *operand = nullptr;
+            //! 演算子か開き括弧の位置
+            pos::Range pos;
+            //! 括弧の中の要素の `items` での開始位置
+            std::size_t items_base = 0;
+        };
+        /**
+         * @brief 文の途中で保留している構文
+         */
+        struct StmtFrame {
+            enum class Kind {
+                Block,
+                Then,
+                Else,
+                While,
+            } kind;
+            //! `{`，`if` または `while` の位置
+            pos::Range pos;
+            ast::Expr *cond = nullptr;
+            ast::Stmt *stmt_true = nullptr;
+            //! ブロックの中の文の `stmts` での開始位置
+            std::size_t stmts_base = 0;
+        };
+
+        /**
+         * @brief 型注釈の途中で保留している `Sound(` または `[`
+         */
+        struct TypeFrame {
+            bool sound;
+            pos::Range pos;
+        };
+
+        lexer::Lexer &lexer;
+        ast::Arena &arena;
+        std::vector<ExprFrame> expr_frames;
+        std::vector<ast::Expr *> items;
+        std::vector<StmtFrame> stmt_frames;
+        std::vector<ast::Stmt *> stmts;
+        std::vector<TypeFrame> type_frames;
+        std::vector<ast::Param> params;
+
+        ast::Expr *parse_expr();
+        ast::Expr *close_bracket(bool);
+        ast::Stmt *parse_stmt();
+        bool begin_stmt(ast::Stmt *&);
+        ast::type::Type *parse_type(pos::Range &);
+        ast::Def *parse_def();
+    public:
+        Parser(lexer::Lexer &, ast::Arena &);
+        ast::TopLevel *parse_top_level();
+    };
+}
 
 #endif
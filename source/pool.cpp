@@ -0,0 +1,103 @@
+/**
+ * @file pool.cpp
+ */
+#include "pool.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace pool {
+    //! 今のスレッドが受け持つキューの添字（ワーカーでなければ最大値）
+    static thread_local std::size_t current_queue = std::numeric_limits<std::size_t>::max();
+    //! 今のスレッドが属するプール
+    static thread_local const Pool *current_pool = nullptr;
+
+    /**
+     * @brief コンストラクタ
+     * @param num_threads ワーカーの数（0 なら 1 とみなす）
+     */
+    Pool::Pool(unsigned num_threads):
+        queued(0),
+        next_queue(0),
+        stopping(false) {
+        num_threads = std::max(num_threads, 1u);
+        for(unsigned i = 0; i < num_threads; i++) queues.push_back(std::make_unique<Queue>());
+        for(unsigned i = 0; i < num_threads; i++) threads.emplace_back(&Pool::work, this, i);
+    }
+    /**
+     * @brief 残っているタスクを全て実行してからワーカーを止める．
+     */
+    Pool::~Pool(){
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for(auto &thread : threads) thread.join();
+    }
+    unsigned Pool::size() const {
+        return static_cast<unsigned>(queues.size());
+    }
+    /**
+     * @brief タスクを投入する．
+     */
+    void Pool::submit(std::function<void()> task){
+        std::size_t index;
+        if(current_pool == this){
+            index = current_queue;
+        }else{
+            std::lock_guard lock(mutex);
+            index = next_queue;
+            next_queue = (next_queue + 1) % queues.size();
+        }
+        {
+            std::lock_guard lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard lock(mutex);
+            queued++;
+        }
+        wakeup.notify_one();
+    }
+    /**
+     * @brief 自分のキューの末尾か，他のワーカーのキューの先頭からタスクを取り出す．
+     */
+    bool Pool::pop(std::size_t index, std::function<void()> &task){
+        for(std::size_t i = 0; i < queues.size(); i++){
+            auto &queue = *queues[(index + i) % queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if(queue.tasks.empty()) continue;
+            if(i == 0){
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }else{
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+    /**
+     * @brief ワーカーの本体
+     *
+     * タスクがなければ `submit` か停止の通知まで眠る．
+     */
+    void Pool::work(std::size_t index){
+        current_queue = index;
+        current_pool = this;
+        while(true){
+            {
+                std::unique_lock lock(mutex);
+                wakeup.wait(lock, [&]{ return queued > 0 || stopping; });
+                if(queued == 0) return;
+                queued--;
+            }
+            // queued を減らした分のタスクは必ずどこかのキューに残っている
+            std::function<void()> task;
+            while(!pop(index, task)) std::this_thread::yield();
+            task();
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file pool.hpp
+ * @brief ワークスティーリングのスレッドプールを定義する．
+ */
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief ワークスティーリングのスレッドプールを定義する．
+ */
+namespace pool {
+    /**
+     * @brief ワークスティーリングのスレッドプール
+     *
+     * ワーカーはそれぞれ自分のキューを持つ．ワーカー自身が投入したタスクは自分のキューの末尾に積み，
+     * 外から投入したタスクは順番にワーカーへ振り分ける．
+     * 自分のキューは末尾から取り出し，空になったら他のワーカーのキューの先頭から盗む．
+     */
+    class Pool {
+        struct Queue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> threads;
+        //! 待機中のワーカーを起こすためのロック
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        //! まだ誰も取り出していないタスクの数（`mutex` で守る）
+        std::size_t queued;
+        std::size_t next_queue;
+        bool stopping;
+        bool pop(std::size_t, std::function<void()> &);
+        void work(std::size_t);
+    public:
+        explicit Pool(unsigned);
+        Pool(const Pool &) = delete;
+        Pool &operator=(const Pool &) = delete;
+        ~Pool();
+        unsigned size() const;
+        void submit(std::function<void()>);
+
+        /**
+         * @brief 関数をタスクとして投入し，結果を受け取る `std::future` を返す．
+         */
+        template<class F>
+        auto async(F f){
+            using Result = std::invoke_result_t<F>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(f));
+            auto ret = task->get_future();
+            submit([task]{ (*task)(); });
+            return ret;
+        }
+    };
+}
+
+#endif
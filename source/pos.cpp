@@ -3,20 +3,67 @@
  */
 #include "pos.hpp"
 
+#include <algorithm>
+
 namespace pos {
+    Source::~Source() = default;
+
+    /**
+     * @brief オフセットを含む行と，その行頭からのバイト数を求める．
+     *
+     * 行頭のオフセットを二分探索する．エラー出力のときにだけ呼ばれる．
+     * @return `first` が行（0-indexed で），`second` が行頭からのバイト数
+     */
+    std::pair<std::size_t, std::size_t> Source::locate(std::uint32_t offset) const {
+        std::size_t low = 0, high = size();
+        while(high - low > 1){
+            auto mid = low + (high - low) / 2;
+            if(line_start(mid) <= offset) low = mid;
+            else high = mid;
+        }
+        if(size() == 0) return {0, offset};
+        return {low, offset - line_start(low)};
+    }
+
+    //! `Attach` が結びつけた `Source` を置く `pword` の添字
+    static int source_index(){
+        static const int index = std::ios_base::xalloc();
+        return index;
+    }
+
+    /**
+     * @brief コンストラクタ
+     * @param os 出力ストリーム
+     * @param source 位置の解釈に用いるソースコード
+     */
+    Attach::Attach(std::ostream &os, const Source &source):
+        os(os),
+        previous(os.pword(source_index())) {
+        os.pword(source_index()) = const_cast<Source *>(&source);
+    }
+    Attach::~Attach(){
+        os.pword(source_index()) = previous;
+    }
+
+    /**
+     * @brief `os` に結びつけられた `Source` を返す．なければ `nullptr`．
+     */
+    static const Source *attached(std::ostream &os){
+        return static_cast<const Source *>(os.pword(source_index()));
+    }
+
     /**
      * @brief デフォルトコンストラクタ
      *
-     * `line`，`byte` をともに 0 で初期化する．
+     * `offset` を 0 で初期化する．
      */
-    Pos::Pos(): line(0), byte(0) {}
+    Pos::Pos(): offset(0) {}
 
     /**
      * @brief コンストラクタ
-     * @param line 何行目か（0-indexed で）
-     * @param byte 何バイト目か（0-indexed で）
+     * @param offset ソースコード先頭から何バイト目か（0-indexed で）
      */
-    Pos::Pos(std::size_t line, std::size_t byte): line(line), byte(byte) {}
+    Pos::Pos(std::uint32_t offset): offset(offset) {}
 
     /**
      * @brief デフォルトコンストラクタ
@@ -35,15 +82,12 @@ namespace pos {
 
     /**
      * @brief コンストラクタ
-     *
-     * 複数行にまたがらない場合（開始と終了が同じ行にある場合）に使う．
-     * @param line 何行目か（0-indexed で）
-     * @param start_byte 何バイト目からか（0-indexed で，`start_byte` 自身も含む）
-     * @param end_byte 何バイト目の手前までか（0-indexed で，`end_byte` 自身は含まない）
+     * @param start 何バイト目からか（0-indexed で，`start` 自身も含む）
+     * @param end 何バイト目の手前までか（0-indexed で，`end` 自身は含まない）
      */
-    Range::Range(std::size_t line, std::size_t start_byte, std::size_t end_byte):
-        start(line, start_byte),
-        end(line, end_byte) {}
+    Range::Range(std::uint32_t start, std::uint32_t end):
+        start(start),
+        end(end) {}
 
     /**
      * @brief ムーブコンストラクタ
@@ -58,16 +102,15 @@ namespace pos {
     /**
      * @brief クローン
      */
-    Range Range::clone(){
+    Range Range::clone() const {
         return Range(start, end);
     }
 
     /**
-     * @brief Pos から `line`，`byte` の値を取り出す．
-     * @return `first` が `line`，`second` が `byte`．
+     * @brief ソースコード先頭からのオフセットを返す．
      */
-    std::pair<std::size_t, std::size_t> Pos::into_pair() const {
-        return {line, byte};
+    std::uint32_t Pos::get_offset() const {
+        return offset;
     }
 
     /**
@@ -78,6 +121,13 @@ namespace pos {
         return *this;
     }
 
+    /**
+     * @brief 開始と終了の位置を返す．
+     */
+    std::pair<Pos, Pos> Range::into_pair() const {
+        return {start, end};
+    }
+
     /**
      * @brief 範囲を結合する．
      */
@@ -86,53 +136,75 @@ namespace pos {
     }
 
     /**
-     * @brief `line`，`byte` の値を 1-indexed に直して出力する．
+     * @brief 行と列を 1-indexed に直して出力する．
+     *
+     * ソースコードが結びつけられていなければ `@` に続けてオフセットを出力する．
      */
     std::ostream &operator<<(std::ostream &os, const Pos &pos){
-        return os << pos.line + 1 << ":" << pos.byte + 1;
+        auto source = attached(os);
+        if(!source) return os << "@" << pos.offset;
+        auto [line, byte] = source->locate(pos.offset);
+        return os << line + 1 << ":" << byte + 1;
     }
     /**
-     * @brief 開始と終了の `line`，`byte` を 1-indexed，閉区間に直して出力する．
+     * @brief 開始と終了の行と列を 1-indexed，閉区間に直して出力する．
      */
     std::ostream &operator<<(std::ostream &os, const Range &range){
-        auto [sline, sbyte] = range.start.into_pair();
-        auto [eline, ebyte] = range.end.into_pair();
+        auto source = attached(os);
+        if(!source) return os << "@" << range.start.get_offset() << "-" << range.end.get_offset();
+        auto [sline, sbyte] = source->locate(range.start.get_offset());
+        auto [eline, ebyte] = source->locate(range.end.get_offset());
         return os
             << sline + 1 << ":" << sbyte + 1
             << "-" << eline + 1 << ":" << ebyte;
     }
 
+    /**
+     * @brief 行の `byte` バイト目までと，それ以降に分ける（行末を越えていれば行末で分ける）．
+     */
+    static std::pair<std::string_view, std::string_view> split(std::string_view line, std::size_t byte){
+        byte = std::min(byte, line.size());
+        return {line.substr(0, byte), line.substr(byte)};
+    }
+
     /**
      * @brief ソースコードから当該の行を切り出して出力する．
      * @param source ソースコード（文字列）
      */
-    void Pos::eprint(const std::deque<std::string> &source) const {
+    void Pos::eprint(const Source &source) const {
+        auto [line, byte] = source.locate(offset);
+        if(line >= source.size()) return;
+        auto [before, after] = split(source[line], byte);
         std::cerr
-            << source[line].substr(0, byte)
+            << before
             << " !-> "
-            << source[line].substr(byte)
+            << after
             << std::endl;
     }
     /**
      * @brief ソースコードから当該の範囲の前後を切り出して出力する．
      * @param source ソースコード（文字列）
      */
-    void Range::eprint(const std::deque<std::string> &source) const {
-        auto [sline, sbyte] = start.into_pair();
-        auto [eline, ebyte] = end.into_pair();
+    void Range::eprint(const Source &source) const {
+        auto [sline, sbyte] = source.locate(start.get_offset());
+        auto [eline, ebyte] = source.locate(end.get_offset());
+        if(eline >= source.size()) return;
         if(sline == eline){
+            auto [before, rest] = split(source[sline], sbyte);
+            auto [inside, after] = split(rest, ebyte - std::min(sbyte, ebyte));
             std::cerr
-                << source[sline].substr(0, sbyte)
+                << before
                 << " !-> "
-                << source[sline].substr(sbyte, ebyte - sbyte)
+                << inside
                 << " <-! "
-                << source[sline].substr(ebyte)
+                << after
                 << std::endl;
         } else {
+            auto [before, first] = split(source[sline], sbyte);
             std::cerr
-                << source[sline].substr(0, sbyte)
+                << before
                 << " !-> "
-                << source[sline].substr(sbyte)
+                << first
                 << std::endl;
             if(eline - sline == 1){
             }else if(eline - sline == 2){
@@ -146,10 +218,11 @@ namespace pos {
                 << " lines)"
                 << std::endl;
             }
+            auto [last, after] = split(source[eline], ebyte);
             std::cerr
-                << source[eline].substr(0, ebyte)
+                << last
                 << " <-! "
-                << source[eline].substr(ebyte)
+                << after
                 << std::endl;
         }
     }
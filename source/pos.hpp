@@ -6,28 +6,72 @@
 #define POS_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <utility>
 #include <vector>
-#include <deque>
 #include <string>
+#include <string_view>
 
 /**
  * @brief エラー出力のための位置情報をもつクラスを定義する．
  */
 namespace pos {
+    /**
+     * @brief エラー出力のために，ソースコードを行単位で参照する．
+     *
+     * 実体は `input::Input` の派生クラスが持つ．
+     */
+    class Source {
+    public:
+        virtual ~Source();
+        /**
+         * @brief 参照できる行数
+         */
+        virtual std::size_t size() const = 0;
+        /**
+         * @brief 行を取り出す（0-indexed で，改行文字を含まない）
+         */
+        virtual std::string_view operator[](std::size_t) const = 0;
+        /**
+         * @brief 行頭のソースコード先頭からのバイト数（行について単調増加）
+         */
+        virtual std::size_t line_start(std::size_t) const = 0;
+        std::pair<std::size_t, std::size_t> locate(std::uint32_t) const;
+    };
+
+    /**
+     * @brief 出力ストリームにソースコードを結びつける．
+     *
+     * 位置は行番号を持たないので，`operator<<` は結びつけられたソースコードから行と列を求める．
+     * 結びつけられていなければバイト単位のオフセットをそのまま出力する．
+     * 破棄されると以前の状態に戻す．
+     */
+    class Attach {
+        std::ostream &os;
+        void *previous;
+    public:
+        Attach(std::ostream &, const Source &);
+        Attach(const Attach &) = delete;
+        Attach &operator=(const Attach &) = delete;
+        ~Attach();
+    };
+
     /**
      * @brief ソースコード上の文字の位置
+     *
+     * ソースコード先頭からのバイト単位のオフセットだけを持つ．
+     * 行と列はエラー出力のときに `Source::locate` で求める．
      */
     class Pos {
-        std::size_t line;
-        std::size_t byte;
+        std::uint32_t offset;
     public:
         Pos();
-        Pos(std::size_t, std::size_t);
-        std::pair<std::size_t, std::size_t> into_pair() const;
+        explicit Pos(std::uint32_t);
+        std::uint32_t get_offset() const;
+        friend bool operator==(const Pos &, const Pos &) = default;
         friend std::ostream &operator<<(std::ostream &, const Pos &);
-        void eprint(const std::deque<std::string> &) const;
+        void eprint(const Source &) const;
     };
 
     /**
@@ -38,7 +82,7 @@ namespace pos {
         Pos end;
     public:
         Range();
-        Range(std::size_t, std::size_t, std::size_t);
+        Range(std::uint32_t, std::uint32_t);
         Range(Pos, Pos);
         Range(const Range &) = delete;
         Range &operator=(const Range &) = delete;
@@ -46,9 +90,10 @@ namespace pos {
         Range &operator=(Range &&);
         Range &operator+=(const Range &);
         friend Range operator+(const Range &, const Range &);
-        Range clone();
+        Range clone() const;
+        std::pair<Pos, Pos> into_pair() const;
         friend std::ostream &operator<<(std::ostream &, const Range &);
-        void eprint(const std::deque<std::string> &) const;
+        void eprint(const Source &) const;
     };
 }
 
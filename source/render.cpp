@@ -0,0 +1,697 @@
+/**
+ * @file render.cpp
+ */
+#include "render.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <new>
+#include <optional>
+#include <utility>
+
+#ifdef DEBUG
+#include <iostream>
+#endif
+
+namespace render {
+    //! バッファを揃える境界（キャッシュラインと AVX-512 のベクトルの大きさ）
+    static constexpr std::size_t alignment = 64;
+
+    const char *name(Opcode op){
+        switch(op){
+            case Opcode::AddInt: return "add.i";
+            case Opcode::SubInt: return "sub.i";
+            case Opcode::MulInt: return "mul.i";
+            case Opcode::RemInt: return "rem.i";
+            case Opcode::NegInt: return "neg.i";
+            case Opcode::BitNotInt: return "bitnot.i";
+            case Opcode::BitAndInt: return "bitand.i";
+            case Opcode::BitOrInt: return "bitor.i";
+            case Opcode::BitXorInt: return "bitxor.i";
+            case Opcode::LeftShiftInt: return "shl.i";
+            case Opcode::RightShiftInt: return "shr.i";
+            case Opcode::AddFloat: return "add.f";
+            case Opcode::SubFloat: return "sub.f";
+            case Opcode::MulFloat: return "mul.f";
+            case Opcode::DivFloat: return "div.f";
+            case Opcode::RemFloat: return "rem.f";
+            case Opcode::NegFloat: return "neg.f";
+            case Opcode::RecipFloat: return "recip.f";
+            case Opcode::EqualInt: return "eq.i";
+            case Opcode::NotEqualInt: return "ne.i";
+            case Opcode::LessInt: return "lt.i";
+            case Opcode::LessEqualInt: return "le.i";
+            case Opcode::EqualFloat: return "eq.f";
+            case Opcode::NotEqualFloat: return "ne.f";
+            case Opcode::LessFloat: return "lt.f";
+            case Opcode::LessEqualFloat: return "le.f";
+            case Opcode::EqualBool: return "eq.b";
+            case Opcode::NotEqualBool: return "ne.b";
+            case Opcode::NotBool: return "not.b";
+            case Opcode::AndBool: return "and.b";
+            case Opcode::OrBool: return "or.b";
+            case Opcode::IntToFloat: return "itof";
+            case Opcode::Sin: return "sin";
+            case Opcode::Cos: return "cos";
+            case Opcode::Tan: return "tan";
+            case Opcode::Exp: return "exp";
+            case Opcode::Log: return "log";
+            case Opcode::Sqrt: return "sqrt";
+            case Opcode::Floor: return "floor";
+            case Opcode::Abs: return "abs";
+            case Opcode::Call: return "call";
+            case Opcode::Kernel: return "kernel";
+        }
+        return "?";
+    }
+
+    namespace {
+        /**
+         * @brief 音がブロックごとに評価できない値や関数を使っていた．
+         */
+        struct Unsupported {};
+
+        /**
+         * @brief 各時刻の値の型に対応するバッファの種類（rational は double で近似する）
+         * @throw Unsupported bool，int，float，rational 以外の型だった．
+         */
+        Kind kind(type::TypeId type){
+            if(type == type::bool_id) return Kind::Bool;
+            if(type == type::int_id) return Kind::Int;
+            if(type == type::float_id || type == type::rational_id) return Kind::Float;
+            throw Unsupported{};
+        }
+
+        /**
+         * @brief 組み込みの演算に対応する命令
+         * @param swap 引数を入れ替えて使うなら `true` にする（`>` と `>=`）
+         * @throw Unsupported 対応する命令がなかった．
+         */
+        Opcode opcode(const ir::Prim &prim, bool &swap){
+            auto type = kind(prim.get_operand());
+            bool is_int = type == Kind::Int, is_float = type == Kind::Float, is_bool = type == Kind::Bool;
+            auto pick = [](bool ok, Opcode op){
+                if(!ok) throw Unsupported{};
+                return op;
+            };
+            switch(prim.get_op()){
+                case ir::Op::Cast: return pick(is_int && kind(prim.get_result()) == Kind::Float, Opcode::IntToFloat);
+                case ir::Op::Neg: return is_int ? Opcode::NegInt : pick(is_float, Opcode::NegFloat);
+                case ir::Op::Recip: return pick(is_float, Opcode::RecipFloat);
+                case ir::Op::Not: return pick(is_bool, Opcode::NotBool);
+                case ir::Op::BitNot: return pick(is_int, Opcode::BitNotInt);
+                case ir::Op::Add: return is_int ? Opcode::AddInt : pick(is_float, Opcode::AddFloat);
+                case ir::Op::Sub: return is_int ? Opcode::SubInt : pick(is_float, Opcode::SubFloat);
+                case ir::Op::Mul: return is_int ? Opcode::MulInt : pick(is_float, Opcode::MulFloat);
+                case ir::Op::Div: return pick(is_float, Opcode::DivFloat);
+                case ir::Op::Rem: return is_int ? Opcode::RemInt : pick(is_float, Opcode::RemFloat);
+                case ir::Op::LeftShift: return pick(is_int, Opcode::LeftShiftInt);
+                case ir::Op::RightShift: return pick(is_int, Opcode::RightShiftInt);
+                case ir::Op::Equal: return is_int ? Opcode::EqualInt : is_float ? Opcode::EqualFloat : pick(is_bool, Opcode::EqualBool);
+                case ir::Op::NotEqual: return is_int ? Opcode::NotEqualInt : is_float ? Opcode::NotEqualFloat : pick(is_bool, Opcode::NotEqualBool);
+                case ir::Op::Greater:
+                    swap = true;
+                    [[fallthrough]];
+                case ir::Op::Less: return is_int ? Opcode::LessInt : pick(is_float, Opcode::LessFloat);
+                case ir::Op::GreaterEqual:
+                    swap = true;
+                    [[fallthrough]];
+                case ir::Op::LessEqual: return is_int ? Opcode::LessEqualInt : pick(is_float, Opcode::LessEqualFloat);
+                case ir::Op::And: return pick(is_bool, Opcode::AndBool);
+                case ir::Op::Or: return pick(is_bool, Opcode::OrBool);
+                case ir::Op::BitAnd: return is_int ? Opcode::BitAndInt : pick(is_bool, Opcode::AndBool);
+                case ir::Op::BitOr: return is_int ? Opcode::BitOrInt : pick(is_bool, Opcode::OrBool);
+                case ir::Op::BitXor: return is_int ? Opcode::BitXorInt : pick(is_bool, Opcode::NotEqualBool);
+                case ir::Op::Sin: return pick(is_float, Opcode::Sin);
+                case ir::Op::Cos: return pick(is_float, Opcode::Cos);
+                case ir::Op::Tan: return pick(is_float, Opcode::Tan);
+                case ir::Op::Exp: return pick(is_float, Opcode::Exp);
+                case ir::Op::Log: return pick(is_float, Opcode::Log);
+                case ir::Op::Sqrt: return pick(is_float, Opcode::Sqrt);
+                case ir::Op::Floor: return pick(is_float, Opcode::Floor);
+                case ir::Op::Abs: return pick(is_float, Opcode::Abs);
+                default: throw Unsupported{};
+            }
+        }
+
+        /**
+         * @brief 命令が読み書きするバッファの種類（`Opcode::Call` と `Opcode::Kernel` 以外）
+         */
+        struct Signature {
+            //! 読み出すバッファの数
+            unsigned arity;
+            //! 読み出すバッファが float か
+            bool float_operands;
+            //! 書き込み先が float か
+            bool float_result;
+        };
+        Signature signature(Opcode op){
+            switch(op){
+                case Opcode::NegInt:
+                case Opcode::BitNotInt:
+                case Opcode::NotBool:
+                    return {1, false, false};
+                case Opcode::IntToFloat:
+                    return {1, false, true};
+                case Opcode::AddFloat:
+                case Opcode::SubFloat:
+                case Opcode::MulFloat:
+                case Opcode::DivFloat:
+                case Opcode::RemFloat:
+                    return {2, true, true};
+                case Opcode::NegFloat:
+                case Opcode::RecipFloat:
+                case Opcode::Sin:
+                case Opcode::Cos:
+                case Opcode::Tan:
+                case Opcode::Exp:
+                case Opcode::Log:
+                case Opcode::Sqrt:
+                case Opcode::Floor:
+                case Opcode::Abs:
+                    return {1, true, true};
+                case Opcode::EqualFloat:
+                case Opcode::NotEqualFloat:
+                case Opcode::LessFloat:
+                case Opcode::LessEqualFloat:
+                    return {2, true, false};
+                default:
+                    return {2, false, false};
+            }
+        }
+
+        /**
+         * @brief `Kernel` に融合できる命令なら，対応する手順
+         */
+        std::optional<Kernel::Op> fusible(Opcode op){
+            switch(op){
+                case Opcode::AddFloat: return Kernel::Op::Add;
+                case Opcode::SubFloat: return Kernel::Op::Sub;
+                case Opcode::MulFloat: return Kernel::Op::Mul;
+                case Opcode::DivFloat: return Kernel::Op::Div;
+                case Opcode::NegFloat: return Kernel::Op::Neg;
+                case Opcode::RecipFloat: return Kernel::Op::Recip;
+                default: return std::nullopt;
+            }
+        }
+
+        /**
+         * @brief 音のグラフを命令の列に変換する．
+         *
+         * 同じ音と時刻の値は一度だけ計算する．音を遅らせると時刻がずれるので，別の値として計算する．
+         */
+        class Compiler {
+            const type::TypeContext &types;
+            const vm::Machine &machine;
+            std::vector<Instr> &code;
+            std::vector<Call> &calls;
+            std::vector<Kernel> &kernels;
+            std::map<std::pair<const ir::Sound *, std::uint32_t>, Operand> memo;
+            Operand emit(Opcode, Kind, Operand, Operand);
+            Kind element(const ir::Sound &) const;
+            template<class F> void operands(Instr &, F);
+            void compact(Operand &);
+        public:
+            //! 種類ごとのバッファの数（float のバッファ 0 は時刻）
+            std::uint32_t floats = 1, ints = 0;
+            //! 最初に埋めておく定数のバッファ
+            std::vector<std::pair<Operand, vm::Reg>> constants;
+            //! 作業用の領域の区画の数と，`Kernel` の手順の数の最大値
+            std::size_t scratch = 0, depth = 0;
+            Compiler(const type::TypeContext &types, const vm::Machine &machine, std::vector<Instr> &code, std::vector<Call> &calls, std::vector<Kernel> &kernels):
+                types(types), machine(machine), code(code), calls(calls), kernels(kernels) {}
+            Operand fresh(Kind);
+            Operand sample(const ir::Sound &, std::uint32_t);
+            void fuse(Operand &);
+        };
+
+        Operand Compiler::fresh(Kind kind){
+            return {kind, kind == Kind::Float ? floats++ : ints++};
+        }
+        /**
+         * @brief 命令を追加し，書き込み先のバッファを返す．
+         */
+        Operand Compiler::emit(Opcode op, Kind kind, Operand b, Operand c){
+            auto dst = fresh(kind);
+            code.push_back({op, dst.index, b.index, c.index});
+            return dst;
+        }
+        /**
+         * @brief 音の各時刻の値の種類
+         */
+        Kind Compiler::element(const ir::Sound &sound) const {
+            auto type = dynamic_cast<const type::Sound *>(&types.get(sound.get_type()));
+            if(!type) throw Unsupported{};
+            return kind(type->get_result());
+        }
+        /**
+         * @brief 時刻がバッファ `time` の時の音の値を計算する命令を追加する．
+         *
+         * 音のグラフはいくらでも深くなるので，再帰せずに明示的なスタックで辿る．
+         * @return 値を置くバッファ
+         */
+        Operand Compiler::sample(const ir::Sound &sound, std::uint32_t time){
+            /**
+             * @brief 値を計算している途中の音
+             */
+            struct Frame {
+                const ir::Sound *sound;
+                std::uint32_t time;
+                //! 引数を積んだか
+                bool expanded = false;
+                //! 遅らせた時刻のバッファ（`Delay` と `Advance` で，ずらす量を計算した後）
+                std::optional<std::uint32_t> shifted = std::nullopt;
+            };
+            std::vector<Frame> stack{{&sound, time}};
+            while(!stack.empty()){
+                auto frame = stack.back();
+                if(memo.contains({frame.sound, frame.time})){
+                    stack.pop_back();
+                    continue;
+                }
+                Operand ret;
+                if(dynamic_cast<const ir::T *>(frame.sound)) ret = {Kind::Float, frame.time};
+                else if(auto c = dynamic_cast<const ir::Const *>(frame.sound)){
+                    auto &value = *c->get_value();
+                    vm::Reg reg{};
+                    if(auto boolean = dynamic_cast<const ir::Bool *>(&value)){
+                        ret = fresh(Kind::Bool);
+                        reg.i = boolean->get_value();
+                    }else if(auto integer = dynamic_cast<const ir::Int *>(&value)){
+                        ret = fresh(Kind::Int);
+                        reg.i = integer->get_value();
+                    }else if(auto real = dynamic_cast<const ir::Float *>(&value)){
+                        ret = fresh(Kind::Float);
+                        reg.f = real->get_value();
+                    }else if(auto rational = dynamic_cast<const ir::Rational *>(&value)){
+                        ret = fresh(Kind::Float);
+                        reg.f = static_cast<double>(rational->get_numer()) / static_cast<double>(rational->get_denom());
+                    }else throw Unsupported{};
+                    constants.emplace_back(ret, reg);
+                }else if(auto app = dynamic_cast<const ir::App *>(frame.sound)){
+                    auto &args = app->get_args();
+                    auto p = dynamic_cast<const ir::Prim *>(app->get_func().get());
+                    auto ref = dynamic_cast<const ir::DefRef *>(app->get_func().get());
+                    if(!p && !ref) throw Unsupported{};
+                    if(ref && !machine.compiled(ref->get_index())) throw Unsupported{};
+                    bool shifts = p && (p->get_op() == ir::Op::Delay || p->get_op() == ir::Op::Advance);
+                    if(!frame.expanded){
+                        // ずらす量は先に計算する．ほかは引数を先頭から順に計算するように，逆順に積む
+                        stack.back().expanded = true;
+                        if(shifts) stack.push_back({args[1].get(), frame.time});
+                        else for(auto arg = args.rbegin(); arg != args.rend(); ++arg) stack.push_back({arg->get(), frame.time});
+                        continue;
+                    }
+                    if(shifts){
+                        if(!frame.shifted){
+                            auto shift = memo.at({args[1].get(), frame.time});
+                            if(shift.kind == Kind::Int) shift = emit(Opcode::IntToFloat, Kind::Float, shift, {});
+                            else if(shift.kind != Kind::Float) throw Unsupported{};
+                            auto shifted = emit(p->get_op() == ir::Op::Delay ? Opcode::SubFloat : Opcode::AddFloat, Kind::Float, {Kind::Float, frame.time}, shift);
+                            stack.back().shifted = shifted.index;
+                            stack.push_back({args[0].get(), shifted.index});
+                            continue;
+                        }
+                        ret = memo.at({args[0].get(), *frame.shifted});
+                    }else if(p && p->get_op() == ir::Op::Cast && kind(p->get_operand()) == kind(p->get_result())){
+                        // rational と float は同じバッファの種類
+                        ret = memo.at({args[0].get(), frame.time});
+                    }else if(p){
+                        bool swap = false;
+                        auto op = opcode(*p, swap);
+                        std::vector<Operand> operands;
+                        for(auto &arg : args) operands.push_back(memo.at({arg.get(), frame.time}));
+                        if(swap) std::swap(operands[0], operands[1]);
+                        ret = emit(op, kind(p->get_result()), operands[0], operands.size() > 1 ? operands[1] : Operand{});
+                    }else{
+                        Call call{ref->get_index(), {}, element(*frame.sound)};
+                        for(auto &arg : args){
+                            element(*arg);
+                            call.args.push_back(memo.at({arg.get(), frame.time}));
+                        }
+                        calls.push_back(std::move(call));
+                        ret = fresh(calls.back().result);
+                        code.push_back({Opcode::Call, ret.index, static_cast<std::uint32_t>(calls.size() - 1), 0});
+                    }
+                }else throw Unsupported{};
+                memo.emplace(std::pair{frame.sound, frame.time}, ret);
+                stack.pop_back();
+            }
+            return memo.at({&sound, time});
+        }
+        /**
+         * @brief 命令が読み書きするバッファの添字を `visit(添字, float か, 書き込み先か)` に渡す．
+         */
+        template<class F> void Compiler::operands(Instr &instr, F visit){
+            if(instr.op == Opcode::Call){
+                auto &call = calls[instr.b];
+                for(auto &arg : call.args) visit(arg.index, arg.kind == Kind::Float, false);
+                visit(instr.a, call.result == Kind::Float, true);
+            }else if(instr.op == Opcode::Kernel){
+                for(auto &step : kernels[instr.b].steps){
+                    if(step.op == Kernel::Op::Load) visit(step.buffer, true, false);
+                }
+                visit(instr.a, true, true);
+            }else{
+                auto sig = signature(instr.op);
+                if(sig.arity > 0) visit(instr.b, sig.float_operands, false);
+                if(sig.arity > 1) visit(instr.c, sig.float_operands, false);
+                visit(instr.a, sig.float_result, true);
+            }
+        }
+        /**
+         * @brief 要素ごとの float の演算の連なりを `Kernel` にまとめる．
+         *
+         * 1 回だけ読まれ，読む命令も融合できる値は，読む命令の `Kernel` に埋め込んでバッファを使わない．
+         * 埋め込んだ命令の定数は `Kernel` の中に置く．埋め込む命令がない命令はそのままにする．
+         */
+        void Compiler::fuse(Operand &output){
+            constexpr auto none = std::numeric_limits<std::size_t>::max();
+            std::vector<std::uint32_t> uses(floats, 0);
+            std::vector<std::size_t> producer(floats, none);
+            for(std::size_t pc = 0; pc < code.size(); pc++){
+                operands(code[pc], [&](std::uint32_t &index, bool is_float, bool write){
+                    if(!is_float) return;
+                    if(write) producer[index] = pc;
+                    else uses[index]++;
+                });
+            }
+            if(output.kind == Kind::Float) uses[output.index]++;
+            std::vector<std::optional<double>> values(floats);
+            for(auto &[operand, value] : constants){
+                if(operand.kind == Kind::Float) values[operand.index] = value.f;
+            }
+            // 埋め込む命令の印をつける
+            std::vector<bool> inlined(code.size(), false);
+            auto inlinable = [&](std::uint32_t index){
+                auto pc = producer[index];
+                return pc != none && inlined[pc];
+            };
+            for(auto &instr : code){
+                if(!fusible(instr.op)) continue;
+                auto arity = signature(instr.op).arity;
+                for(auto index : {instr.b, instr.c}){
+                    if(arity-- == 0) break;
+                    auto pc = producer[index];
+                    if(pc != none && uses[index] == 1 && fusible(code[pc].op)) inlined[pc] = true;
+                }
+            }
+            std::vector<Instr> fused;
+            for(std::size_t pc = 0; pc < code.size(); pc++){
+                if(inlined[pc]) continue;
+                auto instr = code[pc];
+                auto arity = fusible(instr.op) ? signature(instr.op).arity : 0;
+                if(!(arity > 0 && inlinable(instr.b)) && !(arity > 1 && inlinable(instr.c))){
+                    fused.push_back(instr);
+                    continue;
+                }
+                Kernel kernel{{}, scratch};
+                // 埋め込む命令を後順に辿る（連なりはいくらでも長くなるので，再帰しない）
+                std::vector<std::pair<const Instr *, unsigned>> nodes{{&instr, 0}};
+                while(!nodes.empty()){
+                    auto [node, next] = nodes.back();
+                    if(next == signature(node->op).arity){
+                        kernel.steps.push_back({*fusible(node->op), 0, 0.0});
+                        nodes.pop_back();
+                        continue;
+                    }
+                    nodes.back().second++;
+                    auto index = next == 0 ? node->b : node->c;
+                    if(inlinable(index)) nodes.push_back({&code[producer[index]], 0});
+                    else if(values[index]) kernel.steps.push_back({Kernel::Op::Constant, 0, *values[index]});
+                    else kernel.steps.push_back({Kernel::Op::Load, index, 0.0});
+                }
+                scratch += kernel.steps.size();
+                depth = std::max(depth, kernel.steps.size());
+                fused.push_back({Opcode::Kernel, instr.a, static_cast<std::uint32_t>(kernels.size()), 0});
+                kernels.push_back(std::move(kernel));
+            }
+            code = std::move(fused);
+            compact(output);
+        }
+        /**
+         * @brief 使わなくなった float のバッファを除き，添字を詰める（時刻のバッファ 0 は残す）．
+         */
+        void Compiler::compact(Operand &output){
+            constexpr auto none = std::numeric_limits<std::uint32_t>::max();
+            std::vector<std::uint32_t> remap(floats, none);
+            remap[0] = 0;
+            for(auto &instr : code){
+                operands(instr, [&](std::uint32_t &index, bool is_float, bool){
+                    if(is_float) remap[index] = 0;
+                });
+            }
+            if(output.kind == Kind::Float) remap[output.index] = 0;
+            floats = 0;
+            for(auto &index : remap){
+                if(index != none) index = floats++;
+            }
+            for(auto &instr : code){
+                operands(instr, [&](std::uint32_t &index, bool is_float, bool){
+                    if(is_float) index = remap[index];
+                });
+            }
+            if(output.kind == Kind::Float) output.index = remap[output.index];
+            std::erase_if(constants, [&](auto &constant){
+                return constant.first.kind == Kind::Float && remap[constant.first.index] == none;
+            });
+            for(auto &[operand, value] : constants){
+                if(operand.kind == Kind::Float) operand.index = remap[operand.index];
+            }
+        }
+
+        //! 要素ごとの演算でまとめて処理する要素数（端数のないループにし，コンパイラがベクトル化できるようにする）
+        constexpr std::size_t lanes = alignment / sizeof(double);
+
+        // 要素ごとの演算．書き込み先は読み出すバッファと重ならない．`n` は `lanes` の倍数
+        template<class R, class A, class F> void map(std::size_t n, R *__restrict dst, const A *__restrict a, F f){
+            for(std::size_t i = 0; i < n; i += lanes){
+                for(std::size_t k = 0; k < lanes; k++) dst[i + k] = f(a[i + k]);
+            }
+        }
+        template<class R, class A, class F> void map(std::size_t n, R *__restrict dst, const A *__restrict a, const A *__restrict b, F f){
+            for(std::size_t i = 0; i < n; i += lanes){
+                for(std::size_t k = 0; k < lanes; k++) dst[i + k] = f(a[i + k], b[i + k]);
+            }
+        }
+        //! `Kernel` で一度に計算する時刻の数（途中の値が L1 キャッシュに収まり，命令の振り分けが少ない大きさ）
+        constexpr std::size_t tile = 8 * lanes;
+
+        std::int64_t wrap(std::uint64_t value){
+            return static_cast<std::int64_t>(value);
+        }
+    }
+
+    /**
+     * @brief 音を命令の列に変換する．
+     * @param block 1 ブロックの時刻の数（大きいほど速いが，`render` で書き出す単位も大きくなる）
+     * @param fuse 要素ごとの演算を `Kernel` に融合するか
+     * @throw error::NotRenderable 音がブロックごとに評価できない値や関数を使っていた．
+     */
+    Graph::Graph(vm::Machine &machine, const type::TypeContext &types, const ir::Sound &sound, std::size_t block, bool fuse):
+        machine(machine),
+        block(std::max<std::size_t>(block, 1)),
+        stride((std::max<std::size_t>(block, 1) + lanes - 1) / lanes * lanes) {
+        Compiler compiler(types, machine, code, calls, kernels);
+        try {
+            output = compiler.sample(sound, 0);
+        }catch(const Unsupported &){
+            throw error::make<error::NotRenderable>();
+        }
+        if(fuse) compiler.fuse(output);
+        float_count = compiler.floats;
+        int_count = std::max<std::uint32_t>(compiler.ints, 1);
+        floats.reset(static_cast<double *>(std::aligned_alloc(alignment, sizeof(double) * stride * float_count)));
+        ints.reset(static_cast<std::int64_t *>(std::aligned_alloc(alignment, sizeof(std::int64_t) * stride * int_count)));
+        scratch.reset(static_cast<double *>(std::aligned_alloc(alignment, sizeof(double) * tile * std::max<std::size_t>(compiler.scratch, 1))));
+        if(!floats || !ints || !scratch) throw std::bad_alloc();
+        // 端数の要素も計算するので，値を決めておく
+        std::fill_n(floats.get(), stride * float_count, 0.0);
+        std::fill_n(ints.get(), stride * int_count, 0);
+        for(auto &[operand, value] : compiler.constants){
+            if(operand.kind == Kind::Float) std::fill_n(get_float(operand.index), this->block, value.f);
+            else std::fill_n(get_int(operand.index), this->block, value.i);
+        }
+        for(auto &kernel : kernels){
+            for(std::size_t i = 0; i < kernel.steps.size(); i++){
+                if(kernel.steps[i].op == Kernel::Op::Constant) std::fill_n(scratch.get() + (kernel.scratch + i) * tile, tile, kernel.steps[i].value);
+            }
+        }
+        stack.resize(compiler.depth);
+    }
+
+    double *Graph::get_float(std::uint32_t index) const {
+        return floats.get() + stride * index;
+    }
+    std::int64_t *Graph::get_int(std::uint32_t index) const {
+        return ints.get() + stride * index;
+    }
+    /**
+     * @brief 関数を時刻ごとに `vm::Machine` で呼び出し，結果をバッファ `dst` に書く．
+     */
+    void Graph::call(const Call &call, std::uint32_t dst, std::size_t n){
+        std::vector<vm::Reg> args(call.args.size());
+        for(std::size_t i = 0; i < n; i++){
+            for(std::size_t k = 0; k < args.size(); k++){
+                auto &arg = call.args[k];
+                if(arg.kind == Kind::Float) args[k].f = get_float(arg.index)[i];
+                else if(arg.kind == Kind::Int) args[k].i = get_int(arg.index)[i];
+                else args[k].b = get_int(arg.index)[i] != 0;
+            }
+            auto ret = machine.call(call.index, args);
+            if(call.result == Kind::Float) get_float(dst)[i] = ret.f;
+            else if(call.result == Kind::Int) get_int(dst)[i] = ret.i;
+            else get_int(dst)[i] = ret.b;
+        }
+    }
+    /**
+     * @brief `Kernel` を実行し，バッファ `dst` の先頭 `n` 個（`lanes` の倍数）の値を計算する．
+     *
+     * `tile` 個の時刻ずつ手順を順に実行する．読み出すバッファはそのまま指し，途中の値は手順ごとの作業用の区画に書く．
+     */
+    void Graph::kernel(const Kernel &kernel, std::uint32_t dst, std::size_t n){
+        auto &steps = kernel.steps;
+        for(std::size_t base = 0; base < n; base += tile){
+            auto count = std::min(tile, n - base);
+            std::size_t sp = 0;
+            for(std::size_t i = 0; i < steps.size(); i++){
+                // 最後の手順は書き込み先に直接書く
+                auto out = i + 1 == steps.size() ? get_float(dst) + base : scratch.get() + (kernel.scratch + i) * tile;
+                auto left = [&]{ return stack[sp - 2]; };
+                auto right = [&]{ return stack[sp - 1]; };
+                switch(steps[i].op){
+                    case Kernel::Op::Load: stack[sp++] = get_float(steps[i].buffer) + base; continue;
+                    case Kernel::Op::Constant: stack[sp++] = out; continue;
+                    case Kernel::Op::Add: map(count, out, left(), right(), [](double x, double y){ return x + y; }); break;
+                    case Kernel::Op::Sub: map(count, out, left(), right(), [](double x, double y){ return x - y; }); break;
+                    case Kernel::Op::Mul: map(count, out, left(), right(), [](double x, double y){ return x * y; }); break;
+                    case Kernel::Op::Div: map(count, out, left(), right(), [](double x, double y){ return x / y; }); break;
+                    case Kernel::Op::Neg: map(count, out, right(), [](double x){ return -x; }); stack[sp - 1] = out; continue;
+                    case Kernel::Op::Recip: map(count, out, right(), [](double x){ return 1.0 / x; }); stack[sp - 1] = out; continue;
+                }
+                stack[--sp - 1] = out;
+            }
+        }
+    }
+    /**
+     * @brief 命令を順に実行し，各バッファの先頭 `n` 個の値を計算する．
+     *
+     * 要素ごとの演算は `lanes` の倍数に切り上げた数だけ計算する（端数の値は使わない）．
+     * @throw error::DivisionByZero int を 0 で割った余りを求めた．
+     */
+    void Graph::run(std::size_t n){
+        auto rounded = (n + lanes - 1) / lanes * lanes;
+        for(auto &instr : code){
+            // 命令が使うバッファだけ指す
+            auto fa = [&]{ return get_float(instr.a); };
+            auto fb = [&]{ return get_float(instr.b); };
+            auto fc = [&]{ return get_float(instr.c); };
+            auto ia = [&]{ return get_int(instr.a); };
+            auto ib = [&]{ return get_int(instr.b); };
+            auto ic = [&]{ return get_int(instr.c); };
+            using I = std::int64_t;
+            using U = std::uint64_t;
+            switch(instr.op){
+                case Opcode::AddInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return wrap(static_cast<U>(x) + static_cast<U>(y)); }); break;
+                case Opcode::SubInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return wrap(static_cast<U>(x) - static_cast<U>(y)); }); break;
+                case Opcode::MulInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return wrap(static_cast<U>(x) * static_cast<U>(y)); }); break;
+                case Opcode::RemInt:
+                    if(std::find(ic(), ic() + n, 0) != ic() + n) throw error::make<error::DivisionByZero>();
+                    // 端数の要素は 0 かもしれないので，`n` 個だけ計算する
+                    for(std::size_t i = 0; i < n; i++) ia()[i] = ic()[i] == -1 ? 0 : ib()[i] % ic()[i];
+                    break;
+                case Opcode::NegInt: map(rounded, ia(), ib(), [](I x){ return wrap(-static_cast<U>(x)); }); break;
+                case Opcode::BitNotInt: map(rounded, ia(), ib(), [](I x){ return ~x; }); break;
+                case Opcode::BitAndInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return x & y; }); break;
+                case Opcode::BitOrInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return x | y; }); break;
+                case Opcode::BitXorInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return x ^ y; }); break;
+                case Opcode::LeftShiftInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return wrap(static_cast<U>(x) << (y & 63)); }); break;
+                case Opcode::RightShiftInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return x >> (y & 63); }); break;
+                case Opcode::AddFloat: map(rounded, fa(), fb(), fc(), [](double x, double y){ return x + y; }); break;
+                case Opcode::SubFloat: map(rounded, fa(), fb(), fc(), [](double x, double y){ return x - y; }); break;
+                case Opcode::MulFloat: map(rounded, fa(), fb(), fc(), [](double x, double y){ return x * y; }); break;
+                case Opcode::DivFloat: map(rounded, fa(), fb(), fc(), [](double x, double y){ return x / y; }); break;
+                case Opcode::RemFloat: map(rounded, fa(), fb(), fc(), [](double x, double y){ return std::fmod(x, y); }); break;
+                case Opcode::NegFloat: map(rounded, fa(), fb(), [](double x){ return -x; }); break;
+                case Opcode::RecipFloat: map(rounded, fa(), fb(), [](double x){ return 1.0 / x; }); break;
+                case Opcode::EqualInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return I{x == y}; }); break;
+                case Opcode::NotEqualInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return I{x != y}; }); break;
+                case Opcode::LessInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return I{x < y}; }); break;
+                case Opcode::LessEqualInt: map(rounded, ia(), ib(), ic(), [](I x, I y){ return I{x <= y}; }); break;
+                case Opcode::EqualFloat: map(rounded, ia(), fb(), fc(), [](double x, double y){ return I{x == y}; }); break;
+                case Opcode::NotEqualFloat: map(rounded, ia(), fb(), fc(), [](double x, double y){ return I{x != y}; }); break;
+                case Opcode::LessFloat: map(rounded, ia(), fb(), fc(), [](double x, double y){ return I{x < y}; }); break;
+                case Opcode::LessEqualFloat: map(rounded, ia(), fb(), fc(), [](double x, double y){ return I{x <= y}; }); break;
+                case Opcode::EqualBool: map(rounded, ia(), ib(), ic(), [](I x, I y){ return I{x == y}; }); break;
+                case Opcode::NotEqualBool: map(rounded, ia(), ib(), ic(), [](I x, I y){ return x ^ y; }); break;
+                case Opcode::NotBool: map(rounded, ia(), ib(), [](I x){ return x ^ 1; }); break;
+                case Opcode::AndBool: map(rounded, ia(), ib(), ic(), [](I x, I y){ return x & y; }); break;
+                case Opcode::OrBool: map(rounded, ia(), ib(), ic(), [](I x, I y){ return x | y; }); break;
+                case Opcode::IntToFloat: map(rounded, fa(), ib(), [](I x){ return static_cast<double>(x); }); break;
+                case Opcode::Sin: map(rounded, fa(), fb(), [](double x){ return std::sin(x); }); break;
+                case Opcode::Cos: map(rounded, fa(), fb(), [](double x){ return std::cos(x); }); break;
+                case Opcode::Tan: map(rounded, fa(), fb(), [](double x){ return std::tan(x); }); break;
+                case Opcode::Exp: map(rounded, fa(), fb(), [](double x){ return std::exp(x); }); break;
+                case Opcode::Log: map(rounded, fa(), fb(), [](double x){ return std::log(x); }); break;
+                case Opcode::Sqrt: map(rounded, fa(), fb(), [](double x){ return std::sqrt(x); }); break;
+                case Opcode::Floor: map(rounded, fa(), fb(), [](double x){ return std::floor(x); }); break;
+                case Opcode::Abs: map(rounded, fa(), fb(), [](double x){ return std::fabs(x); }); break;
+                case Opcode::Call: call(calls[instr.b], instr.a, n); break;
+                case Opcode::Kernel: kernel(kernels[instr.b], instr.a, rounded); break;
+            }
+        }
+    }
+    /**
+     * @brief 音を `out` に書き出す（`jit::Render` と同じ形）．
+     *
+     * `out[i]` に時刻 `time + i * (1 / rate)` の音の値を書く．`frames` はブロックの大きさの倍数でなくてもよい．
+     * @throw error::DivisionByZero int を 0 で割った余りを求めた．
+     * @throw error::StackOverflow 呼び出した関数の再帰が深すぎた．
+     */
+    void Graph::render(float *out, std::size_t frames, double time, double rate){
+        auto step = 1.0 / rate;
+        auto now = get_float(0);
+        for(std::size_t done = 0; done < frames; done += block){
+            auto n = std::min(block, frames - done);
+            for(std::size_t i = 0; i < n; i++) now[i] = time + static_cast<double>(done + i) * step;
+            run(n);
+            auto dst = out + done;
+            if(output.kind == Kind::Float){
+                auto src = get_float(output.index);
+                for(std::size_t i = 0; i < n; i++) dst[i] = static_cast<float>(src[i]);
+            }else{
+                auto src = get_int(output.index);
+                for(std::size_t i = 0; i < n; i++) dst[i] = static_cast<float>(src[i]);
+            }
+        }
+    }
+
+    /**
+     * @brief バッファの数（float と int の合計．`Kernel` の作業用の領域は含まない）
+     */
+    std::size_t Graph::buffers() const {
+        return float_count + int_count;
+    }
+
+#ifdef DEBUG
+    void Graph::debug_print() const {
+        std::cout << "graph (block " << block << ", output " << (output.kind == Kind::Float ? "f" : "i") << output.index;
+        std::cout << ", buffers f" << float_count << " i" << int_count << ")" << std::endl;
+        for(std::size_t pc = 0; pc < code.size(); pc++){
+            auto &instr = code[pc];
+            std::cout << "  " << pc << ": " << name(instr.op) << " " << instr.a << " " << instr.b << " " << instr.c << std::endl;
+            if(instr.op != Opcode::Kernel) continue;
+            static const char *const names[] = {"load", "const", "add", "sub", "mul", "div", "neg", "recip"};
+            for(auto &step : kernels[instr.b].steps){
+                std::cout << "      " << names[static_cast<int>(step.op)];
+                if(step.op == Kernel::Op::Load) std::cout << " " << step.buffer;
+                else if(step.op == Kernel::Op::Constant) std::cout << " " << step.value;
+                std::cout << std::endl;
+            }
+        }
+    }
+#endif
+}
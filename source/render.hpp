@@ -0,0 +1,195 @@
+/**
+ * @file render.hpp
+ * @brief 音のグラフをブロックごとに評価して書き出す．
+ */
+#ifndef RENDER_HPP
+#define RENDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "ir.hpp"
+#include "type.hpp"
+#include "vm.hpp"
+
+/**
+ * @brief 音のグラフをブロックごとに評価して書き出す．
+ *
+ * グラフの各ノードを命令にし，1 命令で 1 ブロック分（`block` 個の時刻）の値をバッファに書く．
+ * 命令の振り分けはブロックに 1 回なので，要素ごとの演算はベクトル化できる単純なループになる．
+ * 音の各時刻の rational の値は double で近似する．関数の呼び出しは時刻ごとに `vm::Machine` で実行する．
+ */
+namespace render {
+    //! ブロックの大きさの既定値（遅延と速さの兼ね合い）
+    constexpr std::size_t default_block = 256;
+
+    /**
+     * @brief バッファの値の種類
+     *
+     * bool と int は int64 のバッファに，bool は 0 か 1 として置く．
+     */
+    enum class Kind : std::uint8_t {
+        Bool,
+        Int,
+        Float,
+    };
+
+    /**
+     * @brief 命令の種類
+     *
+     * `a` は書き込み先，`b` と `c` は読み出すバッファ．演算の意味は `vm::Opcode` と同じ．
+     */
+    enum class Opcode : std::uint8_t {
+        AddInt,
+        SubInt,
+        MulInt,
+        //! 0 で割ると `error::DivisionByZero`
+        RemInt,
+        NegInt,
+        BitNotInt,
+        BitAndInt,
+        BitOrInt,
+        BitXorInt,
+        LeftShiftInt,
+        RightShiftInt,
+        AddFloat,
+        SubFloat,
+        MulFloat,
+        DivFloat,
+        RemFloat,
+        NegFloat,
+        RecipFloat,
+        EqualInt,
+        NotEqualInt,
+        LessInt,
+        LessEqualInt,
+        EqualFloat,
+        NotEqualFloat,
+        LessFloat,
+        LessEqualFloat,
+        EqualBool,
+        NotEqualBool,
+        NotBool,
+        AndBool,
+        OrBool,
+        IntToFloat,
+        Sin,
+        Cos,
+        Tan,
+        Exp,
+        Log,
+        Sqrt,
+        Floor,
+        Abs,
+        //! `a = calls[b](...)`
+        Call,
+        //! `a = kernels[b](...)`（融合した要素ごとの演算）
+        Kernel,
+    };
+    const char *name(Opcode);
+
+    /**
+     * @brief 命令
+     */
+    struct Instr {
+        Opcode op;
+        std::uint32_t a, b, c;
+    };
+
+    /**
+     * @brief バッファ（`kind` の種類のバッファの `index` 番目）
+     */
+    struct Operand {
+        Kind kind;
+        std::uint32_t index;
+    };
+
+    /**
+     * @brief 関数の呼び出し（`Opcode::Call`）
+     */
+    struct Call {
+        //! `vm::Machine` での関数の添字
+        std::size_t index;
+        std::vector<Operand> args;
+        Kind result;
+    };
+
+    /**
+     * @brief 融合した要素ごとの float の演算（`Opcode::Kernel`）
+     *
+     * 1 回だけ使う途中の値を書き出さず，後置記法の手順でキャッシュに収まる数の時刻ずつ値を計算する．
+     * 途中の値は小さな作業用の領域に置くので，メモリは読み出すバッファと書き込み先だけを 1 回ずつ通る．
+     */
+    struct Kernel {
+        enum class Op : std::uint8_t {
+            //! バッファ `buffer` を積む
+            Load,
+            //! 定数 `value` を積む
+            Constant,
+            Add,
+            Sub,
+            Mul,
+            Div,
+            Neg,
+            Recip,
+        };
+        struct Step {
+            Op op;
+            std::uint32_t buffer;
+            double value;
+        };
+        std::vector<Step> steps;
+        //! 作業用の領域での位置（手順 `i` は `scratch + i` 番目の区画に書く）
+        std::size_t scratch;
+    };
+
+    /**
+     * @brief 命令の列に変換した音のグラフ
+     *
+     * float のバッファ 0 は時刻で，ずらした時刻もバッファとして扱う．
+     * バッファはキャッシュラインに揃え，ノードごとに別にする（読み書きするバッファが重ならない）．
+     * 要素ごとの float の演算の連なりは `Kernel` に融合し，途中の値のバッファを作らない．
+     * 変換できなかったら `error::NotRenderable` を投げる．
+     */
+    class Graph {
+        struct Free {
+            void operator()(void *pointer) const {
+                std::free(pointer);
+            }
+        };
+        vm::Machine &machine;
+        //! 1 ブロックの時刻の数
+        std::size_t block;
+        //! バッファの間隔（要素数）
+        std::size_t stride;
+        std::vector<Instr> code;
+        std::vector<Call> calls;
+        std::vector<Kernel> kernels;
+        Operand output;
+        //! 種類ごとのバッファの数
+        std::uint32_t float_count, int_count;
+        std::unique_ptr<double[], Free> floats;
+        std::unique_ptr<std::int64_t[], Free> ints;
+        //! `Kernel` の途中の値と定数を置く領域
+        std::unique_ptr<double[], Free> scratch;
+        //! `Kernel` を実行するときの値のスタック
+        std::vector<const double *> stack;
+        double *get_float(std::uint32_t) const;
+        std::int64_t *get_int(std::uint32_t) const;
+        void call(const Call &, std::uint32_t, std::size_t);
+        void kernel(const Kernel &, std::uint32_t, std::size_t);
+        void run(std::size_t);
+    public:
+        Graph(vm::Machine &, const type::TypeContext &, const ir::Sound &, std::size_t = default_block, bool = true);
+        void render(float *, std::size_t, double, double);
+        std::size_t buffers() const;
+#ifdef DEBUG
+        void debug_print() const;
+#endif
+    };
+}
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ * @file scan.cpp
+ */
+#include "scan.hpp"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+    // 各 Matcher は探している文字を判定する．
+    // sse2 / avx2 は 16 / 32 バイトのうち探している文字の位置のビットを立てたマスクを返す．
+    struct SpaceMatcher {
+        static bool scalar(char ch){ return ch != ' ' && (ch < '\t' || ch > '\r'); }
+#if defined(__SSE2__)
+        static unsigned sse2(__m128i v){
+            auto space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+            auto control = _mm_and_si128(
+                _mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)),
+                _mm_cmplt_epi8(v, _mm_set1_epi8('\r' + 1))
+            );
+            return ~static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(space, control))) & 0xFFFF;
+        }
+        __attribute__((target("avx2")))
+        static unsigned avx2(__m256i v){
+            auto space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+            auto control = _mm256_and_si256(
+                _mm256_cmpgt_epi8(v, _mm256_set1_epi8('\t' - 1)),
+                _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), v)
+            );
+            return ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(space, control)));
+        }
+#endif
+    };
+    template<char a, char b>
+    struct PairMatcher {
+        static bool scalar(char ch){ return ch == a || ch == b; }
+#if defined(__SSE2__)
+        static unsigned sse2(__m128i v){
+            return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(a)),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(b))
+            )));
+        }
+        __attribute__((target("avx2")))
+        static unsigned avx2(__m256i v){
+            return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(a)),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(b))
+            )));
+        }
+#endif
+    };
+
+    template<class Matcher>
+    std::size_t find_scalar(std::string_view str, std::size_t from){
+        while(from < str.size() && !Matcher::scalar(str[from])) from++;
+        return from;
+    }
+
+#if defined(__SSE2__)
+    template<class Matcher>
+    std::size_t find_sse2(std::string_view str, std::size_t from){
+        const char *data = str.data();
+        for(; from + 16 <= str.size(); from += 16){
+            auto mask = Matcher::sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + from)));
+            if(mask) return from + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+        return find_scalar<Matcher>(str, from);
+    }
+    template<class Matcher>
+    __attribute__((target("avx2")))
+    std::size_t find_avx2(std::string_view str, std::size_t from){
+        const char *data = str.data();
+        for(; from + 32 <= str.size(); from += 32){
+            auto mask = Matcher::avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + from)));
+            if(mask) return from + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+        return find_sse2<Matcher>(str, from);
+    }
+    bool has_avx2(){
+        static const bool ret = __builtin_cpu_supports("avx2");
+        return ret;
+    }
+#endif
+
+    template<class Matcher>
+    std::size_t find(std::string_view str, std::size_t from){
+#if defined(__SSE2__)
+        // 短い範囲はベクトル化しても得をしない
+        if(from + 16 > str.size()) return find_scalar<Matcher>(str, from);
+        if(has_avx2()) return find_avx2<Matcher>(str, from);
+        return find_sse2<Matcher>(str, from);
+#else
+        return find_scalar<Matcher>(str, from);
+#endif
+    }
+}
+
+namespace scan {
+    /**
+     * @brief 空白文字を読み飛ばす．
+     * @return `from` 以降で最初の空白でない文字の位置
+     */
+    std::size_t skip_space(std::string_view str, std::size_t from){
+        return find<SpaceMatcher>(str, from);
+    }
+    /**
+     * @brief ブロックコメントの中身を読み飛ばす．
+     * @return `from` 以降で最初の `*` または `/` の位置
+     */
+    std::size_t find_comment_delimiter(std::string_view str, std::size_t from){
+        return find<PairMatcher<'*', '/'>>(str, from);
+    }
+    /**
+     * @brief 文字列リテラルの中身を読み飛ばす．
+     * @return `from` 以降で最初の `"` または `\` の位置
+     */
+    std::size_t find_string_delimiter(std::string_view str, std::size_t from){
+        return find<PairMatcher<'"', '\\'>>(str, from);
+    }
+}
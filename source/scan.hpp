@@ -0,0 +1,24 @@
+/**
+ * @file scan.hpp
+ * @brief 字句解析で読み飛ばす部分を SIMD でまとめて走査する．
+ */
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @brief 字句解析で読み飛ばす部分を SIMD でまとめて走査する．
+ *
+ * SSE2 を基本とし，実行時に AVX2 が使えればそちらを用いる．
+ * x86 以外では 1 バイトずつ調べる．
+ * いずれの関数も，見つからなければ `str.size()` を返す．
+ */
+namespace scan {
+    std::size_t skip_space(std::string_view str, std::size_t from);
+    std::size_t find_comment_delimiter(std::string_view str, std::size_t from);
+    std::size_t find_string_delimiter(std::string_view str, std::size_t from);
+}
+
+#endif
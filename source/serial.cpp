@@ -0,0 +1,157 @@
+/**
+ * @file serial.cpp
+ */
+#include "serial.hpp"
+
+#include <bit>
+
+namespace serial {
+    Writer::Writer(): last_start(0), depth(0), failed(false) {}
+    void Writer::put_u8(std::uint8_t value){
+        body.push_back(static_cast<char>(value));
+    }
+    void Writer::put_uint(std::uint64_t value){
+        while(value >= 0x80){
+            body.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        body.push_back(static_cast<char>(value));
+    }
+    /**
+     * @brief 符号付き整数を zigzag 符号化して書く．
+     */
+    void Writer::put_int(std::int64_t value){
+        put_uint((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+    }
+    void Writer::put_double(double value){
+        auto bits = std::bit_cast<std::uint64_t>(value);
+        for(int i = 0; i < 8; i++) put_u8(static_cast<std::uint8_t>(bits >> (8 * i)));
+    }
+    void Writer::put_string(std::string_view str){
+        put_uint(str.size());
+        body.append(str);
+    }
+    void Writer::put_symbol(symbol::Symbol symbol){
+        auto [it, inserted] = name_indices.try_emplace(symbol, static_cast<std::uint32_t>(names.size()));
+        if(inserted) names.push_back(symbol);
+        put_uint(it->second);
+    }
+    /**
+     * @brief 位置を書く．
+     *
+     * ノードは前順に書くので，開始位置は直前に書いた開始位置との差分にするとほとんど 1 バイトで済む．
+     */
+    void Writer::put_range(const pos::Range &range){
+        auto [start, end] = range.into_pair();
+        put_int(static_cast<std::int64_t>(start.get_offset()) - last_start);
+        put_uint(end.get_offset() - start.get_offset());
+        last_start = start.get_offset();
+    }
+    /**
+     * @brief 入れ子を 1 段深くする．
+     * @return `max_depth` を超えなければ `true`
+     */
+    bool Writer::enter(){
+        if(++depth > max_depth) failed = true;
+        return !failed;
+    }
+    void Writer::leave(){
+        depth--;
+    }
+    bool Writer::ok() const {
+        return !failed;
+    }
+    /**
+     * @brief 名前表と本体を繋げたバイト列を返す．
+     */
+    std::string Writer::finish() const {
+        Writer header;
+        header.put_uint(names.size());
+        for(auto symbol : names) header.put_string(symbol::name(symbol));
+        return header.body + body;
+    }
+
+    /**
+     * @brief コンストラクタ
+     *
+     * 先頭の名前表を読み，名前を登録しておく．
+     */
+    Reader::Reader(std::string_view data): data(data), cursor(0), last_start(0), depth(0), failed(false) {
+        auto count = get_uint();
+        if(count > data.size()) fail();
+        for(std::uint64_t i = 0; ok() && i < count; i++) names.push_back(symbol::intern(get_string()));
+    }
+    std::uint8_t Reader::get_u8(){
+        if(failed || cursor >= data.size()){
+            fail();
+            return 0;
+        }
+        return static_cast<std::uint8_t>(data[cursor++]);
+    }
+    /**
+     * @brief 次の 1 バイトを読み進めずに返す（終端では 0）．
+     */
+    std::uint8_t Reader::peek_u8() const {
+        if(failed || cursor >= data.size()) return 0;
+        return static_cast<std::uint8_t>(data[cursor]);
+    }
+    std::uint64_t Reader::get_uint(){
+        std::uint64_t ret = 0;
+        for(int shift = 0; shift < 64; shift += 7){
+            auto byte = get_u8();
+            ret |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if(!(byte & 0x80)) return ret;
+        }
+        fail();
+        return 0;
+    }
+    std::int64_t Reader::get_int(){
+        auto value = get_uint();
+        return static_cast<std::int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+    double Reader::get_double(){
+        std::uint64_t bits = 0;
+        for(int i = 0; i < 8; i++) bits |= static_cast<std::uint64_t>(get_u8()) << (8 * i);
+        return std::bit_cast<double>(bits);
+    }
+    std::string_view Reader::get_string(){
+        auto size = get_uint();
+        if(failed || size > data.size() - cursor){
+            fail();
+            return {};
+        }
+        auto ret = data.substr(cursor, size);
+        cursor += size;
+        return ret;
+    }
+    symbol::Symbol Reader::get_symbol(){
+        auto index = get_uint();
+        if(index >= names.size()){
+            fail();
+            return 0;
+        }
+        return names[index];
+    }
+    pos::Range Reader::get_range(){
+        auto start = static_cast<std::uint32_t>(last_start + get_int());
+        auto end = static_cast<std::uint32_t>(start + get_uint());
+        last_start = start;
+        return pos::Range(start, end);
+    }
+    bool Reader::enter(){
+        if(++depth > max_depth) fail();
+        return !failed;
+    }
+    void Reader::leave(){
+        depth--;
+    }
+    void Reader::fail(){
+        failed = true;
+    }
+    bool Reader::ok() const {
+        return !failed;
+    }
+    bool Reader::at_end() const {
+        return cursor == data.size();
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * @file serial.hpp
+ * @brief AST キャッシュのためのバイト列の読み書きを定義する．
+ */
+#ifndef SERIAL_HPP
+#define SERIAL_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "pos.hpp"
+#include "symbol.hpp"
+
+/**
+ * @brief AST キャッシュのためのバイト列の読み書きを定義する．
+ *
+ * 整数は LEB128 の可変長で書く．識別子の ID はプロセスごとに異なるので，
+ * ファイルごとの名前表の添字に置き換える．
+ */
+namespace serial {
+    //! これより深い入れ子は書かない（読むときも再帰が深くなりすぎないように）
+    constexpr std::size_t max_depth = 4096;
+
+    /**
+     * @brief バイト列を書き出す．
+     *
+     * 入れ子が `max_depth` を超えたら失敗として記録し，呼び出し側は結果を捨てる．
+     */
+    class Writer {
+        std::string body;
+        std::vector<symbol::Symbol> names;
+        std::unordered_map<symbol::Symbol, std::uint32_t> name_indices;
+        //! 直前に書いた開始位置
+        std::uint32_t last_start;
+        std::size_t depth;
+        bool failed;
+    public:
+        Writer();
+        void put_u8(std::uint8_t);
+        void put_uint(std::uint64_t);
+        void put_int(std::int64_t);
+        void put_double(double);
+        void put_string(std::string_view);
+        void put_symbol(symbol::Symbol);
+        void put_range(const pos::Range &);
+        bool enter();
+        void leave();
+        bool ok() const;
+        std::string finish() const;
+    };
+
+    /**
+     * @brief `Writer` が書いたバイト列を読む．
+     *
+     * 範囲外を読もうとしたり入れ子が深すぎたりしたら失敗として記録し，以降は 0 を返す．
+     */
+    class Reader {
+        std::string_view data;
+        std::size_t cursor;
+        std::vector<symbol::Symbol> names;
+        std::uint32_t last_start;
+        std::size_t depth;
+        bool failed;
+    public:
+        Reader(std::string_view);
+        std::uint8_t get_u8();
+        std::uint8_t peek_u8() const;
+        std::uint64_t get_uint();
+        std::int64_t get_int();
+        double get_double();
+        std::string_view get_string();
+        symbol::Symbol get_symbol();
+        pos::Range get_range();
+        bool enter();
+        void leave();
+        void fail();
+        bool ok() const;
+        bool at_end() const;
+    };
+}
+
+#endif
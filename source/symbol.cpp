@@ -0,0 +1,151 @@
+/**
+ * @file symbol.cpp
+ */
+#include "symbol.hpp"
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+    // キーワードの完全ハッシュ
+    // 先頭の文字に掛ける係数を，全てのキーワードが異なる位置に来るようコンパイル時に探す．
+    constexpr std::size_t keyword_table_size = 16;
+    constexpr std::size_t keyword_hash(std::string_view name, std::size_t multiplier){
+        return (static_cast<unsigned char>(name.front()) * multiplier + name.size()) % keyword_table_size;
+    }
+    constexpr bool is_perfect(std::size_t multiplier){
+        std::array<bool, keyword_table_size> used{};
+        for(auto keyword : symbol::keywords){
+            auto h = keyword_hash(keyword, multiplier);
+            if(used[h]) return false;
+            used[h] = true;
+        }
+        return true;
+    }
+    constexpr std::size_t find_multiplier(){
+        std::size_t multiplier = 1;
+        while(!is_perfect(multiplier)) multiplier++;
+        return multiplier;
+    }
+    constexpr std::size_t keyword_multiplier = find_multiplier();
+
+    // 添字はハッシュ値，値はキーワードの ID + 1（0 は空き）
+    constexpr std::array<std::uint8_t, keyword_table_size> make_keyword_table(){
+        std::array<std::uint8_t, keyword_table_size> ret{};
+        for(std::size_t i = 0; i < symbol::keywords.size(); i++){
+            ret[keyword_hash(symbol::keywords[i], keyword_multiplier)] = static_cast<std::uint8_t>(i + 1);
+        }
+        return ret;
+    }
+    constexpr auto keyword_table = make_keyword_table();
+
+    /**
+     * @brief 名前の文字列を保持し，ID との対応をとる．
+     *
+     * 並列な字句解析から呼ばれるので，読み出しは共有ロック，追加は排他ロックで守る．
+     * 字句解析はふつう `LocalInterner` を通して呼ぶので，ロックを取るのはスレッドごとに名前の初出だけ．
+     */
+    class Interner {
+        mutable std::shared_mutex mutex;
+        // 名前の実体．チャンクは再配置されないので std::string_view で指せる
+        std::vector<std::unique_ptr<char[]>> chunks;
+        std::size_t chunk_used, chunk_size;
+        std::vector<std::string_view> names;
+        std::unordered_map<std::string_view, symbol::Symbol> ids;
+        std::string_view store(std::string_view name){
+            if(chunks.empty() || chunk_used + name.size() > chunk_size){
+                chunk_size = std::max<std::size_t>(4096, name.size());
+                chunks.push_back(std::make_unique<char[]>(chunk_size));
+                chunk_used = 0;
+            }
+            char *dest = chunks.back().get() + chunk_used;
+            name.copy(dest, name.size());
+            chunk_used += name.size();
+            return std::string_view(dest, name.size());
+        }
+    public:
+        Interner(): chunk_used(0), chunk_size(0) {
+            for(auto keyword : symbol::keywords) intern(keyword);
+        }
+        /**
+         * @brief 名前の ID と，保持している名前の文字列（`Interner` が破棄されるまで有効）を返す．
+         */
+        std::pair<symbol::Symbol, std::string_view> intern(std::string_view name){
+            {
+                std::shared_lock lock(mutex);
+                auto it = ids.find(name);
+                if(it != ids.end()) return {it->second, it->first};
+            }
+            std::unique_lock lock(mutex);
+            // ロックを取り直す間に他のスレッドが追加したかもしれない
+            auto it = ids.find(name);
+            if(it != ids.end()) return {it->second, it->first};
+            auto stored = store(name);
+            auto id = static_cast<symbol::Symbol>(names.size());
+            names.push_back(stored);
+            ids.emplace(stored, id);
+            return {id, stored};
+        }
+        std::string_view name(symbol::Symbol id) const {
+            std::shared_lock lock(mutex);
+            return names[id];
+        }
+    };
+    Interner &interner(){
+        static Interner ret;
+        return ret;
+    }
+
+    /**
+     * @brief スレッドごとの `Interner` の写し
+     *
+     * 一度引いた名前はロックを取らずに引ける．ID は変わらないので，写しを捨てる必要はない．
+     * キーは `Interner` が保持する文字列を指す．
+     */
+    class LocalInterner {
+        std::unordered_map<std::string_view, symbol::Symbol> ids;
+    public:
+        symbol::Symbol intern(std::string_view name){
+            auto it = ids.find(name);
+            if(it != ids.end()) return it->second;
+            auto [id, stored] = interner().intern(name);
+            ids.emplace(stored, id);
+            return id;
+        }
+    };
+    LocalInterner &local_interner(){
+        thread_local LocalInterner ret;
+        return ret;
+    }
+}
+
+namespace symbol {
+    /**
+     * @brief 名前がキーワードならその ID を返す．
+     *
+     * 完全ハッシュで候補を 1 つに絞り，1 回だけ文字列を比較する．
+     */
+    std::optional<Symbol> find_keyword(std::string_view name){
+        if(name.empty()) return std::nullopt;
+        auto entry = keyword_table[keyword_hash(name, keyword_multiplier)];
+        if(entry == 0 || keywords[entry - 1u] != name) return std::nullopt;
+        return entry - 1u;
+    }
+    /**
+     * @brief 名前に対応する ID を返す．初めて現れた名前には新しい ID を割り当てる．
+     */
+    Symbol intern(std::string_view name){
+        if(auto keyword = find_keyword(name)) return keyword.value();
+        return local_interner().intern(name);
+    }
+    /**
+     * @brief ID に対応する名前を返す．
+     */
+    std::string_view name(Symbol id){
+        return interner().name(id);
+    }
+}
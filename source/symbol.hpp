@@ -0,0 +1,44 @@
+/**
+ * @file symbol.hpp
+ * @brief 識別子を整数の ID に変換する．
+ */
+#ifndef SYMBOL_HPP
+#define SYMBOL_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/**
+ * @brief 識別子を整数の ID に変換する．
+ *
+ * 同じ名前には常に同じ ID が割り当てられるので，名前の比較は整数の比較で済む．
+ */
+namespace symbol {
+    /**
+     * @brief 識別子の ID（0 から順に密に割り当てられる）
+     */
+    using Symbol = std::uint32_t;
+
+    /**
+     * @brief あらかじめ登録されるキーワード
+     *
+     * ID は添字と一致し，`token::Keyword` と同じ順に並べる．
+     */
+    constexpr std::array<std::string_view, 7> keywords = {
+        "if",
+        "else",
+        "while",
+        "break",
+        "continue",
+        "return",
+        "def",
+    };
+
+    std::optional<Symbol> find_keyword(std::string_view);
+    Symbol intern(std::string_view);
+    std::string_view name(Symbol);
+}
+
+#endif
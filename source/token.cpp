@@ -3,103 +3,175 @@
  */
 #include "token.hpp"
 
-namespace token {
-    Token::~Token() = default;
-    Identifier::Identifier(std::string_view name): name(name) {}
-    Number::Number(std::string_view value): value(value) {}
-    String::String(std::string value) : value(std::move(value)) {}
+#include <array>
 
-    std::optional<Keyword> Token::keyword() { return std::nullopt; }
-    std::optional<Keyword> Identifier::keyword(){
-        if(name == "if") return Keyword::If;
-        else if(name == "else") return Keyword::Else;
-        else if(name == "while") return Keyword::While;
-        else if(name == "break") return Keyword::Break;
-        else if(name == "continue") return Keyword::Continue;
-        else if(name == "return") return Keyword::Return;
-        else return std::nullopt;
+namespace token {
+    /**
+     * @brief EOF でなければ `true`
+     */
+    Token::operator bool() const {
+        return kind != Kind::End;
     }
-    std::unique_ptr<ast::Expr> Token::factor(){ return nullptr; }
-    std::unique_ptr<ast::Expr> Identifier::factor(){
-        if(keyword()) return nullptr;
-        else return std::make_unique<ast::Identifier>(name);
+    /**
+     * @brief 位置を `pos::Range` にして返す．
+     */
+    pos::Range Token::pos() const {
+        return pos::Range(start, end);
     }
-    std::unique_ptr<ast::Expr> Number::factor(){ return std::make_unique<ast::Number>(value); }
-    std::unique_ptr<ast::Expr> String::factor(){ return std::make_unique<ast::String>(std::move(value)); }
 
-    std::optional<ast::UnaryOperator> Token::prefix(){ return std::nullopt; }
-    std::optional<ast::UnaryOperator> Plus::prefix(){ return ast::UnaryOperator::Plus; }
-    std::optional<ast::UnaryOperator> Hyphen::prefix(){ return ast::UnaryOperator::Minus; }
-    std::optional<ast::UnaryOperator> DoublePlus::prefix(){ return ast::UnaryOperator::PreInc; }
-    std::optional<ast::UnaryOperator> DoubleHyphen::prefix(){ return ast::UnaryOperator::PreDec; }
-    std::optional<ast::UnaryOperator> Slash::prefix(){ return ast::UnaryOperator::Recip; }
-    std::optional<ast::UnaryOperator> Exclamation::prefix(){ return ast::UnaryOperator::LogicalNot; }
-    std::optional<ast::UnaryOperator> Tilde::prefix(){ return ast::UnaryOperator::BitNot; }
+    void Payloads::clear(){
+        numbers.clear();
+        strings.clear();
+    }
+
+    static constexpr std::array<Traits, kind_count> make_traits(){
+        std::array<Traits, kind_count> ret{};
+        auto at = [&](Kind kind) -> Traits & { return ret[static_cast<std::size_t>(kind)]; };
+
+        at(Kind::End).name = "EOF";
+        at(Kind::Identifier).name = "identifier";
+        at(Kind::Number).name = "number";
+        at(Kind::String).name = "string";
 
-    std::optional<ast::UnaryOperator> Token::suffix(){ return std::nullopt; }
-    std::optional<ast::UnaryOperator> DoublePlus::suffix(){ return ast::UnaryOperator::PostInc; }
-    std::optional<ast::UnaryOperator> DoubleHyphen::suffix(){ return ast::UnaryOperator::PostDec; }
+        at(Kind::Plus).prefix = ast::UnaryOperator::Plus;
+        at(Kind::Hyphen).prefix = ast::UnaryOperator::Minus;
+        at(Kind::DoublePlus).prefix = ast::UnaryOperator::PreInc;
+        at(Kind::DoubleHyphen).prefix = ast::UnaryOperator::PreDec;
+        at(Kind::Slash).prefix = ast::UnaryOperator::Recip;
+        at(Kind::Exclamation).prefix = ast::UnaryOperator::LogicalNot;
+        at(Kind::Tilde).prefix = ast::UnaryOperator::BitNot;
+
+        at(Kind::DoublePlus).suffix = ast::UnaryOperator::PostInc;
+        at(Kind::DoubleHyphen).suffix = ast::UnaryOperator::PostDec;
+
+        at(Kind::Plus).infix = ast::BinaryOperator::Add;
+        at(Kind::Hyphen).infix = ast::BinaryOperator::Sub;
+        at(Kind::Asterisk).infix = ast::BinaryOperator::Mul;
+        at(Kind::Slash).infix = ast::BinaryOperator::Div;
+        at(Kind::Percent).infix = ast::BinaryOperator::Rem;
+        at(Kind::DoubleGreater).infix = ast::BinaryOperator::RightShift;
+        at(Kind::DoubleLess).infix = ast::BinaryOperator::LeftShift;
+        at(Kind::TripleGreater).infix = ast::BinaryOperator::ForwardShift;
+        at(Kind::TripleLess).infix = ast::BinaryOperator::BackwardShift;
+        at(Kind::DoubleEqual).infix = ast::BinaryOperator::Equal;
+        at(Kind::ExclamationEqual).infix = ast::BinaryOperator::NotEqual;
+        at(Kind::Less).infix = ast::BinaryOperator::Less;
+        at(Kind::LessEqual).infix = ast::BinaryOperator::LessEqual;
+        at(Kind::Greater).infix = ast::BinaryOperator::Greater;
+        at(Kind::GreaterEqual).infix = ast::BinaryOperator::GreaterEqual;
+        at(Kind::DoubleAmpersand).infix = ast::BinaryOperator::LogicalAnd;
+        at(Kind::DoubleBar).infix = ast::BinaryOperator::LogicalOr;
+        at(Kind::Ampersand).infix = ast::BinaryOperator::BitAnd;
+        at(Kind::Bar).infix = ast::BinaryOperator::BitOr;
+        at(Kind::Circumflex).infix = ast::BinaryOperator::BitXor;
+        at(Kind::Equal).infix = ast::BinaryOperator::Assign;
+        at(Kind::PlusEqual).infix = ast::BinaryOperator::AddAssign;
+        at(Kind::HyphenEqual).infix = ast::BinaryOperator::SubAssign;
+        at(Kind::AsteriskEqual).infix = ast::BinaryOperator::MulAssign;
+        at(Kind::SlashEqual).infix = ast::BinaryOperator::DivAssign;
+        at(Kind::PercentEqual).infix = ast::BinaryOperator::RemAssign;
+        at(Kind::AmpersandEqual).infix = ast::BinaryOperator::BitAndAssign;
+        at(Kind::BarEqual).infix = ast::BinaryOperator::BitOrAssign;
+        at(Kind::CircumflexEqual).infix = ast::BinaryOperator::BitXorAssign;
+        at(Kind::DoubleGreaterEqual).infix = ast::BinaryOperator::RightShiftAssign;
+        at(Kind::DoubleLessEqual).infix = ast::BinaryOperator::LeftShiftAssign;
+        at(Kind::TripleGreaterEqual).infix = ast::BinaryOperator::ForwardShiftAssign;
+        at(Kind::TripleLessEqual).infix = ast::BinaryOperator::BackwardShiftAssign;
+
+        at(Kind::OpeningParenthesis).opening_bracket_type = BracketType::Round;
+        at(Kind::ClosingParenthesis).closing_bracket_type = BracketType::Round;
+        at(Kind::OpeningBracket).opening_bracket_type = BracketType::Square;
+        at(Kind::ClosingBracket).closing_bracket_type = BracketType::Square;
+
+        at(Kind::Plus).name = "plus (+)";
+        at(Kind::DoublePlus).name = "double plus (++)";
+        at(Kind::PlusEqual).name = "plus equal (+=)";
+        at(Kind::Hyphen).name = "hyphen (-)";
+        at(Kind::DoubleHyphen).name = "double hyphen (--)";
+        at(Kind::HyphenEqual).name = "hyphen equal (-=)";
+        at(Kind::Asterisk).name = "asterisk (*)";
+        at(Kind::AsteriskEqual).name = "asterisk equal (*=)";
+        at(Kind::Slash).name = "slash (/)";
+        at(Kind::SlashEqual).name = "slash equal (/=)";
+        at(Kind::Percent).name = "percent (%)";
+        at(Kind::PercentEqual).name = "percent equal (%=)";
+        at(Kind::Equal).name = "equal (=)";
+        at(Kind::DoubleEqual).name = "double equal (==)";
+        at(Kind::Exclamation).name = "exclamation (!)";
+        at(Kind::ExclamationEqual).name = "exclamation equal (!=)";
+        at(Kind::Less).name = "less (<)";
+        at(Kind::LessEqual).name = "less equal (<=)";
+        at(Kind::DoubleLess).name = "double less (<<)";
+        at(Kind::DoubleLessEqual).name = "double less equal (<<=)";
+        at(Kind::TripleLess).name = "triple less (<<<)";
+        at(Kind::TripleLessEqual).name = "triple less equal (<<<=)";
+        at(Kind::Greater).name = "greater (>)";
+        at(Kind::GreaterEqual).name = "greater equal (>=)";
+        at(Kind::DoubleGreater).name = "double greater (>>)";
+        at(Kind::DoubleGreaterEqual).name = "double greater equal (>>=)";
+        at(Kind::TripleGreater).name = "triple greater (>>>)";
+        at(Kind::TripleGreaterEqual).name = "triple greater equal (>>>=)";
+        at(Kind::Ampersand).name = "ampersand (&)";
+        at(Kind::AmpersandEqual).name = "ampersand equal (&=)";
+        at(Kind::DoubleAmpersand).name = "double ampersand (&&)";
+        at(Kind::Bar).name = "bar (|)";
+        at(Kind::BarEqual).name = "bar equal (|=)";
+        at(Kind::DoubleBar).name = "double bar (||)";
+        at(Kind::Circumflex).name = "circumflex (^)";
+        at(Kind::CircumflexEqual).name = "circumflex equal (^=)";
+        at(Kind::Dot).name = "dot (.)";
+        at(Kind::Colon).name = "colon (:)";
+        at(Kind::Semicolon).name = "semicolon (;)";
+        at(Kind::Comma).name = "comma (,)";
+        at(Kind::Question).name = "question (?)";
+        at(Kind::Hash).name = "hash (#)";
+        at(Kind::Tilde).name = "tilde (~)";
+        at(Kind::OpeningParenthesis).name = "opening parenthesis '('";
+        at(Kind::ClosingParenthesis).name = "closing parenthesis ')'";
+        at(Kind::OpeningBracket).name = "opening bracket '['";
+        at(Kind::ClosingBracket).name = "closing bracket ']'";
+        at(Kind::OpeningBrace).name = "opening brace '{'";
+        at(Kind::ClosingBrace).name = "closing brace '}'";
+        return ret;
+    }
+    static constexpr std::array<Traits, kind_count> traits_table = make_traits();
 
-    std::optional<ast::BinaryOperator> Token::infix(){ return std::nullopt; }
-    std::optional<ast::BinaryOperator> Plus::infix(){ return ast::BinaryOperator::Add; }
-    std::optional<ast::BinaryOperator> Hyphen::infix(){ return ast::BinaryOperator::Sub; }
-    std::optional<ast::BinaryOperator> Asterisk::infix(){ return ast::BinaryOperator::Mul; }
-    std::optional<ast::BinaryOperator> Slash::infix(){ return ast::BinaryOperator::Div; }
-    std::optional<ast::BinaryOperator> Percent::infix(){ return ast::BinaryOperator::Rem; }
-    std::optional<ast::BinaryOperator> DoubleGreater::infix(){ return ast::BinaryOperator::RightShift; }
-    std::optional<ast::BinaryOperator> DoubleLess::infix(){ return ast::BinaryOperator::LeftShift; }
-    std::optional<ast::BinaryOperator> TripleGreater::infix(){ return ast::BinaryOperator::ForwardShift; }
-    std::optional<ast::BinaryOperator> TripleLess::infix(){ return ast::BinaryOperator::BackwardShift; }
-    std::optional<ast::BinaryOperator> DoubleEqual::infix(){ return ast::BinaryOperator::Equal; }
-    std::optional<ast::BinaryOperator> ExclamationEqual::infix(){ return ast::BinaryOperator::NotEqual; }
-    std::optional<ast::BinaryOperator> Less::infix(){ return ast::BinaryOperator::Less; }
-    std::optional<ast::BinaryOperator> LessEqual::infix(){ return ast::BinaryOperator::LessEqual; }
-    std::optional<ast::BinaryOperator> Greater::infix(){ return ast::BinaryOperator::Greater; }
-    std::optional<ast::BinaryOperator> GreaterEqual::infix(){ return ast::BinaryOperator::GreaterEqual; }
-    std::optional<ast::BinaryOperator> DoubleAmpersand::infix(){ return ast::BinaryOperator::LogicalAnd; }
-    std::optional<ast::BinaryOperator> DoubleBar::infix(){ return ast::BinaryOperator::LogicalOr; }
-    std::optional<ast::BinaryOperator> Ampersand::infix(){ return ast::BinaryOperator::BitAnd; }
-    std::optional<ast::BinaryOperator> Bar::infix(){ return ast::BinaryOperator::BitOr; }
-    std::optional<ast::BinaryOperator> Circumflex::infix(){ return ast::BinaryOperator::BitXor; }
-    std::optional<ast::BinaryOperator> Equal::infix(){ return ast::BinaryOperator::Assign; }
-    std::optional<ast::BinaryOperator> PlusEqual::infix(){ return ast::BinaryOperator::AddAssign; }
-    std::optional<ast::BinaryOperator> HyphenEqual::infix(){ return ast::BinaryOperator::SubAssign; }
-    std::optional<ast::BinaryOperator> AsteriskEqual::infix(){ return ast::BinaryOperator::MulAssign; }
-    std::optional<ast::BinaryOperator> SlashEqual::infix(){ return ast::BinaryOperator::DivAssign; }
-    std::optional<ast::BinaryOperator> PercentEqual::infix(){ return ast::BinaryOperator::RemAssign; }
-    std::optional<ast::BinaryOperator> AmpersandEqual::infix(){ return ast::BinaryOperator::BitAndAssign; }
-    std::optional<ast::BinaryOperator> BarEqual::infix(){ return ast::BinaryOperator::BitOrAssign; }
-    std::optional<ast::BinaryOperator> CircumflexEqual::infix(){ return ast::BinaryOperator::BitXorAssign; }
-    std::optional<ast::BinaryOperator> DoubleGreaterEqual::infix(){ return ast::BinaryOperator::RightShiftAssign; }
-    std::optional<ast::BinaryOperator> DoubleLessEqual::infix(){ return ast::BinaryOperator::LeftShiftAssign; }
-    std::optional<ast::BinaryOperator> TripleGreaterEqual::infix(){ return ast::BinaryOperator::ForwardShiftAssign; }
-    std::optional<ast::BinaryOperator> TripleLessEqual::infix(){ return ast::BinaryOperator::BackwardShiftAssign; }
+    /**
+     * @brief トークンの種類ごとの性質を表から引く．
+     */
+    const Traits &traits(Kind kind){
+        return traits_table[static_cast<std::size_t>(kind)];
+    }
 
-    bool Token::is_comma() const { return false; }
-    bool Comma::is_comma() const { return true; }
-    bool Token::is_semicolon() const { return false; }
-    bool Semicolon::is_semicolon() const { return true; }
-    bool Token::is_colon() const { return false; }
-    bool Colon::is_colon() const { return true; }
-    bool Token::is_opening_parenthesis() const { return false; }
-    bool OpeningParenthesis::is_opening_parenthesis() const { return true; }
-    bool Token::is_closing_parenthesis() const { return false; }
-    bool ClosingParenthesis::is_closing_parenthesis() const { return true; }
-    bool Token::is_opening_bracket() const { return false; }
-    bool OpeningBracket::is_opening_bracket() const { return true; }
-    bool Token::is_closing_bracket() const { return false; }
-    bool ClosingBracket::is_closing_bracket() const { return true; }
-    bool Token::is_opening_brace() const { return false; }
-    bool OpeningBrace::is_opening_brace() const { return true; }
-    bool Token::is_closing_brace() const { return false; }
-    bool ClosingBrace::is_closing_brace() const { return true; }
+    static_assert(static_cast<std::size_t>(Keyword::Def) + 1 == symbol::keywords.size());
+    /**
+     * @brief 識別子がキーワードであればそれを返す．
+     *
+     * キーワードの ID は `Keyword` の値と一致するので，比較 1 回で済む．
+     */
+    std::optional<Keyword> keyword(const Token &token){
+        if(token.kind != Kind::Identifier || token.payload >= symbol::keywords.size()) return std::nullopt;
+        return static_cast<Keyword>(token.payload);
+    }
 
-    std::optional<BracketType> Token::opening_bracket_type() const { return std::nullopt; }
-    std::optional<BracketType> Token::closing_bracket_type() const { return std::nullopt; }
-    std::optional<BracketType> OpeningParenthesis::opening_bracket_type() const { return BracketType::Round; }
-    std::optional<BracketType> ClosingParenthesis::closing_bracket_type() const { return BracketType::Round; }
-    std::optional<BracketType> OpeningBracket::opening_bracket_type() const { return BracketType::Square; }
-    std::optional<BracketType> ClosingBracket::closing_bracket_type() const { return BracketType::Square; }
+    /**
+     * @brief トークンが単独で式になるならその式を `arena` 上に作って返す．
+     *
+     * 文字列リテラルの中身は `arena` にコピーされる．
+     */
+    ast::Expr *factor(const Token &token, const Payloads &payloads, ast::Arena &arena){
+        switch(token.kind){
+            case Kind::Identifier:
+                if(keyword(token)) return nullptr;
+                else return arena.make<ast::Identifier>(token.payload);
+            case Kind::Number:
+                return arena.make<ast::Number>(payloads.numbers[token.payload]);
+            case Kind::String:
+                return arena.make<ast::String>(arena.copy(payloads.strings[token.payload]));
+            default:
+                return nullptr;
+        }
+    }
 }
 
 #ifdef DEBUG
@@ -108,74 +180,21 @@ static void indent(int depth){
     for(int i = 0; i < depth; i++) std::cout << "    ";
 }
 namespace token {
-    void Identifier::debug_print(int depth) const {
-        indent(depth);
-        std::cout << "identifier (" << name << ")" << std::endl;
-    }
-    void Number::debug_print(int depth) const {
+    void debug_print(const Token &token, const Payloads &payloads, int depth){
         indent(depth);
-        std::cout << "number (" << value << ")" << std::endl;
+        switch(token.kind){
+            case Kind::Identifier:
+                std::cout << "identifier (" << symbol::name(token.payload) << ")" << std::endl;
+                break;
+            case Kind::Number:
+                std::cout << "number (" << payloads.numbers[token.payload] << ")" << std::endl;
+                break;
+            case Kind::String:
+                std::cout << "string (" << payloads.strings[token.payload] << ")" << std::endl;
+                break;
+            default:
+                std::cout << traits(token.kind).name << std::endl;
+        }
     }
-    void String::debug_print(int depth) const {
-        indent(depth);
-        std::cout << "string (" << value << ")" << std::endl;
-    }
-
-#define define_debug_print(token, text) \
-    void token::debug_print(int depth) const { \
-        indent(depth); \
-        std::cout << text << std::endl; \
-    } \
-
-    define_debug_print(Plus, "plus (+)")
-    define_debug_print(DoublePlus, "double plus (++)")
-    define_debug_print(PlusEqual, "plus equal (+=)")
-    define_debug_print(Hyphen, "hyphen (-)")
-    define_debug_print(DoubleHyphen, "double hyphen (--)")
-    define_debug_print(HyphenEqual, "hyphen equal (-=)")
-    define_debug_print(Asterisk, "asterisk (*)")
-    define_debug_print(AsteriskEqual, "asterisk equal (*=)")
-    define_debug_print(Slash, "slash (/)")
-    define_debug_print(SlashEqual, "slash equal (/=)")
-    define_debug_print(Percent, "percent (%)")
-    define_debug_print(PercentEqual, "percent equal (%=)")
-    define_debug_print(Equal, "equal (=)")
-    define_debug_print(DoubleEqual, "double equal (==)")
-    define_debug_print(Exclamation, "exclamation (!)")
-    define_debug_print(ExclamationEqual, "exclamation equal (!=)")
-    define_debug_print(Less, "less (<)")
-    define_debug_print(LessEqual, "less equal (<=)")
-    define_debug_print(DoubleLess, "double less (<<)")
-    define_debug_print(DoubleLessEqual, "double less equal (<<=)")
-    define_debug_print(TripleLess, "triple less (<<<)")
-    define_debug_print(TripleLessEqual, "triple less equal (<<<=)")
-    define_debug_print(Greater, "greater (>)")
-    define_debug_print(GreaterEqual, "greater equal (>=)")
-    define_debug_print(DoubleGreater, "double greater (>>)")
-    define_debug_print(DoubleGreaterEqual, "double greater equal (>>=)")
-    define_debug_print(TripleGreater, "triple greater (>>>)")
-    define_debug_print(TripleGreaterEqual, "triple greater equal (>>>=)")
-    define_debug_print(Ampersand, "ampersand (&)")
-    define_debug_print(AmpersandEqual, "ampersand equal (&=)")
-    define_debug_print(DoubleAmpersand, "double ampersand (&&)")
-    define_debug_print(Bar, "bar (|)")
-    define_debug_print(BarEqual, "bar equal (|=)")
-    define_debug_print(DoubleBar, "double bar (||)")
-    define_debug_print(Circumflex, "circumflex (^)")
-    define_debug_print(CircumflexEqual, "circumflex equal (^=)")
-    define_debug_print(Dot, "dot (.)")
-    define_debug_print(Colon, "colon (:)")
-    define_debug_print(Semicolon, "semicolon (;)")
-    define_debug_print(Comma, "comma (,)")
-    define_debug_print(Question, "question (?)")
-    define_debug_print(Hash, "hash (#)")
-    define_debug_print(Tilde, "tilde (~)")
-    define_debug_print(OpeningParenthesis, "opening parenthesis '('")
-    define_debug_print(ClosingParenthesis, "closing parenthesis ')'")
-    define_debug_print(OpeningBracket, "opening bracket '['")
-    define_debug_print(ClosingBracket, "closing bracket ']'")
-    define_debug_print(OpeningBrace, "opening brace '{'")
-    define_debug_print(ClosingBrace, "closing brace '}'")
 }
 #endif
-
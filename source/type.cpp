@@ -3,53 +3,164 @@
  */
 #include "type.hpp"
 
-#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <bit>
+#include <limits>
 
 namespace type {
+    //! キーの先頭に置く，型の種類
+    enum Tag : TypeId {
+        FuncTag,
+        SoundTag,
+    };
+    //! ハッシュ表の空き
+    static constexpr TypeId empty_slot = std::numeric_limits<TypeId>::max();
+
+    /**
+     * @brief ID の列のハッシュ
+     */
+    static std::uint64_t hash(std::span<const TypeId> key){
+        constexpr std::uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+        std::uint64_t h = key.size();
+        for(auto id : key) h = (h ^ id) * multiplier;
+        return h ^ (h >> 32);
+    }
+    //! キーを組み立てる作業領域
+    static thread_local std::vector<TypeId> scratch;
+
+    Type::Type(TypeId id): id(id) {}
     Type::~Type() = default;
+    TypeId Type::get_id() const { return id; }
 
-    Func::Func(const std::vector<std::reference_wrapper<const Type>> &args, const Type &ret): args(std::move(args)), ret(ret) {}
+    Bool::Bool(): Type(bool_id) {}
+    Int::Int(): Type(int_id) {}
+    Rational::Rational(): Type(rational_id) {}
+    Float::Float(): Type(float_id) {}
+    Str::Str(): Type(str_id) {}
 
-    const std::vector<std::reference_wrapper<const Type>> &Func::get_args() const { return args; }
-    const Type &Func::get_ret() const { return ret; }
-    std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> Func::get_pair() const { return {args, ret}; }
+    Func::Func(TypeId id, const TypeContext &context, std::span<const TypeId> args, TypeId ret): Type(id), context(context), args(args), ret(ret) {}
 
-    std::size_t FuncHash::operator()(const std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> & pair) const noexcept {
-        std::size_t seed = 0;
-        for(const Type &arg : pair.first) boost::hash_combine<const Type *>(seed, &arg);
-        boost::hash_combine<const Type *>(seed, &pair.second);
-        return seed;
-    }
-    std::size_t FuncHash::operator()(const std::unique_ptr<Func> &type) const noexcept { return (*this)(type->get_pair()); }
-    bool FuncEq::operator()(const std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> &left, const std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> &right) const noexcept {
-        if(&left.second != &right.second) return false;
-        if(left.first.size() != right.first.size()) return false;
-        for(std::size_t i = 0; i < left.first.size(); i++){
-            if(&left.first[i].get() != &right.first[i].get()) return false;
-        }
-        return true;
-    }
-    bool FuncEq::operator()(const std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> &left, const std::unique_ptr<Func> &right) const noexcept { return (*this)(left, right->get_pair()); }
-    bool FuncEq::operator()(const std::unique_ptr<Func> &left, const std::unique_ptr<Func> &right) const noexcept { return (*this)(left->get_pair(), right->get_pair()); }
+    std::span<const TypeId> Func::get_args() const { return args; }
+    TypeId Func::get_ret() const { return ret; }
 
-    Sound::Sound(const Type &result): result(result) {}
+    Sound::Sound(TypeId id, const TypeContext &context, TypeId result): Type(id), context(context), result(result) {}
 
-    const Type &Sound::get_result() const { return result; }
+    TypeId Sound::get_result() const { return result; }
 
-    std::size_t SoundHash::operator()(const Type &result) const noexcept {
-        return std::hash<const Type *>()(&result);
+    /**
+     * @brief コンストラクタ
+     * @param concurrent 複数のスレッドから同時に型を作るなら `true`
+     */
+    TypeContext::TypeContext(bool concurrent):
+        concurrent(concurrent),
+        next_id(0) {
+        for(auto &segment : segments) segment.store(nullptr, std::memory_order_relaxed);
+        for(auto &shard : shards) shard.slots.assign(64, Slot{0, empty_slot});
+        const Type *primitives[] = {&bool_ty, &int_ty, &rational_ty, &float_ty, &str_ty};
+        for(auto type : primitives) publish(next_id++, type, {});
+    }
+    TypeContext::~TypeContext(){
+        for(auto &segment : segments) delete[] segment.load(std::memory_order_relaxed);
     }
-    std::size_t SoundHash::operator()(const std::unique_ptr<Sound> &type) const noexcept {
-        return (*this)(type->get_result());
+
+    /**
+     * @brief ID に対応する表の要素
+     *
+     * ID が `(64 << k) - 64` 以上 `(128 << k) - 64` 未満なら `segments[k]` にある．
+     */
+    TypeContext::Entry &TypeContext::entry(TypeId id) const {
+        auto biased = static_cast<std::uint64_t>(id) + 64;
+        auto k = static_cast<std::size_t>(std::bit_width(biased)) - 7;
+        return segments[k].load(std::memory_order_acquire)[biased - (std::uint64_t{64} << k)];
     }
-    bool SoundEq::operator()(const Type &left, const Type &right) const noexcept {
-        return &left == &right;
+    /**
+     * @brief 振った ID を表に登録する．
+     *
+     * 表の領域がなければ確保する．他のスレッドと同時に確保した場合は先に置いた方を使う．
+     */
+    void TypeContext::publish(TypeId id, const Type *type, std::span<const TypeId> key){
+        auto biased = static_cast<std::uint64_t>(id) + 64;
+        auto k = static_cast<std::size_t>(std::bit_width(biased)) - 7;
+        auto segment = segments[k].load(std::memory_order_acquire);
+        if(!segment){
+            auto allocated = new Entry[std::size_t{64} << k];
+            if(segments[k].compare_exchange_strong(segment, allocated, std::memory_order_acq_rel)) segment = allocated;
+            else delete[] allocated;
+        }
+        segment[biased - (std::uint64_t{64} << k)] = Entry{type, key};
     }
-    bool SoundEq::operator()(const Type &left, const std::unique_ptr<Sound> &right) const noexcept {
-        return (*this)(left, right->get_result());
+
+    /**
+     * @brief キーを `key_blocks` に複製する．
+     *
+     * 一度置いたキーは動かさないので，`Func` の引数の列はそれを直接指す．
+     */
+    std::span<const TypeId> TypeContext::Shard::store_key(std::span<const TypeId> key){
+        if(key_rest < key.size()){
+            constexpr std::size_t min_block_size = 4096;
+            auto size = std::max(min_block_size, key.size());
+            key_blocks.push_back(std::make_unique<TypeId[]>(size));
+            key_cursor = key_blocks.back().get();
+            key_rest = size;
+        }
+        auto stored = key_cursor;
+        std::copy(key.begin(), key.end(), stored);
+        key_cursor += key.size();
+        key_rest -= key.size();
+        return std::span<const TypeId>(stored, key.size());
     }
-    bool SoundEq::operator()(const std::unique_ptr<Sound> &left, const std::unique_ptr<Sound> &right) const noexcept {
-        return (*this)(left->get_result(), right->get_result());
+    /**
+     * @brief `key` をもつ型の入っている位置か，入るべき空きの位置を線形探査で探す．
+     */
+    std::size_t TypeContext::find_slot(const Shard &shard, std::span<const TypeId> key, std::uint64_t h) const {
+        auto mask = shard.slots.size() - 1;
+        for(auto i = h & mask; ; i = (i + 1) & mask){
+            auto [slot_hash, id] = shard.slots[i];
+            if(id == empty_slot) return i;
+            if(slot_hash == static_cast<std::uint32_t>(h) && std::ranges::equal(entry(id).key, key)) return i;
+        }
+    }
+    /**
+     * @brief シャードのハッシュ表を倍に広げる．
+     */
+    void TypeContext::grow(Shard &shard){
+        std::vector<Slot> old(shard.slots.size() * 2, Slot{0, empty_slot});
+        shard.slots.swap(old);
+        auto mask = shard.slots.size() - 1;
+        for(auto slot : old){
+            if(slot.id == empty_slot) continue;
+            // 元の表に重複はないので，空きを探すだけでよい
+            auto i = slot.hash & mask;
+            while(shard.slots[i].id != empty_slot) i = (i + 1) & mask;
+            shard.slots[i] = slot;
+        }
+    }
+    /**
+     * @brief キーに対応する型を探し，なければ作って ID を返す．
+     *
+     * ハッシュの上位 bit でシャードを選び，`concurrent` ならそのシャードのロックを取る．
+     */
+    TypeId TypeContext::intern(std::span<const TypeId> key){
+        auto h = hash(key);
+        auto &shard = shards[(h >> 60) % shard_count];
+        std::unique_lock lock(shard.mutex, std::defer_lock);
+        if(concurrent) lock.lock();
+        auto slot = find_slot(shard, key, h);
+        if(shard.slots[slot].id != empty_slot) return shard.slots[slot].id;
+        // 負荷率を 1/2 以下に保つ
+        if((shard.count + 1) * 2 > shard.slots.size()){
+            grow(shard);
+            slot = find_slot(shard, key, h);
+        }
+        auto stored = shard.store_key(key);
+        auto id = next_id.fetch_add(1, std::memory_order_relaxed);
+        const Type *type;
+        if(stored[0] == FuncTag) type = &shard.funcs.emplace_back(id, *this, stored.subspan(2), stored[1]);
+        else type = &shard.sounds.emplace_back(id, *this, stored[1]);
+        publish(id, type, stored);
+        shard.slots[slot] = Slot{static_cast<std::uint32_t>(h), id};
+        shard.count++;
+        return id;
     }
 
     const Bool &TypeContext::get_bool() & { return bool_ty; }
@@ -58,14 +169,63 @@ namespace type {
     const Float &TypeContext::get_float() & { return float_ty; }
     const Str &TypeContext::get_str() & { return str_ty; }
     const Func &TypeContext::get_func(const std::vector<std::reference_wrapper<const Type>> &args, const Type &ret) & {
-        auto it = funcs.find(std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &>(args, ret));
-        if(it == funcs.end()) it = funcs.insert(std::make_unique<Func>(args, ret)).first;
-        return **it;
+        scratch.assign({FuncTag, ret.get_id()});
+        for(const Type &arg : args) scratch.push_back(arg.get_id());
+        return static_cast<const Func &>(get(intern(scratch)));
     }
     const Sound &TypeContext::get_sound(const Type &result){
-        auto it = sounds.find(result);
-        if(it == sounds.end()) it = sounds.insert(std::make_unique<Sound>(result)).first;
-        return **it;
+        return static_cast<const Sound &>(get(sound(result.get_id())));
+    }
+    /**
+     * @brief 関数型の ID を得る．
+     */
+    TypeId TypeContext::func(std::span<const TypeId> args, TypeId ret){
+        scratch.resize(args.size() + 2);
+        scratch[0] = FuncTag;
+        scratch[1] = ret;
+        std::copy(args.begin(), args.end(), scratch.begin() + 2);
+        return intern(scratch);
+    }
+    /**
+     * @brief Sound 型の ID を得る．
+     */
+    TypeId TypeContext::sound(TypeId result){
+        const TypeId key[] = {SoundTag, result};
+        return intern(key);
+    }
+    /**
+     * @brief ID から型を得る．
+     */
+    const Type &TypeContext::get(TypeId id) const {
+        return *entry(id).type;
+    }
+    /**
+     * @brief これまでに作った型の数（次に振る ID）
+     */
+    std::size_t TypeContext::size() const {
+        return next_id.load(std::memory_order_relaxed);
+    }
+    /**
+     * @brief エラーメッセージのための型の名前
+     *
+     * 例えば `func(int, float) -> float` や `Sound(float)`．
+     */
+    std::string TypeContext::name(TypeId id) const {
+        switch(id){
+            case bool_id: return "bool";
+            case int_id: return "int";
+            case rational_id: return "rational";
+            case float_id: return "float";
+            case str_id: return "str";
+        }
+        auto key = entry(id).key;
+        if(key[0] == SoundTag) return "Sound(" + name(key[1]) + ")";
+        std::string ret = "func(";
+        for(std::size_t i = 2; i < key.size(); i++){
+            if(i > 2) ret += ", ";
+            ret += name(key[i]);
+        }
+        return ret + ") -> " + name(key[1]);
     }
 }
 
@@ -98,20 +258,23 @@ namespace type {
     void Func::debug_print(int depth) const {
         indent(depth);
         std::cout << "func(" << args.size() << ") (" << std::endl;
-        for(const Type &arg: args){
-            arg.debug_print(depth + 1);
+        for(auto arg : args){
+            context.get(arg).debug_print(depth + 1);
         }
         indent(depth);
         std::cout << ") ->" << std::endl;
-        ret.debug_print(depth + 1);
+        context.get(ret).debug_print(depth + 1);
     }
     void Sound::debug_print(int depth) const {
         indent(depth);
         std::cout << "Sound" << std::endl;
-        result.debug_print(depth + 1);
+        context.get(result).debug_print(depth + 1);
     }
     void TypeContext::debug_print(int depth) const {
-        for(auto &func : funcs) func->debug_print(depth);
+        for(TypeId id = 0; id < size(); id++){
+            auto key = entry(id).key;
+            if(!key.empty() && key[0] == FuncTag) entry(id).type->debug_print(depth);
+        }
     }
 }
 #endif
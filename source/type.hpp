@@ -5,21 +5,54 @@
 #ifndef TYPE_HPP
 #define TYPE_HPP
 
-#include <vector>
-#include <memory>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <functional>
-#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
 
 /**
  * @brief 型を定義する．
  */
 namespace type {
+    /**
+     * @brief 型の ID
+     *
+     * `TypeContext` ごとに 0 から順に振られる．同じ型には同じ ID が振られるので，
+     * 型の比較やハッシュは ID だけで行える．
+     */
+    using TypeId = std::uint32_t;
+
+    //! bool 型の ID
+    constexpr TypeId bool_id = 0;
+    //! int 型の ID
+    constexpr TypeId int_id = 1;
+    //! rational 型の ID
+    constexpr TypeId rational_id = 2;
+    //! float 型の ID
+    constexpr TypeId float_id = 3;
+    //! str 型の ID
+    constexpr TypeId str_id = 4;
+    //! 型がまだ決まっていないことを表す（どの型の ID でもない）
+    constexpr TypeId no_type = ~TypeId{0};
+
+    class TypeContext;
+
     /**
      * @brief 全ての型の基底クラス
      */
     class Type {
+        TypeId id;
+    protected:
+        explicit Type(TypeId);
     public:
         virtual ~Type();
+        TypeId get_id() const;
 #ifdef DEBUG
         virtual void debug_print(int) const = 0;
 #endif
@@ -29,6 +62,8 @@ namespace type {
      * @brief bool 型
      */
     class Bool : public Type {
+    public:
+        Bool();
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
@@ -38,6 +73,8 @@ namespace type {
      * @brief int 型
      */
     class Int : public Type {
+    public:
+        Int();
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
@@ -47,6 +84,8 @@ namespace type {
      * @brief rational 型
      */
     class Rational : public Type {
+    public:
+        Rational();
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
@@ -56,6 +95,8 @@ namespace type {
      * @brief float 型
      */
     class Float : public Type {
+    public:
+        Float();
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
@@ -65,6 +106,8 @@ namespace type {
      * @brief str 型
      */
     class Str : public Type {
+    public:
+        Str();
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
@@ -72,83 +115,106 @@ namespace type {
 
     /**
      * @brief 関数型
+     *
+     * 引数と返り値の型は ID で持ち，引数の列は `TypeContext` の持つ領域を指す．
      */
     class Func : public Type {
-        std::vector<std::reference_wrapper<const Type>> args;
-        const Type &ret;
+        const TypeContext &context;
+        std::span<const TypeId> args;
+        TypeId ret;
     public:
-        Func(const std::vector<std::reference_wrapper<const Type>> &, const Type &);
-        const std::vector<std::reference_wrapper<const Type>> &get_args() const;
-        const Type &get_ret() const;
-        std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> get_pair() const;
+        Func(TypeId, const TypeContext &, std::span<const TypeId>, TypeId);
+        std::span<const TypeId> get_args() const;
+        TypeId get_ret() const;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
 
-    /**
-     * @brief `std::unique_ptr<Func>` をもつ `std::unordered_set`に用いるハッシュ関数オブジェクト
-     */
-    struct FuncHash {
-        using is_transparent = void;
-        std::size_t operator()(const std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> &) const noexcept;
-        std::size_t operator()(const std::unique_ptr<Func> &) const noexcept;
-    };
-    /**
-     * @brief `std::unique_ptr<Func>` をもつ `std::unordered_set`に用いる比較関数オブジェクト
-     */
-    struct FuncEq {
-        using is_transparent = void;
-        bool operator()(const std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> &, const std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> &) const noexcept;
-        bool operator()(const std::pair<const std::vector<std::reference_wrapper<const Type>> &, const Type &> &, const std::unique_ptr<Func> &) const noexcept;
-        bool operator()(const std::unique_ptr<Func> &, const std::unique_ptr<Func> &) const noexcept;
-    };
-
     /**
      * @brief Sound 型
      */
     class Sound : public Type {
-        const Type &result;
+        const TypeContext &context;
+        TypeId result;
     public:
-        Sound(const Type &);
-        const Type &get_result() const;
+        Sound(TypeId, const TypeContext &, TypeId);
+        TypeId get_result() const;
 #ifdef DEBUG
         void debug_print(int) const override;
 #endif
     };
 
-    /**
-     * @brief `std::unique_ptr<Sound>` をもつ `std::unordered_set`に用いるハッシュ関数オブジェクト
-     */
-    struct SoundHash {
-        using is_transparent = void;
-        std::size_t operator()(const Type &) const noexcept;
-        std::size_t operator()(const std::unique_ptr<Sound> &) const noexcept;
-    };
-    /**
-     * @brief `std::unique_ptr<Sound>` をもつ `std::unordered_set`に用いる比較関数オブジェクト
-     */
-    struct SoundEq {
-        using is_transparent = void;
-        bool operator()(const Type &, const Type &) const noexcept;
-        bool operator()(const Type &, const std::unique_ptr<Sound> &) const noexcept;
-        bool operator()(const std::unique_ptr<Sound> &, const std::unique_ptr<Sound> &) const noexcept;
-    };
-
     /**
      * @brief 型を管理する．
      *
-     * 同じ型を表すオブジェクトを複数作ることはないため，アドレスで比較できる．
+     * 同じ型を表すオブジェクトを複数作ることはないため，アドレスや ID で比較できる．
+     *
+     * 関数型や Sound 型は「種類，構成要素の ID の列」を連続した ID の配列をキーとし，
+     * キーのハッシュで選んだシャードのオープンアドレス法のハッシュ表で重複を除く．
+     * 型のオブジェクトとキーはシャードごとにまとめて確保し，一度作ったら動かさない．
+     *
+     * `concurrent` を指定して作ると，複数のスレッドから同時に型を作れる．
+     * シャードごとにロックを取るので，異なるシャードへの挿入は互いに待たない．
+     * この場合も同じ型には同じ ID が振られるが，ID の順番はスレッドの実行順に依存する．
      */
     class TypeContext {
+        /**
+         * @brief ハッシュ表の要素
+         *
+         * キーを比べる前にハッシュの下位 32 bit で絞り込む．空きは `id` が `empty_slot`．
+         */
+        struct Slot {
+            std::uint32_t hash;
+            TypeId id;
+        };
+        /**
+         * @brief 型の ID からの表の要素
+         */
+        struct Entry {
+            const Type *type;
+            //! キー（基本型では空）
+            std::span<const TypeId> key;
+        };
+        /**
+         * @brief キーのハッシュで分けた，ハッシュ表とオブジェクトの置き場
+         */
+        struct Shard {
+            std::mutex mutex;
+            std::deque<Func> funcs;
+            std::deque<Sound> sounds;
+            //! キーを置く領域（確保した配列は動かさない）
+            std::vector<std::unique_ptr<TypeId[]>> key_blocks;
+            TypeId *key_cursor = nullptr;
+            std::size_t key_rest = 0;
+            std::size_t count = 0;
+            //! ハッシュ表（大きさは 2 の冪）
+            std::vector<Slot> slots;
+            std::span<const TypeId> store_key(std::span<const TypeId>);
+        };
+        static constexpr std::size_t shard_count = 16;
+        //! `segments[k]` は ID が `(64 << k) - 64` から始まる `64 << k` 個の要素を持つ
+        static constexpr std::size_t segment_count = 27;
         Bool bool_ty;
         Int int_ty;
         Rational rational_ty;
         Float float_ty;
         Str str_ty;
-        std::unordered_set<std::unique_ptr<Func>, FuncHash, FuncEq> funcs;
-        std::unordered_set<std::unique_ptr<Sound>, SoundHash, SoundEq> sounds;
+        bool concurrent;
+        std::array<Shard, shard_count> shards;
+        //! ID から型とキー（要素は動かないので，ロックなしで読める）
+        std::array<std::atomic<Entry *>, segment_count> segments;
+        std::atomic<TypeId> next_id;
+        Entry &entry(TypeId) const;
+        std::size_t find_slot(const Shard &, std::span<const TypeId>, std::uint64_t) const;
+        void grow(Shard &);
+        void publish(TypeId, const Type *, std::span<const TypeId>);
+        TypeId intern(std::span<const TypeId>);
     public:
+        explicit TypeContext(bool = false);
+        TypeContext(const TypeContext &) = delete;
+        TypeContext &operator=(const TypeContext &) = delete;
+        ~TypeContext();
         /**
          * @brief bool 型を得る．
          */
@@ -177,6 +243,11 @@ namespace type {
          * @brief 音を得る．
          */
         const Sound &get_sound(const Type &);
+        TypeId func(std::span<const TypeId>, TypeId);
+        TypeId sound(TypeId);
+        const Type &get(TypeId) const;
+        std::size_t size() const;
+        std::string name(TypeId) const;
 #ifdef DEBUG
         void debug_print(int) const;
 #endif
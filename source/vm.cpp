@@ -0,0 +1,591 @@
+/**
+ * @file vm.cpp
+ */
+#include "vm.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+// 命令の振り分けに GNU 拡張のラベルのアドレス（computed goto）を使う
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wgnu-label-as-value"
+#endif
+
+namespace vm {
+    //! レジスタのスタックの大きさ（8 MiB）
+    static constexpr std::size_t stack_size = std::size_t{1} << 20;
+    //! 呼び出しの深さの上限（レジスタを使わない関数は窓が進まないので，別に数える）
+    static constexpr std::size_t max_frames = stack_size;
+    //! レジスタ番号，定数の番号，命令の番号の上限
+    static constexpr std::size_t max_operand = 0xffff;
+
+    const char *name(Opcode op){
+        switch(op){
+            case Opcode::Move: return "move";
+            case Opcode::Load: return "load";
+            case Opcode::AddInt: return "add.i";
+            case Opcode::SubInt: return "sub.i";
+            case Opcode::MulInt: return "mul.i";
+            case Opcode::RemInt: return "rem.i";
+            case Opcode::NegInt: return "neg.i";
+            case Opcode::BitNotInt: return "bitnot.i";
+            case Opcode::BitAndInt: return "bitand.i";
+            case Opcode::BitOrInt: return "bitor.i";
+            case Opcode::BitXorInt: return "bitxor.i";
+            case Opcode::LeftShiftInt: return "shl.i";
+            case Opcode::RightShiftInt: return "shr.i";
+            case Opcode::AddFloat: return "add.f";
+            case Opcode::SubFloat: return "sub.f";
+            case Opcode::MulFloat: return "mul.f";
+            case Opcode::DivFloat: return "div.f";
+            case Opcode::RemFloat: return "rem.f";
+            case Opcode::NegFloat: return "neg.f";
+            case Opcode::RecipFloat: return "recip.f";
+            case Opcode::EqualInt: return "eq.i";
+            case Opcode::NotEqualInt: return "ne.i";
+            case Opcode::LessInt: return "lt.i";
+            case Opcode::LessEqualInt: return "le.i";
+            case Opcode::EqualFloat: return "eq.f";
+            case Opcode::NotEqualFloat: return "ne.f";
+            case Opcode::LessFloat: return "lt.f";
+            case Opcode::LessEqualFloat: return "le.f";
+            case Opcode::EqualBool: return "eq.b";
+            case Opcode::NotEqualBool: return "ne.b";
+            case Opcode::NotBool: return "not.b";
+            case Opcode::AndBool: return "and.b";
+            case Opcode::OrBool: return "or.b";
+            case Opcode::IntToFloat: return "itof";
+            case Opcode::Sin: return "sin";
+            case Opcode::Cos: return "cos";
+            case Opcode::Tan: return "tan";
+            case Opcode::Exp: return "exp";
+            case Opcode::Log: return "log";
+            case Opcode::Sqrt: return "sqrt";
+            case Opcode::Floor: return "floor";
+            case Opcode::Abs: return "abs";
+            case Opcode::LoadSound: return "load.sound";
+            case Opcode::Apply: return "apply";
+            case Opcode::Jump: return "jump";
+            case Opcode::JumpIf: return "jump.if";
+            case Opcode::JumpUnless: return "jump.unless";
+            case Opcode::Call: return "call";
+            case Opcode::Ret: return "ret";
+            case Opcode::RetVoid: return "ret.void";
+        }
+        return "?";
+    }
+
+    namespace {
+        /**
+         * @brief 関数がバイトコードで扱えない値や演算を使っていた．
+         */
+        struct Unsupported {};
+
+        /**
+         * @brief 組み込みの演算に対応する命令
+         * @param swap 引数を入れ替えて使うなら `true` にする（`>` と `>=`）
+         * @throw Unsupported 対応する命令がなかった．
+         */
+        Opcode opcode(const ir::Prim &prim, bool &swap){
+            auto type = prim.get_operand();
+            bool is_int = type == type::int_id, is_float = type == type::float_id, is_bool = type == type::bool_id;
+            auto pick = [](bool ok, Opcode op){
+                if(!ok) throw Unsupported{};
+                return op;
+            };
+            switch(prim.get_op()){
+                case ir::Op::Cast:
+                    if(type == prim.get_result()) return pick(is_int || is_float || is_bool, Opcode::Move);
+                    return pick(is_int && prim.get_result() == type::float_id, Opcode::IntToFloat);
+                case ir::Op::Neg: return is_int ? Opcode::NegInt : pick(is_float, Opcode::NegFloat);
+                case ir::Op::Recip: return pick(is_float, Opcode::RecipFloat);
+                case ir::Op::Not: return pick(is_bool, Opcode::NotBool);
+                case ir::Op::BitNot: return pick(is_int, Opcode::BitNotInt);
+                case ir::Op::Add: return is_int ? Opcode::AddInt : pick(is_float, Opcode::AddFloat);
+                case ir::Op::Sub: return is_int ? Opcode::SubInt : pick(is_float, Opcode::SubFloat);
+                case ir::Op::Mul: return is_int ? Opcode::MulInt : pick(is_float, Opcode::MulFloat);
+                case ir::Op::Div: return pick(is_float, Opcode::DivFloat);
+                case ir::Op::Rem: return is_int ? Opcode::RemInt : pick(is_float, Opcode::RemFloat);
+                case ir::Op::LeftShift: return pick(is_int, Opcode::LeftShiftInt);
+                case ir::Op::RightShift: return pick(is_int, Opcode::RightShiftInt);
+                case ir::Op::Equal: return is_int ? Opcode::EqualInt : is_float ? Opcode::EqualFloat : pick(is_bool, Opcode::EqualBool);
+                case ir::Op::NotEqual: return is_int ? Opcode::NotEqualInt : is_float ? Opcode::NotEqualFloat : pick(is_bool, Opcode::NotEqualBool);
+                case ir::Op::Greater:
+                    swap = true;
+                    [[fallthrough]];
+                case ir::Op::Less: return is_int ? Opcode::LessInt : pick(is_float, Opcode::LessFloat);
+                case ir::Op::GreaterEqual:
+                    swap = true;
+                    [[fallthrough]];
+                case ir::Op::LessEqual: return is_int ? Opcode::LessEqualInt : pick(is_float, Opcode::LessEqualFloat);
+                case ir::Op::And: return pick(is_bool, Opcode::AndBool);
+                case ir::Op::Or: return pick(is_bool, Opcode::OrBool);
+                case ir::Op::BitAnd: return is_int ? Opcode::BitAndInt : pick(is_bool, Opcode::AndBool);
+                case ir::Op::BitOr: return is_int ? Opcode::BitOrInt : pick(is_bool, Opcode::OrBool);
+                case ir::Op::BitXor: return is_int ? Opcode::BitXorInt : pick(is_bool, Opcode::NotEqualBool);
+                case ir::Op::Sin: return pick(is_float, Opcode::Sin);
+                case ir::Op::Cos: return pick(is_float, Opcode::Cos);
+                case ir::Op::Tan: return pick(is_float, Opcode::Tan);
+                case ir::Op::Exp: return pick(is_float, Opcode::Exp);
+                case ir::Op::Log: return pick(is_float, Opcode::Log);
+                case ir::Op::Sqrt: return pick(is_float, Opcode::Sqrt);
+                case ir::Op::Floor: return pick(is_float, Opcode::Floor);
+                case ir::Op::Abs: return pick(is_float, Opcode::Abs);
+                default: throw Unsupported{};
+            }
+        }
+
+        /**
+         * @brief リテラルの値を複製する．
+         * @return リテラルでなければ `nullptr`
+         */
+        std::shared_ptr<ir::Value> literal(const ir::Expr &expr){
+            if(auto value = dynamic_cast<const ir::Bool *>(&expr)) return std::make_shared<ir::Bool>(value->get_value());
+            if(auto value = dynamic_cast<const ir::Int *>(&expr)) return std::make_shared<ir::Int>(value->get_value());
+            if(auto value = dynamic_cast<const ir::Rational *>(&expr)) return std::make_shared<ir::Rational>(value->get_numer(), value->get_denom());
+            if(auto value = dynamic_cast<const ir::Float *>(&expr)) return std::make_shared<ir::Float>(value->get_value());
+            if(auto value = dynamic_cast<const ir::Str *>(&expr)) return std::make_shared<ir::Str>(value->get_value());
+            return nullptr;
+        }
+
+        /**
+         * @brief 式が変数に代入するなら `true`
+         */
+        bool assigns(const ir::Expr &expr){
+            if(dynamic_cast<const ir::Subst *>(&expr)) return true;
+            if(auto call = dynamic_cast<const ir::Call *>(&expr)){
+                for(auto &arg : call->get_args()) if(assigns(*arg)) return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief 1 つの `ir::Def` をバイトコードに変換する．
+         *
+         * IR のスロットはそのままレジスタの番号にし，式の途中の値はその後ろのレジスタに
+         * 入れ子の深さの順に置く．各メンバ関数の `top` は，それ以降のレジスタを自由に使ってよいことを表す．
+         */
+        class Compiler {
+            Function &func;
+            type::TypeContext &types;
+            const ir::Def &def;
+            std::unordered_map<std::int64_t, std::uint16_t> constant_index;
+            //! 各ブロックの先頭の命令
+            std::vector<std::size_t> starts;
+            //! 飛び先のブロックを後で命令の番号に直す命令
+            std::vector<std::pair<std::size_t, std::size_t>> fixups;
+            std::uint16_t operand(std::size_t);
+            std::uint16_t use(std::size_t);
+            void emit(Opcode, std::size_t, std::size_t = 0, std::size_t = 0);
+            void jump(Opcode, std::size_t, std::size_t);
+            std::uint16_t constant(Reg);
+            bool sound(type::TypeId) const;
+            void apply(const ir::Call &, std::shared_ptr<ir::Func>, std::size_t, std::size_t);
+            std::optional<Reg> fold(const ir::Expr &) const;
+            std::uint16_t value(const ir::Expr &, std::size_t);
+            void into(const ir::Expr &, std::size_t, std::size_t);
+            void term(const ir::Term &, std::size_t);
+        public:
+            Compiler(Function &, type::TypeContext &, const ir::Def &);
+        };
+
+        Compiler::Compiler(Function &func, type::TypeContext &types, const ir::Def &def): func(func), types(types), def(def) {
+            func.name = def.get_name();
+            func.params = operand(def.get_params());
+            func.registers = operand(def.get_slots().size());
+            for(auto slot : def.get_slots()){
+                if(slot != type::bool_id && slot != type::int_id && slot != type::float_id && !sound(slot)) throw Unsupported{};
+            }
+            auto &blocks = def.get_blocks();
+            for(std::size_t b = 0; b < blocks.size(); b++){
+                starts.push_back(func.code.size());
+                for(auto &expr : blocks[b].first) value(*expr, def.get_slots().size());
+                term(*blocks[b].second, b + 1);
+            }
+            for(auto [at, block] : fixups) func.code[at].b = operand(starts[block]);
+        }
+        std::uint16_t Compiler::operand(std::size_t value){
+            if(value > max_operand) throw Unsupported{};
+            return static_cast<std::uint16_t>(value);
+        }
+        /**
+         * @brief レジスタを使う．
+         */
+        std::uint16_t Compiler::use(std::size_t reg){
+            func.registers = std::max(func.registers, operand(reg + 1));
+            return static_cast<std::uint16_t>(reg);
+        }
+        void Compiler::emit(Opcode op, std::size_t a, std::size_t b, std::size_t c){
+            func.code.push_back({op, operand(a), operand(b), operand(c)});
+        }
+        /**
+         * @brief ブロック `block` の先頭へ飛ぶ命令
+         */
+        void Compiler::jump(Opcode op, std::size_t cond, std::size_t block){
+            fixups.emplace_back(func.code.size(), block);
+            emit(op, cond);
+        }
+        std::uint16_t Compiler::constant(Reg value){
+            std::int64_t key;
+            std::memcpy(&key, &value, sizeof(key));
+            auto [it, inserted] = constant_index.try_emplace(key, 0);
+            if(inserted){
+                it->second = operand(func.constants.size());
+                func.constants.push_back(value);
+            }
+            return it->second;
+        }
+        bool Compiler::sound(type::TypeId type) const {
+            return dynamic_cast<const type::Sound *>(&types.get(type));
+        }
+        /**
+         * @brief 関数 `target` を各時刻の値に適用する音を作る．
+         *
+         * 引数はレジスタ `top` から並べ，リテラルの引数はここで `ir::Const` にしておく．
+         */
+        void Compiler::apply(const ir::Call &call, std::shared_ptr<ir::Func> target, std::size_t dst, std::size_t top){
+            Apply site{std::move(target), call.get_type(), {}};
+            auto &args = call.get_args();
+            for(std::size_t i = 0; i < args.size(); i++){
+                auto type = args[i]->get_type();
+                if(auto value = literal(*args[i])){
+                    site.args.push_back({std::make_shared<ir::Const>(types.sound(type), std::move(value)), type::no_type, type});
+                    continue;
+                }
+                into(*args[i], top + i, top + i + 1);
+                site.args.push_back({nullptr, sound(type) ? type::no_type : types.sound(type), type});
+            }
+            func.applies.push_back(std::move(site));
+            emit(Opcode::Apply, dst, func.applies.size() - 1, top);
+        }
+        /**
+         * @brief 定数と，定数の型変換を計算する．
+         */
+        std::optional<Reg> Compiler::fold(const ir::Expr &expr) const {
+            Reg ret{};
+            if(auto integer = dynamic_cast<const ir::Int *>(&expr)) ret.i = integer->get_value();
+            else if(auto real = dynamic_cast<const ir::Float *>(&expr)) ret.f = real->get_value();
+            else if(auto boolean = dynamic_cast<const ir::Bool *>(&expr)) ret.b = boolean->get_value();
+            else if(auto call = dynamic_cast<const ir::Call *>(&expr)){
+                // 小数のリテラルは rational なので，float への変換はここで済ませる
+                auto prim = dynamic_cast<const ir::Prim *>(call->get_func().get());
+                if(!prim || prim->get_op() != ir::Op::Cast || prim->get_result() != type::float_id) return std::nullopt;
+                auto &arg = *call->get_args()[0];
+                if(auto rational = dynamic_cast<const ir::Rational *>(&arg)) ret.f = static_cast<double>(rational->get_numer()) / static_cast<double>(rational->get_denom());
+                else if(auto number = dynamic_cast<const ir::Int *>(&arg)) ret.f = static_cast<double>(number->get_value());
+                else return std::nullopt;
+            }else return std::nullopt;
+            return ret;
+        }
+        /**
+         * @brief 式の値を計算し，値のあるレジスタを返す．
+         *
+         * 変数の読み出しと代入はそのスロットを，それ以外は `top` を返す．
+         */
+        std::uint16_t Compiler::value(const ir::Expr &expr, std::size_t top){
+            if(auto var = dynamic_cast<const ir::Var *>(&expr)) return operand(var->get_index());
+            if(auto subst = dynamic_cast<const ir::Subst *>(&expr)){
+                into(subst->get_expr(), subst->get_index(), top);
+                return operand(subst->get_index());
+            }
+            into(expr, top, top);
+            return use(top);
+        }
+        /**
+         * @brief 式の値を `dst` に書く．`dst` は `top` と同じでもよい．
+         * @throw Unsupported バイトコードで扱えない式だった．
+         */
+        void Compiler::into(const ir::Expr &expr, std::size_t dst, std::size_t top){
+            use(dst);
+            if(auto folded = fold(expr)) return emit(Opcode::Load, dst, constant(*folded));
+            if(auto var = dynamic_cast<const ir::Var *>(&expr)){
+                if(var->get_index() != dst) emit(Opcode::Move, dst, var->get_index());
+                return;
+            }
+            if(auto subst = dynamic_cast<const ir::Subst *>(&expr)){
+                into(subst->get_expr(), subst->get_index(), top);
+                if(subst->get_index() != dst) emit(Opcode::Move, dst, subst->get_index());
+                return;
+            }
+            if(dynamic_cast<const ir::T *>(&expr)){
+                func.sounds.push_back(std::make_shared<ir::T>(expr.get_type()));
+                return emit(Opcode::LoadSound, dst, func.sounds.size() - 1);
+            }
+            auto call = dynamic_cast<const ir::Call *>(&expr);
+            if(!call) throw Unsupported{};
+            auto &args = call->get_args();
+            if(auto lift = dynamic_cast<const ir::Lift *>(call->get_func().get())) return apply(*call, lift->get_func(), dst, top);
+            if(auto prim = dynamic_cast<const ir::Prim *>(call->get_func().get())){
+                // 音を遅らせる・早める演算は音そのものに適用する
+                if(prim->get_op() == ir::Op::Delay || prim->get_op() == ir::Op::Advance) return apply(*call, call->get_func(), dst, top);
+                bool swap = false;
+                auto op = opcode(*prim, swap);
+                std::uint16_t regs[2] = {};
+                for(std::size_t i = 0; i < args.size(); i++){
+                    regs[i] = value(*args[i], top + i);
+                    // 後の引数が書き換えるかもしれない変数は，読んだ時点の値を写しておく
+                    if(regs[i] < def.get_slots().size() && std::any_of(args.begin() + static_cast<std::ptrdiff_t>(i) + 1, args.end(), [](auto &arg){ return assigns(*arg); })){
+                        emit(Opcode::Move, use(top + i), regs[i]);
+                        regs[i] = static_cast<std::uint16_t>(top + i);
+                    }
+                }
+                if(swap) std::swap(regs[0], regs[1]);
+                return emit(op, dst, regs[0], regs[1]);
+            }
+            if(auto ref = dynamic_cast<const ir::DefRef *>(call->get_func().get())){
+                // 引数は呼び出し先のレジスタ 0 からになるよう，連続したレジスタに置く
+                for(std::size_t i = 0; i < args.size(); i++) into(*args[i], top + i, top + i + 1);
+                func.callees.push_back(ref->get_index());
+                return emit(Opcode::Call, dst, ref->get_index(), top);
+            }
+            throw Unsupported{};
+        }
+        /**
+         * @brief ブロックの終端を変換する．
+         * @param next 直後に置くブロック（そこへのジャンプは省く）
+         */
+        void Compiler::term(const ir::Term &term, std::size_t next){
+            auto top = def.get_slots().size();
+            if(auto ret = dynamic_cast<const ir::Ret *>(&term)){
+                if(ret->get_expr()) emit(Opcode::Ret, value(*ret->get_expr(), top));
+                else emit(Opcode::RetVoid, 0);
+            }else if(auto jmp = dynamic_cast<const ir::Jmp *>(&term)){
+                if(jmp->get_dest() != next) jump(Opcode::Jump, 0, jmp->get_dest());
+            }else if(auto br = dynamic_cast<const ir::Br *>(&term)){
+                auto cond = value(br->get_cond(), top);
+                if(br->get_dest_true() == next) jump(Opcode::JumpUnless, cond, br->get_dest_false());
+                else{
+                    jump(Opcode::JumpIf, cond, br->get_dest_true());
+                    if(br->get_dest_false() != next) jump(Opcode::Jump, 0, br->get_dest_false());
+                }
+            }else throw Unsupported{};
+        }
+
+        std::int64_t wrap(std::uint64_t value){
+            return static_cast<std::int64_t>(value);
+        }
+    }
+
+    /**
+     * @brief モジュールの関数をバイトコードに変換する．
+     *
+     * バイトコードで扱えない関数と，それを呼び出す関数は変換しない．
+     */
+    Machine::Machine(type::TypeContext &types, const ir::Module &module): stack(stack_size) {
+        functions.resize(module.defs.size() + 1);
+        auto compile = [&](std::size_t index, const ir::Def *def){
+            if(!def) return;
+            try {
+                Function func;
+                Compiler(func, types, *def);
+                functions[index] = std::move(func);
+            }catch(const Unsupported &){}
+        };
+        for(std::size_t i = 0; i < module.defs.size(); i++) compile(i, module.defs[i].get());
+        compile(module.defs.size(), module.main.get());
+        for(bool changed = true; changed; ){
+            changed = false;
+            for(auto &func : functions){
+                if(func && std::any_of(func->callees.begin(), func->callees.end(), [&](auto callee){ return !functions[callee]; })){
+                    func.reset();
+                    changed = true;
+                }
+            }
+        }
+    }
+    std::size_t Machine::size() const {
+        return functions.size();
+    }
+    std::size_t Machine::main_index() const {
+        return functions.size() - 1;
+    }
+    bool Machine::compiled(std::size_t index) const {
+        return functions[index].has_value();
+    }
+    const Function &Machine::get(std::size_t index) const {
+        return *functions[index];
+    }
+    /**
+     * @brief 最も外側で呼び出した関数 `index` のレジスタ（`main` のスロットの値を読むのに使う）
+     */
+    std::span<const Reg> Machine::registers(std::size_t index) const {
+        return {stack.data(), functions[index]->registers};
+    }
+    /**
+     * @brief 音のレジスタの値が指す音（次に `call` するまで有効）
+     */
+    const std::shared_ptr<ir::Sound> &Machine::sound(Reg reg) const {
+        return sounds[static_cast<std::size_t>(reg.i)];
+    }
+    std::int64_t Machine::keep(std::shared_ptr<ir::Sound> sound){
+        sounds.push_back(std::move(sound));
+        return static_cast<std::int64_t>(sounds.size() - 1);
+    }
+    /**
+     * @brief `ir::Lift` した関数の呼び出しの結果の音を作る．値の引数は `ir::Const` で包む．
+     */
+    std::int64_t Machine::apply(const Apply &site, const Reg *args){
+        std::vector<std::shared_ptr<ir::Sound>> operands;
+        for(std::size_t i = 0; i < site.args.size(); i++){
+            auto &arg = site.args[i];
+            if(arg.constant) operands.push_back(arg.constant);
+            else if(arg.sound == type::no_type) operands.push_back(sound(args[i]));
+            else{
+                std::shared_ptr<ir::Value> value;
+                if(arg.value == type::bool_id) value = std::make_shared<ir::Bool>(args[i].b);
+                else if(arg.value == type::int_id) value = std::make_shared<ir::Int>(args[i].i);
+                else value = std::make_shared<ir::Float>(args[i].f);
+                operands.push_back(std::make_shared<ir::Const>(arg.sound, std::move(value)));
+            }
+        }
+        return keep(std::make_shared<ir::App>(site.type, site.func, std::move(operands)));
+    }
+
+    /**
+     * @brief 変換済みの関数を呼び出す．
+     * @return 返り値（値を返さない関数なら不定）
+     * @throw error::DivisionByZero int を 0 で割った余りを求めた．
+     * @throw error::StackOverflow 呼び出しが深すぎた．
+     */
+    Reg Machine::call(std::size_t index, std::span<const Reg> args){
+        static const void *const labels[] = {
+            &&op_move, &&op_load,
+            &&op_add_int, &&op_sub_int, &&op_mul_int, &&op_rem_int, &&op_neg_int,
+            &&op_bit_not_int, &&op_bit_and_int, &&op_bit_or_int, &&op_bit_xor_int, &&op_left_shift_int, &&op_right_shift_int,
+            &&op_add_float, &&op_sub_float, &&op_mul_float, &&op_div_float, &&op_rem_float, &&op_neg_float, &&op_recip_float,
+            &&op_equal_int, &&op_not_equal_int, &&op_less_int, &&op_less_equal_int,
+            &&op_equal_float, &&op_not_equal_float, &&op_less_float, &&op_less_equal_float,
+            &&op_equal_bool, &&op_not_equal_bool, &&op_not_bool, &&op_and_bool, &&op_or_bool,
+            &&op_int_to_float,
+            &&op_sin, &&op_cos, &&op_tan, &&op_exp, &&op_log, &&op_sqrt, &&op_floor, &&op_abs,
+            &&op_load_sound, &&op_apply,
+            &&op_jump, &&op_jump_if, &&op_jump_unless, &&op_call, &&op_ret, &&op_ret_void,
+        };
+        static_assert(std::size(labels) == static_cast<std::size_t>(Opcode::RetVoid) + 1);
+        const Function *func = &*functions[index];
+        if(func->registers > stack.size()) throw error::make<error::StackOverflow>();
+        std::copy(args.begin(), args.end(), stack.begin());
+        frames.clear();
+        sounds.clear();
+        Reg *r = stack.data();
+        const Reg *end = stack.data() + stack.size();
+        const Instr *ip = func->code.data();
+        const Reg *k = func->constants.data();
+#define DISPATCH() goto *labels[static_cast<std::size_t>(ip->op)]
+#define NEXT() do { ++ip; DISPATCH(); } while(false)
+#define A r[ip->a]
+#define B r[ip->b]
+#define C r[ip->c]
+        DISPATCH();
+    op_move: A = B; NEXT();
+    op_load: A = k[ip->b]; NEXT();
+    op_add_int: A.i = wrap(static_cast<std::uint64_t>(B.i) + static_cast<std::uint64_t>(C.i)); NEXT();
+    op_sub_int: A.i = wrap(static_cast<std::uint64_t>(B.i) - static_cast<std::uint64_t>(C.i)); NEXT();
+    op_mul_int: A.i = wrap(static_cast<std::uint64_t>(B.i) * static_cast<std::uint64_t>(C.i)); NEXT();
+    op_rem_int:
+        if(C.i == 0) throw error::make<error::DivisionByZero>();
+        A.i = C.i == -1 ? 0 : B.i % C.i;
+        NEXT();
+    op_neg_int: A.i = wrap(-static_cast<std::uint64_t>(B.i)); NEXT();
+    op_bit_not_int: A.i = ~B.i; NEXT();
+    op_bit_and_int: A.i = B.i & C.i; NEXT();
+    op_bit_or_int: A.i = B.i | C.i; NEXT();
+    op_bit_xor_int: A.i = B.i ^ C.i; NEXT();
+    op_left_shift_int: A.i = wrap(static_cast<std::uint64_t>(B.i) << (C.i & 63)); NEXT();
+    op_right_shift_int: A.i = B.i >> (C.i & 63); NEXT();
+    op_add_float: A.f = B.f + C.f; NEXT();
+    op_sub_float: A.f = B.f - C.f; NEXT();
+    op_mul_float: A.f = B.f * C.f; NEXT();
+    op_div_float: A.f = B.f / C.f; NEXT();
+    op_rem_float: A.f = std::fmod(B.f, C.f); NEXT();
+    op_neg_float: A.f = -B.f; NEXT();
+    op_recip_float: A.f = 1.0 / B.f; NEXT();
+    op_equal_int: A.b = B.i == C.i; NEXT();
+    op_not_equal_int: A.b = B.i != C.i; NEXT();
+    op_less_int: A.b = B.i < C.i; NEXT();
+    op_less_equal_int: A.b = B.i <= C.i; NEXT();
+    op_equal_float: A.b = B.f == C.f; NEXT();
+    op_not_equal_float: A.b = B.f != C.f; NEXT();
+    op_less_float: A.b = B.f < C.f; NEXT();
+    op_less_equal_float: A.b = B.f <= C.f; NEXT();
+    op_equal_bool: A.b = B.b == C.b; NEXT();
+    op_not_equal_bool: A.b = B.b != C.b; NEXT();
+    op_not_bool: A.b = !B.b; NEXT();
+    op_and_bool: A.b = B.b && C.b; NEXT();
+    op_or_bool: A.b = B.b || C.b; NEXT();
+    op_int_to_float: A.f = static_cast<double>(B.i); NEXT();
+    op_sin: A.f = std::sin(B.f); NEXT();
+    op_cos: A.f = std::cos(B.f); NEXT();
+    op_tan: A.f = std::tan(B.f); NEXT();
+    op_exp: A.f = std::exp(B.f); NEXT();
+    op_log: A.f = std::log(B.f); NEXT();
+    op_sqrt: A.f = std::sqrt(B.f); NEXT();
+    op_floor: A.f = std::floor(B.f); NEXT();
+    op_abs: A.f = std::fabs(B.f); NEXT();
+    op_load_sound: A.i = keep(func->sounds[ip->b]); NEXT();
+    op_apply: A.i = apply(func->applies[ip->b], r + ip->c); NEXT();
+    op_jump: ip = func->code.data() + ip->b; DISPATCH();
+    op_jump_if:
+        if(A.b) ip = func->code.data() + ip->b;
+        else ++ip;
+        DISPATCH();
+    op_jump_unless:
+        if(!A.b) ip = func->code.data() + ip->b;
+        else ++ip;
+        DISPATCH();
+    op_call: {
+        auto &callee = *functions[ip->b];
+        auto base = r + ip->c;
+        if(end - base < callee.registers || frames.size() >= max_frames) throw error::make<error::StackOverflow>();
+        frames.push_back({func, ip, r});
+        func = &callee;
+        r = base;
+        ip = callee.code.data();
+        k = callee.constants.data();
+        DISPATCH();
+    }
+    op_ret: {
+        auto value = A;
+        if(frames.empty()) return value;
+        auto frame = frames.back();
+        frames.pop_back();
+        func = frame.func;
+        ip = frame.ip;
+        r = frame.regs;
+        k = func->constants.data();
+        A = value;
+        NEXT();
+    }
+    op_ret_void:
+        return Reg{};
+#undef DISPATCH
+#undef NEXT
+#undef A
+#undef B
+#undef C
+    }
+}
+
+#ifdef DEBUG
+#include <iostream>
+namespace vm {
+    void Machine::debug_print() const {
+        for(std::size_t i = 0; i < functions.size(); i++){
+            if(!functions[i]) continue;
+            auto &func = *functions[i];
+            std::cout << "function " << i << " " << func.name << " (params " << func.params << ", registers " << func.registers << ")" << std::endl;
+            for(std::size_t k = 0; k < func.constants.size(); k++){
+                std::cout << "  k" << k << " = " << func.constants[k].i << std::endl;
+            }
+            for(std::size_t pc = 0; pc < func.code.size(); pc++){
+                auto &instr = func.code[pc];
+                std::cout << "  " << pc << ": " << name(instr.op) << " " << instr.a << " " << instr.b << " " << instr.c << std::endl;
+            }
+        }
+    }
+}
+#endif
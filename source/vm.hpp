@@ -0,0 +1,186 @@
+/**
+ * @file vm.hpp
+ * @brief IR をレジスタ型のバイトコードに変換して実行する．
+ */
+#ifndef VM_HPP
+#define VM_HPP
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+#include "type.hpp"
+
+/**
+ * @brief IR をレジスタ型のバイトコードに変換して実行する．
+ *
+ * 値は `Reg` に型の区別なく（ボックス化せずに）置き，型ごとの命令で読み書きする．
+ * 扱えるのは bool，int，float の値と音で，文字列や rational の変数を使う関数は変換しない．
+ * 音はレジスタに `Machine` の持つ音の番号として置き，`ir::Lift` の呼び出しで `ir::App` を組み立てる．
+ */
+namespace vm {
+    /**
+     * @brief レジスタ（どの型として読むかは命令が決める）
+     */
+    union Reg {
+        //! int の値，または音の番号
+        std::int64_t i;
+        double f;
+        bool b;
+    };
+
+    /**
+     * @brief 命令の種類
+     *
+     * `a` は書き込み先，`b` と `c` は読み出すレジスタ．int の算術は 2 の補数で折り返す．
+     */
+    enum class Opcode : std::uint16_t {
+        //! `a = b`
+        Move,
+        //! `a = constants[b]`
+        Load,
+        AddInt,
+        SubInt,
+        MulInt,
+        //! 0 で割ると `error::DivisionByZero`
+        RemInt,
+        NegInt,
+        BitNotInt,
+        BitAndInt,
+        BitOrInt,
+        BitXorInt,
+        //! シフト量は下位 6 bit だけを使う
+        LeftShiftInt,
+        RightShiftInt,
+        AddFloat,
+        SubFloat,
+        MulFloat,
+        DivFloat,
+        RemFloat,
+        NegFloat,
+        RecipFloat,
+        EqualInt,
+        NotEqualInt,
+        LessInt,
+        LessEqualInt,
+        EqualFloat,
+        NotEqualFloat,
+        LessFloat,
+        LessEqualFloat,
+        EqualBool,
+        NotEqualBool,
+        NotBool,
+        AndBool,
+        OrBool,
+        IntToFloat,
+        Sin,
+        Cos,
+        Tan,
+        Exp,
+        Log,
+        Sqrt,
+        Floor,
+        Abs,
+        //! `a` に関数の音の定数 `b` を置く
+        LoadSound,
+        //! 関数の `Apply` の `b` 番目で，レジスタ `c` からの引数の音を作って `a` に置く
+        Apply,
+        //! 命令 `b` へ飛ぶ
+        Jump,
+        //! `a` が真なら命令 `b` へ飛ぶ
+        JumpIf,
+        //! `a` が偽なら命令 `b` へ飛ぶ
+        JumpUnless,
+        //! 関数 `b` を，レジスタ `c` からの引数で呼び出して `a` に書く（`c` が呼び出し先のレジスタ 0 になる）
+        Call,
+        //! `a` を返す
+        Ret,
+        //! 値を返さずに終わる
+        RetVoid,
+    };
+    const char *name(Opcode);
+
+    /**
+     * @brief 命令（8 byte）
+     */
+    struct Instr {
+        Opcode op;
+        std::uint16_t a, b, c;
+    };
+
+    /**
+     * @brief 音を作る命令（`Opcode::Apply`）の引数の扱い
+     */
+    struct Apply {
+        struct Arg {
+            //! 定数の引数なら，それを包んだ音
+            std::shared_ptr<ir::Sound> constant;
+            //! レジスタの値を包む `ir::Const` の型（音の引数なら `type::no_type`）
+            type::TypeId sound;
+            //! レジスタの値の型
+            type::TypeId value;
+        };
+        //! 各時刻の値に適用する関数
+        std::shared_ptr<ir::Func> func;
+        //! 作る音の型
+        type::TypeId type;
+        std::vector<Arg> args;
+    };
+
+    /**
+     * @brief バイトコードに変換した関数
+     *
+     * レジスタ 0 から順に引数，IR のスロット，一時的な値が並ぶ．
+     */
+    struct Function {
+        std::string name;
+        std::vector<Instr> code;
+        std::vector<Reg> constants;
+        std::vector<std::shared_ptr<ir::Sound>> sounds;
+        std::vector<Apply> applies;
+        std::uint16_t params;
+        std::uint16_t registers;
+        //! 呼び出す関数
+        std::vector<std::size_t> callees;
+    };
+
+    /**
+     * @brief バイトコードの解釈器
+     *
+     * 関数は `ir::Module::defs` と同じ添字で，`main` はその次に置く．
+     * 呼び出しはネイティブのスタックを使わず，固定長のレジスタのスタックに窓をずらして積む．
+     */
+    class Machine {
+        struct Frame {
+            const Function *func;
+            const Instr *ip;
+            Reg *regs;
+        };
+        //! 変換できなかった関数は `std::nullopt`
+        std::vector<std::optional<Function>> functions;
+        std::vector<Reg> stack;
+        std::vector<Frame> frames;
+        //! 実行中に作った音（レジスタは添字を持つ）
+        std::vector<std::shared_ptr<ir::Sound>> sounds;
+        std::int64_t keep(std::shared_ptr<ir::Sound>);
+        std::int64_t apply(const Apply &, const Reg *);
+    public:
+        Machine(type::TypeContext &, const ir::Module &);
+        std::size_t size() const;
+        std::size_t main_index() const;
+        bool compiled(std::size_t) const;
+        const Function &get(std::size_t) const;
+        Reg call(std::size_t, std::span<const Reg>);
+        std::span<const Reg> registers(std::size_t) const;
+        const std::shared_ptr<ir::Sound> &sound(Reg) const;
+#ifdef DEBUG
+        void debug_print() const;
+#endif
+    };
+}
+
+#endif
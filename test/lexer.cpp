@@ -0,0 +1,129 @@
+/**
+ * @file lexer.cpp
+ * @brief `lexer::IncrementalLexer` の結果を，全体を字句解析し直した結果と比べる．
+ *
+ * 使い方: `test/lexer [回数] [シード]`
+ * 行をランダムに置き換え，挿入し，削除するたびに，`Lexer(const IncrementalLexer &)` から得たトークン列
+ * （種類と範囲）とエラーが，同じ内容の一時ファイルを `Lexer` で読んだ結果と一致することを確かめる．
+ * 複数行にわたるコメントや文字列リテラルを開く行，閉じる行も編集に混ぜる．
+ */
+#include "../source/error.hpp"
+#include "../source/input.hpp"
+#include "../source/lexer.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+    /**
+     * @brief 字句解析の結果（トークンの列と，エラーがあればその説明）
+     */
+    struct Result {
+        std::vector<token::Token> tokens;
+        std::string error;
+    };
+
+    Result run(lexer::Lexer &lexer, const pos::Source &source){
+        Result ret;
+        try {
+            for(;;){
+                auto token = lexer.next();
+                ret.tokens.push_back(token);
+                if(token.kind == token::Kind::End) break;
+            }
+        }catch(std::unique_ptr<error::Error> &error){
+            std::ostringstream out;
+            auto saved = std::cerr.rdbuf(out.rdbuf());
+            error->eprint(source);
+            std::cerr.rdbuf(saved);
+            ret.error = out.str();
+        }
+        return ret;
+    }
+
+    /**
+     * @brief 行の列を改行で繋いで一時ファイルに書き，全体を字句解析する．
+     */
+    Result full(const std::vector<std::string> &lines){
+        char path[] = "/tmp/cryss-test-lexer-XXXXXX";
+        int fd = mkstemp(path);
+        if(fd < 0){
+            std::perror("mkstemp");
+            std::exit(EXIT_FAILURE);
+        }
+        close(fd);
+        {
+            std::ofstream file(path);
+            for(std::size_t i = 0; i < lines.size(); i++) file << (i ? "\n" : "") << lines[i];
+        }
+        Result ret;
+        {
+            input::MappedFile source(path);
+            lexer::Lexer lexer(source);
+            ret = run(lexer, source);
+        }
+        std::remove(path);
+        return ret;
+    }
+
+    bool same(const token::Token &a, const token::Token &b){
+        if(a.kind != b.kind || a.start != b.start || a.end != b.end) return false;
+        return a.kind != token::Kind::Identifier || a.payload == b.payload;
+    }
+
+    std::string line(std::mt19937 &random){
+        static const char *const pieces[] = {
+            "x = 1;", "y += 2.5e0;", "def f(a: int): int = a * 2;", "while(i < 3){ i++; }",
+            "/*", "*/", "/* a */", "/* /*", "\"", "\"abc\"", "s = \"", "\";", "// /*", "if(p) q = -1; else q = 0;",
+            "z = [1, 2, 3];", "w = 1x;", "@", "   ", "",
+        };
+        std::string ret;
+        auto count = random() % 4;
+        for(std::size_t i = 0; i < count; i++){
+            if(i) ret += ' ';
+            ret += pieces[random() % std::size(pieces)];
+        }
+        return ret;
+    }
+}
+
+int main(int argc, char **argv){
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+    std::mt19937 random(argc > 2 ? static_cast<std::mt19937::result_type>(std::atoi(argv[2])) : 1);
+    lexer::IncrementalLexer incremental;
+    std::vector<std::string> lines;
+    int failed = 0;
+    for(int round = 0; round < rounds; round++){
+        auto first = random() % (lines.size() + 1);
+        auto last = first + random() % (std::min<std::size_t>(lines.size() - first, 3) + 1);
+        std::vector<std::string> replacement(random() % 4);
+        for(auto &text : replacement) text = line(random);
+        if(lines.size() > 40) replacement.clear();
+        incremental.edit(first, last, replacement);
+        lines.erase(lines.begin() + static_cast<std::ptrdiff_t>(first), lines.begin() + static_cast<std::ptrdiff_t>(last));
+        lines.insert(lines.begin() + static_cast<std::ptrdiff_t>(first), replacement.begin(), replacement.end());
+
+        lexer::Lexer lexer(incremental);
+        auto got = run(lexer, incremental);
+        // 空のファイルは空の行が 1 つあるものとして読むので，行がない場合は比べられない
+        auto expected = lines.empty() ? Result{{token::Token{token::Kind::End, 0, 0, 0}}, ""} : full(lines);
+        bool ok = got.error == expected.error && got.tokens.size() == expected.tokens.size();
+        for(std::size_t i = 0; ok && i < got.tokens.size(); i++) ok = same(got.tokens[i], expected.tokens[i]);
+        if(!ok){
+            std::cout << "FAIL round " << round << " (edit " << first << "-" << last << ")" << std::endl;
+            for(auto &text : lines) std::cout << "  | " << text << std::endl;
+            if(++failed >= 5) break;
+        }
+    }
+    if(failed > 0) return EXIT_FAILURE;
+    std::cout << "ok   incremental lexer (" << rounds << " edits)" << std::endl;
+}
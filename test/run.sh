@@ -0,0 +1,93 @@
+#!/bin/sh
+# 回帰テスト
+#
+# 使い方: test/run.sh [cryss]
+# test/*.cryss と，下で生成するファイルを cryss に渡し，出力（標準出力と標準エラー出力）を確かめる．
+# ファイルの先頭の行には次の指定を書ける．
+#   // args: 引数     cryss に渡す引数（@tmp@ は作業用のディレクトリ）
+#   // expect: 文字列 出力に文字列が含まれる
+#   // reject: 文字列 出力に文字列が含まれない
+#   // stdin          ファイルを引数ではなく標準入力から渡す
+# シグナルで終了したら（`std::bad_alloc` や範囲外の読み出しなど）失敗とする．
+
+cryss=${1:-./cryss}
+dir=$(dirname "$0")
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+failed=0
+
+check(){
+    file=$1
+    args=$(sed -n 's/^\/\/ args: //p' "$file" | sed "s|@tmp@|$tmp|g")
+    if grep -q '^// stdin$' "$file"; then
+        # shellcheck disable=SC2086
+        "$cryss" $args < "$file" > "$tmp/out" 2>&1
+    else
+        # shellcheck disable=SC2086
+        "$cryss" $args "$file" > "$tmp/out" 2>&1
+    fi
+    status=$?
+    ok=1
+    if [ $status -ge 128 ]; then
+        echo "FAIL $file: killed by signal $((status - 128))"
+        ok=0
+    fi
+    sed -n 's/^\/\/ expect: //p' "$file" > "$tmp/expect"
+    while IFS= read -r text; do
+        if ! grep -qF -- "$text" "$tmp/out"; then
+            echo "FAIL $file: missing \`$text\`"
+            ok=0
+        fi
+    done < "$tmp/expect"
+    sed -n 's/^\/\/ reject: //p' "$file" > "$tmp/reject"
+    while IFS= read -r text; do
+        if grep -qF -- "$text" "$tmp/out"; then
+            echo "FAIL $file: unexpected \`$text\`"
+            ok=0
+        fi
+    done < "$tmp/reject"
+    if [ $ok = 1 ]; then
+        echo "ok   $file"
+    else
+        failed=$((failed + 1))
+        head -c 2000 "$tmp/out"
+    fi
+}
+
+# 最後の 1 バイトが `/` で改行のないファイル（大きさをページの倍数にし，マッピングの外を読むと落ちるようにする）
+{
+    printf '// expect: found EOF\nx = 1;'
+    head -c $((4096 - 28)) /dev/zero | tr '\0' ' '
+    printf '/'
+} > "$tmp/slash-at-eof.cryss"
+
+# 左結合の二項演算を平らに並べた長い式（入れ子ではないので検査でき，実行もできる）
+{
+    printf '// args: --emit-obj=@tmp@/long-flat-chain.o\n// reject: nested too deeply\ni = 1;\nx = 1'
+    i=0
+    while [ $i -lt 20000 ]; do
+        printf ' + i'
+        i=$((i + 1))
+    done
+    printf ';\ny = 0.5e0'
+    i=0
+    while [ $i -lt 20000 ]; do
+        printf ' * 1.0e0 - 0.25e0'
+        i=$((i + 1))
+    done
+    printf ';\np = i < 2'
+    i=0
+    while [ $i -lt 20000 ]; do
+        printf ' && (i += 1) > 0'
+        i=$((i + 1))
+    done
+    printf ';\n'
+} > "$tmp/long-flat-chain.cryss"
+
+for file in "$dir"/*.cryss "$tmp"/*.cryss; do
+    [ -f "$file" ] && check "$file"
+done
+if [ $failed -gt 0 ]; then
+    echo "$failed failed"
+    exit 1
+fi